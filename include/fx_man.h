@@ -50,6 +50,39 @@ enum FX_ERRORS
    FX_MultiVocError,
    };
 
+enum FX_INTERPOLATIONS
+   {
+   FX_InterpNearest,
+   FX_InterpLinear,
+   FX_InterpCubic,
+   FX_InterpAuto
+   };
+
+enum FX_FILTERS
+   {
+   FX_FilterNone,
+   FX_FilterLowPass,
+   FX_FilterHighPass
+   };
+
+enum FX_ATTENUATIONS
+   {
+   FX_AttenuateNone,
+   FX_AttenuateInverse,
+   FX_AttenuateLinear,
+   FX_AttenuateExponential
+   };
+
+enum FX_LOADFLAGS
+   {
+   FX_LoadConvert  = 1,
+   FX_LoadResample = 2
+   };
+
+#define FX_NUM_BUSES 4
+#define FX_NUM_GROUPS 8
+#define FX_NUM_CURVES 4
+
 #define FX_MUSIC_PRIORITY	0x7fffffffl
 
 
@@ -66,10 +99,31 @@ void  FX_SetReverseStereo( int setting );
 int   FX_GetReverseStereo( void );
 void  FX_SetReverb( int reverb );
 void  FX_SetFastReverb( int reverb );
+int   FX_SetRoomReverb( int level, int roomsize, int damping );
+void  FX_SetInternalMixRate( int rate );
+int   FX_SetLimiter( int lookahead, int release, int threshold, int ratio );
 int   FX_GetMaxReverbDelay( void );
 int   FX_GetReverbDelay( void );
 void  FX_SetReverbDelay( int delay );
 
+// With a coalescing window set, a trigger of a sound already started
+// within the window at the same pitch joins that voice and returns its
+// handle, so stopping or changing either handle affects both.  The
+// joined trigger's callback is still called when the voice finishes.
+void  FX_SetCoalesceWindow( int window );
+int   FX_GetCoalesceWindow( void );
+
+void  FX_SetStreamThreads( int threads );
+int   FX_GetStreamThreads( void );
+int   FX_GetStreamStarvation( void );
+int   FX_SetSoundLimit( char *ptr, int maxvoices, int interval, int steal );
+void  FX_ClearSoundLimits( void );
+int   FX_SetMaxVoices( int voices );
+int   FX_GetMaxVoices( void );
+int   FX_SetInterpolation( int mode );
+int   FX_GetInterpolation( void );
+void  FX_SetInterpolationBudget( int taps );
+
 int FX_VoiceAvailable( int priority );
 int FX_EndLooping( int handle );
 int FX_SetPan( int handle, int vol, int left, int right );
@@ -102,6 +156,26 @@ int FX_PlayLoopedAuto( char *ptr, unsigned int ptrlength, int loopstart, int loo
 int FX_PlayAuto3D( char *ptr, unsigned int ptrlength, int pitchoffset, int angle, int distance,
                   int priority, unsigned int callbackval );
 
+int FX_PlayFile( const char *filename, int pitchoffset, int vol, int left, int right,
+                int priority, unsigned int callbackval );
+int FX_PlayLoopedFile( const char *filename, int loopstart, int loopend,
+                      int pitchoffset, int vol, int left, int right, int priority,
+                      unsigned int callbackval );
+int FX_PlayFile3D( const char *filename, int pitchoffset, int angle, int distance,
+                  int priority, unsigned int callbackval );
+
+int FX_LoadSound( char *ptr, unsigned int ptrlength, int flags );
+int FX_LoadBank( char *ptr, unsigned int ptrlength, int *ids, int maxids );
+int FX_UnloadSound( int id );
+void FX_UnloadAllSounds( void );
+int FX_GetSoundInfo( int id, unsigned int *rate, int *channels, unsigned int *frames );
+int FX_PlaySound( int id, int pitchoffset, int vol, int left, int right,
+       int priority, unsigned int callbackval );
+int FX_PlayLoopedSound( int id, int loopstart, int loopend, int pitchoffset,
+       int vol, int left, int right, int priority, unsigned int callbackval );
+int FX_PlaySound3D( int id, int pitchoffset, int angle, int distance,
+       int priority, unsigned int callbackval );
+
 int FX_PlayRaw( char *ptr, unsigned int length, unsigned rate,
        int pitchoffset, int vol, int left, int right, int priority,
        unsigned int callbackval );
@@ -109,6 +183,21 @@ int FX_PlayLoopedRaw( char *ptr, unsigned int length, char *loopstart,
        char *loopend, unsigned rate, int pitchoffset, int vol, int left,
        int right, int priority, unsigned int callbackval );
 int FX_Pan3D( int handle, int angle, int distance );
+int FX_SetFilter( int handle, int type, int cutoff, int q );
+int FX_SetSend( int handle, int bus, int level );
+int FX_SetBusReturn( int bus, int level );
+int FX_SetBusReverb( int bus, int roomsize, int damping );
+int FX_SetBusFilter( int bus, int type, int cutoff, int q );
+int FX_SetBusImpulse( int bus, char *ptr, unsigned int ptrlength );
+int FX_SetGroup( int handle, int group );
+int FX_SetDucking( int group, int keygroup, int level, int threshold, int attack, int release );
+void FX_SetListener( const float *position, const float *velocity, const float *forward, const float *up );
+int FX_SetAttenuation( int curve, int model, float refdistance, float maxdistance, float rolloff );
+void FX_SetDoppler( float factor, float speedofsound );
+int FX_SetEmitterCurve( int handle, int curve );
+int FX_SetEmitters( int count, const int *handles, const float *positions, const float *velocities );
+int FX_SetHRTF( char *ptr, unsigned int length, int directions );
+void FX_SetHRTFVoices( int voices );
 int FX_SoundActive( int handle );
 int FX_SoundsPlaying( void );
 int FX_StopSound( int handle );
@@ -117,6 +206,10 @@ int FX_StopAllSounds( void );
 int FX_StartDemandFeedPlayback( void ( *function )( char **ptr, unsigned int *length ),
        int rate, int pitchoffset, int vol, int left, int right,
        int priority, unsigned int callbackval );
+int FX_StartQueuedPlayback( int rate, int bits, int channels, int pitchoffset,
+       int vol, int left, int right, int priority, unsigned int callbackval );
+int FX_QueueBuffer( int handle, char *ptr, unsigned int length );
+int FX_UnqueueProcessed( int handle, char **buffers, int maxbuffers );
 int  FX_StartRecording( int MixRate, void ( *function )( char *ptr, int length ) );
 void FX_StopRecord( void );
 
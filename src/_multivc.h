@@ -31,6 +31,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef ___MULTIVC_H
 #define ___MULTIVC_H
 
+#include "multivoc.h"
+
 #define TRUE  ( 1 == 1 )
 #define FALSE ( !TRUE )
 
@@ -50,6 +52,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define T_STEREOSOURCE 8
 #define T_LEFTQUIET    16
 #define T_RIGHTQUIET   32
+#define T_LAWSOURCE    64
 #define T_DEFAULT      T_SIXTEENBIT_STEREO
 
 #define MV_MaxPanPosition  31
@@ -90,13 +93,64 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define PI                3.1415926536
 
+#define MV_MaxQueuedBuffers 32
+
+#define MV_MaxMergedCallbacks 8
+
+#define MV_SoundLimitTableSize 256
+
+#define MV_NumFilterLanes 8
+
+#define MV_FDNLines 8
+
+#define MV_NumBuses 4
+
+#define MV_NumGroups 8
+
+#define MV_ConvFFTSize ( MixBufferSize * 2 )
+#define MV_ConvBins    ( MixBufferSize + 1 )
+#define MV_MaxImpulseSeconds 3
+
+#define MV_MaxLookahead    1024
+#define MV_LimiterRing     2048
+#define MV_LimiterHeadroom 2
+
+#define MV_ResampleTaps    48
+#define MV_MaxResampleTaps 128
+#define MV_ResamplePhases  256
+
+#define MV_MaxOutputChannels 8
+
+#define MV_NumCurves 4
+
+#define MV_MaxHRTFVoices     64
+#define MV_DefaultHRTFVoices 16
+
+// batched emitter updates hash up to half as many handles as slots
+#define MV_EmitterHashBits 11
+#define MV_EmitterBatch    ( 1 << ( MV_EmitterHashBits - 1 ) )
+
+// samples of packed VOC data decoded, or silence played, at a time
+#define MV_VOCWindow 512
+
+#define MV_MaxDecoders 16
+
+#define MV_MaxStreamThreads     8
+#define MV_DefaultStreamThreads 2
+#define MV_StreamPollTime       10
+
+#define MV_NumInterpolators 3
+#define MV_DefaultInterpolationBudget 64
+
 typedef enum
    {
    Raw,
    VOC,
    DemandFeed,
    WAV,
-	Vorbis
+   BufferQueue,
+   ADPCM,
+   Decoder
    } wavedata;
 
 typedef enum
@@ -106,6 +160,197 @@ typedef enum
    } playbackstatus;
 
 
+typedef struct
+   {
+   int   type;
+   float b0;
+   float b1;
+   float b2;
+   float a1;
+   float a2;
+   float z1[ 2 ];
+   float z2[ 2 ];
+   } voicefilter;
+
+// Biquad coefficients and state laid out by lane for batch processing
+typedef struct
+   {
+   float b0[ MV_NumFilterLanes ];
+   float b1[ MV_NumFilterLanes ];
+   float b2[ MV_NumFilterLanes ];
+   float a1[ MV_NumFilterLanes ];
+   float a2[ MV_NumFilterLanes ];
+   float z1[ MV_NumFilterLanes ];
+   float z2[ MV_NumFilterLanes ];
+   } filterbatch;
+
+typedef struct
+   {
+   float *line[ MV_FDNLines ];
+   int    maxlength[ MV_FDNLines ];
+   int    length[ MV_FDNLines ];
+   int    pos[ MV_FDNLines ];
+   float  gain[ MV_FDNLines ];
+   float  lowpass[ MV_FDNLines ];
+   float  damping;
+   int    rate;
+   } fdnreverb;
+
+typedef struct
+   {
+   int    size;
+   int   *bitrev;
+   float *twre;
+   float *twim;
+   } fftplan;
+
+typedef struct
+   {
+   fftplan *plan;
+   int    channels;
+   int    partitions;
+   float *irre;
+   float *irim;
+   float *fdlre;
+   float *fdlim;
+   int    fdlpos;
+   float  history[ MV_ConvFFTSize ];
+   float  workre[ MV_ConvFFTSize ];
+   float  workim[ MV_ConvFFTSize ];
+   float  accre[ 2 ][ MV_ConvBins ];
+   float  accim[ 2 ][ MV_ConvBins ];
+   } convolver;
+
+typedef struct
+   {
+   float        delay[ ( MV_MaxLookahead + MixBufferSize ) * MV_MaxOutputChannels ];
+   float        window[ MV_MaxLookahead ];
+   float        minval[ MV_LimiterRing ];
+   unsigned int minframe[ MV_LimiterRing ];
+   unsigned int head;
+   unsigned int tail;
+   unsigned int frame;
+   int          winpos;
+   double       sum;
+   float        envelope;
+   float        release;
+   float        ceiling;
+   float        threshold;
+   float        slope;
+   int          lookahead;
+   int          channels;
+   } limiter;
+
+// Horizontal-plane HRIR spectra and the voices queued through them
+typedef struct
+   {
+   fftplan *plan;
+   int      directions;
+   float   *specre;
+   float   *specim;
+   unsigned int frame;
+   int      handles[ MV_MaxHRTFVoices ];
+   unsigned int stamps[ MV_MaxHRTFVoices ];
+   float    history[ MV_MaxHRTFVoices ][ MixBufferSize ];
+   int      queued;
+   float    window[ MV_MaxHRTFVoices ][ MV_ConvFFTSize ];
+   float    position[ MV_MaxHRTFVoices ];
+   float    gain[ MV_MaxHRTFVoices ];
+   float    workre[ MV_ConvFFTSize ];
+   float    workim[ MV_ConvFFTSize ];
+   float    accre[ 2 ][ MV_ConvBins ];
+   float    accim[ 2 ][ MV_ConvBins ];
+   } hrtfset;
+
+typedef struct
+   {
+   float        left[ MixBufferSize ];
+   float        right[ MixBufferSize ];
+   fdnreverb   *reverb;
+   convolver   *convolver;
+   voicefilter  filter;
+   int          level;
+   int          active;
+   } sendbus;
+
+typedef struct
+   {
+   int     channels;
+   int     taps;
+   float  *coefs;
+   float  *input[ MV_MaxOutputChannels ];
+   int     fill;
+   int     capacity;
+   double  step;
+   double  position;
+   } resampler;
+
+// Ducks one voice group by the level of another
+typedef struct
+   {
+   int   key;
+   float level;
+   float threshold;
+   float attack;
+   float release;
+   float envelope;
+   } ducker;
+
+typedef struct
+   {
+   int   model;
+   float refdistance;
+   float maxdistance;
+   float rolloff;
+   } attenuation;
+
+typedef struct
+   {
+   float position[ 3 ];
+   float velocity[ 3 ];
+   float forward[ 3 ];
+   float right[ 3 ];
+   } listener;
+
+// Float position of a voice placed in the 3D scene
+typedef struct
+   {
+   int   active;
+   int   curve;
+   float position[ 3 ];
+   float velocity[ 3 ];
+   float azimuth;
+   float level;
+   float gains[ MV_MaxOutputChannels ];
+   } emitter;
+
+// Incremental state of a VOC voice with packed or silence blocks
+typedef struct
+   {
+   unsigned char *data;
+   unsigned int   bytes;
+   unsigned int   silence;
+   int            packtype;
+   int            haveref;
+   int            reference;
+   int            scale;
+   unsigned char  window[ MV_VOCWindow ];
+   } vocdecoder;
+
+typedef void ( *MV_MixFunc )( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+typedef struct
+   {
+   char         *key;
+   int           maxvoices;
+   int           steal;
+   unsigned int  interval;
+   unsigned int  lasttrigger;
+   int           triggered;
+   int           active;
+   } soundlimit;
+
 typedef struct VoiceNode
    {
    struct VoiceNode *next;
@@ -114,6 +359,7 @@ typedef struct VoiceNode
    wavedata      wavetype;
    char          bits;
 	char          channels;
+   const short  *Expand;
 
    playbackstatus ( *GetSound )( struct VoiceNode *voice );
 
@@ -149,6 +395,34 @@ typedef struct VoiceNode
 
    unsigned int  callbackval;
 
+   // callback values of the triggers coalesced into this voice
+   unsigned int  MergedCallbacks[ MV_MaxMergedCallbacks ];
+   int           NumMerged;
+
+   char         *Origin;
+   unsigned int  StartTime;
+   int           Volume;
+   int           LeftLevel;
+   int           RightLevel;
+
+   soundlimit   *Limit;
+
+   const MV_MixFunc *Kernels;
+   int           Interpolation;
+
+   voicefilter   Filter;
+
+   unsigned char Send[ MV_NumBuses ];
+   int           Sends;
+
+   int           Group;
+
+   int           Angle;
+   emitter       Emitter;
+
+   int           Sound;
+   void         *File;
+
    } VoiceNode;
 
 typedef struct
@@ -213,6 +487,11 @@ typedef struct
    unsigned int  size;
    } data_header;
 
+#define WAVE_FORMAT_PCM       0x0001
+#define WAVE_FORMAT_ALAW      0x0006
+#define WAVE_FORMAT_MULAW     0x0007
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+
 typedef MONO8  VOLUME8[ 256 ];
 typedef MONO16 VOLUME16[ 256 ];
 
@@ -221,19 +500,99 @@ extern int MV_ErrorCode;
 extern int MV_Installed;
 extern int MV_MaxVolume;
 extern int MV_MixRate;
+extern int MV_StreamWorkers;
+extern volatile int MV_StreamStarvation;
 typedef char HARSH_CLIP_TABLE_8[ MV_NumVoices * 256 ];
 
 #define MV_SetErrorCode( status ) \
    MV_ErrorCode   = ( status );
 
-void MV_PlayVoice( VoiceNode *voice );
+// Flags and pointers handed between the calling thread, the mixer and
+// the stream workers.  Whatever a thread wrote before a store is seen
+// by the thread that loads the stored value.
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MV_LoadAcquire( x ) \
+   _InterlockedOr( ( volatile long * )&( x ), 0 )
+#define MV_StoreRelease( x, v ) \
+   _InterlockedExchange( ( volatile long * )&( x ), ( long )( v ) )
+#define MV_LoadAcquirePtr( x ) \
+   _InterlockedCompareExchangePointer( ( void * volatile * )&( x ), NULL, NULL )
+#define MV_StoreReleasePtr( x, v ) \
+   _InterlockedExchangePointer( ( void * volatile * )&( x ), ( void * )( v ) )
+#else
+#define MV_LoadAcquire( x )        __atomic_load_n( &( x ), __ATOMIC_ACQUIRE )
+#define MV_StoreRelease( x, v )    __atomic_store_n( &( x ), ( v ), __ATOMIC_RELEASE )
+#define MV_LoadAcquirePtr( x )     MV_LoadAcquire( x )
+#define MV_StoreReleasePtr( x, v ) MV_StoreRelease( x, v )
+#endif
+
+// How a voice starts: the angle the 3D functions put it at, or -1 to
+// pan it by level, and the loaded sound or mapped file it plays
+typedef struct
+   {
+   int   angle;
+   int   sound;
+   void *file;
+   } voicestart;
+
+int  MV_PlayVoice( VoiceNode *voice );
 
 VoiceNode *MV_AllocVoice( int priority );
 
 void MV_SetVoiceMixMode( VoiceNode *voice );
 void MV_SetVoiceVolume ( VoiceNode *voice, int vol, int left, int right );
-
-void MV_ReleaseVorbisVoice( VoiceNode * voice );
+void MV_SetVoiceAngle( VoiceNode *voice, int vol, int left, int right, int angle );
+void MV_TagVoice( VoiceNode *voice, const voicestart *start );
+void MV_TagHandle( int handle, const voicestart *start );
+int  MV_StartAngle( const voicestart *start );
+
+int  MV_ParseWAV( char *ptr, unsigned int ptrlength, format_header *format,
+   char **sampledata, unsigned int *samplelength );
+int  MV_PlayParsedWAV( char *ptr, const format_header *format, char *dataptr,
+   unsigned int datalength, int loopstart, int loopend, int pitchoffset,
+   int vol, int left, int right, int priority, unsigned int callbackval,
+   const voicestart *start );
+int  MV_StartRaw( char *ptr, unsigned int length, char *loopstart, char *loopend,
+   unsigned rate, int pitchoffset, int vol, int left, int right, int priority,
+   unsigned int callbackval, const voicestart *start );
+int  MV_StartWAV( char *ptr, unsigned int ptrlength, int loopstart, int loopend,
+   int pitchoffset, int vol, int left, int right, int priority,
+   unsigned int callbackval, const voicestart *start );
+int  MV_StartVOC( char *ptr, unsigned int ptrlength, int loopstart, int loopend,
+   int pitchoffset, int vol, int left, int right, int priority,
+   unsigned int callbackval, const voicestart *start );
+void MV_KillSoundVoices( int sound );
+int  MV_CountQueueStates( void );
+
+// implemented in adpcm.c
+int  MV_PlayLoopedADPCM( char *ptr, const format_header *format, char *data,
+   unsigned int datalength, int loopstart, int loopend, int pitchoffset,
+   int vol, int left, int right, int priority, unsigned int callbackval,
+   const voicestart *start );
+void MV_ReleaseADPCMVoice( VoiceNode * voice );
+int  MV_CreativeADPCMRatio( int packtype );
+int  MV_DecodeCreativeADPCM( int packtype, const unsigned char *in, int bytes,
+   unsigned char *out, int *reference, int *scale );
+
+// implemented in decoder.c
+int  MV_StartDecoder( const MV_Decoder *decoder, char *ptr, unsigned int length,
+   int loopstart, int loopend, int pitchoffset, int vol, int left, int right,
+   int priority, unsigned int callbackval, const voicestart *start );
+void MV_ReleaseDecoderVoice( VoiceNode * voice );
+void MV_EndDecoderLooping( VoiceNode * voice );
+void MV_FreeDecoderStates( void );
+void MV_ServiceDecoderStreams( int worker );
+
+// implemented in file.c
+void MV_ReleaseFileVoice( VoiceNode * voice );
+void MV_ReleaseFile( void *file );
+void MV_PrefaultFile( void *file );
+void MV_CloseFiles( void );
+
+// implemented in stream.c
+int  MV_StartStreamThreads( void );
+void MV_StopStreamThreads( void );
 
 // implemented in mix.c
 void ClearBuffer_DW( void *ptr, unsigned data, int length );
@@ -297,4 +656,137 @@ void MV_Mix8BitStereo16Stereo( unsigned int position,
 void MV_Mix16BitStereo16Stereo( unsigned int position,
 								  unsigned int rate, char *start, unsigned int length );
 
+// implemented in filter.c
+void MV_CalcFilter( voicefilter *filter, int type, int cutoff, int q, int rate );
+void MV_FilterLanes( float *data, int count, filterbatch *batch );
+void MV_FilterBlock( voicefilter *filter, float *data, int count, int channel );
+
+// implemented in reverb.c
+fdnreverb *MV_CreateFDN( int rate );
+void MV_DestroyFDN( fdnreverb *fdn );
+void MV_SetFDNParams( fdnreverb *fdn, int roomsize, int damping );
+void MV_ProcessFDN( fdnreverb *fdn, const float *input, float *left, float *right, int count );
+
+// implemented in fft.c
+fftplan *MV_CreateFFT( int size );
+void MV_DestroyFFT( fftplan *plan );
+void MV_FFT( fftplan *plan, float *re, float *im, int inverse );
+
+// implemented in convolve.c
+convolver *MV_CreateConvolver( const float *ir, int length, int channels );
+void MV_DestroyConvolver( convolver *conv );
+void MV_ProcessConvolver( convolver *conv, const float *input, float *left, float *right );
+
+// implemented in hrtf.c
+hrtfset *MV_CreateHRTF( const float *ir, int length, int directions );
+void MV_DestroyHRTF( hrtfset *hrtf );
+int  MV_QueueHRTF( hrtfset *hrtf, int handle, const float *input, float azimuth, float gain );
+void MV_RenderHRTF( hrtfset *hrtf, float *left, float *right );
+
+// implemented in limiter.c
+limiter *MV_CreateLimiter( int channels );
+void MV_DestroyLimiter( limiter *lim );
+void MV_SetLimiterParams( limiter *lim, int lookahead, int release, float threshold, float ratio );
+void MV_ProcessLimiter( limiter *lim, float *data );
+
+// implemented in resample.c
+resampler *MV_CreateResampler( int inrate, int outrate, int channels );
+void MV_DestroyResampler( resampler *rs );
+int  MV_ResamplerAvailable( resampler *rs );
+void MV_ResamplerPush( resampler *rs, const float *data, int frames );
+void MV_ResamplerPull( resampler *rs, float *data, int frames );
+
+// implemented in spatial.c
+void  MV_PanGains( double azimuth, int channels, float *gains );
+float MV_AttenuationGain( const attenuation *curve, float distance );
+float MV_UpdateEmitter( emitter *em, const listener *lis, const attenuation *curve,
+   float doppler, float speed, int channels, int mirror );
+
+// implemented in mixhq.c
+void MV_InitInterpolation( void );
+
+void MV_Mix16BitMonoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMonoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitMono16Linear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMono16Cubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereo16Linear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereo16Cubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitMono8StereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMono8StereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereo8StereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereo8StereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitMono16StereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMono16StereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereo16StereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereo16StereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitMonoLawLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMonoLawCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereoLawLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereoLawCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitMonoLawStereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMonoLawStereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix16BitStereoLawStereoLinear( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereoLawStereoCubic( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+// implemented in mixlaw.c
+extern short MV_ALawTable[ 256 ];
+extern short MV_MuLawTable[ 256 ];
+
+void MV_InitCompanding( void );
+
+void MV_Mix8BitMonoLaw( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix8BitStereoLaw( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMonoLaw( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereoLaw( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
+void MV_Mix8BitMonoLawStereo( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix8BitStereoLawStereo( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitMonoLawStereo( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+void MV_Mix16BitStereoLawStereo( unsigned int position, unsigned int rate,
+   char *start, unsigned int length );
+
 #endif
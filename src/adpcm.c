@@ -0,0 +1,432 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * IMA ADPCM WAV source support for MultiVoc
+ *
+ * The sound stays compressed in memory. Each voice decodes one block
+ * at a time into a window the size of a block as the mixer consumes
+ * it. Every block starts with the predictor state for each channel,
+ * so playback can restart at any block, and loops are rounded out to
+ * block boundaries.
+ *
+ * The Creative ADPCM packings found in VOC files are decoded here too,
+ * following the Sound Blaster hardware: each code adds a step from a
+ * table to an 8-bit reference sample and moves the step up or down.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pitch.h"
+#include "multivoc.h"
+#include "_multivc.h"
+
+typedef struct {
+   unsigned char * data;
+   unsigned int blocks;
+   unsigned int lastsize;
+   int blockalign;
+   int samplesperblock;
+   int channels;
+
+   unsigned int block;
+   unsigned int loopstart;
+   unsigned int loopend;
+
+   short * pcm;
+} adpcm_data;
+
+static const short stepsizes[89] = {
+   7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37,
+   41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173,
+   190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+   724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+   2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894,
+   6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289,
+   16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const signed char indexadjust[8] = {
+   -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Creative ADPCM: the code plus the scale picks the step and how the
+// scale moves; adjustments are modulo 256
+static const signed char ct4steps[64] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  0,  -1,  -2,  -3,  -4,  -5,  -6,  -7,
+   1,  3,  5,  7,  9, 11, 13, 15, -1,  -3,  -5,  -7,  -9, -11, -13, -15,
+   2,  6, 10, 14, 18, 22, 26, 30, -2,  -6, -10, -14, -18, -22, -26, -30,
+   4, 12, 20, 28, 36, 44, 52, 60, -4, -12, -20, -28, -36, -44, -52, -60
+};
+
+static const unsigned char ct4adjust[64] = {
+     0, 0, 0, 0, 0, 16, 16, 16,   0, 0, 0, 0, 0, 16, 16, 16,
+   240, 0, 0, 0, 0, 16, 16, 16, 240, 0, 0, 0, 0, 16, 16, 16,
+   240, 0, 0, 0, 0, 16, 16, 16, 240, 0, 0, 0, 0, 16, 16, 16,
+   240, 0, 0, 0, 0,  0,  0,  0, 240, 0, 0, 0, 0,  0,  0,  0
+};
+
+static const signed char ct3steps[40] = {
+   0,  1,  2,  3,  0,  -1,  -2,  -3,
+   1,  3,  5,  7, -1,  -3,  -5,  -7,
+   2,  6, 10, 14, -2,  -6, -10, -14,
+   4, 12, 20, 28, -4, -12, -20, -28,
+   5, 15, 25, 35, -5, -15, -25, -35
+};
+
+static const unsigned char ct3adjust[40] = {
+     0, 0, 0, 8,   0, 0, 0, 8,
+   248, 0, 0, 8, 248, 0, 0, 8,
+   248, 0, 0, 8, 248, 0, 0, 8,
+   248, 0, 0, 8, 248, 0, 0, 8,
+   248, 0, 0, 0, 248, 0, 0, 0
+};
+
+static const signed char ct2steps[24] = {
+   0,  1,  0,  -1,  1,  3,  -1,  -3,
+   2,  6, -2,  -6,  4, 12,  -4, -12,
+   8, 24, -8, -24, 16, 48, -16, -48
+};
+
+static const unsigned char ct2adjust[24] = {
+     0, 4,   0, 4, 252, 4, 252, 4, 252, 4, 252, 4,
+   252, 4, 252, 4, 252, 4, 252, 4, 252, 0, 252, 0
+};
+
+
+/*
+ Returns how many frames a block of size bytes holds. The channels'
+ nibbles are interleaved in words of four bytes, eight samples each,
+ after a four byte header per channel that holds the first sample.
+ */
+static int frames_in_block(int size, int channels)
+{
+   int words = (size - 4 * channels) / (4 * channels);
+
+   if (size < 4 * channels) {
+      return 0;
+   }
+   if (channels == 1) {
+      return (size - 4) * 2 + 1;
+   }
+   return words * 8 + 1;
+}
+
+
+/*
+ Decodes one block into the voice's window and returns its frame count.
+ */
+static int decode_block(adpcm_data * ad, const unsigned char * in, int size)
+{
+   int channels = ad->channels;
+   int frames = frames_in_block(size, channels);
+   int c, i;
+
+   for (c = 0; c < channels; c++) {
+      const unsigned char * header = in + c * 4;
+      const unsigned char * nibbles = in + channels * 4;
+      short * out = ad->pcm + c;
+      int predictor = (short) (header[0] | (header[1] << 8));
+      int index = header[2];
+
+      if (index > 88) {
+         index = 88;
+      }
+      out[0] = (short) predictor;
+
+      for (i = 1; i < frames; i++) {
+         int j = i - 1;
+         int byte = nibbles[((j >> 3) * channels + c) * 4 + ((j & 7) >> 1)];
+         int code = (j & 1) ? (byte >> 4) : (byte & 15);
+         int step = stepsizes[index];
+         int diff = step >> 3;
+
+         if (code & 1) diff += step >> 2;
+         if (code & 2) diff += step >> 1;
+         if (code & 4) diff += step;
+         predictor += (code & 8) ? -diff : diff;
+         if (predictor > 32767) {
+            predictor = 32767;
+         } else if (predictor < -32768) {
+            predictor = -32768;
+         }
+
+         index += indexadjust[code & 7];
+         if (index < 0) {
+            index = 0;
+         } else if (index > 88) {
+            index = 88;
+         }
+
+         out[i * channels] = (short) predictor;
+      }
+   }
+
+   return frames;
+}
+
+
+/*
+ Expands one Creative ADPCM code against the reference sample.
+ */
+static unsigned char expand_creative(int code, int * reference, int * scale,
+   const signed char * steps, const unsigned char * adjust, int entries)
+{
+   int index = code + *scale;
+   int sample;
+
+   if (index >= entries) {
+      index = entries - 1;
+   }
+
+   sample = *reference + steps[index];
+   *reference = sample < 0 ? 0 : sample > 255 ? 255 : sample;
+   *scale = (*scale + adjust[index]) & 255;
+
+   return (unsigned char) *reference;
+}
+
+
+/*
+ Returns how many samples one byte of a Creative ADPCM packing holds.
+ */
+int MV_CreativeADPCMRatio(int packtype)
+{
+   switch (packtype) {
+      case VOC_CT4_ADPCM: return 2;
+      case VOC_CT3_ADPCM: return 3;
+      case VOC_CT2_ADPCM: return 4;
+      default: return 0;
+   }
+}
+
+
+/*
+ Decodes bytes of Creative ADPCM data to unsigned 8-bit samples and
+ returns how many were written. reference and scale carry the decoder
+ state from one call to the next.
+ */
+int MV_DecodeCreativeADPCM(int packtype, const unsigned char * in, int bytes,
+   unsigned char * out, int * reference, int * scale)
+{
+   unsigned char * start = out;
+   int i;
+
+   for (i = 0; i < bytes; i++) {
+      int b = in[i];
+
+      switch (packtype) {
+         case VOC_CT4_ADPCM:
+            *out++ = expand_creative(b >> 4, reference, scale, ct4steps, ct4adjust, 64);
+            *out++ = expand_creative(b & 15, reference, scale, ct4steps, ct4adjust, 64);
+            break;
+         case VOC_CT3_ADPCM:
+            *out++ = expand_creative(b >> 5, reference, scale, ct3steps, ct3adjust, 40);
+            *out++ = expand_creative((b >> 2) & 7, reference, scale, ct3steps, ct3adjust, 40);
+            *out++ = expand_creative((b & 3) << 1, reference, scale, ct3steps, ct3adjust, 40);
+            break;
+         case VOC_CT2_ADPCM:
+            *out++ = expand_creative(b >> 6, reference, scale, ct2steps, ct2adjust, 24);
+            *out++ = expand_creative((b >> 4) & 3, reference, scale, ct2steps, ct2adjust, 24);
+            *out++ = expand_creative((b >> 2) & 3, reference, scale, ct2steps, ct2adjust, 24);
+            *out++ = expand_creative(b & 3, reference, scale, ct2steps, ct2adjust, 24);
+            break;
+         default:
+            return 0;
+      }
+   }
+
+   return (int)(out - start);
+}
+
+
+/*---------------------------------------------------------------------
+Function: MV_GetNextADPCMBlock
+
+Controls playback of IMA ADPCM data
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextADPCMBlock
+(
+ VoiceNode *voice
+ )
+
+{
+   adpcm_data * ad = (adpcm_data *) voice->extra;
+   unsigned int end;
+   int size, frames;
+
+   // MV_EndLooping clears LoopStart to let the sound run out
+   end = voice->LoopStart ? ad->loopend : ad->blocks;
+   if (ad->block >= end) {
+      if (voice->LoopStart == NULL) {
+         voice->Playing = FALSE;
+         return NoMoreData;
+      }
+      ad->block = ad->loopstart;
+   }
+
+   size = (ad->block == ad->blocks - 1) ? (int)ad->lastsize : ad->blockalign;
+   frames = decode_block(ad, ad->data + ad->block * ad->blockalign, size);
+   ad->block++;
+
+   voice->sound       = (char *) ad->pcm;
+   voice->position   -= voice->length;
+   voice->length      = (unsigned int)frames << 16;
+   voice->BlockLength = 0;
+
+   return( KeepPlaying );
+}
+
+
+/*---------------------------------------------------------------------
+Function: MV_PlayLoopedADPCM
+
+Begin playback of the IMA ADPCM data of a WAV file already parsed by
+MV_PlayLoopedWAV.  Loop points are in sample frames and are widened
+to whole blocks.
+---------------------------------------------------------------------*/
+
+int MV_PlayLoopedADPCM
+(
+ char *ptr,
+ const format_header *format,
+ char *data,
+ unsigned int datalength,
+ int   loopstart,
+ int   loopend,
+ int   pitchoffset,
+ int   vol,
+ int   left,
+ int   right,
+ int   priority,
+ unsigned int callbackval,
+ const voicestart *start
+ )
+
+{
+   VoiceNode    *voice;
+   adpcm_data   *ad;
+   unsigned int  blocks;
+   unsigned int  lastsize;
+   unsigned int  frames;
+   int           spb;
+
+   spb = frames_in_block(format->nBlockAlign, format->nChannels);
+   blocks = (datalength + format->nBlockAlign - 1) / format->nBlockAlign;
+   lastsize = datalength - (blocks - 1) * format->nBlockAlign;
+   if (blocks > 0 && frames_in_block(lastsize, format->nChannels) == 0) {
+      // too short to hold even the header
+      blocks--;
+      lastsize = format->nBlockAlign;
+   }
+   if (blocks == 0 || spb <= 0) {
+      MV_SetErrorCode( MV_InvalidWAVFile );
+      return MV_Error;
+   }
+   frames = (blocks - 1) * spb + frames_in_block(lastsize, format->nChannels);
+
+   ad = (adpcm_data *) malloc( sizeof(adpcm_data) + spb * format->nChannels * sizeof(short) );
+   if (!ad) {
+      MV_SetErrorCode( MV_NoMem );
+      return MV_Error;
+   }
+
+   memset(ad, 0, sizeof(adpcm_data));
+   ad->data = (unsigned char *) data;
+   ad->blocks = blocks;
+   ad->lastsize = lastsize;
+   ad->blockalign = format->nBlockAlign;
+   ad->samplesperblock = spb;
+   ad->channels = format->nChannels;
+   ad->pcm = (short *) (ad + 1);
+
+   ad->loopend = blocks;
+   if (loopend >= 0 && (unsigned int)loopend < frames) {
+      ad->loopend = (loopend + spb - 1) / spb;
+   }
+   ad->loopstart = (loopstart >= 0) ? (unsigned int)loopstart / spb : 0;
+   if (ad->loopend <= ad->loopstart) {
+      ad->loopend = ad->loopstart + 1;
+   }
+
+   // Request a voice from the voice pool
+   voice = MV_AllocVoice( priority );
+   if ( voice == NULL )
+   {
+      free(ad);
+      MV_SetErrorCode( MV_NoVoices );
+      return( MV_Error );
+   }
+   MV_TagVoice( voice, start );
+
+   voice->wavetype    = ADPCM;
+   voice->bits        = 16;
+   voice->channels    = format->nChannels;
+   voice->extra       = (void *) ad;
+   voice->GetSound    = MV_GetNextADPCMBlock;
+   voice->NextBlock   = data;
+   voice->DemandFeed  = NULL;
+   voice->LoopCount   = 0;
+   voice->BlockLength = 0;
+   voice->PitchScale  = PITCH_GetScale( pitchoffset );
+   voice->position    = 0;
+   voice->length      = 0;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = ptr;
+   voice->LoopStart   = NULL;
+   voice->LoopEnd     = NULL;
+   voice->LoopSize    = 0;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+
+   if (loopstart >= 0 && (unsigned int)loopstart < frames) {
+      voice->LoopStart = data + ad->loopstart * ad->blockalign;
+      voice->LoopEnd   = data + ad->loopend * ad->blockalign;
+      voice->LoopSize  = (ad->loopend - ad->loopstart) * spb;
+   }
+
+   voice->SamplingRate = format->nSamplesPerSec;
+   voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
+   voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+      voice->RateScale;
+   MV_SetVoiceMixMode( voice );
+
+   MV_SetVoiceAngle( voice, vol, left, right, MV_StartAngle( start ) );
+   return( MV_PlayVoice( voice ) );
+}
+
+
+/*
+ Frees the decoder state of an IMA ADPCM voice, or the Creative ADPCM
+ state of a VOC voice that has one.
+ */
+void MV_ReleaseADPCMVoice( VoiceNode * voice )
+{
+   if (voice->wavetype != ADPCM && voice->wavetype != VOC) {
+      return;
+   }
+
+   free(voice->extra);
+   voice->extra = 0;
+}
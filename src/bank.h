@@ -0,0 +1,66 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Packed sound bank layout, shared by MultiVoc and mkbank
+ *
+ * A bank is a header, an index with one entry per sound, and the
+ * sounds' samples, each starting on a BANK_ALIGN boundary from the
+ * start of the bank. All fields are little-endian. Samples are stored
+ * the way the mixer reads them: unsigned 8-bit or signed 16-bit PCM,
+ * A-law, mu-law or IMA ADPCM blocks. A sound with format
+ * BANK_FORMAT_STREAM holds a whole file for a registered decoder,
+ * such as Ogg Vorbis or FLAC.
+ */
+
+#ifndef __BANK_H
+#define __BANK_H
+
+#define BANK_MAGIC         "JFSB"
+#define BANK_VERSION       1
+#define BANK_ALIGN         16
+
+#define BANK_FORMAT_STREAM 0
+
+typedef struct
+   {
+   unsigned char  magic[ 4 ];
+   unsigned short version;
+   unsigned short count;
+   unsigned int   indexoffset;
+   unsigned int   length;
+   } bank_header;
+
+typedef struct
+   {
+   unsigned int   offset;
+   unsigned int   length;
+   unsigned int   rate;
+   unsigned int   frames;
+   int            loopstart;
+   int            loopend;
+   unsigned short format;          // a WAVE_FORMAT tag or BANK_FORMAT_STREAM
+   unsigned short blockalign;
+   unsigned char  channels;
+   unsigned char  bits;
+   unsigned char  reserved[ 2 ];
+   } bank_entry;
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Uniformly partitioned overlap-save convolution
+ *
+ * The impulse response is cut into MixBufferSize partitions whose
+ * spectra are computed once at load. Each buffer costs one forward and
+ * one inverse FFT of MV_ConvFFTSize points plus, for every partition,
+ * a complex multiply-add over the MV_ConvBins non-redundant bins per
+ * output channel. Both output channels share the inverse FFT by
+ * packing the right channel into the imaginary part. A 2 second
+ * response at 44.1kHz has 345 partitions, about 180000 complex
+ * multiply-adds per buffer, and the cost is fixed once loaded.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+
+/*
+ Builds a convolver from an impulse response of length frames of
+ interleaved float samples with one or two channels.
+ */
+convolver *MV_CreateConvolver(const float *ir, int length, int channels)
+{
+    convolver *conv;
+    float *re, *im;
+    int p, c, i, count;
+
+    conv = (convolver *) malloc(sizeof(convolver));
+    if (!conv) {
+        return NULL;
+    }
+    memset(conv, 0, sizeof(convolver));
+
+    conv->channels = channels;
+    conv->partitions = (length + MixBufferSize - 1) / MixBufferSize;
+    if (conv->partitions < 1) {
+        conv->partitions = 1;
+    }
+
+    conv->plan = MV_CreateFFT(MV_ConvFFTSize);
+    count = conv->partitions * MV_ConvBins;
+    conv->irre = (float *) calloc(count * channels, sizeof(float));
+    conv->irim = (float *) calloc(count * channels, sizeof(float));
+    conv->fdlre = (float *) calloc(count, sizeof(float));
+    conv->fdlim = (float *) calloc(count, sizeof(float));
+    if (!conv->plan || !conv->irre || !conv->irim || !conv->fdlre || !conv->fdlim) {
+        MV_DestroyConvolver(conv);
+        return NULL;
+    }
+
+    re = conv->workre;
+    im = conv->workim;
+    for (p = 0; p < conv->partitions; p++) {
+        for (c = 0; c < channels; c++) {
+            memset(re, 0, sizeof(conv->workre));
+            memset(im, 0, sizeof(conv->workim));
+            for (i = 0; i < MixBufferSize && p * MixBufferSize + i < length; i++) {
+                re[i] = ir[(p * MixBufferSize + i) * channels + c];
+            }
+
+            MV_FFT(conv->plan, re, im, 0);
+
+            memcpy(conv->irre + (p * channels + c) * MV_ConvBins, re, MV_ConvBins * sizeof(float));
+            memcpy(conv->irim + (p * channels + c) * MV_ConvBins, im, MV_ConvBins * sizeof(float));
+        }
+    }
+
+    return conv;
+}
+
+void MV_DestroyConvolver(convolver *conv)
+{
+    if (!conv) {
+        return;
+    }
+
+    MV_DestroyFFT(conv->plan);
+    free(conv->irre);
+    free(conv->irim);
+    free(conv->fdlre);
+    free(conv->fdlim);
+    free(conv);
+}
+
+/*
+ Convolves MixBufferSize frames of mono input and adds the result to
+ the left and right outputs.
+ */
+void MV_ProcessConvolver(convolver *conv, const float *input, float *left, float *right)
+{
+    float *re = conv->workre, *im = conv->workim;
+    float *yre[2], *yim[2];
+    const float *xre, *xim, *hre, *him;
+    float scale;
+    int p, c, k, slot;
+
+    // overlap-save: the previous block followed by the new one
+    memmove(conv->history, conv->history + MixBufferSize, MixBufferSize * sizeof(float));
+    memcpy(conv->history + MixBufferSize, input, MixBufferSize * sizeof(float));
+
+    memcpy(re, conv->history, sizeof(conv->history));
+    memset(im, 0, sizeof(conv->workim));
+    MV_FFT(conv->plan, re, im, 0);
+
+    conv->fdlpos = (conv->fdlpos + 1) % conv->partitions;
+    memcpy(conv->fdlre + conv->fdlpos * MV_ConvBins, re, MV_ConvBins * sizeof(float));
+    memcpy(conv->fdlim + conv->fdlpos * MV_ConvBins, im, MV_ConvBins * sizeof(float));
+
+    yre[0] = conv->accre[0]; yim[0] = conv->accim[0];
+    yre[1] = conv->accre[1]; yim[1] = conv->accim[1];
+    memset(conv->accre, 0, sizeof(conv->accre));
+    memset(conv->accim, 0, sizeof(conv->accim));
+
+    for (p = 0; p < conv->partitions; p++) {
+        slot = conv->fdlpos - p;
+        if (slot < 0) {
+            slot += conv->partitions;
+        }
+        xre = conv->fdlre + slot * MV_ConvBins;
+        xim = conv->fdlim + slot * MV_ConvBins;
+
+        for (c = 0; c < conv->channels; c++) {
+            float *ore = yre[c], *oim = yim[c];
+
+            hre = conv->irre + (p * conv->channels + c) * MV_ConvBins;
+            him = conv->irim + (p * conv->channels + c) * MV_ConvBins;
+            for (k = 0; k < MV_ConvBins; k++) {
+                ore[k] += xre[k] * hre[k] - xim[k] * him[k];
+                oim[k] += xre[k] * him[k] + xim[k] * hre[k];
+            }
+        }
+    }
+
+    if (conv->channels == 1) {
+        memcpy(yre[1], yre[0], MV_ConvBins * sizeof(float));
+        memcpy(yim[1], yim[0], MV_ConvBins * sizeof(float));
+    }
+
+    // pack left + j*right, filling the upper bins by conjugate symmetry
+    for (k = 0; k < MV_ConvBins; k++) {
+        re[k] = yre[0][k] - yim[1][k];
+        im[k] = yim[0][k] + yre[1][k];
+    }
+    for (k = MV_ConvBins; k < MV_ConvFFTSize; k++) {
+        int m = MV_ConvFFTSize - k;
+        re[k] = yre[0][m] + yim[1][m];
+        im[k] = yre[1][m] - yim[0][m];
+    }
+
+    MV_FFT(conv->plan, re, im, 1);
+
+    scale = 1.f / MV_ConvFFTSize;
+    for (k = 0; k < MixBufferSize; k++) {
+        left[k] += re[MixBufferSize + k] * scale;
+        right[k] += im[MixBufferSize + k] * scale;
+    }
+}
+
@@ -0,0 +1,1104 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Registry of the sound formats MultiVoc can play
+ *
+ * Formats are probed in table order, built-in ones first. VOC and WAV
+ * data is mixed in place by their own play functions. Streamed formats
+ * all play through one voice type here, which handles loop points and
+ * format changes for them.
+ *
+ * Each streamed decoder keeps a pool of per-voice state blocks. A block
+ * is claimed when a sound starts and handed back when its voice stops,
+ * so once a pool has grown to the peak number of voices, sounds start
+ * and stop without touching the heap, and the mixer never frees
+ * memory. Only the calling thread claims blocks and links new ones in;
+ * the mixer only clears a block's in-use flag. New blocks and decoders
+ * are published with a release store, as the workers walk the pools
+ * without a lock.
+ *
+ * Voices playing files are decoded ahead by the stream workers into
+ * two blocks of samples, one the mixer plays while a worker fills the
+ * other. Such a voice's block belongs to its worker from the moment
+ * the mixer lets it go, and the worker closes the decoder and frees
+ * the block when the voice stops. If the next block is not ready in
+ * time the voice is silent until it is, and the stall is counted. The
+ * flags that hand blocks and voices between threads are only read
+ * with acquire and written with release ordering, so the samples or
+ * state behind a flag are complete before the flag is seen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pitch.h"
+#include "multivoc.h"
+#include "_multivc.h"
+#include "assmisc.h"
+
+#ifdef HAVE_VORBIS
+extern const MV_Decoder MV_VorbisDecoder;
+#endif
+extern const MV_Decoder MV_FLACDecoder;
+extern const MV_Decoder MV_WAVStreamDecoder;
+
+// frames in each block a stream worker decodes ahead
+#define MV_StreamBlockFrames 16384
+
+typedef struct
+   {
+   char             *data;
+   int               frames;
+   MV_DecoderFormat  format;
+   int               ready;
+   } streamblock;
+
+typedef struct
+   {
+   streamblock       block[ 2 ];
+   int               play;
+   int               playing;
+   int               fill;
+   int               starved;
+   int               loop;
+   int               ended;
+   int               release;
+   void             *file;
+
+   // the format the decoder last reported
+   MV_DecoderFormat  format;
+
+   // decoded samples that did not fit in the last block
+   char             *pending;
+   int               pendingframes;
+   MV_DecoderFormat  pendingformat;
+   } streamdata;
+
+typedef struct decoderslot
+   {
+   struct decoderslot *next;
+   int                 inuse;
+   const MV_Decoder   *decoder;
+   MV_DecoderFormat    format;
+   unsigned int        frame;
+   unsigned int        loopstart;
+   unsigned int        loopend;
+   int                 async;
+   int                 worker;
+   streamdata         *stream;
+   } decoderslot;
+
+typedef struct
+   {
+   const MV_Decoder *decoder;
+   decoderslot      *pool;
+   } decoderentry;
+
+// decoder state follows the slot, aligned for any type
+#define SLOT_HEADER ( ( sizeof( decoderslot ) + 15 ) & ~( size_t )15 )
+
+static int probe_voc( const char *ptr, unsigned int length )
+{
+   // VOC and WAV data may be passed in with no length
+   return ( length == 0 || length >= 20 ) &&
+      !memcmp( "Creative Voice File\x1a", ptr, 20 );
+}
+
+static int probe_wav( const char *ptr, unsigned int length )
+{
+   return ( length == 0 || length >= 12 ) && !memcmp( "RIFF", ptr, 4 ) && !memcmp( "WAVE", ptr + 8, 4 );
+}
+
+static const MV_Decoder MV_VOCDecoder =
+   {
+   "VOC", probe_voc, MV_PlayLoopedVOC, 0, NULL, NULL, NULL, NULL
+   };
+
+static const MV_Decoder MV_WAVDecoder =
+   {
+   "WAV", probe_wav, MV_PlayLoopedWAV, 0, NULL, NULL, NULL, NULL
+   };
+
+static decoderentry MV_Decoders[ MV_MaxDecoders ] =
+   {
+      { &MV_VOCDecoder, NULL },
+      { &MV_WAVDecoder, NULL },
+#ifdef HAVE_VORBIS
+      { &MV_VorbisDecoder, NULL },
+#endif
+      { &MV_FLACDecoder, NULL },
+      { &MV_WAVStreamDecoder, NULL }
+   };
+
+static int MV_NextStreamWorker = 0;
+
+
+/*---------------------------------------------------------------------
+   Function: MV_RegisterDecoder
+
+   Adds a sound format to the end of the probing order.
+---------------------------------------------------------------------*/
+
+int MV_RegisterDecoder
+   (
+   const MV_Decoder *decoder
+   )
+
+   {
+   int i;
+
+   if ( ( decoder == NULL ) || ( decoder->probe == NULL ) ||
+      ( ( decoder->play == NULL ) &&
+        ( ( decoder->open == NULL ) || ( decoder->decode == NULL ) ) ) )
+      {
+      MV_SetErrorCode( MV_InvalidDecoder );
+      return( MV_Error );
+      }
+
+   for( i = 0; i < MV_MaxDecoders; i++ )
+      {
+      if ( MV_Decoders[ i ].decoder == decoder )
+         {
+         return( MV_Ok );
+         }
+      if ( MV_Decoders[ i ].decoder == NULL )
+         {
+         MV_Decoders[ i ].pool = NULL;
+         MV_StoreReleasePtr( MV_Decoders[ i ].decoder, decoder );
+         return( MV_Ok );
+         }
+      }
+
+   MV_SetErrorCode( MV_InvalidDecoder );
+   return( MV_Error );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FindDecoder
+
+   Returns the first decoder that recognises the sound data, or NULL.
+---------------------------------------------------------------------*/
+
+const MV_Decoder *MV_FindDecoder
+   (
+   const char *ptr,
+   unsigned int length
+   )
+
+   {
+   int i;
+
+   for( i = 0; ( i < MV_MaxDecoders ) && ( MV_Decoders[ i ].decoder != NULL ); i++ )
+      {
+      if ( MV_Decoders[ i ].decoder->probe( ptr, length ) )
+         {
+         return( MV_Decoders[ i ].decoder );
+         }
+      }
+
+   return( NULL );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ClaimDecoderSlot
+
+   Takes a free state block from a decoder's pool, growing the pool
+   if every block is in use.
+---------------------------------------------------------------------*/
+
+static decoderslot *MV_ClaimDecoderSlot
+   (
+   decoderentry *entry
+   )
+
+   {
+   decoderslot *slot;
+
+   for( slot = entry->pool; slot != NULL; slot = slot->next )
+      {
+      if ( !MV_LoadAcquire( slot->inuse ) )
+         {
+         break;
+         }
+      }
+
+   if ( slot == NULL )
+      {
+      slot = ( decoderslot * )malloc( SLOT_HEADER + entry->decoder->statesize );
+      if ( slot == NULL )
+         {
+         return( NULL );
+         }
+      slot->next   = entry->pool;
+      slot->inuse  = TRUE;
+      slot->async  = FALSE;
+      slot->stream = NULL;
+      MV_StoreReleasePtr( entry->pool, slot );
+      }
+
+   memset( ( char * )slot + SLOT_HEADER, 0, entry->decoder->statesize );
+   slot->decoder = entry->decoder;
+   MV_StoreRelease( slot->inuse, TRUE );
+
+   return( slot );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ReleaseDecoderVoice
+
+   Closes the decoder of a streamed voice and returns its state to
+   the pool.
+---------------------------------------------------------------------*/
+
+void MV_ReleaseDecoderVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   decoderslot *slot = ( decoderslot * )voice->extra;
+
+   if ( ( voice->wavetype != Decoder ) || ( slot == NULL ) )
+      {
+      return;
+      }
+
+   voice->extra = NULL;
+
+   // The worker may be decoding, so it closes the stream itself
+   if ( MV_LoadAcquire( slot->async ) )
+      {
+      MV_StoreRelease( slot->stream->release, TRUE );
+      return;
+      }
+
+   if ( slot->decoder->close != NULL )
+      {
+      slot->decoder->close( ( char * )slot + SLOT_HEADER );
+      }
+
+   MV_StoreRelease( slot->inuse, FALSE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_EndDecoderLooping
+
+   Lets the worker decoding ahead for a streamed voice play on past the
+   loop end.  Voices decoded by the mixer go by their LoopCount.
+---------------------------------------------------------------------*/
+
+void MV_EndDecoderLooping
+   (
+   VoiceNode *voice
+   )
+
+   {
+   decoderslot *slot = ( decoderslot * )voice->extra;
+
+   if ( ( voice->wavetype == Decoder ) && ( slot != NULL ) &&
+      MV_LoadAcquire( slot->async ) )
+      {
+      MV_StoreRelease( slot->stream->loop, FALSE );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_CloseStream
+
+   Closes the decoder of a stopped streamed voice and returns its
+   state and file.
+---------------------------------------------------------------------*/
+
+static void MV_CloseStream
+   (
+   decoderslot *slot
+   )
+
+   {
+   if ( slot->decoder->close != NULL )
+      {
+      slot->decoder->close( ( char * )slot + SLOT_HEADER );
+      }
+
+   MV_ReleaseFile( slot->stream->file );
+   slot->stream->file    = NULL;
+   slot->stream->release = FALSE;
+   MV_StoreRelease( slot->async, FALSE );
+   MV_StoreRelease( slot->inuse, FALSE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FreeDecoderStates
+
+   Frees every decoder's state pool.  No voices may be playing, and
+   the stream workers must be stopped.
+---------------------------------------------------------------------*/
+
+void MV_FreeDecoderStates
+   (
+   void
+   )
+
+   {
+   decoderslot *slot;
+   int i;
+
+   for( i = 0; i < MV_MaxDecoders; i++ )
+      {
+      while( MV_Decoders[ i ].pool != NULL )
+         {
+         slot = MV_Decoders[ i ].pool;
+         MV_Decoders[ i ].pool = slot->next;
+         if ( slot->async )
+            {
+            MV_CloseStream( slot );
+            }
+         if ( slot->stream != NULL )
+            {
+            free( slot->stream->block[ 0 ].data );
+            free( slot->stream );
+            }
+         free( slot );
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetDecoderFormat
+
+   Sets up a voice for the format of the samples its decoder produces.
+---------------------------------------------------------------------*/
+
+static void MV_SetDecoderFormat
+   (
+   VoiceNode *voice,
+   const MV_DecoderFormat *format
+   )
+
+   {
+   voice->bits         = format->bits;
+   voice->channels     = format->channels;
+   voice->SamplingRate = format->rate;
+   voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
+   voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+      voice->RateScale;
+   MV_SetVoiceMixMode( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_DecodeLoopedBlock
+
+   Decodes the next run of samples of a streamed voice, going back to
+   the loop start at the loop end or the end of the stream while loop
+   is set.  Returns how many sample frames the run holds, or zero at
+   the end.
+---------------------------------------------------------------------*/
+
+static int MV_DecodeLoopedBlock
+   (
+   decoderslot *slot,
+   char **block,
+   MV_DecoderFormat *format,
+   int loop
+   )
+
+   {
+   const MV_Decoder *decoder = slot->decoder;
+   void *state = ( char * )slot + SLOT_HEADER;
+   int   frames;
+   int   restarted = FALSE;
+
+   for( ;; )
+      {
+      frames = 0;
+      if ( ( slot->loopend == 0 ) || ( slot->frame < slot->loopend ) )
+         {
+         frames = decoder->decode( state, block, format );
+         }
+
+      if ( frames > 0 )
+         {
+         break;
+         }
+
+      if ( loop && !restarted &&
+         ( decoder->seek( state, slot->loopstart ) == MV_Ok ) )
+         {
+         slot->frame = slot->loopstart;
+         restarted   = TRUE;
+         continue;
+         }
+
+      return( 0 );
+      }
+
+   if ( ( slot->loopend > 0 ) && ( slot->frame + frames > slot->loopend ) )
+      {
+      frames = slot->loopend - slot->frame;
+      }
+   slot->frame += frames;
+
+   return( frames );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FillStreamBlock
+
+   Decodes ahead into a streamed voice's free block, if it has one.
+   A block holds samples of one format only, and a format the mixer
+   cannot play ends the stream.
+---------------------------------------------------------------------*/
+
+static void MV_FillStreamBlock
+   (
+   decoderslot *slot
+   )
+
+   {
+   streamdata       *stream = slot->stream;
+   streamblock      *next = &stream->block[ stream->fill ];
+   MV_DecoderFormat  format;
+   char             *run;
+   int               frames;
+   int               framesize;
+   int               count;
+   int               filled = 0;
+   int               atend = FALSE;
+
+   if ( MV_LoadAcquire( next->ready ) || stream->ended )
+      {
+      return;
+      }
+
+   for( ;; )
+      {
+      if ( stream->pendingframes > 0 )
+         {
+         run    = stream->pending;
+         frames = stream->pendingframes;
+         format = stream->pendingformat;
+         stream->pendingframes = 0;
+         }
+      else
+         {
+         frames = MV_DecodeLoopedBlock( slot, &run, &stream->format,
+            MV_LoadAcquire( stream->loop ) );
+         format = stream->format;
+         if ( frames <= 0 )
+            {
+            atend = TRUE;
+            break;
+            }
+
+         // Blocks only have room for 8 or 16-bit mono or stereo
+         if ( ( format.channels < 1 ) || ( format.channels > 2 ) ||
+            ( ( format.bits != 8 ) && ( format.bits != 16 ) ) || ( format.rate == 0 ) )
+            {
+            atend = TRUE;
+            break;
+            }
+         }
+
+      framesize = format.channels * format.bits / 8;
+      count     = 0;
+      if ( filled == 0 )
+         {
+         next->format = format;
+         count = min( frames, MV_StreamBlockFrames );
+         }
+      else if ( ( format.rate == next->format.rate ) &&
+         ( format.channels == next->format.channels ) &&
+         ( format.bits == next->format.bits ) )
+         {
+         count = min( frames, MV_StreamBlockFrames - filled );
+         }
+
+      memcpy( next->data + filled * framesize, run, count * framesize );
+      filled += count;
+
+      if ( count < frames )
+         {
+         // The rest starts the next block, and the decoder's buffer
+         // is good until it is next called
+         stream->pending       = run + count * framesize;
+         stream->pendingframes = frames - count;
+         stream->pendingformat = format;
+         break;
+         }
+
+      if ( filled == MV_StreamBlockFrames )
+         {
+         break;
+         }
+      }
+
+   if ( filled > 0 )
+      {
+      next->frames = filled;
+      MV_StoreRelease( next->ready, TRUE );
+      stream->fill ^= 1;
+      }
+
+   if ( atend )
+      {
+      MV_StoreRelease( stream->ended, TRUE );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ServiceDecoderStreams
+
+   Called by each stream worker to decode ahead for its voices and to
+   close the ones that have stopped.
+---------------------------------------------------------------------*/
+
+void MV_ServiceDecoderStreams
+   (
+   int worker
+   )
+
+   {
+   decoderslot *slot;
+   int i;
+
+   for( i = 0; ( i < MV_MaxDecoders ) &&
+      ( MV_LoadAcquirePtr( MV_Decoders[ i ].decoder ) != NULL ); i++ )
+      {
+      for( slot = MV_LoadAcquirePtr( MV_Decoders[ i ].pool ); slot != NULL;
+         slot = slot->next )
+         {
+         if ( !MV_LoadAcquire( slot->async ) ||
+            ( MV_LoadAcquire( slot->worker ) != worker ) )
+            {
+            continue;
+            }
+
+         if ( MV_LoadAcquire( slot->stream->release ) )
+            {
+            MV_CloseStream( slot );
+            continue;
+            }
+
+         MV_FillStreamBlock( slot );
+         MV_FillStreamBlock( slot );
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartStream
+
+   Sets up a voice's stream and decodes its first block, so that the
+   voice starts without waiting on a worker.  Voices that cannot get
+   the memory play without one.
+---------------------------------------------------------------------*/
+
+static void MV_StartStream
+   (
+   decoderslot *slot,
+   VoiceNode *voice
+   )
+
+   {
+   streamdata *stream = slot->stream;
+
+   if ( stream == NULL )
+      {
+      stream = ( streamdata * )malloc( sizeof( streamdata ) );
+      if ( stream == NULL )
+         {
+         return;
+         }
+      memset( stream, 0, sizeof( streamdata ) );
+
+      // room for two blocks of 16-bit stereo
+      stream->block[ 0 ].data = ( char * )malloc( 2 * MV_StreamBlockFrames * 4 );
+      if ( stream->block[ 0 ].data == NULL )
+         {
+         free( stream );
+         return;
+         }
+      stream->block[ 1 ].data = stream->block[ 0 ].data + MV_StreamBlockFrames * 4;
+      slot->stream = stream;
+      }
+
+   stream->block[ 0 ].ready = FALSE;
+   stream->block[ 1 ].ready = FALSE;
+   stream->play          = 0;
+   stream->playing       = -1;
+   stream->fill          = 0;
+   stream->starved       = FALSE;
+   stream->loop          = voice->LoopCount;
+   stream->ended         = FALSE;
+   stream->release       = FALSE;
+   stream->pendingframes = 0;
+   stream->format        = slot->format;
+
+   MV_FillStreamBlock( slot );
+
+   // The worker hands the file back once it has closed the decoder
+   stream->file = voice->File;
+   voice->File  = NULL;
+
+   MV_StoreRelease( slot->worker, MV_NextStreamWorker );
+   MV_NextStreamWorker = ( MV_NextStreamWorker + 1 ) % MV_StreamWorkers;
+   MV_StoreRelease( slot->async, TRUE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextDecoderBlock
+
+   Controls playback of streamed sound data
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextDecoderBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   decoderslot *slot = ( decoderslot * )voice->extra;
+   streamdata  *stream = slot->stream;
+   streamblock *next;
+   MV_DecoderFormat format = slot->format;
+   char *block = NULL;
+   int   frames;
+   int   ended;
+
+   voice->Playing = TRUE;
+
+   if ( MV_LoadAcquire( slot->async ) )
+      {
+      // The block just played goes back to the worker
+      if ( stream->playing >= 0 )
+         {
+         MV_StoreRelease( stream->block[ stream->playing ].ready, FALSE );
+         stream->playing = -1;
+         }
+
+      // Read before ready, as the worker sets them the other way round
+      ended = MV_LoadAcquire( stream->ended );
+      next  = &stream->block[ stream->play ];
+      if ( !MV_LoadAcquire( next->ready ) )
+         {
+         if ( ended )
+            {
+            voice->Playing = FALSE;
+            return( NoMoreData );
+            }
+
+         if ( !stream->starved )
+            {
+            stream->starved = TRUE;
+            MV_StreamStarvation++;
+            }
+         voice->position = 0;
+         voice->length   = 0;
+         return( NoMoreData );
+         }
+
+      stream->starved = FALSE;
+      stream->playing = stream->play;
+      stream->play   ^= 1;
+      block  = next->data;
+      frames = next->frames;
+      format = next->format;
+      }
+   else
+      {
+      frames = MV_DecodeLoopedBlock( slot, &block, &format,
+         voice->LoopCount );
+      if ( frames <= 0 )
+         {
+         voice->Playing = FALSE;
+         return( NoMoreData );
+         }
+      }
+
+   if ( ( format.rate != slot->format.rate ) ||
+      ( format.channels != slot->format.channels ) ||
+      ( format.bits != slot->format.bits ) )
+      {
+      if ( ( format.channels < 1 ) || ( format.channels > 2 ) ||
+         ( ( format.bits != 8 ) && ( format.bits != 16 ) ) || ( format.rate == 0 ) )
+         {
+         voice->Playing = FALSE;
+         return( NoMoreData );
+         }
+      slot->format = format;
+      MV_SetDecoderFormat( voice, &format );
+      }
+
+   voice->position    = 0;
+   voice->sound       = block;
+   voice->BlockLength = 0;
+   voice->length      = ( unsigned int )frames << 16;
+
+   return( KeepPlaying );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartDecoder
+
+   Begin playback of sound data in the decoder's format, placing the
+   voice as start describes.  In-place formats other than the built-in
+   VOC and WAV ones are only placed by their levels.
+---------------------------------------------------------------------*/
+
+int MV_StartDecoder
+   (
+   const MV_Decoder *decoder,
+   char *ptr,
+   unsigned int length,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   const voicestart *start
+   )
+
+   {
+   VoiceNode   *voice = NULL;
+   decoderslot *slot;
+   int          status;
+   int          i;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( decoder->play == MV_PlayLoopedVOC )
+      {
+      return( MV_StartVOC( ptr, length, loopstart, loopend, pitchoffset,
+         vol, left, right, priority, callbackval, start ) );
+      }
+   if ( decoder->play == MV_PlayLoopedWAV )
+      {
+      return( MV_StartWAV( ptr, length, loopstart, loopend, pitchoffset,
+         vol, left, right, priority, callbackval, start ) );
+      }
+   if ( decoder->play != NULL )
+      {
+      status = decoder->play( ptr, length, loopstart, loopend, pitchoffset,
+         vol, left, right, priority, callbackval );
+      if ( status > MV_Ok )
+         {
+         MV_TagHandle( status, start );
+         }
+      return( status );
+      }
+
+   for( i = 0; i < MV_MaxDecoders; i++ )
+      {
+      if ( MV_Decoders[ i ].decoder == decoder )
+         {
+         break;
+         }
+      }
+   if ( i == MV_MaxDecoders )
+      {
+      MV_SetErrorCode( MV_InvalidDecoder );
+      return( MV_Error );
+      }
+
+   slot = MV_ClaimDecoderSlot( &MV_Decoders[ i ] );
+   if ( slot == NULL )
+      {
+      MV_SetErrorCode( MV_NoMem );
+      return( MV_Error );
+      }
+
+   status = decoder->open( ( char * )slot + SLOT_HEADER, ptr, length, &slot->format );
+   if ( status != MV_Ok )
+      {
+      MV_StoreRelease( slot->inuse, FALSE );
+      MV_SetErrorCode( status );
+      return( MV_Error );
+      }
+
+   if ( ( slot->format.channels < 1 ) || ( slot->format.channels > 2 ) ||
+      ( ( slot->format.bits != 8 ) && ( slot->format.bits != 16 ) ) ||
+      ( slot->format.rate == 0 ) )
+      {
+      status = MV_InvalidDecoder;
+      }
+   else
+      {
+      // Request a voice from the voice pool
+      voice = MV_AllocVoice( priority );
+      if ( voice == NULL )
+         {
+         status = MV_NoVoices;
+         }
+      }
+
+   if ( status != MV_Ok )
+      {
+      if ( decoder->close != NULL )
+         {
+         decoder->close( ( char * )slot + SLOT_HEADER );
+         }
+      MV_StoreRelease( slot->inuse, FALSE );
+      MV_SetErrorCode( status );
+      return( MV_Error );
+      }
+   MV_TagVoice( voice, start );
+
+   slot->frame     = 0;
+   slot->loopstart = ( loopstart > 0 ) ? ( unsigned int )loopstart : 0;
+   slot->loopend   = ( ( loopstart >= 0 ) && ( loopend > loopstart ) ) ?
+      ( unsigned int )loopend : 0;
+
+   voice->wavetype    = Decoder;
+   voice->extra       = ( void * )slot;
+   voice->GetSound    = MV_GetNextDecoderBlock;
+   voice->NextBlock   = NULL;
+   voice->DemandFeed  = NULL;
+   voice->LoopCount   = ( ( loopstart >= 0 ) && ( decoder->seek != NULL ) ) ? TRUE : FALSE;
+   voice->BlockLength = 0;
+   voice->PitchScale  = PITCH_GetScale( pitchoffset );
+   voice->position    = 0;
+   voice->length      = 0;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = NULL;
+   voice->LoopStart   = NULL;
+   voice->LoopEnd     = NULL;
+   voice->LoopSize    = 0;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+
+   MV_SetDecoderFormat( voice, &slot->format );
+
+   // Files are read and decoded ahead by the stream workers, or read
+   // in whole now if the mixer has to decode them
+   if ( voice->File != NULL )
+      {
+      if ( MV_StreamWorkers > 0 )
+         {
+         MV_StartStream( slot, voice );
+         }
+      if ( !slot->async )
+         {
+         MV_PrefaultFile( voice->File );
+         }
+      }
+
+   MV_SetVoiceAngle( voice, vol, left, right, MV_StartAngle( start ) );
+   return( MV_PlayVoice( voice ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayLoopedDecoder
+
+   Begin playback of sound data in the decoder's format with the given
+   sound levels and priority.  For streamed formats, loopstart and
+   loopend are in sample frames, and a loopend at or before loopstart
+   loops from the end of the stream.
+---------------------------------------------------------------------*/
+
+int MV_PlayLoopedDecoder
+   (
+   const MV_Decoder *decoder,
+   char *ptr,
+   unsigned int length,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   return( MV_StartDecoder( decoder, ptr, length, loopstart, loopend,
+      pitchoffset, vol, left, right, priority, callbackval, NULL ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayDecoder3D
+
+   Begin playback of sound data in the decoder's format at specified
+   angle and distance from listener.
+---------------------------------------------------------------------*/
+
+int MV_PlayDecoder3D
+   (
+   const MV_Decoder *decoder,
+   char *ptr,
+   unsigned int length,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
+   )
+
+   {
+   int left;
+   int right;
+   int mid;
+   int volume;
+   voicestart start;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
+
+   volume = MIX_VOLUME( distance );
+
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
+
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
+
+   start.angle = angle;
+   start.sound = 0;
+   start.file  = NULL;
+   return( MV_StartDecoder( decoder, ptr, length, -1, -1, pitchoffset, mid,
+      left, right, priority, callbackval, &start ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayLoopedAuto
+
+   Begin looped playback of sound data, detecting its format.
+---------------------------------------------------------------------*/
+
+int MV_PlayLoopedAuto
+   (
+   char *ptr,
+   unsigned int length,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   const MV_Decoder *decoder;
+
+   decoder = MV_FindDecoder( ptr, length );
+   if ( decoder == NULL )
+      {
+      MV_SetErrorCode( MV_UnknownFormat );
+      return( MV_Error );
+      }
+
+   return( MV_PlayLoopedDecoder( decoder, ptr, length, loopstart, loopend,
+      pitchoffset, vol, left, right, priority, callbackval ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayAuto
+
+   Begin playback of sound data, detecting its format.
+---------------------------------------------------------------------*/
+
+int MV_PlayAuto
+   (
+   char *ptr,
+   unsigned int length,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   return( MV_PlayLoopedAuto( ptr, length, -1, -1, pitchoffset, vol, left, right,
+      priority, callbackval ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayAuto3D
+
+   Begin playback of sound data at specified angle and distance from
+   listener, detecting its format.
+---------------------------------------------------------------------*/
+
+int MV_PlayAuto3D
+   (
+   char *ptr,
+   unsigned int length,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
+   )
+
+   {
+   const MV_Decoder *decoder;
+
+   decoder = MV_FindDecoder( ptr, length );
+   if ( decoder == NULL )
+      {
+      MV_SetErrorCode( MV_UnknownFormat );
+      return( MV_Error );
+      }
+
+   return( MV_PlayDecoder3D( decoder, ptr, length, pitchoffset, angle, distance,
+      priority, callbackval ) );
+   }
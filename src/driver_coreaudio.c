@@ -434,6 +434,10 @@ int CoreAudioDrv_PCM_Init(int * mixrate, int * numchannels, int * samplebits, vo
     // set the requested pcm audio format
     pcmDesc.mFormatID = kAudioFormatLinearPCM;
     pcmDesc.mFormatFlags = kLinearPCMFormatFlagIsPacked;
+    // surround layouts are only negotiated through SDL
+    if (*numchannels > 2) {
+        *numchannels = 2;
+    }
     pcmDesc.mChannelsPerFrame = *numchannels;
     pcmDesc.mSampleRate = *mixrate;
     pcmDesc.mBitsPerChannel = *samplebits;
@@ -357,6 +357,10 @@ int DirectSoundDrv_PCM_Init(int * mixrate, int * numchannels, int * samplebits,
     
     memset(&wfex, 0, sizeof(WAVEFORMATEX));
     wfex.wFormatTag = WAVE_FORMAT_PCM;
+    // surround layouts are only negotiated through SDL
+    if (*numchannels > 2) {
+        *numchannels = 2;
+    }
     wfex.nChannels = *numchannels;
     wfex.nSamplesPerSec = *mixrate;
     wfex.wBitsPerSample = *samplebits;
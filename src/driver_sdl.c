@@ -254,7 +254,9 @@ int SDLDrv_PCM_Init(int * mixrate, int * numchannels, int * samplebits, void * i
         ErrorCode = SDLErr_OpenAudio;
         err = 1;
     }
-    if (actual.channels == 1 || actual.channels == 2) {
+    // 4, 6 and 8 channels are quad, 5.1 and 7.1 in SDL's speaker order
+    if (actual.channels == 1 || actual.channels == 2 || actual.channels == 4 ||
+            actual.channels == 6 || actual.channels == 8) {
         *numchannels = actual.channels;
     } else {
         ASS_Message("SDLDrv: audio channels: %d\n", actual.channels);
@@ -284,6 +284,10 @@ int XAudio2Drv_PCM_Init(int * mixrate, int * numchannels, int * samplebits, void
     }
 
     wfex.wFormatTag = WAVE_FORMAT_PCM;
+    // surround layouts are only negotiated through SDL
+    if (*numchannels > 2) {
+        *numchannels = 2;
+    }
     wfex.nChannels = *numchannels;
     wfex.nSamplesPerSec = *mixrate;
     wfex.wBitsPerSample = *samplebits;
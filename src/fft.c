@@ -0,0 +1,130 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Radix-2 complex FFT on split real and imaginary arrays
+ *
+ * Twiddles for each stage are stored contiguously so the butterfly loop
+ * runs over unit-stride arrays the compiler can vectorise.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+
+fftplan *MV_CreateFFT(int size)
+{
+    fftplan *plan;
+    int i, j, bits, half, offset;
+
+    for (bits = 0; (1 << bits) < size; bits++) ;
+    if ((1 << bits) != size || size < 2) {
+        return NULL;
+    }
+
+    plan = (fftplan *) malloc(sizeof(fftplan));
+    if (!plan) {
+        return NULL;
+    }
+    memset(plan, 0, sizeof(fftplan));
+
+    plan->size = size;
+    plan->bitrev = (int *) malloc(size * sizeof(int));
+    plan->twre = (float *) malloc(size * sizeof(float));
+    plan->twim = (float *) malloc(size * sizeof(float));
+    if (!plan->bitrev || !plan->twre || !plan->twim) {
+        MV_DestroyFFT(plan);
+        return NULL;
+    }
+
+    for (i = 0; i < size; i++) {
+        int r = 0;
+        for (j = 0; j < bits; j++) {
+            r |= ((i >> j) & 1) << (bits - 1 - j);
+        }
+        plan->bitrev[i] = r;
+    }
+
+    // stage with butterflies half apart keeps its twiddles at offset half-1
+    for (half = 1, offset = 0; half < size; half <<= 1) {
+        for (i = 0; i < half; i++) {
+            plan->twre[offset + i] = (float) cos(-PI * i / half);
+            plan->twim[offset + i] = (float) sin(-PI * i / half);
+        }
+        offset += half;
+    }
+
+    return plan;
+}
+
+void MV_DestroyFFT(fftplan *plan)
+{
+    if (!plan) {
+        return;
+    }
+
+    free(plan->bitrev);
+    free(plan->twre);
+    free(plan->twim);
+    free(plan);
+}
+
+/*
+ In-place transform. The inverse is unscaled.
+ */
+void MV_FFT(fftplan *plan, float *re, float *im, int inverse)
+{
+    const float *wre, *wim;
+    float tre, tim, sign;
+    int i, j, k, half, size = plan->size;
+
+    for (i = 0; i < size; i++) {
+        j = plan->bitrev[i];
+        if (j > i) {
+            tre = re[i]; re[i] = re[j]; re[j] = tre;
+            tim = im[i]; im[i] = im[j]; im[j] = tim;
+        }
+    }
+
+    sign = inverse ? -1.f : 1.f;
+    wre = plan->twre;
+    wim = plan->twim;
+    for (half = 1; half < size; half <<= 1) {
+        for (i = 0; i < size; i += half << 1) {
+            float *are = re + i, *aim = im + i;
+            float *bre = re + i + half, *bim = im + i + half;
+
+            for (k = 0; k < half; k++) {
+                float wr = wre[k], wi = sign * wim[k];
+
+                tre = bre[k] * wr - bim[k] * wi;
+                tim = bre[k] * wi + bim[k] * wr;
+                bre[k] = are[k] - tre;
+                bim[k] = aim[k] - tim;
+                are[k] += tre;
+                aim[k] += tim;
+            }
+        }
+        wre += half;
+        wim += half;
+    }
+}
+
@@ -0,0 +1,662 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Sounds played straight from files
+ *
+ * The file is mapped into memory rather than read, and plays through
+ * the same paths as sounds in memory. The mapping is marked for
+ * sequential access and the start of the file is asked for before
+ * the voice starts.
+ *
+ * While the stream workers run, files are decoded ahead by them, so
+ * the mixer never touches the mapping itself and only the pages the
+ * workers have reached are resident. PCM WAV files stream through a
+ * decoder of their own for this. Voices the mixer plays straight from
+ * the mapping, which are those of the formats mixed in place and any
+ * file while no workers run, have the whole file read in by the
+ * calling thread before they start, as the mixer must never wait on
+ * the disk.
+ *
+ * The mixer, or the stream worker, only clears a mapping's in-use flag
+ * when its voice stops, with a release store that the calling thread
+ * reads with acquire ordering, so no read of the mapping can still be
+ * pending when it is unmapped. Unused mappings are unmapped by the
+ * calling thread the next time a file is played, and at shutdown.
+ */
+
+#ifndef _WIN32
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <sys/types.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+#include "multivoc.h"
+#include "_multivc.h"
+#include "assmisc.h"
+
+// how much of a file to ask for before its voice starts
+#define MV_FilePrefetch 0x40000
+
+// step small enough to touch every page of a mapping
+#define MV_FilePageSize 0x1000
+
+// most frames the WAV stream decoder hands over at once
+#define MV_WAVStreamRun 4096
+
+typedef struct mappedfile
+   {
+   struct mappedfile *next;
+   int                inuse;
+   char              *ptr;
+   unsigned int       length;
+   } mappedfile;
+
+typedef struct
+   {
+   char             *data;
+   unsigned int      frames;
+   unsigned int      frame;
+   MV_DecoderFormat  format;
+   } wavstream;
+
+static mappedfile *MV_Files = NULL;
+
+
+/*---------------------------------------------------------------------
+   Function: WAVStream_Probe
+
+   The WAV stream decoder is only ever asked for by name.
+---------------------------------------------------------------------*/
+
+static int WAVStream_Probe
+   (
+   const char *ptr,
+   unsigned int length
+   )
+
+   {
+   ( void )ptr;
+   ( void )length;
+
+   return( FALSE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: WAVStream_Open
+
+   Finds the samples of an 8 or 16-bit PCM WAV file.
+---------------------------------------------------------------------*/
+
+static int WAVStream_Open
+   (
+   void *state,
+   char *ptr,
+   unsigned int length,
+   MV_DecoderFormat *format
+   )
+
+   {
+   wavstream     *ws = ( wavstream * )state;
+   format_header  header;
+   char          *data;
+   unsigned int   datalength;
+
+   if ( MV_ParseWAV( ptr, length, &header, &data, &datalength ) != MV_Ok )
+      {
+      return( MV_InvalidWAVFile );
+      }
+
+   if ( ( header.wFormatTag != WAVE_FORMAT_PCM ) ||
+      ( ( header.nBitsPerSample != 8 ) && ( header.nBitsPerSample != 16 ) ) )
+      {
+      return( MV_InvalidWAVFile );
+      }
+
+   ws->format.rate     = header.nSamplesPerSec;
+   ws->format.channels = header.nChannels;
+   ws->format.bits     = header.nBitsPerSample;
+   ws->data   = data;
+   ws->frames = datalength / ( header.nChannels * header.nBitsPerSample / 8 );
+   ws->frame  = 0;
+
+   *format = ws->format;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: WAVStream_Decode
+
+   Hands over the next run of samples in place.
+---------------------------------------------------------------------*/
+
+static int WAVStream_Decode
+   (
+   void *state,
+   char **block,
+   MV_DecoderFormat *format
+   )
+
+   {
+   wavstream    *ws = ( wavstream * )state;
+   unsigned int  frames;
+
+   frames = min( ws->frames - ws->frame, MV_WAVStreamRun );
+
+   *block  = ws->data + ws->frame * ( ws->format.channels * ws->format.bits / 8 );
+   *format = ws->format;
+   ws->frame += frames;
+
+   return( ( int )frames );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: WAVStream_Seek
+
+   Moves to the given sample frame.
+---------------------------------------------------------------------*/
+
+static int WAVStream_Seek
+   (
+   void *state,
+   unsigned int frame
+   )
+
+   {
+   wavstream *ws = ( wavstream * )state;
+
+   ws->frame = min( frame, ws->frames );
+
+   return( MV_Ok );
+   }
+
+
+const MV_Decoder MV_WAVStreamDecoder =
+   {
+   "WAV stream",
+   WAVStream_Probe,
+   NULL,
+   sizeof( wavstream ),
+   WAVStream_Open,
+   WAVStream_Decode,
+   WAVStream_Seek,
+   NULL
+   };
+
+
+/*---------------------------------------------------------------------
+   Function: MV_MapFile
+
+   Maps a whole file into memory for reading.
+---------------------------------------------------------------------*/
+
+static char *MV_MapFile
+   (
+   const char *filename,
+   unsigned int *length
+   )
+
+   {
+#ifdef _WIN32
+   HANDLE         file;
+   HANDLE         mapping;
+   LARGE_INTEGER  size;
+   char          *ptr = NULL;
+
+   file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if ( file == INVALID_HANDLE_VALUE )
+      {
+      return( NULL );
+      }
+
+   if ( GetFileSizeEx( file, &size ) && ( size.QuadPart > 0 ) &&
+      ( size.QuadPart <= 0xffffffff ) )
+      {
+      mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+      if ( mapping != NULL )
+         {
+         ptr = ( char * )MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+         CloseHandle( mapping );
+         }
+      *length = ( unsigned int )size.QuadPart;
+      }
+   CloseHandle( file );
+
+   return( ptr );
+#else
+   struct stat  st;
+   void        *ptr = MAP_FAILED;
+   int          fd;
+
+   fd = open( filename, O_RDONLY );
+   if ( fd < 0 )
+      {
+      return( NULL );
+      }
+
+   if ( ( fstat( fd, &st ) == 0 ) && ( st.st_size > 0 ) &&
+      ( ( unsigned long long )st.st_size <= 0xffffffff ) )
+      {
+      ptr = mmap( NULL, ( size_t )st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      *length = ( unsigned int )st.st_size;
+      }
+   close( fd );
+
+   if ( ptr == MAP_FAILED )
+      {
+      return( NULL );
+      }
+
+   posix_madvise( ptr, *length, POSIX_MADV_SEQUENTIAL );
+   posix_madvise( ptr, min( *length, MV_FilePrefetch ), POSIX_MADV_WILLNEED );
+
+   return( ( char * )ptr );
+#endif
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UnmapFile
+
+   Releases a file mapping.
+---------------------------------------------------------------------*/
+
+static void MV_UnmapFile
+   (
+   mappedfile *file
+   )
+
+   {
+#ifdef _WIN32
+   UnmapViewOfFile( file->ptr );
+#else
+   munmap( file->ptr, file->length );
+#endif
+   file->ptr = NULL;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PrefaultFile
+
+   Reads in every page of a file's mapping on the calling thread.
+---------------------------------------------------------------------*/
+
+void MV_PrefaultFile
+   (
+   void *file
+   )
+
+   {
+   mappedfile          *mapped = ( mappedfile * )file;
+   const volatile char *ptr = mapped->ptr;
+   unsigned int         pages = ( mapped->length - 1 ) / MV_FilePageSize;
+   unsigned int         i;
+
+#ifndef _WIN32
+   posix_madvise( mapped->ptr, mapped->length, POSIX_MADV_WILLNEED );
+#endif
+
+   for( i = 0; i <= pages; i++ )
+      {
+      ( void )ptr[ i * MV_FilePageSize ];
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_CollectFiles
+
+   Unmaps the files no voice is playing any more.
+---------------------------------------------------------------------*/
+
+static void MV_CollectFiles
+   (
+   void
+   )
+
+   {
+   mappedfile *file;
+
+   for( file = MV_Files; file != NULL; file = file->next )
+      {
+      if ( !MV_LoadAcquire( file->inuse ) && ( file->ptr != NULL ) )
+         {
+         MV_UnmapFile( file );
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_OpenFile
+
+   Maps a file into a free entry of the list, growing the list if
+   every entry is in use.
+---------------------------------------------------------------------*/
+
+static mappedfile *MV_OpenFile
+   (
+   const char *filename
+   )
+
+   {
+   mappedfile *file;
+
+   MV_CollectFiles();
+
+   for( file = MV_Files; file != NULL; file = file->next )
+      {
+      if ( !MV_LoadAcquire( file->inuse ) )
+         {
+         break;
+         }
+      }
+
+   if ( file == NULL )
+      {
+      file = ( mappedfile * )malloc( sizeof( mappedfile ) );
+      if ( file == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( NULL );
+         }
+      file->next  = MV_Files;
+      file->inuse = FALSE;
+      file->ptr   = NULL;
+      MV_Files    = file;
+      }
+
+   file->ptr = MV_MapFile( filename, &file->length );
+   if ( file->ptr == NULL )
+      {
+      MV_SetErrorCode( MV_FileError );
+      return( NULL );
+      }
+   MV_StoreRelease( file->inuse, TRUE );
+
+   return( file );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ReleaseFileVoice
+
+   Hands a stopped voice's file back for unmapping.
+---------------------------------------------------------------------*/
+
+void MV_ReleaseFileVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   MV_ReleaseFile( voice->File );
+   voice->File = NULL;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ReleaseFile
+
+   Hands a file back for unmapping.
+---------------------------------------------------------------------*/
+
+void MV_ReleaseFile
+   (
+   void *file
+   )
+
+   {
+   if ( file != NULL )
+      {
+      MV_StoreRelease( ( ( mappedfile * )file )->inuse, FALSE );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_CloseFiles
+
+   Unmaps every file and frees the list.  No voices may be playing.
+---------------------------------------------------------------------*/
+
+void MV_CloseFiles
+   (
+   void
+   )
+
+   {
+   mappedfile *file;
+
+   while( MV_Files != NULL )
+      {
+      file     = MV_Files;
+      MV_Files = file->next;
+      if ( file->ptr != NULL )
+         {
+         MV_UnmapFile( file );
+         }
+      free( file );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartFile
+
+   Begin playback of a sound file, detecting its format, handing the
+   mapping to the voice and placing it at angle, or by its levels if
+   angle is -1.
+---------------------------------------------------------------------*/
+
+static int MV_StartFile
+   (
+   const char *filename,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   int   angle
+   )
+
+   {
+   const MV_Decoder *decoder;
+   mappedfile *file;
+   voicestart  start;
+   int         status;
+   int         retry;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   file = MV_OpenFile( filename );
+   if ( file == NULL )
+      {
+      return( MV_Error );
+      }
+
+   start.angle = angle;
+   start.sound = 0;
+   start.file  = file;
+
+   status = MV_Error;
+   retry  = TRUE;
+   // PCM WAV streams through its own decoder, other WAV data as usual
+   if ( ( MV_StartStreamThreads() > 0 ) && ( file->length >= 12 ) &&
+      !memcmp( "RIFF", file->ptr, 4 ) && !memcmp( "WAVE", file->ptr + 8, 4 ) )
+      {
+      status = MV_StartDecoder( &MV_WAVStreamDecoder, file->ptr, file->length,
+         loopstart, loopend, pitchoffset, vol, left, right, priority, callbackval,
+         &start );
+
+      // Only a format it turned down is worth another try, not a lack
+      // of voices or memory
+      retry = ( status < MV_Ok ) && ( MV_ErrorCode == MV_InvalidWAVFile );
+      }
+   if ( retry )
+      {
+      decoder = MV_FindDecoder( file->ptr, file->length );
+      if ( decoder == NULL )
+         {
+         MV_SetErrorCode( MV_UnknownFormat );
+         }
+      else
+         {
+         // Formats mixed in place read the mapping from the mixer
+         if ( decoder->play != NULL )
+            {
+            MV_PrefaultFile( file );
+            }
+         status = MV_StartDecoder( decoder, file->ptr, file->length, loopstart,
+            loopend, pitchoffset, vol, left, right, priority, callbackval,
+            &start );
+         }
+      }
+
+   if ( status < MV_Ok )
+      {
+      MV_StoreRelease( file->inuse, FALSE );
+      MV_UnmapFile( file );
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayLoopedFile
+
+   Begin looped playback of a sound file, detecting its format.
+   loopstart and loopend are in sample frames.
+---------------------------------------------------------------------*/
+
+int MV_PlayLoopedFile
+   (
+   const char *filename,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   return( MV_StartFile( filename, loopstart, loopend, pitchoffset, vol, left,
+      right, priority, callbackval, -1 ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayFile
+
+   Begin playback of a sound file with the given sound levels and
+   priority.
+---------------------------------------------------------------------*/
+
+int MV_PlayFile
+   (
+   const char *filename,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   return( MV_PlayLoopedFile( filename, -1, -1, pitchoffset, vol, left, right,
+      priority, callbackval ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayFile3D
+
+   Begin playback of a sound file at specified angle and distance
+   from listener.
+---------------------------------------------------------------------*/
+
+int MV_PlayFile3D
+   (
+   const char *filename,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
+   )
+
+   {
+   int left;
+   int right;
+   int mid;
+   int volume;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
+
+   volume = MIX_VOLUME( distance );
+
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
+
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
+
+   return( MV_StartFile( filename, -1, -1, pitchoffset, mid, left, right,
+      priority, callbackval, angle ) );
+   }
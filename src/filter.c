@@ -0,0 +1,125 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Biquad filters for MultiVoc voices
+ */
+
+#include <math.h>
+#include <string.h>
+#include "multivoc.h"
+#include "_multivc.h"
+
+/*
+ Computes RBJ cookbook coefficients for a low- or high-pass biquad.
+ cutoff is in Hz and q is the filter Q in hundredths.
+ */
+void MV_CalcFilter(voicefilter *filter, int type, int cutoff, int q, int rate)
+{
+    double w0, cosw0, alpha, a0;
+    double fc, qf;
+
+    fc = cutoff;
+    if (fc < 10.0) fc = 10.0;
+    else if (fc > 0.45 * rate) fc = 0.45 * rate;
+
+    qf = q / 100.0;
+    if (qf < 0.1) qf = 0.1;
+
+    w0 = 2.0 * PI * fc / rate;
+    cosw0 = cos(w0);
+    alpha = sin(w0) / (2.0 * qf);
+    a0 = 1.0 + alpha;
+
+    if (type == MV_FilterHighPass) {
+        filter->b0 = (float) (((1.0 + cosw0) / 2.0) / a0);
+        filter->b1 = (float) (-(1.0 + cosw0) / a0);
+    } else {
+        filter->b0 = (float) (((1.0 - cosw0) / 2.0) / a0);
+        filter->b1 = (float) ((1.0 - cosw0) / a0);
+    }
+    filter->b2 = filter->b0;
+    filter->a1 = (float) ((-2.0 * cosw0) / a0);
+    filter->a2 = (float) ((1.0 - alpha) / a0);
+
+    filter->type = type;
+}
+
+/*
+ Runs a batch of biquads over count frames of MV_NumFilterLanes
+ interleaved lanes, in place. Each lane is one channel of one voice;
+ lanes with zero coefficients produce silence. Transposed direct
+ form II keeps two state values per lane.
+ */
+void MV_FilterLanes(float *data, int count, filterbatch *batch)
+{
+    float b0[MV_NumFilterLanes], b1[MV_NumFilterLanes], b2[MV_NumFilterLanes];
+    float a1[MV_NumFilterLanes], a2[MV_NumFilterLanes];
+    float z1[MV_NumFilterLanes], z2[MV_NumFilterLanes];
+    float x, y;
+    int lane;
+
+    // work on local copies so the lane loop can stay in registers
+    memcpy(b0, batch->b0, sizeof(b0));
+    memcpy(b1, batch->b1, sizeof(b1));
+    memcpy(b2, batch->b2, sizeof(b2));
+    memcpy(a1, batch->a1, sizeof(a1));
+    memcpy(a2, batch->a2, sizeof(a2));
+    memcpy(z1, batch->z1, sizeof(z1));
+    memcpy(z2, batch->z2, sizeof(z2));
+
+    while (count--) {
+        for (lane = 0; lane < MV_NumFilterLanes; lane++) {
+            x = data[lane];
+            y = b0[lane] * x + z1[lane];
+            z1[lane] = b1[lane] * x - a1[lane] * y + z2[lane];
+            z2[lane] = b2[lane] * x - a2[lane] * y;
+            data[lane] = y;
+        }
+        data += MV_NumFilterLanes;
+    }
+
+    // keep decaying state from going denormal
+    for (lane = 0; lane < MV_NumFilterLanes; lane++) {
+        batch->z1[lane] = fabsf(z1[lane]) < 1e-15f ? 0.f : z1[lane];
+        batch->z2[lane] = fabsf(z2[lane]) < 1e-15f ? 0.f : z2[lane];
+    }
+}
+
+/*
+ Runs one channel of a single biquad over count samples, in place.
+ */
+void MV_FilterBlock(voicefilter *filter, float *data, int count, int channel)
+{
+    float z1 = filter->z1[channel], z2 = filter->z2[channel];
+    float x, y;
+
+    while (count--) {
+        x = *data;
+        y = filter->b0 * x + z1;
+        z1 = filter->b1 * x - filter->a1 * y + z2;
+        z2 = filter->b2 * x - filter->a2 * y;
+        *data++ = y;
+    }
+
+    filter->z1[channel] = fabsf(z1) < 1e-15f ? 0.f : z1;
+    filter->z2[channel] = fabsf(z2) < 1e-15f ? 0.f : z2;
+}
+
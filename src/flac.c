@@ -0,0 +1,734 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * FLAC source support for MultiVoc
+ *
+ * A self-contained decoder for native FLAC streams of one or two
+ * channels and up to 24 bits. The file stays in memory and each voice
+ * decodes one frame at a time as the mixer consumes it. Frame and
+ * subframe CRCs are not checked; reads past the end of the data are
+ * caught and end playback instead.
+ *
+ * Seeks are sample accurate. Decoding restarts from the nearest seek
+ * table point at or before the target, and the frame holding the
+ * target is remembered the first time it plays so that repeated seeks
+ * to one place, such as a loop start, go straight to it. Streams with
+ * blocks no larger than the streamable subset allows decode into
+ * buffers inside the decoder state.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pitch.h"
+#include "multivoc.h"
+#include "_multivc.h"
+#include "assmisc.h"
+
+// largest block size the streamable subset allows
+#define FLAC_InlineBlock 4608
+
+typedef struct {
+   const unsigned char * data;
+   unsigned int length;
+   unsigned int pos;
+   uint64_t cache;
+   int bits;
+   int overrun;
+} bitreader;
+
+typedef struct {
+   const unsigned char * data;
+   unsigned int length;
+   unsigned int firstframe;
+   unsigned int pos;
+
+   int channels;
+   int bps;
+   int maxblock;
+   unsigned int samplerate;
+   uint64_t totalsamples;
+
+   const unsigned char * seektable;
+   int seekpoints;
+
+   uint64_t sample;
+   uint64_t target;
+   uint64_t seektarget;
+   unsigned int seekpos;
+   uint64_t seeksample;
+   int haveseekpos;
+
+   int * chan[2];
+   short * pcm;
+   int inlinechan[2][FLAC_InlineBlock];
+   short inlinepcm[2 * FLAC_InlineBlock];
+} flac_data;
+
+static void br_init(bitreader * br, const unsigned char * data, unsigned int length)
+{
+   br->data = data;
+   br->length = length;
+   br->pos = 0;
+   br->cache = 0;
+   br->bits = 0;
+   br->overrun = 0;
+}
+
+static void br_refill(bitreader * br)
+{
+   while (br->bits <= 56 && br->pos < br->length) {
+      br->cache |= (uint64_t) br->data[br->pos++] << (56 - br->bits);
+      br->bits += 8;
+   }
+}
+
+static unsigned int br_get(bitreader * br, int n)
+{
+   unsigned int v;
+
+   if (n == 0) {
+      return 0;
+   }
+   if (br->bits < n) {
+      br_refill(br);
+      if (br->bits < n) {
+         br->overrun = 1;
+         br->cache = 0;
+         br->bits = 0;
+         return 0;
+      }
+   }
+
+   v = (unsigned int) (br->cache >> (64 - n));
+   br->cache <<= n;
+   br->bits -= n;
+   return v;
+}
+
+static int br_getsigned(bitreader * br, int n)
+{
+   unsigned int v = br_get(br, n);
+
+   if (n == 0) {
+      return 0;
+   }
+   return (int) (v ^ (1u << (n - 1))) - (int) (1u << (n - 1));
+}
+
+// counts zero bits up to and including the next one
+static unsigned int br_unary(bitreader * br)
+{
+   unsigned int count = 0;
+
+   for (;;) {
+      if (br->bits == 0) {
+         br_refill(br);
+         if (br->bits == 0) {
+            br->overrun = 1;
+            return 0;
+         }
+      }
+      if (br->cache == 0) {
+         // bits past the filled ones are always clear
+         count += br->bits;
+         br->bits = 0;
+         continue;
+      }
+      while ((br->cache >> 56) == 0) {
+         count += 8;
+         br->cache <<= 8;
+         br->bits -= 8;
+      }
+      while ((br->cache >> 63) == 0) {
+         count++;
+         br->cache <<= 1;
+         br->bits--;
+      }
+      br->cache <<= 1;
+      br->bits--;
+      return count;
+   }
+}
+
+static void br_align(bitreader * br)
+{
+   br_get(br, br->bits & 7);
+}
+
+// bytes consumed, once aligned
+static unsigned int br_tell(const bitreader * br)
+{
+   return br->pos - (br->bits >> 3);
+}
+
+static unsigned int get24be(const unsigned char * p)
+{
+   return ((unsigned int) p[0] << 16) | ((unsigned int) p[1] << 8) | p[2];
+}
+
+static uint64_t get64be(const unsigned char * p)
+{
+   uint64_t v = 0;
+   int i;
+
+   for (i = 0; i < 8; i++) {
+      v = (v << 8) | p[i];
+   }
+   return v;
+}
+
+/*
+ Decodes a partitioned Rice residual into out[order..blocksize).
+ */
+static int decode_residual(bitreader * br, int * out, int blocksize, int order)
+{
+   int method, partitions, porder, p, n, i, k, escape;
+   unsigned int u;
+
+   method = br_get(br, 2);
+   if (method > 1) {
+      return 0;
+   }
+   escape = method ? 31 : 15;
+
+   porder = br_get(br, 4);
+   partitions = 1 << porder;
+   if ((blocksize >> porder) << porder != blocksize || (blocksize >> porder) < order) {
+      return 0;
+   }
+
+   out += order;
+   for (p = 0; p < partitions; p++) {
+      n = (blocksize >> porder) - (p == 0 ? order : 0);
+      k = br_get(br, method ? 5 : 4);
+      if (k == escape) {
+         k = br_get(br, 5);
+         for (i = 0; i < n; i++) {
+            out[i] = br_getsigned(br, k);
+         }
+      } else {
+         for (i = 0; i < n; i++) {
+            u = (br_unary(br) << k) | br_get(br, k);
+            out[i] = (int) (u >> 1) ^ -(int) (u & 1);
+         }
+      }
+      out += n;
+   }
+
+   return !br->overrun;
+}
+
+static void predict_fixed(int * s, int blocksize, int order)
+{
+   int i;
+
+   switch (order) {
+      case 1:
+         for (i = 1; i < blocksize; i++) {
+            s[i] += s[i - 1];
+         }
+         break;
+      case 2:
+         for (i = 2; i < blocksize; i++) {
+            s[i] += 2 * s[i - 1] - s[i - 2];
+         }
+         break;
+      case 3:
+         for (i = 3; i < blocksize; i++) {
+            s[i] += 3 * s[i - 1] - 3 * s[i - 2] + s[i - 3];
+         }
+         break;
+      case 4:
+         for (i = 4; i < blocksize; i++) {
+            s[i] += 4 * s[i - 1] - 6 * s[i - 2] + 4 * s[i - 3] - s[i - 4];
+         }
+         break;
+   }
+}
+
+static void predict_lpc(int * s, int blocksize, const int * coefs, int order, int shift, int wide)
+{
+   int i, j;
+
+   if (wide) {
+      for (i = order; i < blocksize; i++) {
+         int64_t sum = 0;
+         for (j = 0; j < order; j++) {
+            sum += (int64_t) coefs[j] * s[i - 1 - j];
+         }
+         s[i] += (int) (sum >> shift);
+      }
+   } else {
+      // the sum is known to fit in 32 bits
+      for (i = order; i < blocksize; i++) {
+         int sum = 0;
+         for (j = 0; j < order; j++) {
+            sum += coefs[j] * s[i - 1 - j];
+         }
+         s[i] += sum >> shift;
+      }
+   }
+}
+
+static int decode_subframe(bitreader * br, int * out, int blocksize, int bps)
+{
+   int type, wasted = 0, order, precision, shift, i, log2order;
+   int coefs[32];
+
+   if (br_get(br, 1) != 0) {
+      return 0;
+   }
+   type = br_get(br, 6);
+   if (br_get(br, 1)) {
+      wasted = br_unary(br) + 1;
+      if (wasted >= bps) {
+         return 0;
+      }
+      bps -= wasted;
+   }
+
+   if (type == 0) {
+      int v = br_getsigned(br, bps);
+      for (i = 0; i < blocksize; i++) {
+         out[i] = v;
+      }
+   } else if (type == 1) {
+      for (i = 0; i < blocksize; i++) {
+         out[i] = br_getsigned(br, bps);
+      }
+   } else if (type >= 8 && type <= 12) {
+      order = type - 8;
+      if (order > blocksize) {
+         return 0;
+      }
+      for (i = 0; i < order; i++) {
+         out[i] = br_getsigned(br, bps);
+      }
+      if (!decode_residual(br, out, blocksize, order)) {
+         return 0;
+      }
+      predict_fixed(out, blocksize, order);
+   } else if (type >= 32) {
+      order = type - 31;
+      if (order > blocksize) {
+         return 0;
+      }
+      for (i = 0; i < order; i++) {
+         out[i] = br_getsigned(br, bps);
+      }
+      precision = br_get(br, 4) + 1;
+      if (precision == 16) {
+         return 0;
+      }
+      shift = br_getsigned(br, 5);
+      if (shift < 0) {
+         return 0;
+      }
+      for (i = 0; i < order; i++) {
+         coefs[i] = br_getsigned(br, precision);
+      }
+      if (!decode_residual(br, out, blocksize, order)) {
+         return 0;
+      }
+      for (log2order = 0; (1 << log2order) < order; log2order++) ;
+      predict_lpc(out, blocksize, coefs, order, shift, bps + precision + log2order > 32);
+   } else {
+      return 0;
+   }
+
+   if (wasted) {
+      for (i = 0; i < blocksize; i++) {
+         out[i] = (int) ((unsigned int) out[i] << wasted);
+      }
+   }
+
+   return !br->overrun;
+}
+
+/*
+ Decodes the frame at fd->pos into fd->pcm as interleaved 16-bit
+ samples and returns how many sample frames it holds, or 0 at the end
+ of the stream or on a damaged frame.
+ */
+static int decode_frame(flac_data * fd)
+{
+   static const int sizes[8] = { 0, 8, 12, 0, 16, 20, 24, 0 };
+   bitreader br;
+   int blocksize, code, assignment, bps, c, i, shift, extra;
+   int * l, * r;
+   short * out;
+
+   if (fd->pos + 2 > fd->length) {
+      return 0;
+   }
+   br_init(&br, fd->data + fd->pos, fd->length - fd->pos);
+
+   if (br_get(&br, 15) != 0x7ffc) {
+      return 0;
+   }
+   br_get(&br, 1);      // blocking strategy
+
+   code = br_get(&br, 4);
+   c = br_get(&br, 4);  // sample rate, taken from the stream info
+   assignment = br_get(&br, 4);
+   bps = br_get(&br, 3);
+   br_get(&br, 1);
+
+   // coded frame or sample number, skipped
+   i = br_get(&br, 8);
+   for (extra = 0; extra < 8 && (i & (0x80 >> extra)); extra++) ;
+   if (extra == 1 || extra > 7) {
+      return 0;
+   }
+   for (i = 1; i < extra; i++) {
+      br_get(&br, 8);
+   }
+
+   if (code == 0) {
+      return 0;
+   } else if (code == 1) {
+      blocksize = 192;
+   } else if (code <= 5) {
+      blocksize = 576 << (code - 2);
+   } else if (code == 6) {
+      blocksize = br_get(&br, 8) + 1;
+   } else if (code == 7) {
+      blocksize = br_get(&br, 16) + 1;
+   } else {
+      blocksize = 256 << (code - 8);
+   }
+
+   if (c == 12) {
+      br_get(&br, 8);
+   } else if (c == 13 || c == 14) {
+      br_get(&br, 16);
+   } else if (c == 15) {
+      return 0;
+   }
+   br_get(&br, 8);      // header CRC
+
+   bps = bps ? sizes[bps] : fd->bps;
+   if (bps == 0 || bps > 24 || blocksize > fd->maxblock) {
+      return 0;
+   }
+   if ((assignment < 8 && assignment + 1 != fd->channels) ||
+       (assignment >= 8 && (assignment > 10 || fd->channels != 2))) {
+      return 0;
+   }
+
+   l = fd->chan[0];
+   r = fd->chan[1];
+   for (c = 0; c < fd->channels; c++) {
+      // the side channel carries one extra bit
+      int sbps = bps + ((assignment == 8 && c == 1) || (assignment == 9 && c == 0) ||
+                        (assignment == 10 && c == 1));
+      if (!decode_subframe(&br, fd->chan[c], blocksize, sbps)) {
+         return 0;
+      }
+   }
+
+   br_align(&br);
+   br_get(&br, 16);     // frame CRC
+   if (br.overrun) {
+      return 0;
+   }
+   fd->pos += br_tell(&br);
+
+   switch (assignment) {
+      case 8:
+         for (i = 0; i < blocksize; i++) {
+            r[i] = l[i] - r[i];
+         }
+         break;
+      case 9:
+         for (i = 0; i < blocksize; i++) {
+            l[i] += r[i];
+         }
+         break;
+      case 10:
+         for (i = 0; i < blocksize; i++) {
+            int mid = (int) ((unsigned int) l[i] << 1) | (r[i] & 1);
+            l[i] = (mid + r[i]) >> 1;
+            r[i] = (mid - r[i]) >> 1;
+         }
+         break;
+   }
+
+   out = fd->pcm;
+   shift = bps - 16;
+   if (fd->channels == 2) {
+      if (shift >= 0) {
+         for (i = 0; i < blocksize; i++) {
+            out[i * 2] = (short) (l[i] >> shift);
+            out[i * 2 + 1] = (short) (r[i] >> shift);
+         }
+      } else {
+         for (i = 0; i < blocksize; i++) {
+            out[i * 2] = (short) ((unsigned int) l[i] << -shift);
+            out[i * 2 + 1] = (short) ((unsigned int) r[i] << -shift);
+         }
+      }
+   } else {
+      if (shift >= 0) {
+         for (i = 0; i < blocksize; i++) {
+            out[i] = (short) (l[i] >> shift);
+         }
+      } else {
+         for (i = 0; i < blocksize; i++) {
+            out[i] = (short) ((unsigned int) l[i] << -shift);
+         }
+      }
+   }
+
+   return blocksize;
+}
+
+/*
+ Positions the decoder to produce output from sample target onwards.
+ */
+static void seek_flac(flac_data * fd, uint64_t target)
+{
+   const unsigned char * point;
+   uint64_t sample, offset;
+   int i;
+
+   fd->pos = fd->firstframe;
+   fd->sample = 0;
+   fd->target = target;
+
+   if (target != fd->seektarget) {
+      fd->seektarget = target;
+      fd->haveseekpos = FALSE;
+   } else if (fd->haveseekpos) {
+      fd->pos = fd->seekpos;
+      fd->sample = fd->seeksample;
+      return;
+   }
+
+   for (i = 0; i < fd->seekpoints; i++) {
+      point = fd->seektable + i * 18;
+      sample = get64be(point);
+      offset = get64be(point + 8);
+      if (sample == UINT64_C(0xffffffffffffffff) || sample > target) {
+         // points are sorted, placeholders last
+         break;
+      }
+      if (offset < fd->length - fd->firstframe && sample >= fd->sample) {
+         fd->pos = fd->firstframe + (unsigned int) offset;
+         fd->sample = sample;
+      }
+   }
+}
+
+
+/*
+ Reads the metadata blocks ahead of the first frame. Returns 0 if the
+ stream is not one that can be played.
+ */
+static int parse_flac(flac_data * fd)
+{
+   const unsigned char * p;
+   unsigned int pos = 4, len;
+   int type, last, haveinfo = FALSE;
+
+   if (fd->length < 4 || memcmp(fd->data, "fLaC", 4)) {
+      return 0;
+   }
+
+   do {
+      if (pos + 4 > fd->length) {
+         return 0;
+      }
+      p = fd->data + pos;
+      last = p[0] & 0x80;
+      type = p[0] & 0x7f;
+      len = get24be(p + 1);
+      pos += 4;
+      if (len > fd->length - pos) {
+         return 0;
+      }
+      p += 4;
+
+      if (type == 0 && len >= 34) {
+         fd->maxblock = (p[2] << 8) | p[3];
+         fd->samplerate = ((unsigned int) p[10] << 12) | ((unsigned int) p[11] << 4) | (p[12] >> 4);
+         fd->channels = ((p[12] >> 1) & 7) + 1;
+         fd->bps = (((p[12] & 1) << 4) | (p[13] >> 4)) + 1;
+         fd->totalsamples = ((uint64_t) (p[13] & 15) << 32) |
+            ((unsigned int) p[14] << 24) | ((unsigned int) p[15] << 16) |
+            ((unsigned int) p[16] << 8) | p[17];
+         haveinfo = TRUE;
+      } else if (type == 3) {
+         fd->seektable = p;
+         fd->seekpoints = len / 18;
+      }
+
+      pos += len;
+   } while (!last);
+
+   fd->firstframe = pos;
+
+   return haveinfo && fd->maxblock >= 16 && fd->samplerate > 0 &&
+      (fd->channels == 1 || fd->channels == 2) && fd->bps >= 4 && fd->bps <= 24;
+}
+
+
+/*---------------------------------------------------------------------
+Function: FLAC_Probe
+
+Recognises a native FLAC stream.
+---------------------------------------------------------------------*/
+
+static int FLAC_Probe(const char * ptr, unsigned int length)
+{
+   return length >= 4 && !memcmp(ptr, "fLaC", 4);
+}
+
+
+/*---------------------------------------------------------------------
+Function: FLAC_Open
+
+Reads the stream's metadata and sets up its decode buffers.
+---------------------------------------------------------------------*/
+
+static int FLAC_Open(void * state, char * ptr, unsigned int length, MV_DecoderFormat * format)
+{
+   flac_data * fd = (flac_data *) state;
+
+   fd->data = (const unsigned char *) ptr;
+   fd->length = length;
+   if (!parse_flac(fd)) {
+      return MV_InvalidFLACFile;
+   }
+
+   if (fd->maxblock <= FLAC_InlineBlock) {
+      fd->chan[0] = fd->inlinechan[0];
+      fd->chan[1] = fd->inlinechan[1];
+      fd->pcm = fd->inlinepcm;
+   } else {
+      fd->chan[0] = (int *) malloc(fd->maxblock * fd->channels * (sizeof(int) + sizeof(short)));
+      if (!fd->chan[0]) {
+         return MV_NoMem;
+      }
+      fd->chan[1] = fd->chan[0] + fd->maxblock;
+      fd->pcm = (short *) (fd->chan[0] + fd->maxblock * fd->channels);
+   }
+   fd->pos = fd->firstframe;
+
+   format->rate = fd->samplerate;
+   format->channels = fd->channels;
+   format->bits = 16;
+
+   return MV_Ok;
+}
+
+
+/*---------------------------------------------------------------------
+Function: FLAC_Decode
+
+Decodes the next frame, skipping anything ahead of a seek target.
+---------------------------------------------------------------------*/
+
+static int FLAC_Decode(void * state, char ** block, MV_DecoderFormat * format)
+{
+   flac_data * fd = (flac_data *) state;
+   uint64_t framestart;
+   unsigned int framepos, start;
+   int frames;
+
+   (void) format;
+
+   for (;;) {
+      framestart = fd->sample;
+      framepos = fd->pos;
+      frames = decode_frame(fd);
+      if (frames == 0) {
+         return 0;
+      }
+      fd->sample += frames;
+
+      if (fd->haveseekpos == FALSE && fd->seektarget >= framestart &&
+          fd->seektarget < fd->sample) {
+         fd->seekpos = framepos;
+         fd->seeksample = framestart;
+         fd->haveseekpos = TRUE;
+      }
+
+      if (fd->sample > fd->target) {
+         break;
+      }
+   }
+
+   start = (fd->target > framestart) ? (unsigned int) (fd->target - framestart) : 0;
+   fd->target = 0;
+
+   *block = (char *) (fd->pcm + start * fd->channels);
+   return frames - start;
+}
+
+
+/*---------------------------------------------------------------------
+Function: FLAC_Seek
+
+Moves decoding to the given sample frame.
+---------------------------------------------------------------------*/
+
+static int FLAC_Seek(void * state, unsigned int frame)
+{
+   flac_data * fd = (flac_data *) state;
+
+   if (fd->totalsamples > 0 && frame >= fd->totalsamples) {
+      frame = 0;
+   }
+   seek_flac(fd, frame);
+
+   return MV_Ok;
+}
+
+
+/*---------------------------------------------------------------------
+Function: FLAC_Close
+
+Frees decode buffers too large to be kept in the state.
+---------------------------------------------------------------------*/
+
+static void FLAC_Close(void * state)
+{
+   flac_data * fd = (flac_data *) state;
+
+   if (fd->chan[0] && fd->chan[0] != fd->inlinechan[0]) {
+      free(fd->chan[0]);
+   }
+   fd->chan[0] = 0;
+}
+
+
+const MV_Decoder MV_FLACDecoder = {
+   "FLAC",
+   FLAC_Probe,
+   NULL,
+   sizeof(flac_data),
+   FLAC_Open,
+   FLAC_Decode,
+   FLAC_Seek,
+   FLAC_Close
+};
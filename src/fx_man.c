@@ -100,7 +100,9 @@ const char *FX_ErrorString
 /*---------------------------------------------------------------------
    Function: FX_Init
 
-   Selects which sound device to use.
+   Selects which sound device to use.  numchannels may ask for 4, 6 or
+   8 channels of quad, 5.1 or 7.1 output, and returns what the device
+   actually opened with.
 ---------------------------------------------------------------------*/
 
 int FX_Init
@@ -344,6 +346,80 @@ void FX_SetFastReverb
    }
 
 
+/*---------------------------------------------------------------------
+   Function: FX_SetRoomReverb
+
+   Sets the level, room size and damping of the room reverb.
+---------------------------------------------------------------------*/
+
+int FX_SetRoomReverb
+   (
+   int level,
+   int roomsize,
+   int damping
+   )
+
+   {
+   int status;
+
+   status = MV_SetRoomReverb( level, roomsize, damping );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetInternalMixRate
+
+   Sets the rate sounds are mixed at from the next FX_Init, with the
+   mix converted to the device rate for output.  0 mixes at the device
+   rate.
+---------------------------------------------------------------------*/
+
+void FX_SetInternalMixRate
+   (
+   int rate
+   )
+
+   {
+   MV_SetInternalMixRate( rate );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetLimiter
+
+   Sets the look-ahead, release, compression threshold and ratio of
+   the master limiter.
+---------------------------------------------------------------------*/
+
+int FX_SetLimiter
+   (
+   int lookahead,
+   int release,
+   int threshold,
+   int ratio
+   )
+
+   {
+   int status;
+
+   status = MV_SetLimiter( lookahead, release, threshold, ratio );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
 /*---------------------------------------------------------------------
    Function: FX_GetMaxReverbDelay
 
@@ -392,6 +468,232 @@ void FX_SetReverbDelay
    }
 
 
+/*---------------------------------------------------------------------
+   Function: FX_SetCoalesceWindow
+
+   Sets the window within which duplicate triggers of a sound are
+   merged into one voice.  A negative window disables merging.
+---------------------------------------------------------------------*/
+
+void FX_SetCoalesceWindow
+   (
+   int window
+   )
+
+   {
+   MV_SetCoalesceWindow( window );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetCoalesceWindow
+
+   Returns the trigger coalescing window.
+---------------------------------------------------------------------*/
+
+int FX_GetCoalesceWindow
+   (
+   void
+   )
+
+   {
+   return MV_GetCoalesceWindow();
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetStreamThreads
+
+   Sets how many worker threads read and decode played files ahead of
+   the mixer, from the next time they start.  With none, files are
+   read in whole before their voices start.
+---------------------------------------------------------------------*/
+
+void FX_SetStreamThreads
+   (
+   int threads
+   )
+
+   {
+   MV_SetStreamThreads( threads );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetStreamThreads
+
+   Returns how many worker threads stream files.
+---------------------------------------------------------------------*/
+
+int FX_GetStreamThreads
+   (
+   void
+   )
+
+   {
+   return MV_GetStreamThreads();
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetStreamStarvation
+
+   Returns how many times a played file has fallen silent because its
+   next samples were not read in time.
+---------------------------------------------------------------------*/
+
+int FX_GetStreamStarvation
+   (
+   void
+   )
+
+   {
+   return MV_GetStreamStarvation();
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetSoundLimit
+
+   Limits the concurrent instances and retrigger interval of a sound.
+---------------------------------------------------------------------*/
+
+int FX_SetSoundLimit
+   (
+   char *ptr,
+   int maxvoices,
+   int interval,
+   int steal
+   )
+
+   {
+   int status;
+
+   status = MV_SetSoundLimit( ptr, maxvoices, interval, steal );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_ClearSoundLimits
+
+   Removes all per-sound limits.
+---------------------------------------------------------------------*/
+
+void FX_ClearSoundLimits
+   (
+   void
+   )
+
+   {
+   MV_ClearSoundLimits();
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetMaxVoices
+
+   Resizes the voice pool while sounds keep playing.
+---------------------------------------------------------------------*/
+
+int FX_SetMaxVoices
+   (
+   int voices
+   )
+
+   {
+   int status;
+
+   status = MV_SetMaxVoices( voices );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetMaxVoices
+
+   Returns the size of the voice pool.
+---------------------------------------------------------------------*/
+
+int FX_GetMaxVoices
+   (
+   void
+   )
+
+   {
+   return( MV_GetMaxVoices() );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetInterpolation
+
+   Sets the resampling mode used when mixing.
+---------------------------------------------------------------------*/
+
+int FX_SetInterpolation
+   (
+   int mode
+   )
+
+   {
+   int status;
+
+   status = MV_SetInterpolation( mode );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetInterpolation
+
+   Returns the resampling mode used when mixing.
+---------------------------------------------------------------------*/
+
+int FX_GetInterpolation
+   (
+   void
+   )
+
+   {
+   return( MV_GetInterpolation() );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetInterpolationBudget
+
+   Limits how much interpolation automatic mode may spend per sample.
+---------------------------------------------------------------------*/
+
+void FX_SetInterpolationBudget
+   (
+   int taps
+   )
+
+   {
+   MV_SetInterpolationBudget( taps );
+   }
+
+
 /*---------------------------------------------------------------------
    Function: FX_VoiceAvailable
 
@@ -874,103 +1176,581 @@ int FX_Pan3D
 
 
 /*---------------------------------------------------------------------
-   Function: FX_SoundActive
+   Function: FX_SetFilter
 
-   Tests if the specified sound is currently playing.
+   Applies a low- or high-pass filter to the specified sound.
 ---------------------------------------------------------------------*/
 
-int FX_SoundActive
+int FX_SetFilter
    (
-   int handle
+   int handle,
+   int type,
+   int cutoff,
+   int q
    )
 
    {
-   return( MV_VoicePlaying( handle ) );
+   int status;
+
+   status = MV_SetVoiceFilter( handle, type, cutoff, q );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: FX_SoundsPlaying
+   Function: FX_SetSend
 
-   Reports the number of voices playing.
+   Sets how much of the specified sound is sent to an effect bus.
 ---------------------------------------------------------------------*/
 
-int FX_SoundsPlaying
+int FX_SetSend
    (
-   void
+   int handle,
+   int bus,
+   int level
    )
 
    {
-   return( MV_VoicesPlaying() );
+   int status;
+
+   status = MV_SetVoiceSend( handle, bus, level );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: FX_StopSound
+   Function: FX_SetBusReturn
 
-   Halts playback of a specific voice
+   Sets the return level of an effect bus.
 ---------------------------------------------------------------------*/
 
-int FX_StopSound
+int FX_SetBusReturn
    (
-   int handle
+   int bus,
+   int level
    )
 
    {
    int status;
 
-   status = MV_Kill( handle );
+   status = MV_SetBusReturn( bus, level );
    if ( status != MV_Ok )
       {
       FX_SetErrorCode( FX_MultiVocError );
-      return( FX_Warning );
+      status = FX_Error;
       }
 
-   return( FX_Ok );
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: FX_PauseSound
+   Function: FX_SetBusReverb
 
-   Pauses or resumes playback of a specific voice
+   Places a room reverb on an effect bus.
 ---------------------------------------------------------------------*/
 
-int FX_PauseSound
+int FX_SetBusReverb
    (
-   int handle,
-   int pauseon
+   int bus,
+   int roomsize,
+   int damping
    )
 
    {
    int status;
-   
+
+   status = MV_SetBusReverb( bus, roomsize, damping );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetBusFilter
+
+   Places a low- or high-pass filter on an effect bus.
+---------------------------------------------------------------------*/
+
+int FX_SetBusFilter
+   (
+   int bus,
+   int type,
+   int cutoff,
+   int q
+   )
+
+   {
+   int status;
+
+   status = MV_SetBusFilter( bus, type, cutoff, q );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetBusImpulse
+
+   Convolves an effect bus with an impulse response from a WAV file.
+---------------------------------------------------------------------*/
+
+int FX_SetBusImpulse
+   (
+   int bus,
+   char *ptr,
+   unsigned int ptrlength
+   )
+
+   {
+   int status;
+
+   status = MV_SetBusImpulse( bus, ptr, ptrlength );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetGroup
+
+   Places the specified sound in a group for ducking.
+---------------------------------------------------------------------*/
+
+int FX_SetGroup
+   (
+   int handle,
+   int group
+   )
+
+   {
+   int status;
+
+   status = MV_SetVoiceGroup( handle, group );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetDucking
+
+   Ducks one group of sounds under the level of another.
+---------------------------------------------------------------------*/
+
+int FX_SetDucking
+   (
+   int group,
+   int keygroup,
+   int level,
+   int threshold,
+   int attack,
+   int release
+   )
+
+   {
+   int status;
+
+   status = MV_SetDucking( group, keygroup, level, threshold, attack, release );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetListener
+
+   Sets the position, velocity and orientation of the listener.
+---------------------------------------------------------------------*/
+
+void FX_SetListener
+   (
+   const float *position,
+   const float *velocity,
+   const float *forward,
+   const float *up
+   )
+
+   {
+   MV_SetListener( position, velocity, forward, up );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetAttenuation
+
+   Sets how an attenuation curve lowers the level with distance.
+---------------------------------------------------------------------*/
+
+int FX_SetAttenuation
+   (
+   int   curve,
+   int   model,
+   float refdistance,
+   float maxdistance,
+   float rolloff
+   )
+
+   {
+   int status;
+
+   status = MV_SetAttenuation( curve, model, refdistance, maxdistance, rolloff );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetDoppler
+
+   Sets the strength of the Doppler shift and the speed of sound.
+---------------------------------------------------------------------*/
+
+void FX_SetDoppler
+   (
+   float factor,
+   float speedofsound
+   )
+
+   {
+   MV_SetDoppler( factor, speedofsound );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetEmitterCurve
+
+   Chooses the attenuation curve of a positioned sound.
+---------------------------------------------------------------------*/
+
+int FX_SetEmitterCurve
+   (
+   int handle,
+   int curve
+   )
+
+   {
+   int status;
+
+   status = MV_SetEmitterCurve( handle, curve );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetEmitters
+
+   Moves a batch of sounds to new positions in the 3D scene.
+---------------------------------------------------------------------*/
+
+int FX_SetEmitters
+   (
+   int          count,
+   const int   *handles,
+   const float *positions,
+   const float *velocities
+   )
+
+   {
+   int status;
+
+   status = MV_SetEmitters( count, handles, positions, velocities );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetHRTF
+
+   Renders positioned sounds binaurally for headphones with the
+   head-related impulse responses in a stereo WAV file.  NULL returns
+   to speaker panning.
+---------------------------------------------------------------------*/
+
+int FX_SetHRTF
+   (
+   char *ptr,
+   unsigned int length,
+   int directions
+   )
+
+   {
+   int status;
+
+   status = MV_SetHRTF( ptr, length, directions );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Error;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SetHRTFVoices
+
+   Sets how many of the highest priority positioned sounds get full
+   binaural rendering.
+---------------------------------------------------------------------*/
+
+void FX_SetHRTFVoices
+   (
+   int voices
+   )
+
+   {
+   MV_SetHRTFVoices( voices );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SoundActive
+
+   Tests if the specified sound is currently playing.
+---------------------------------------------------------------------*/
+
+int FX_SoundActive
+   (
+   int handle
+   )
+
+   {
+   return( MV_VoicePlaying( handle ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_SoundsPlaying
+
+   Reports the number of voices playing.
+---------------------------------------------------------------------*/
+
+int FX_SoundsPlaying
+   (
+   void
+   )
+
+   {
+   return( MV_VoicesPlaying() );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_StopSound
+
+   Halts playback of a specific voice
+---------------------------------------------------------------------*/
+
+int FX_StopSound
+   (
+   int handle
+   )
+
+   {
+   int status;
+
+   status = MV_Kill( handle );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      return( FX_Warning );
+      }
+
+   return( FX_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_PauseSound
+
+   Pauses or resumes playback of a specific voice
+---------------------------------------------------------------------*/
+
+int FX_PauseSound
+   (
+   int handle,
+   int pauseon
+   )
+
+   {
+   int status;
+   
    status = MV_PauseVoice( handle, pauseon );
    if ( status != MV_Ok )
       {
       FX_SetErrorCode( FX_MultiVocError );
-      return( FX_Warning );
+      return( FX_Warning );
+      }
+   
+   return( FX_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_StopAllSounds
+
+   Halts playback of all sounds.
+---------------------------------------------------------------------*/
+
+int FX_StopAllSounds
+   (
+   void
+   )
+
+   {
+   int status;
+
+   status = MV_KillAllVoices();
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      return( FX_Warning );
+      }
+
+   return( FX_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_StartDemandFeedPlayback
+
+   Plays a digitized sound from a user controlled buffering system.
+---------------------------------------------------------------------*/
+
+int FX_StartDemandFeedPlayback
+   (
+   void ( *function )( char **ptr, unsigned int *length ),
+   int rate,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
+   )
+
+   {
+   int handle;
+
+   handle = MV_StartDemandFeedPlayback( function, rate,
+      pitchoffset, vol, left, right, priority, callbackval );
+   if ( handle < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+      }
+
+   return( handle );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_StartQueuedPlayback
+
+   Starts a voice that plays queued buffers of PCM data back-to-back.
+---------------------------------------------------------------------*/
+
+int FX_StartQueuedPlayback
+   (
+   int rate,
+   int bits,
+   int channels,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
+   )
+
+   {
+   int handle;
+
+   handle = MV_StartQueuedPlayback( rate, bits, channels, pitchoffset,
+      vol, left, right, priority, callbackval );
+   if ( handle < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
       }
-   
-   return( FX_Ok );
+
+   return( handle );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: FX_StopAllSounds
+   Function: FX_QueueBuffer
 
-   Halts playback of all sounds.
+   Appends a buffer to a queued voice.  A NULL buffer ends the stream.
 ---------------------------------------------------------------------*/
 
-int FX_StopAllSounds
+int FX_QueueBuffer
    (
-   void
+   int handle,
+   char *ptr,
+   unsigned int length
    )
 
    {
    int status;
 
-   status = MV_KillAllVoices();
+   status = MV_QueueBuffer( handle, ptr, length );
    if ( status != MV_Ok )
       {
       FX_SetErrorCode( FX_MultiVocError );
@@ -982,35 +1762,29 @@ int FX_StopAllSounds
 
 
 /*---------------------------------------------------------------------
-   Function: FX_StartDemandFeedPlayback
+   Function: FX_UnqueueProcessed
 
-   Plays a digitized sound from a user controlled buffering system.
+   Retrieves buffers a queued voice has finished playing.
 ---------------------------------------------------------------------*/
 
-int FX_StartDemandFeedPlayback
+int FX_UnqueueProcessed
    (
-   void ( *function )( char **ptr, unsigned int *length ),
-   int rate,
-   int pitchoffset,
-   int vol,
-   int left,
-   int right,
-   int priority,
-   unsigned int callbackval
+   int handle,
+   char **buffers,
+   int maxbuffers
    )
 
    {
-   int handle;
+   int count;
 
-   handle = MV_StartDemandFeedPlayback( function, rate,
-      pitchoffset, vol, left, right, priority, callbackval );
-   if ( handle < MV_Ok )
+   count = MV_UnqueueProcessed( handle, buffers, maxbuffers );
+   if ( count < MV_Ok )
       {
       FX_SetErrorCode( FX_MultiVocError );
-      handle = FX_Warning;
+      count = FX_Warning;
       }
 
-   return( handle );
+   return( count );
    }
 
 
@@ -1061,18 +1835,9 @@ void FX_StopRecord
 int FX_PlayAuto( char *ptr, unsigned int length, int pitchoffset, int vol,
                  int left, int right, int priority, unsigned int callbackval )
 {
-   int handle = -1;
-   
-   if (!memcmp("Creative Voice File\x1a", ptr, 20)) {
-      handle = MV_PlayVOC(ptr, length, pitchoffset, vol, left, right, priority, callbackval);
-   } else if (!memcmp("RIFF", ptr, 4) && !memcmp("WAVE", ptr + 8, 4)) {
-      handle = MV_PlayWAV(ptr, length, pitchoffset, vol, left, right, priority, callbackval);
-   #ifdef HAVE_VORBIS
-   } else if (!memcmp("OggS", ptr, 4)) {
-      handle = MV_PlayVorbis(ptr, length, pitchoffset, vol, left, right, priority, callbackval);
-   #endif
-   }
+   int handle;
    
+   handle = MV_PlayAuto(ptr, length, pitchoffset, vol, left, right, priority, callbackval);
    if ( handle < MV_Ok )
    {
       FX_SetErrorCode( FX_MultiVocError );
@@ -1091,21 +1856,10 @@ int FX_PlayLoopedAuto( char *ptr, unsigned int length, int loopstart, int loopen
                        int pitchoffset, int vol, int left, int right, int priority,
                        unsigned int callbackval )
 {
-   int handle = -1;
+   int handle;
    
-   if (!memcmp("Creative Voice File\x1a", ptr, 20)) {
-      handle = MV_PlayLoopedVOC(ptr, length, loopstart, loopend, pitchoffset,
+   handle = MV_PlayLoopedAuto(ptr, length, loopstart, loopend, pitchoffset,
                               vol, left, right, priority, callbackval);
-   } else if (!memcmp("RIFF", ptr, 4) && !memcmp("WAVE", ptr + 8, 4)) {
-      handle = MV_PlayLoopedWAV(ptr, length, loopstart, loopend, pitchoffset,
-                              vol, left, right, priority, callbackval);
-   #ifdef HAVE_VORBIS
-   } else if (!memcmp("OggS", ptr, 4)) {
-      handle = MV_PlayLoopedVorbis(ptr, length, loopstart, loopend, pitchoffset,
-                              vol, left, right, priority, callbackval);
-   #endif
-   }
-   
    if ( handle < MV_Ok )
    {
       FX_SetErrorCode( FX_MultiVocError );
@@ -1123,18 +1877,72 @@ int FX_PlayLoopedAuto( char *ptr, unsigned int length, int loopstart, int loopen
 int FX_PlayAuto3D( char *ptr, unsigned int length, int pitchoffset, int angle,
                    int distance, int priority, unsigned int callbackval )
 {
-   int handle = -1;
+   int handle;
+   
+   handle = MV_PlayAuto3D(ptr, length, pitchoffset, angle, distance, priority, callbackval);
+   if ( handle < MV_Ok )
+   {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+   }
+   
+   return handle;
+}
+
+/*---------------------------------------------------------------------
+   Function: FX_PlayFile
+
+   Play a sound file, autodetecting the format.  The file is mapped
+   rather than read, so it need not fit in memory.
+---------------------------------------------------------------------*/
+int FX_PlayFile( const char *filename, int pitchoffset, int vol,
+                 int left, int right, int priority, unsigned int callbackval )
+{
+   int handle;
+   
+   handle = MV_PlayFile(filename, pitchoffset, vol, left, right, priority, callbackval);
+   if ( handle < MV_Ok )
+   {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+   }
+   
+   return handle;
+}
+
+/*---------------------------------------------------------------------
+   Function: FX_PlayLoopedFile
+
+   Play a looped sound file, autodetecting the format.
+---------------------------------------------------------------------*/
+int FX_PlayLoopedFile( const char *filename, int loopstart, int loopend,
+                       int pitchoffset, int vol, int left, int right, int priority,
+                       unsigned int callbackval )
+{
+   int handle;
    
-   if (!memcmp("Creative Voice File\x1a", ptr, 20)) {
-      handle = MV_PlayVOC3D(ptr, length, pitchoffset, angle, distance, priority, callbackval);
-   } else if (!memcmp("RIFF", ptr, 4) && !memcmp("WAVE", ptr + 8, 4)) {
-      handle = MV_PlayWAV3D(ptr, length, pitchoffset, angle, distance, priority, callbackval);
-   #ifdef HAVE_VORBIS
-   } else if (!memcmp("OggS", ptr, 4)) {
-      handle = MV_PlayVorbis3D(ptr, length, pitchoffset, angle, distance, priority, callbackval);
-   #endif
+   handle = MV_PlayLoopedFile(filename, loopstart, loopend, pitchoffset,
+                              vol, left, right, priority, callbackval);
+   if ( handle < MV_Ok )
+   {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
    }
    
+   return handle;
+}
+
+/*---------------------------------------------------------------------
+   Function: FX_PlayFile3D
+
+   Play a positioned sound file, autodetecting the format.
+---------------------------------------------------------------------*/
+int FX_PlayFile3D( const char *filename, int pitchoffset, int angle,
+                   int distance, int priority, unsigned int callbackval )
+{
+   int handle;
+   
+   handle = MV_PlayFile3D(filename, pitchoffset, angle, distance, priority, callbackval);
    if ( handle < MV_Ok )
    {
       FX_SetErrorCode( FX_MultiVocError );
@@ -1144,5 +1952,231 @@ int FX_PlayAuto3D( char *ptr, unsigned int length, int pitchoffset, int angle,
    return handle;
 }
 
+/*---------------------------------------------------------------------
+   Function: FX_LoadSound
+
+   Reads a sound's format once so that it can be played by ID.  With
+   FX_LoadConvert, compressed sounds are decoded up front, and with
+   FX_LoadResample they are also resampled to the mix rate.
+---------------------------------------------------------------------*/
+
+int FX_LoadSound
+   (
+   char *ptr,
+   unsigned int ptrlength,
+   int flags
+   )
+
+   {
+   int id;
+
+   id = MV_LoadSound( ptr, ptrlength, flags );
+   if ( id < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      id = FX_Error;
+      }
+
+   return( id );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_LoadBank
+
+   Loads the sounds of a packed bank, storing their IDs in index order,
+   and returns how many there are.  The bank must stay in memory while
+   its sounds are loaded.
+---------------------------------------------------------------------*/
+
+int FX_LoadBank
+   (
+   char *ptr,
+   unsigned int ptrlength,
+   int *ids,
+   int maxids
+   )
+
+   {
+   int count;
+
+   count = MV_LoadBank( ptr, ptrlength, ids, maxids );
+   if ( count < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      count = FX_Error;
+      }
+
+   return( count );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_UnloadSound
+
+   Stops a loaded sound and forgets it.
+---------------------------------------------------------------------*/
+
+int FX_UnloadSound
+   (
+   int id
+   )
+
+   {
+   int status;
+
+   status = MV_UnloadSound( id );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_UnloadAllSounds
+
+   Forgets every loaded sound.
+---------------------------------------------------------------------*/
+
+void FX_UnloadAllSounds
+   (
+   void
+   )
+
+   {
+   MV_UnloadAllSounds();
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_GetSoundInfo
+
+   Reports a loaded sound's sample rate, channels and length.
+---------------------------------------------------------------------*/
+
+int FX_GetSoundInfo
+   (
+   int id,
+   unsigned int *rate,
+   int *channels,
+   unsigned int *frames
+   )
+
+   {
+   int status;
+
+   status = MV_GetSoundInfo( id, rate, channels, frames );
+   if ( status != MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      status = FX_Warning;
+      }
+
+   return( status );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_PlaySound
+
+   Begin playback of a loaded sound, looping it if the file gives a
+   loop.
+---------------------------------------------------------------------*/
+
+int FX_PlaySound
+   (
+   int id,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
+   )
+
+   {
+   int handle;
+
+   handle = MV_PlaySound( id, pitchoffset, vol, left, right, priority,
+      callbackval );
+   if ( handle < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+      }
+
+   return( handle );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_PlayLoopedSound
+
+   Begin playback of a loaded sound with the given loop.
+---------------------------------------------------------------------*/
+
+int FX_PlayLoopedSound
+   (
+   int id,
+   int loopstart,
+   int loopend,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
+   )
+
+   {
+   int handle;
+
+   handle = MV_PlayLoopedSound( id, loopstart, loopend, pitchoffset, vol,
+      left, right, priority, callbackval );
+   if ( handle < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+      }
+
+   return( handle );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: FX_PlaySound3D
+
+   Begin playback of a loaded sound at specified angle and distance
+   from listener.
+---------------------------------------------------------------------*/
+
+int FX_PlaySound3D
+   (
+   int id,
+   int pitchoffset,
+   int angle,
+   int distance,
+   int priority,
+   unsigned int callbackval
+   )
+
+   {
+   int handle;
+
+   handle = MV_PlaySound3D( id, pitchoffset, angle, distance, priority,
+      callbackval );
+   if ( handle < MV_Ok )
+      {
+      FX_SetErrorCode( FX_MultiVocError );
+      handle = FX_Warning;
+      }
+
+   return( handle );
+   }
+
 // vim:ts=3:expandtab:
 
@@ -0,0 +1,255 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Binaural rendering through a set of head-related impulse responses
+ *
+ * The set holds left and right ear responses, at most MixBufferSize
+ * taps long, for directions evenly spaced around the horizontal plane
+ * clockwise from the front. Their spectra are computed once at load.
+ * Each buffer, the queued voices are transformed two at a time by
+ * packing one into the imaginary part of a complex FFT. Every voice is
+ * multiplied by its direction's spectra, interpolated between the two
+ * nearest measured directions, and summed in the frequency domain.
+ * One inverse FFT then yields both ears for all voices together, so a
+ * voice costs half a forward FFT plus four complex multiply-adds per
+ * bin.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+
+/*
+ Builds an HRIR set from directions consecutive blocks of length
+ frames of interleaved left and right float samples.
+ */
+hrtfset *MV_CreateHRTF(const float *ir, int length, int directions)
+{
+    hrtfset *hrtf;
+    float *re, *im;
+    int d, c, i;
+
+    hrtf = (hrtfset *) malloc(sizeof(hrtfset));
+    if (!hrtf) {
+        return NULL;
+    }
+    memset(hrtf, 0, sizeof(hrtfset));
+
+    hrtf->directions = directions;
+    hrtf->plan = MV_CreateFFT(MV_ConvFFTSize);
+    hrtf->specre = (float *) malloc(directions * 2 * MV_ConvBins * sizeof(float));
+    hrtf->specim = (float *) malloc(directions * 2 * MV_ConvBins * sizeof(float));
+    if (!hrtf->plan || !hrtf->specre || !hrtf->specim) {
+        MV_DestroyHRTF(hrtf);
+        return NULL;
+    }
+
+    if (length > MixBufferSize) {
+        length = MixBufferSize;
+    }
+
+    re = hrtf->workre;
+    im = hrtf->workim;
+    for (d = 0; d < directions; d++) {
+        for (c = 0; c < 2; c++) {
+            memset(re, 0, sizeof(hrtf->workre));
+            memset(im, 0, sizeof(hrtf->workim));
+            for (i = 0; i < length; i++) {
+                re[i] = ir[(d * length + i) * 2 + c];
+            }
+
+            MV_FFT(hrtf->plan, re, im, 0);
+
+            memcpy(hrtf->specre + (d * 2 + c) * MV_ConvBins, re, MV_ConvBins * sizeof(float));
+            memcpy(hrtf->specim + (d * 2 + c) * MV_ConvBins, im, MV_ConvBins * sizeof(float));
+        }
+    }
+
+    // no slot has been used yet
+    hrtf->frame = 2;
+
+    return hrtf;
+}
+
+void MV_DestroyHRTF(hrtfset *hrtf)
+{
+    if (!hrtf) {
+        return;
+    }
+
+    MV_DestroyFFT(hrtf->plan);
+    free(hrtf->specre);
+    free(hrtf->specim);
+    free(hrtf);
+}
+
+/*
+ Queues MixBufferSize samples of a voice for the next render. A voice
+ that was rendered in the previous buffer keeps its slot and history;
+ otherwise the slot longest unused is taken. Returns 0 if every slot
+ is already queued this buffer.
+ */
+int MV_QueueHRTF(hrtfset *hrtf, int handle, const float *input, float azimuth, float gain)
+{
+    int s, slot = -1;
+    unsigned int oldest = hrtf->frame;
+    float position;
+
+    if (hrtf->queued >= MV_MaxHRTFVoices) {
+        return 0;
+    }
+
+    for (s = 0; s < MV_MaxHRTFVoices; s++) {
+        if (hrtf->handles[s] == handle && hrtf->stamps[s] == hrtf->frame - 1) {
+            slot = s;
+            break;
+        }
+        if (hrtf->stamps[s] < oldest) {
+            oldest = hrtf->stamps[s];
+            slot = s;
+        }
+    }
+    if (slot < 0) {
+        return 0;
+    }
+
+    if (hrtf->handles[slot] != handle || hrtf->stamps[slot] != hrtf->frame - 1) {
+        memset(hrtf->history[slot], 0, sizeof(hrtf->history[slot]));
+        hrtf->handles[slot] = handle;
+    }
+    hrtf->stamps[slot] = hrtf->frame;
+
+    // overlap-save window: the previous block followed by the new one
+    memcpy(hrtf->window[hrtf->queued], hrtf->history[slot], MixBufferSize * sizeof(float));
+    memcpy(hrtf->window[hrtf->queued] + MixBufferSize, input, MixBufferSize * sizeof(float));
+    memcpy(hrtf->history[slot], input, MixBufferSize * sizeof(float));
+
+    position = azimuth * (float) (hrtf->directions / (2.0 * PI));
+    position -= hrtf->directions * floorf(position / hrtf->directions);
+    hrtf->position[hrtf->queued] = position;
+    hrtf->gain[hrtf->queued] = gain;
+    hrtf->queued++;
+
+    return 1;
+}
+
+/*
+ Multiplies one voice's spectrum by its interpolated HRIR spectra and
+ adds the result to both ear accumulators.
+ */
+static void accumulate(hrtfset *hrtf, const float *xre, const float *xim, int queued)
+{
+    const float *h0re, *h0im, *h1re, *h1im;
+    float g0, g1, t, xr, xi;
+    int c, k, d0, d1;
+
+    d0 = (int) hrtf->position[queued];
+    t = hrtf->position[queued] - d0;
+    d0 %= hrtf->directions;
+    d1 = (d0 + 1) % hrtf->directions;
+    g0 = hrtf->gain[queued] * (1.f - t);
+    g1 = hrtf->gain[queued] * t;
+
+    for (c = 0; c < 2; c++) {
+        float *ore = hrtf->accre[c], *oim = hrtf->accim[c];
+
+        h0re = hrtf->specre + (d0 * 2 + c) * MV_ConvBins;
+        h0im = hrtf->specim + (d0 * 2 + c) * MV_ConvBins;
+        h1re = hrtf->specre + (d1 * 2 + c) * MV_ConvBins;
+        h1im = hrtf->specim + (d1 * 2 + c) * MV_ConvBins;
+        for (k = 0; k < MV_ConvBins; k++) {
+            float hr = g0 * h0re[k] + g1 * h1re[k];
+            float hi = g0 * h0im[k] + g1 * h1im[k];
+
+            xr = xre[k];
+            xi = xim[k];
+            ore[k] += xr * hr - xi * hi;
+            oim[k] += xr * hi + xi * hr;
+        }
+    }
+}
+
+/*
+ Renders the queued voices and adds MixBufferSize samples to each of
+ the left and right outputs.
+ */
+void MV_RenderHRTF(hrtfset *hrtf, float *left, float *right)
+{
+    float *re = hrtf->workre, *im = hrtf->workim;
+    float are[MV_ConvBins], aim[MV_ConvBins], bre[MV_ConvBins], bim[MV_ConvBins];
+    float scale;
+    int q, k;
+
+    hrtf->frame++;
+    if (hrtf->queued == 0) {
+        return;
+    }
+
+    memset(hrtf->accre, 0, sizeof(hrtf->accre));
+    memset(hrtf->accim, 0, sizeof(hrtf->accim));
+
+    for (q = 0; q < hrtf->queued; q += 2) {
+        memcpy(re, hrtf->window[q], sizeof(hrtf->workre));
+        if (q + 1 < hrtf->queued) {
+            memcpy(im, hrtf->window[q + 1], sizeof(hrtf->workim));
+        } else {
+            memset(im, 0, sizeof(hrtf->workim));
+        }
+
+        MV_FFT(hrtf->plan, re, im, 0);
+
+        // split the two real signals' spectra by conjugate symmetry
+        for (k = 0; k < MV_ConvBins; k++) {
+            int m = (MV_ConvFFTSize - k) & (MV_ConvFFTSize - 1);
+
+            are[k] = 0.5f * (re[k] + re[m]);
+            aim[k] = 0.5f * (im[k] - im[m]);
+            bre[k] = 0.5f * (im[k] + im[m]);
+            bim[k] = 0.5f * (re[m] - re[k]);
+        }
+
+        accumulate(hrtf, are, aim, q);
+        if (q + 1 < hrtf->queued) {
+            accumulate(hrtf, bre, bim, q + 1);
+        }
+    }
+    hrtf->queued = 0;
+
+    // pack left + j*right, filling the upper bins by conjugate symmetry
+    for (k = 0; k < MV_ConvBins; k++) {
+        re[k] = hrtf->accre[0][k] - hrtf->accim[1][k];
+        im[k] = hrtf->accim[0][k] + hrtf->accre[1][k];
+    }
+    for (k = MV_ConvBins; k < MV_ConvFFTSize; k++) {
+        int m = MV_ConvFFTSize - k;
+        re[k] = hrtf->accre[0][m] + hrtf->accim[1][m];
+        im[k] = hrtf->accre[1][m] - hrtf->accim[0][m];
+    }
+
+    MV_FFT(hrtf->plan, re, im, 1);
+
+    scale = 1.f / MV_ConvFFTSize;
+    for (k = 0; k < MixBufferSize; k++) {
+        left[k] += re[MixBufferSize + k] * scale;
+        right[k] += im[MixBufferSize + k] * scale;
+    }
+}
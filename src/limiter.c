@@ -0,0 +1,193 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Look-ahead peak limiter with optional compression
+ *
+ * The signal is delayed by the look-ahead while the gain it needs is
+ * worked out ahead of it. The required gain is held at the minimum over
+ * the look-ahead window, released slowly, and then box-averaged over
+ * the same window, so the gain is already down when a peak reaches the
+ * output and no sample ever exceeds the ceiling. Only the windowed
+ * minimum runs sample by sample; the peak detection, the gain curve,
+ * the delay and the gain multiply run over whole buffers in plain
+ * loops the compiler can vectorise.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+
+limiter *MV_CreateLimiter(int channels)
+{
+    limiter *lim;
+
+    lim = (limiter *) malloc(sizeof(limiter));
+    if (!lim) {
+        return NULL;
+    }
+    memset(lim, 0, sizeof(limiter));
+
+    lim->channels = channels;
+    lim->lookahead = 1;
+    lim->envelope = 1.f;
+    lim->window[0] = 1.f;
+    lim->sum = 1.0;
+    lim->ceiling = 32700.f;
+    lim->threshold = 32768.f;
+    lim->slope = 0.f;
+    lim->release = 0.f;
+
+    return lim;
+}
+
+void MV_DestroyLimiter(limiter *lim)
+{
+    free(lim);
+}
+
+/*
+ lookahead is in frames and is clamped to MV_MaxLookahead. release is
+ in frames for the gain to recover by about 63%. threshold is the
+ level, on the 16-bit scale, above which the signal is compressed by
+ ratio:1. A ratio of 1 or less limits only.
+ */
+void MV_SetLimiterParams(limiter *lim, int lookahead, int release, float threshold, float ratio)
+{
+    int i;
+
+    lookahead = lookahead < 1 ? 1 : lookahead > MV_MaxLookahead ? MV_MaxLookahead : lookahead;
+    if (lookahead != lim->lookahead) {
+        // a new window length restarts the gain state and the delay
+        lim->lookahead = lookahead;
+        lim->head = lim->tail = 0;
+        lim->frame = 0;
+        lim->winpos = 0;
+        lim->envelope = 1.f;
+        for (i = 0; i < lookahead; i++) {
+            lim->window[i] = 1.f;
+        }
+        lim->sum = lookahead;
+        memset(lim->delay, 0, sizeof(lim->delay));
+    }
+
+    lim->release = release > 0 ? (float) exp(-1.0 / release) : 0.f;
+    lim->threshold = threshold > 1.f ? threshold : 1.f;
+    lim->slope = ratio > 1.f ? 1.f - 1.f / ratio : 0.f;
+}
+
+/*
+ Limits MixBufferSize frames of interleaved samples in place. The
+ output is the input delayed by the look-ahead.
+ */
+void MV_ProcessLimiter(limiter *lim, float *data)
+{
+    float peak[MixBufferSize], gain[MixBufferSize];
+    float *delay = lim->delay;
+    float g, held, env = lim->envelope;
+    float ceiling = lim->ceiling, threshold = lim->threshold, slope = lim->slope;
+    float release = lim->release, scale = 1.f / lim->lookahead;
+    int channels = lim->channels, lookahead = lim->lookahead;
+    int i, count = MixBufferSize * channels;
+
+    // per-frame peak and the gain it asks for
+    if (channels == 2) {
+        for (i = 0; i < MixBufferSize; i++) {
+            float l = fabsf(data[i * 2]), r = fabsf(data[i * 2 + 1]);
+            peak[i] = l > r ? l : r;
+        }
+    } else if (channels == 1) {
+        for (i = 0; i < MixBufferSize; i++) {
+            peak[i] = fabsf(data[i]);
+        }
+    } else {
+        for (i = 0; i < MixBufferSize; i++) {
+            const float *frame = data + i * channels;
+            float p = 0.f;
+            int c;
+
+            for (c = 0; c < channels; c++) {
+                p = fabsf(frame[c]) > p ? fabsf(frame[c]) : p;
+            }
+            peak[i] = p;
+        }
+    }
+
+    for (i = 0; i < MixBufferSize; i++) {
+        g = peak[i] > ceiling ? ceiling / peak[i] : 1.f;
+        if (slope > 0.f && peak[i] > threshold) {
+            float c = powf(peak[i] / threshold, -slope);
+            g = c < g ? c : g;
+        }
+        gain[i] = g;
+    }
+
+    // hold the minimum over the window, release, then smooth
+    for (i = 0; i < MixBufferSize; i++, lim->frame++) {
+        g = gain[i];
+        while (lim->head != lim->tail &&
+               lim->minval[(lim->tail - 1) & (MV_LimiterRing - 1)] >= g) {
+            lim->tail--;
+        }
+        lim->minval[lim->tail & (MV_LimiterRing - 1)] = g;
+        lim->minframe[lim->tail & (MV_LimiterRing - 1)] = lim->frame;
+        lim->tail++;
+        if (lim->frame - lim->minframe[lim->head & (MV_LimiterRing - 1)] > (unsigned) lookahead) {
+            lim->head++;
+        }
+        held = lim->minval[lim->head & (MV_LimiterRing - 1)];
+
+        env = held < env ? held : held + (env - held) * release;
+
+        lim->sum += env - lim->window[lim->winpos];
+        lim->window[lim->winpos] = env;
+        if (++lim->winpos >= lookahead) {
+            int k;
+
+            // re-add the window once per lap so rounding cannot build up
+            lim->winpos = 0;
+            lim->sum = 0.0;
+            for (k = 0; k < lookahead; k++) {
+                lim->sum += lim->window[k];
+            }
+        }
+        gain[i] = (float) lim->sum * scale;
+    }
+    lim->envelope = env;
+
+    // the delay line holds lookahead frames ahead of the new buffer
+    memcpy(delay + lookahead * channels, data, count * sizeof(float));
+    if (channels == 2) {
+        for (i = 0; i < MixBufferSize; i++) {
+            data[i * 2] = delay[i * 2] * gain[i];
+            data[i * 2 + 1] = delay[i * 2 + 1] * gain[i];
+        }
+    } else if (channels == 1) {
+        for (i = 0; i < MixBufferSize; i++) {
+            data[i] = delay[i] * gain[i];
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            data[i] = delay[i] * gain[i / channels];
+        }
+    }
+    memmove(delay, delay + count, lookahead * channels * sizeof(float));
+}
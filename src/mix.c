@@ -163,6 +163,8 @@ void MV_Mix16BitMono16( unsigned int position, unsigned int rate,
     unsigned short *source = (unsigned short *) start;
     short *dest = (short *) MV_MixDestination;
     int sample0l, sample0h, sample0;
+    // the low byte's share of the zero offset, exact at any volume
+    int bias0 = -(MV_LeftVolume[0] >> 8);
     
     while (length--) {
         sample0 = source[position >> 16];
@@ -177,7 +179,7 @@ void MV_Mix16BitMono16( unsigned int position, unsigned int rate,
         
         sample0l = MV_LeftVolume[sample0l] >> 8;
         sample0h = MV_LeftVolume[sample0h];
-        sample0 = sample0l + sample0h + 128 + *dest;
+        sample0 = sample0l + sample0h + bias0 + *dest;
         if (sample0 < -32768) sample0 = -32768;
         else if (sample0 > 32767) sample0 = 32767;
         
@@ -250,6 +252,8 @@ void MV_Mix16BitStereo16( unsigned int position, unsigned int rate,
     short *dest = (short *) MV_MixDestination;
     int sample0l, sample0h, sample0;
     int sample1l, sample1h, sample1;
+    int bias0 = -(MV_LeftVolume[0] >> 8);
+    int bias1 = -(MV_RightVolume[0] >> 8);
     
     while (length--) {
         sample0 = source[position >> 16];
@@ -268,8 +272,8 @@ void MV_Mix16BitStereo16( unsigned int position, unsigned int rate,
         sample0h = MV_LeftVolume[sample0h];
         sample1l = MV_RightVolume[sample1l] >> 8;
         sample1h = MV_RightVolume[sample1h];
-        sample0 = sample0l + sample0h + 128 + *dest;
-        sample1 = sample1l + sample1h + 128 + *(dest + MV_RightChannelOffset/2);
+        sample0 = sample0l + sample0h + bias0 + *dest;
+        sample1 = sample1l + sample1h + bias1 + *(dest + MV_RightChannelOffset/2);
         if (sample0 < -32768) sample0 = -32768;
         else if (sample0 > 32767) sample0 = 32767;
         if (sample1 < -32768) sample1 = -32768;
@@ -290,6 +294,7 @@ void MV_16BitReverb( char *src, char *dest, VOLUME16 *volume, unsigned int count
     unsigned short * input = (unsigned short *) src;
     short * output = (short *) dest;
     short sample0l, sample0h, sample0;
+    short bias0 = -(((short *) volume)[0] >> 8);
     
     do {
         sample0 = *input;
@@ -303,7 +308,7 @@ void MV_16BitReverb( char *src, char *dest, VOLUME16 *volume, unsigned int count
         
         sample0l = ((short *) volume)[sample0l] >> 8;
         sample0h = ((short *) volume)[sample0h];
-        *output = (short) (sample0l + sample0h + 128);
+        *output = (short) (sample0l + sample0h + bias0);
         
         input++;
         output++;
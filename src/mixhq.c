@@ -0,0 +1,317 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Interpolating mixers for 16-bit output
+ */
+
+#include <math.h>
+#include "_multivc.h"
+
+extern char  *MV_MixDestination;			// pointer to the next output sample
+extern unsigned int MV_MixPosition;		// return value of where the source pointer got to
+extern unsigned int MV_MixLastSample;	// index of the last sample frame in the source block
+extern short *MV_LeftVolume;
+extern short *MV_RightVolume;
+extern int    MV_SampleSize;
+extern int    MV_RightChannelOffset;
+extern const short *MV_MixExpand;
+
+#ifdef __POWERPC__
+# define BIGENDIAN
+#endif
+
+// Catmull-Rom coefficients in 2.14 fixed point, indexed by the top
+// eight bits of the fractional source position
+static short MV_CubicTable[256][4];
+
+void MV_InitInterpolation(void)
+{
+    int i;
+    double t, t2, t3;
+
+    for (i = 0; i < 256; i++) {
+        t = i / 256.0;
+        t2 = t * t;
+        t3 = t2 * t;
+
+        MV_CubicTable[i][0] = (short) floor(0.5 + 16384.0 * 0.5 * (-t3 + 2.0 * t2 - t));
+        MV_CubicTable[i][1] = (short) floor(0.5 + 16384.0 * 0.5 * (3.0 * t3 - 5.0 * t2 + 2.0));
+        MV_CubicTable[i][2] = (short) floor(0.5 + 16384.0 * 0.5 * (-3.0 * t3 + 4.0 * t2 + t));
+        MV_CubicTable[i][3] = (short) floor(0.5 + 16384.0 * 0.5 * (t3 - t2));
+    }
+}
+
+// fetch a source sample as signed 16-bit; bits of 0 marks companded
+// 8-bit data expanded through MV_MixExpand
+static inline int MV_FetchSample(const char *start, unsigned int index,
+                                 int bits, int channels, int channel)
+{
+    if (bits == 0) {
+        return MV_MixExpand[((const unsigned char *) start)[index * channels + channel]];
+    }
+
+    if (bits == 16) {
+        unsigned int sample = ((const unsigned short *) start)[index * channels + channel];
+#ifdef BIGENDIAN
+        sample = ((sample & 255) << 8) | (sample >> 8);
+#endif
+        return (short) sample;
+    }
+
+    return ((int) ((const unsigned char *) start)[index * channels + channel] - 128) << 8;
+}
+
+// interpolate a source sample at a 16.16 position, never reading past
+// the end of the current block
+static inline int MV_InterpolateSample(const char *start, unsigned int position,
+                                       int bits, int channels, int channel, int cubic)
+{
+    unsigned int index = position >> 16;
+    unsigned int next = index < MV_MixLastSample ? index + 1 : MV_MixLastSample;
+    int sample0, sample1, samplem, sample2;
+    const short *coef;
+
+    sample0 = MV_FetchSample(start, index, bits, channels, channel);
+    sample1 = MV_FetchSample(start, next, bits, channels, channel);
+
+    if (!cubic) {
+        return sample0 + (((sample1 - sample0) * (int) ((position >> 1) & 0x7fff)) >> 15);
+    }
+
+    samplem = MV_FetchSample(start, index > 0 ? index - 1 : 0, bits, channels, channel);
+    sample2 = MV_FetchSample(start, next < MV_MixLastSample ? next + 1 : MV_MixLastSample,
+                             bits, channels, channel);
+
+    coef = MV_CubicTable[(position >> 8) & 255];
+    sample0 = (coef[0] * samplem + coef[1] * sample0 + coef[2] * sample1 + coef[3] * sample2) >> 14;
+    if (sample0 < -32768) sample0 = -32768;
+    else if (sample0 > 32767) sample0 = 32767;
+
+    return sample0;
+}
+
+// scale a signed 16-bit sample through a volume table
+static inline int MV_ScaleSample(const short *volume, int sample)
+{
+    return (volume[sample & 255] >> 8) + volume[((sample >> 8) & 255) ^ 128] - (volume[0] >> 8);
+}
+
+static inline void MV_MixInterpolated(unsigned int position, unsigned int rate,
+                                      char *start, unsigned int length,
+                                      int bits, int channels, int stereoout, int cubic)
+{
+    short *dest = (short *) MV_MixDestination;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = MV_InterpolateSample(start, position, bits, channels, 0, cubic);
+        if (channels == 2) {
+            sample1 = MV_InterpolateSample(start, position, bits, channels, 1, cubic);
+        } else {
+            sample1 = sample0;
+        }
+        position += rate;
+
+        if (stereoout) {
+            sample0 = MV_ScaleSample(MV_LeftVolume, sample0) + *dest;
+            sample1 = MV_ScaleSample(MV_RightVolume, sample1) + *(dest + MV_RightChannelOffset / 2);
+            if (sample0 < -32768) sample0 = -32768;
+            else if (sample0 > 32767) sample0 = 32767;
+            if (sample1 < -32768) sample1 = -32768;
+            else if (sample1 > 32767) sample1 = 32767;
+
+            *dest = (short) sample0;
+            *(dest + MV_RightChannelOffset / 2) = (short) sample1;
+        } else {
+            if (channels == 2) {
+                sample0 = (MV_ScaleSample(MV_LeftVolume, sample0) +
+                           MV_ScaleSample(MV_LeftVolume, sample1)) / 2 + *dest;
+            } else {
+                sample0 = MV_ScaleSample(MV_LeftVolume, sample0) + *dest;
+            }
+            if (sample0 < -32768) sample0 = -32768;
+            else if (sample0 > 32767) sample0 = 32767;
+
+            *dest = (short) sample0;
+        }
+
+        dest += MV_SampleSize / 2;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// 8-bit mono source, 16-bit mono output
+void MV_Mix16BitMonoLinear( unsigned int position, unsigned int rate,
+                           char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 1, 0, 0);
+}
+
+void MV_Mix16BitMonoCubic( unsigned int position, unsigned int rate,
+                          char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 1, 0, 1);
+}
+
+// 8-bit mono source, 16-bit stereo output
+void MV_Mix16BitStereoLinear( unsigned int position, unsigned int rate,
+                             char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 1, 1, 0);
+}
+
+void MV_Mix16BitStereoCubic( unsigned int position, unsigned int rate,
+                            char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 1, 1, 1);
+}
+
+// 16-bit mono source, 16-bit mono output
+void MV_Mix16BitMono16Linear( unsigned int position, unsigned int rate,
+                             char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 1, 0, 0);
+}
+
+void MV_Mix16BitMono16Cubic( unsigned int position, unsigned int rate,
+                            char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 1, 0, 1);
+}
+
+// 16-bit mono source, 16-bit stereo output
+void MV_Mix16BitStereo16Linear( unsigned int position, unsigned int rate,
+                               char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 1, 1, 0);
+}
+
+void MV_Mix16BitStereo16Cubic( unsigned int position, unsigned int rate,
+                              char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 1, 1, 1);
+}
+
+// 8-bit stereo source, 16-bit mono output
+void MV_Mix16BitMono8StereoLinear( unsigned int position, unsigned int rate,
+                                  char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 2, 0, 0);
+}
+
+void MV_Mix16BitMono8StereoCubic( unsigned int position, unsigned int rate,
+                                 char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 2, 0, 1);
+}
+
+// 8-bit stereo source, 16-bit stereo output
+void MV_Mix16BitStereo8StereoLinear( unsigned int position, unsigned int rate,
+                                    char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 2, 1, 0);
+}
+
+void MV_Mix16BitStereo8StereoCubic( unsigned int position, unsigned int rate,
+                                   char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 8, 2, 1, 1);
+}
+
+// 16-bit stereo source, 16-bit mono output
+void MV_Mix16BitMono16StereoLinear( unsigned int position, unsigned int rate,
+                                   char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 2, 0, 0);
+}
+
+void MV_Mix16BitMono16StereoCubic( unsigned int position, unsigned int rate,
+                                  char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 2, 0, 1);
+}
+
+// 16-bit stereo source, 16-bit stereo output
+void MV_Mix16BitStereo16StereoLinear( unsigned int position, unsigned int rate,
+                                     char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 2, 1, 0);
+}
+
+void MV_Mix16BitStereo16StereoCubic( unsigned int position, unsigned int rate,
+                                    char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 16, 2, 1, 1);
+}
+
+// companded mono source, 16-bit mono output
+void MV_Mix16BitMonoLawLinear( unsigned int position, unsigned int rate,
+                              char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 1, 0, 0);
+}
+
+void MV_Mix16BitMonoLawCubic( unsigned int position, unsigned int rate,
+                             char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 1, 0, 1);
+}
+
+// companded mono source, 16-bit stereo output
+void MV_Mix16BitStereoLawLinear( unsigned int position, unsigned int rate,
+                                char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 1, 1, 0);
+}
+
+void MV_Mix16BitStereoLawCubic( unsigned int position, unsigned int rate,
+                               char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 1, 1, 1);
+}
+
+// companded stereo source, 16-bit mono output
+void MV_Mix16BitMonoLawStereoLinear( unsigned int position, unsigned int rate,
+                                    char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 2, 0, 0);
+}
+
+void MV_Mix16BitMonoLawStereoCubic( unsigned int position, unsigned int rate,
+                                   char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 2, 0, 1);
+}
+
+// companded stereo source, 16-bit stereo output
+void MV_Mix16BitStereoLawStereoLinear( unsigned int position, unsigned int rate,
+                                      char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 2, 1, 0);
+}
+
+void MV_Mix16BitStereoLawStereoCubic( unsigned int position, unsigned int rate,
+                                     char *start, unsigned int length )
+{
+    MV_MixInterpolated(position, rate, start, length, 0, 2, 1, 1);
+}
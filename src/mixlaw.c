@@ -0,0 +1,293 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Mixers for A-law and mu-law companded sources
+ *
+ * Each 8-bit code is expanded to signed 16-bit through the voice's
+ * table in MV_MixExpand and then scaled like a 16-bit sample, so the
+ * sound is never decoded ahead of the mix.
+ */
+
+#include "_multivc.h"
+
+extern char  *MV_HarshClipTable;
+extern char  *MV_MixDestination;			// pointer to the next output sample
+extern unsigned int MV_MixPosition;		// return value of where the source pointer got to
+extern short *MV_LeftVolume;
+extern short *MV_RightVolume;
+extern int    MV_SampleSize;
+extern int    MV_RightChannelOffset;
+extern const short *MV_MixExpand;
+
+short MV_ALawTable[256];
+short MV_MuLawTable[256];
+
+// G.711 expansion
+void MV_InitCompanding(void)
+{
+    int i, t, seg;
+
+    for (i = 0; i < 256; i++) {
+        t = i ^ 0x55;
+        seg = (t & 0x70) >> 4;
+        if (seg == 0) {
+            t = ((t & 0x0f) << 4) + 8;
+        } else {
+            t = (((t & 0x0f) << 4) + 0x108) << (seg - 1);
+        }
+        MV_ALawTable[i] = (short) ((i & 0x80) ? t : -t);
+
+        t = ~i & 255;
+        seg = (t & 0x70) >> 4;
+        t = ((((t & 0x0f) << 3) + 0x84) << seg) - 0x84;
+        MV_MuLawTable[i] = (short) ((~i & 0x80) ? -t : t);
+    }
+}
+
+// scale a signed 16-bit sample through a volume table
+static inline int MV_ScaleLaw(const short *volume, int sample)
+{
+    return (volume[sample & 255] >> 8) + volume[((sample >> 8) & 255) ^ 128] - (volume[0] >> 8);
+}
+
+// companded mono source, 8-bit mono output
+void MV_Mix8BitMonoLaw( unsigned int position, unsigned int rate,
+                       char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    unsigned char *dest = (unsigned char *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0;
+
+    while (length--) {
+        sample0 = expand[source[position >> 16]] >> 8;
+        position += rate;
+
+        sample0 = MV_LeftVolume[sample0 + 128] + *dest;
+        sample0 = MV_HarshClipTable[sample0 + 128];
+
+        *dest = sample0 & 255;
+
+        dest += MV_SampleSize;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded mono source, 8-bit stereo output
+void MV_Mix8BitStereoLaw( unsigned int position, unsigned int rate,
+                         char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    unsigned char *dest = (unsigned char *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[position >> 16]] >> 8;
+        sample1 = sample0;
+        position += rate;
+
+        sample0 = MV_LeftVolume[sample0 + 128] + *dest;
+        sample1 = MV_RightVolume[sample1 + 128] + *(dest + MV_RightChannelOffset);
+        sample0 = MV_HarshClipTable[sample0 + 128];
+        sample1 = MV_HarshClipTable[sample1 + 128];
+
+        *dest = sample0 & 255;
+        *(dest + MV_RightChannelOffset) = sample1 & 255;
+
+        dest += MV_SampleSize;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded mono source, 16-bit mono output
+void MV_Mix16BitMonoLaw( unsigned int position, unsigned int rate,
+                        char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    short *dest = (short *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0;
+
+    while (length--) {
+        sample0 = expand[source[position >> 16]];
+        position += rate;
+
+        sample0 = MV_ScaleLaw(MV_LeftVolume, sample0) + *dest;
+        if (sample0 < -32768) sample0 = -32768;
+        else if (sample0 > 32767) sample0 = 32767;
+
+        *dest = (short) sample0;
+
+        dest += MV_SampleSize / 2;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded mono source, 16-bit stereo output
+void MV_Mix16BitStereoLaw( unsigned int position, unsigned int rate,
+                          char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    short *dest = (short *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[position >> 16]];
+        sample1 = sample0;
+        position += rate;
+
+        sample0 = MV_ScaleLaw(MV_LeftVolume, sample0) + *dest;
+        sample1 = MV_ScaleLaw(MV_RightVolume, sample1) + *(dest + MV_RightChannelOffset / 2);
+        if (sample0 < -32768) sample0 = -32768;
+        else if (sample0 > 32767) sample0 = 32767;
+        if (sample1 < -32768) sample1 = -32768;
+        else if (sample1 > 32767) sample1 = 32767;
+
+        *dest = (short) sample0;
+        *(dest + MV_RightChannelOffset / 2) = (short) sample1;
+
+        dest += MV_SampleSize / 2;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded stereo source, 8-bit mono output
+void MV_Mix8BitMonoLawStereo( unsigned int position, unsigned int rate,
+                             char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    unsigned char *dest = (unsigned char *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[(position >> 16) << 1]] >> 8;
+        sample1 = expand[source[((position >> 16) << 1) + 1]] >> 8;
+        position += rate;
+
+        sample0 = (MV_LeftVolume[sample0 + 128] + MV_LeftVolume[sample1 + 128]) / 2 + *dest;
+        sample0 = MV_HarshClipTable[sample0 + 128];
+
+        *dest = sample0 & 255;
+
+        dest += MV_SampleSize;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded stereo source, 8-bit stereo output
+void MV_Mix8BitStereoLawStereo( unsigned int position, unsigned int rate,
+                               char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    unsigned char *dest = (unsigned char *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[(position >> 16) << 1]] >> 8;
+        sample1 = expand[source[((position >> 16) << 1) + 1]] >> 8;
+        position += rate;
+
+        sample0 = MV_LeftVolume[sample0 + 128] + *dest;
+        sample1 = MV_RightVolume[sample1 + 128] + *(dest + MV_RightChannelOffset);
+        sample0 = MV_HarshClipTable[sample0 + 128];
+        sample1 = MV_HarshClipTable[sample1 + 128];
+
+        *dest = sample0 & 255;
+        *(dest + MV_RightChannelOffset) = sample1 & 255;
+
+        dest += MV_SampleSize;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded stereo source, 16-bit mono output
+void MV_Mix16BitMonoLawStereo( unsigned int position, unsigned int rate,
+                              char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    short *dest = (short *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[(position >> 16) << 1]];
+        sample1 = expand[source[((position >> 16) << 1) + 1]];
+        position += rate;
+
+        sample0 = MV_ScaleLaw(MV_LeftVolume, (sample0 + sample1) >> 1) + *dest;
+        if (sample0 < -32768) sample0 = -32768;
+        else if (sample0 > 32767) sample0 = 32767;
+
+        *dest = (short) sample0;
+
+        dest += MV_SampleSize / 2;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
+
+// companded stereo source, 16-bit stereo output
+void MV_Mix16BitStereoLawStereo( unsigned int position, unsigned int rate,
+                                char *start, unsigned int length )
+{
+    unsigned char *source = (unsigned char *) start;
+    short *dest = (short *) MV_MixDestination;
+    const short *expand = MV_MixExpand;
+    int sample0, sample1;
+
+    while (length--) {
+        sample0 = expand[source[(position >> 16) << 1]];
+        sample1 = expand[source[((position >> 16) << 1) + 1]];
+        position += rate;
+
+        sample0 = MV_ScaleLaw(MV_LeftVolume, sample0) + *dest;
+        sample1 = MV_ScaleLaw(MV_RightVolume, sample1) + *(dest + MV_RightChannelOffset / 2);
+        if (sample0 < -32768) sample0 = -32768;
+        else if (sample0 > 32767) sample0 = 32767;
+        if (sample1 < -32768) sample1 = -32768;
+        else if (sample1 > 32767) sample1 = 32767;
+
+        *dest = (short) sample0;
+        *(dest + MV_RightChannelOffset / 2) = (short) sample1;
+
+        dest += MV_SampleSize / 2;
+    }
+
+    MV_MixPosition = position;
+    MV_MixDestination = (char *) dest;
+}
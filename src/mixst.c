@@ -158,6 +158,7 @@ void MV_Mix16BitMono16Stereo( unsigned int position, unsigned int rate,
     short *dest = (short *) MV_MixDestination;
     int sample0l, sample0h, sample0;
     int sample1l, sample1h, sample1;
+    int bias0 = -(MV_LeftVolume[0] >> 8);
     
     while (length--) {
         sample0 = source[(position >> 16) << 1];
@@ -177,10 +178,10 @@ void MV_Mix16BitMono16Stereo( unsigned int position, unsigned int rate,
         
         sample0l = MV_LeftVolume[sample0l] >> 8;
         sample0h = MV_LeftVolume[sample0h];
-        sample0 = sample0l + sample0h + 128;
+        sample0 = sample0l + sample0h + bias0;
         sample1l = MV_LeftVolume[sample1l] >> 8;
         sample1h = MV_LeftVolume[sample1h];
-        sample1 = sample1l + sample1h + 128;
+        sample1 = sample1l + sample1h + bias0;
         
         sample0 = (sample0 + sample1) / 2 + *dest;
         if (sample0 < -32768) sample0 = -32768;
@@ -258,6 +259,8 @@ void MV_Mix16BitStereo16Stereo( unsigned int position, unsigned int rate,
     short *dest = (short *) MV_MixDestination;
     int sample0l, sample0h, sample0;
     int sample1l, sample1h, sample1;
+    int bias0 = -(MV_LeftVolume[0] >> 8);
+    int bias1 = -(MV_RightVolume[0] >> 8);
     
     while (length--) {
         sample0 = source[(position >> 16) << 1];
@@ -279,8 +282,8 @@ void MV_Mix16BitStereo16Stereo( unsigned int position, unsigned int rate,
         sample0h = MV_LeftVolume[sample0h];
         sample1l = MV_RightVolume[sample1l] >> 8;
         sample1h = MV_RightVolume[sample1h];
-        sample0 = sample0l + sample0h + 128 + *dest;
-        sample1 = sample1l + sample1h + 128 + *(dest + MV_RightChannelOffset/2);
+        sample0 = sample0l + sample0h + bias0 + *dest;
+        sample1 = sample1l + sample1h + bias1 + *(dest + MV_RightChannelOffset/2);
         if (sample0 < -32768) sample0 = -32768;
         else if (sample0 > 32767) sample0 = 32767;
         if (sample1 < -32768) sample1 = -32768;
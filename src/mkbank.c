@@ -0,0 +1,569 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * mkbank: packs WAV, VOC, Ogg Vorbis and FLAC files into a sound bank
+ *
+ * WAV and VOC samples are stored ready to mix. 24 and 32-bit PCM and
+ * float WAVs are reduced to 16 bits, VOC blocks are joined, silence
+ * blocks are filled in and an endless VOC repeat becomes the sound's
+ * loop. Ogg Vorbis and FLAC files are stored whole for their decoders.
+ * Sounds are numbered in the order they are given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bank.h"
+
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_ALAW       0x0006
+#define WAVE_FORMAT_MULAW      0x0007
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_IMA_ADPCM  0x0011
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+
+typedef struct {
+    bank_entry entry;
+    unsigned char * data;
+    unsigned int length;
+    int owned;
+} sound;
+
+static unsigned int get16(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void put16(unsigned char * p, unsigned int v)
+{
+    p[0] = v & 255;
+    p[1] = (v >> 8) & 255;
+}
+
+static void put32(unsigned char * p, unsigned int v)
+{
+    p[0] = v & 255;
+    p[1] = (v >> 8) & 255;
+    p[2] = (v >> 16) & 255;
+    p[3] = (v >> 24) & 255;
+}
+
+static unsigned char * readfile(const char * name, unsigned int * length)
+{
+    FILE * fp;
+    long size;
+    unsigned char * data;
+
+    fp = fopen(name, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    data = (unsigned char *) malloc(size > 0 ? size : 1);
+    if (!data || (size > 0 && fread(data, size, 1, fp) != 1)) {
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+    *length = (unsigned int) size;
+    return data;
+}
+
+/*
+ Reduces 24 and 32-bit integer or float samples to 16 bits in place.
+ */
+static unsigned int narrow(unsigned char * data, unsigned int length, int bits, int isfloat)
+{
+    int width = bits / 8;
+    unsigned int count = length / width, i;
+    short * out = (short *) data;
+
+    for (i = 0; i < count; i++) {
+        const unsigned char * in = data + i * width;
+        int sample;
+
+        if (isfloat) {
+            union { unsigned int u; float f; } v;
+            v.u = get32(in);
+            sample = (int) (v.f * 32768.f);
+            if (sample > 32767) sample = 32767;
+            else if (sample < -32768) sample = -32768;
+        } else {
+            sample = (signed char) in[width - 1] * 256 + in[width - 2];
+        }
+
+        // little-endian like the rest of the bank
+        put16((unsigned char *) &out[i], (unsigned int) sample);
+    }
+
+    return count * 2;
+}
+
+static int loadwav(const char * name, unsigned char * file, unsigned int length, sound * snd)
+{
+    unsigned char * chunk = file + 12, * end = file + length;
+    unsigned char * fmt = NULL, * data = NULL;
+    unsigned int fmtsize = 0, datasize = 0, size;
+    int format, channels, bits, isfloat;
+
+    while (chunk + 8 <= end) {
+        size = get32(chunk + 4);
+        if (size > (unsigned int) (end - chunk) - 8) {
+            size = (unsigned int) (end - chunk) - 8;
+        }
+        if (!memcmp(chunk, "fmt ", 4)) {
+            fmt = chunk + 8;
+            fmtsize = size;
+        } else if (!memcmp(chunk, "data", 4)) {
+            data = chunk + 8;
+            datasize = size;
+        } else if (!memcmp(chunk, "smpl", 4) && size >= 36 + 24 && get32(chunk + 8 + 28) > 0) {
+            snd->entry.loopstart = (int) get32(chunk + 8 + 36 + 8);
+            snd->entry.loopend = (int) get32(chunk + 8 + 36 + 12) + 1;
+        }
+        chunk += 8 + ((size + 1) & ~1);
+    }
+
+    if (!fmt || fmtsize < 16 || !data) {
+        fprintf(stderr, "%s: no format or data chunk\n", name);
+        return 0;
+    }
+
+    format = get16(fmt);
+    channels = get16(fmt + 2);
+    bits = get16(fmt + 14);
+    if (format == WAVE_FORMAT_EXTENSIBLE && fmtsize >= 26) {
+        format = get16(fmt + 24);
+    }
+    isfloat = (format == WAVE_FORMAT_IEEE_FLOAT);
+
+    if (channels < 1 || channels > 2) {
+        fprintf(stderr, "%s: %d channels is not supported\n", name, channels);
+        return 0;
+    }
+
+    snd->entry.rate = get32(fmt + 4);
+    snd->entry.channels = channels;
+    snd->entry.bits = bits;
+    snd->entry.format = format;
+    snd->entry.blockalign = get16(fmt + 12);
+    snd->data = data;
+    snd->length = datasize;
+
+    if ((format == WAVE_FORMAT_PCM && (bits == 24 || bits == 32)) || (isfloat && bits == 32)) {
+        snd->data = (unsigned char *) malloc(datasize);
+        if (!snd->data) {
+            return 0;
+        }
+        memcpy(snd->data, data, datasize);
+        snd->owned = 1;
+        snd->length = narrow(snd->data, datasize, bits, isfloat);
+        snd->entry.format = WAVE_FORMAT_PCM;
+        snd->entry.bits = 16;
+    } else if (format == WAVE_FORMAT_IMA_ADPCM) {
+        if (bits != 4 || snd->entry.blockalign <= 4 * channels) {
+            fprintf(stderr, "%s: bad IMA ADPCM format\n", name);
+            return 0;
+        }
+        if (fmtsize >= 22) {
+            unsigned int spb = get16(fmt + 18);
+            snd->entry.frames = (datasize / snd->entry.blockalign) * spb;
+        }
+        return 1;
+    } else if (!((format == WAVE_FORMAT_PCM && (bits == 8 || bits == 16)) ||
+                 ((format == WAVE_FORMAT_ALAW || format == WAVE_FORMAT_MULAW) && bits == 8))) {
+        fprintf(stderr, "%s: WAV format %d with %d bits is not supported\n", name, format, bits);
+        return 0;
+    }
+
+    snd->entry.blockalign = channels * snd->entry.bits / 8;
+    snd->length -= snd->length % snd->entry.blockalign;
+    snd->entry.frames = snd->length / snd->entry.blockalign;
+    return 1;
+}
+
+static int appendvoc(sound * snd, const unsigned char * data, unsigned int length, unsigned int * size)
+{
+    unsigned char * grown;
+
+    if (snd->length + length > *size) {
+        *size = (snd->length + length) * 2;
+        grown = (unsigned char *) realloc(snd->data, *size);
+        if (!grown) {
+            return 0;
+        }
+        snd->data = grown;
+    }
+
+    if (data) {
+        memcpy(snd->data + snd->length, data, length);
+    } else {
+        memset(snd->data + snd->length, 128, length);
+    }
+    snd->length += length;
+    return 1;
+}
+
+static int loadvoc(const char * name, unsigned char * file, unsigned int length, sound * snd)
+{
+    unsigned char * block = file + get16(file + 0x14), * end = file + length;
+    unsigned int blocklength, rate = 0, size = 0, silence, tc;
+    int format = -1, channels = 1, bits = 8, extchannels = 0, haveext = 0;
+    int f, c, b, repeat = 0;
+
+    snd->owned = 1;
+    snd->data = NULL;
+    snd->length = 0;
+
+    while (block + 4 <= end && *block != 0) {
+        blocklength = get32(block + 1) & 0xffffff;
+        if (blocklength > (unsigned int) (end - block) - 4) {
+            blocklength = (unsigned int) (end - block) - 4;
+        }
+
+        f = -1;
+        c = channels;
+        b = bits;
+        switch (*block) {
+            case 1:
+                if (block[5] != 0) {
+                    fprintf(stderr, "%s: packed VOC data is not supported\n", name);
+                    return 0;
+                }
+                if (haveext) {
+                    c = extchannels;
+                } else {
+                    tc = (unsigned int) block[4] << 8;
+                    rate = 256000000L / (65536 - tc);
+                    c = 1;
+                }
+                haveext = 0;
+                f = WAVE_FORMAT_PCM;
+                b = 8;
+                blocklength -= 2;
+                block += 2;
+                break;
+
+            case 2:
+                f = format;
+                break;
+
+            case 3:
+                if (format >= 0 && (format != WAVE_FORMAT_PCM || bits != 8)) {
+                    fprintf(stderr, "%s: silence in non 8-bit VOC data is not supported\n", name);
+                    return 0;
+                }
+                silence = (get16(block + 4) + 1) * channels;
+                if (format < 0) {
+                    rate = 256000000L / (65536 - ((unsigned int) block[6] << 8));
+                    format = WAVE_FORMAT_PCM;
+                }
+                if (!appendvoc(snd, NULL, silence, &size)) {
+                    return 0;
+                }
+                break;
+
+            case 6:
+                if (get16(block + 4) == 0xffff) {
+                    repeat = 1;
+                    snd->entry.loopstart = snd->length / (channels * bits / 8);
+                }
+                break;
+
+            case 7:
+                if (repeat) {
+                    snd->entry.loopend = snd->length / (channels * bits / 8);
+                    repeat = 0;
+                }
+                break;
+
+            case 8:
+                tc = get16(block + 4);
+                extchannels = block[7] + 1;
+                rate = 256000000L / (extchannels * (65536 - tc));
+                haveext = 1;
+                if (block[6] != 0) {
+                    fprintf(stderr, "%s: packed VOC data is not supported\n", name);
+                    return 0;
+                }
+                break;
+
+            case 9:
+                rate = get32(block + 4);
+                b = block[8];
+                c = block[9];
+                switch (get16(block + 10)) {
+                    case 0: f = (b == 8) ? WAVE_FORMAT_PCM : -1; break;
+                    case 4: f = (b == 16) ? WAVE_FORMAT_PCM : -1; break;
+                    case 6: f = (b == 8) ? WAVE_FORMAT_ALAW : -1; break;
+                    case 7: f = (b == 8) ? WAVE_FORMAT_MULAW : -1; break;
+                }
+                if (f < 0 || c < 1 || c > 2) {
+                    fprintf(stderr, "%s: VOC sample format is not supported\n", name);
+                    return 0;
+                }
+                blocklength -= 12;
+                block += 12;
+                break;
+        }
+
+        if (f >= 0 && blocklength > 0) {
+            if (format >= 0 && snd->length > 0 && (f != format || c != channels || b != bits)) {
+                fprintf(stderr, "%s: VOC blocks change format\n", name);
+                return 0;
+            }
+            format = f;
+            channels = c;
+            bits = b;
+            if (!appendvoc(snd, block + 4, blocklength, &size)) {
+                return 0;
+            }
+        }
+
+        block += 4 + blocklength;
+    }
+
+    if (format < 0 || snd->length == 0 || rate == 0) {
+        fprintf(stderr, "%s: no samples\n", name);
+        return 0;
+    }
+
+    snd->entry.rate = rate;
+    snd->entry.format = format;
+    snd->entry.channels = channels;
+    snd->entry.bits = bits;
+    snd->entry.blockalign = channels * bits / 8;
+    snd->length -= snd->length % snd->entry.blockalign;
+    snd->entry.frames = snd->length / snd->entry.blockalign;
+    return 1;
+}
+
+static int loadstream(const char * name, unsigned char * file, unsigned int length, sound * snd)
+{
+    snd->entry.format = BANK_FORMAT_STREAM;
+    snd->data = file;
+    snd->length = length;
+
+    // take what the index can show from the stream headers
+    if (!memcmp(file, "fLaC", 4) && length >= 8 + 34 && (file[4] & 0x7f) == 0) {
+        const unsigned char * info = file + 8;
+        snd->entry.rate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+        snd->entry.channels = ((info[12] >> 1) & 7) + 1;
+        snd->entry.bits = 16;
+        snd->entry.frames = (info[14] << 24) | (info[15] << 16) | (info[16] << 8) | info[17];
+    } else if (length >= 27 && length >= 27u + file[26] + 16 &&
+               !memcmp(file + 27 + file[26], "\x01vorbis", 7)) {
+        const unsigned char * ident = file + 27 + file[26];
+        snd->entry.channels = ident[11];
+        snd->entry.rate = get32(ident + 12);
+        snd->entry.bits = 16;
+    } else {
+        fprintf(stderr, "%s: unrecognised stream\n", name);
+        return 0;
+    }
+
+    if (snd->entry.channels < 1 || snd->entry.channels > 2) {
+        fprintf(stderr, "%s: %d channels is not supported\n", name, snd->entry.channels);
+        return 0;
+    }
+    return 1;
+}
+
+static int loadsound(const char * name, sound * snd)
+{
+    unsigned char * file;
+    unsigned int length;
+    int ok;
+
+    memset(snd, 0, sizeof(sound));
+    snd->entry.loopstart = -1;
+    snd->entry.loopend = -1;
+
+    file = readfile(name, &length);
+    if (!file) {
+        fprintf(stderr, "%s: could not be read\n", name);
+        return 0;
+    }
+
+    if (length >= 12 && !memcmp(file, "RIFF", 4) && !memcmp(file + 8, "WAVE", 4)) {
+        ok = loadwav(name, file, length, snd);
+    } else if (length >= 26 && !memcmp(file, "Creative Voice File\x1a", 20)) {
+        ok = loadvoc(name, file, length, snd);
+    } else if (length >= 4 && (!memcmp(file, "OggS", 4) || !memcmp(file, "fLaC", 4))) {
+        ok = loadstream(name, file, length, snd);
+    } else {
+        fprintf(stderr, "%s: not a WAV, VOC, Ogg Vorbis or FLAC file\n", name);
+        ok = 0;
+    }
+
+    if (!ok) {
+        if (snd->owned) {
+            free(snd->data);
+        }
+        free(file);
+        return 0;
+    }
+
+    // keep the samples, not the file they came from
+    if (!snd->owned) {
+        unsigned char * copy = (unsigned char *) malloc(snd->length + 1);
+        if (!copy) {
+            free(file);
+            return 0;
+        }
+        memcpy(copy, snd->data, snd->length);
+        snd->data = copy;
+        snd->owned = 1;
+    }
+    free(file);
+
+    if (snd->entry.loopstart >= 0 && (unsigned int) snd->entry.loopstart >= snd->entry.frames &&
+        snd->entry.format != BANK_FORMAT_STREAM) {
+        snd->entry.loopstart = -1;
+        snd->entry.loopend = -1;
+    }
+    return 1;
+}
+
+static int writebank(const char * name, sound * sounds, int count)
+{
+    unsigned char header[sizeof(bank_header)], entry[sizeof(bank_entry)];
+    unsigned char pad[BANK_ALIGN];
+    unsigned int offset;
+    FILE * fp;
+    int i;
+
+    offset = sizeof(bank_header) + count * sizeof(bank_entry);
+    for (i = 0; i < count; i++) {
+        offset = (offset + BANK_ALIGN - 1) & ~(BANK_ALIGN - 1);
+        sounds[i].entry.offset = offset;
+        sounds[i].entry.length = sounds[i].length;
+        offset += sounds[i].length;
+    }
+
+    fp = fopen(name, "wb");
+    if (!fp) {
+        fprintf(stderr, "%s: could not be created\n", name);
+        return 0;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, BANK_MAGIC, 4);
+    put16(header + 4, BANK_VERSION);
+    put16(header + 6, count);
+    put32(header + 8, sizeof(bank_header));
+    put32(header + 12, offset);
+    fwrite(header, sizeof(header), 1, fp);
+
+    for (i = 0; i < count; i++) {
+        const bank_entry * e = &sounds[i].entry;
+
+        memset(entry, 0, sizeof(entry));
+        put32(entry + 0, e->offset);
+        put32(entry + 4, e->length);
+        put32(entry + 8, e->rate);
+        put32(entry + 12, e->frames);
+        put32(entry + 16, (unsigned int) e->loopstart);
+        put32(entry + 20, (unsigned int) e->loopend);
+        put16(entry + 24, e->format);
+        put16(entry + 26, e->blockalign);
+        entry[28] = e->channels;
+        entry[29] = e->bits;
+        fwrite(entry, sizeof(entry), 1, fp);
+    }
+
+    memset(pad, 0, sizeof(pad));
+    for (i = 0; i < count; i++) {
+        long pos = ftell(fp);
+        if (pos < (long) sounds[i].entry.offset) {
+            fwrite(pad, sounds[i].entry.offset - pos, 1, fp);
+        }
+        if (sounds[i].length > 0) {
+            fwrite(sounds[i].data, sounds[i].length, 1, fp);
+        }
+    }
+
+    if (ferror(fp) | fclose(fp)) {
+        fprintf(stderr, "%s: write failed\n", name);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char ** argv)
+{
+    static const char * formats[] = { "stream", "pcm", "?", "?", "?", "?", "alaw", "mulaw" };
+    sound * sounds;
+    int count, i, ok = 1;
+
+    if (argc < 3) {
+        puts("mkbank bank file...");
+        puts("");
+        puts("Packs WAV, VOC, Ogg Vorbis and FLAC files into a sound bank.");
+        puts("Sounds are numbered from 0 in the order given.");
+        return argc == 2 && !strcmp(argv[1], "-h") ? 0 : 1;
+    }
+
+    count = argc - 2;
+    if (count > 65535) {
+        fprintf(stderr, "too many sounds\n");
+        return 1;
+    }
+
+    sounds = (sound *) calloc(count, sizeof(sound));
+    if (!sounds) {
+        return 1;
+    }
+
+    for (i = 0; i < count && ok; i++) {
+        ok = loadsound(argv[i + 2], &sounds[i]);
+    }
+
+    if (ok) {
+        ok = writebank(argv[1], sounds, count);
+    }
+
+    for (i = 0; i < count; i++) {
+        const bank_entry * e = &sounds[i].entry;
+        if (ok) {
+            printf("%4d  %-6s %6uHz %d-ch %2d-bit %9u frames  %s\n", i,
+                e->format == WAVE_FORMAT_IMA_ADPCM ? "ima" : formats[e->format < 8 ? e->format : 2],
+                e->rate, e->channels, e->format == WAVE_FORMAT_IMA_ADPCM ? 4 : e->bits,
+                e->frames, argv[i + 2]);
+        }
+        free(sounds[i].data);
+    }
+    free(sounds);
+
+    return ok ? 0 : 1;
+}
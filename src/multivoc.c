@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
+#include <math.h>
 #include "linklist.h"
 #include "sndcards.h"
 #include "drivers.h"
@@ -49,6 +50,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
           ) >> (bits)                           \
         )
 
+// Fibonacci hash of a voice handle into MV_EmitterHashBits bits
+#define MV_HashHandle( handle ) \
+   ( ( ( unsigned int )( handle ) * 2654435761u ) >> ( 32 - MV_EmitterHashBits ) )
+
 #define IS_QUIET( ptr )  ( ( void * )( ptr ) == ( void * )&MV_VolumeTable[ 0 ] )
 
 static int       MV_ReverbLevel;
@@ -81,6 +86,38 @@ static int MV_SwapLeftRight = FALSE;
 static int MV_RequestedMixRate;
 int MV_MixRate;
 
+// Mixing at a rate other than the device's goes through a resampler
+// into a separate ring of output pages
+static int         MV_InternalMixRate = 0;
+static resampler  *MV_Resampler = NULL;
+static char       *MV_OutputBuffer[ NumberOfBuffers ];
+static int         MV_OutputPage;
+static float       MV_ResampleData[ MixBufferSize * MV_MaxOutputChannels ];
+
+// Surround devices get the stereo mix on the front pair, with voices
+// placed by the 3D functions spread over every speaker
+static int         MV_OutputChannels = 1;
+static int         MV_OutputPageSize;
+static float       MV_SpeakerGains[ MV_NumPanPositions ][ MV_MaxOutputChannels ];
+static float       MV_SpatialData[ MixBufferSize ][ MV_MaxOutputChannels ];
+static float       MV_SpatialInput[ MixBufferSize ];
+static int         MV_SpatialActive = FALSE;
+
+static listener    MV_Listener;
+static attenuation MV_Curves[ MV_NumCurves ];
+static float       MV_DopplerFactor = 1.f;
+static float       MV_SpeedOfSound  = 343.3f;
+
+// Headphone output renders the highest priority 3D voices binaurally
+static hrtfset    *MV_HRTF       = NULL;
+static int         MV_HRTFVoices = MV_DefaultHRTFVoices;
+static int         MV_HRTFUsed   = 0;
+static float       MV_HRTFLeft[ MixBufferSize ];
+static float       MV_HRTFRight[ MixBufferSize ];
+
+// Silence blocks in VOC files play from here, in unsigned 8-bit
+static unsigned char MV_VOCSilence[ MV_VOCWindow ];
+
 static int MV_BuffShift;
 
 static int MV_TotalMemory;
@@ -89,11 +126,90 @@ static int   MV_BufferEmpty[ NumberOfBuffers ];
 char *MV_MixBuffer[ NumberOfBuffers + 1 ];
 
 static VoiceNode *MV_Voices = NULL;
+static int MV_BlockVoices    = 0;
+static int MV_VoiceDeficit   = 0;
 
 static volatile VoiceNode VoiceList;
 static volatile VoiceNode VoicePool;
+static volatile VoiceNode VoiceReserve;
+
+typedef struct queuedata
+   {
+   struct queuedata *next;
+   int           inuse;
+   int           released;  // voice stopped, buffers left to hand back
+   int           handle;
+   char         *buffer[ MV_MaxQueuedBuffers ];
+   unsigned int  length[ MV_MaxQueuedBuffers ];
+   unsigned int  tail;      // next free slot, advanced by MV_QueueBuffer
+   unsigned int  head;      // next buffer to be played
+   unsigned int  finished;  // buffers completely consumed by the mixer
+   unsigned int  unqueued;  // buffers handed back by MV_UnqueueProcessed
+   int           playing;
+   int           ended;
+   } queuedata;
+
+// Queue state outlives its voice until the caller has taken back
+// every buffer, so the mixer only marks it released or free
+static queuedata *MV_QueuePool = NULL;
 
 static int MV_MixPage      = 0;
+static unsigned int MV_MixClock = 0;
+static int MV_CoalesceWindow    = -1;
+
+static soundlimit MV_SoundLimits[ MV_SoundLimitTableSize ];
+static int MV_NumSoundLimits    = 0;
+
+static filterbatch MV_FilterBatch;
+static float       MV_FilterData[ MixBufferSize ][ MV_NumFilterLanes ];
+static unsigned    MV_FilterScratch[ MixBufferSize ];
+static VoiceNode  *MV_FilterVoices[ MV_NumFilterLanes ];
+static int         MV_FilterHandles[ MV_NumFilterLanes ];
+static unsigned char MV_FilterSends[ MV_NumFilterLanes ][ MV_NumBuses ];
+static int         MV_FilterGroups[ MV_NumFilterLanes ];
+static int         MV_FilterBatchLanes  = 0;
+static int         MV_FilterBatchVoices = 0;
+
+static sendbus     MV_Buses[ MV_NumBuses ];
+
+// Ducking of each group, the peak level each group reached in the last
+// buffer, whether a group keys a ducker, and the gains each group is
+// ramped between over the buffer being mixed
+static ducker      MV_Duckers[ MV_NumGroups ];
+static float       MV_GroupPeak[ MV_NumGroups ];
+static int         MV_KeyGroups[ MV_NumGroups ];
+static float       MV_GroupStartGain[ MV_NumGroups ];
+static float       MV_GroupGain[ MV_NumGroups ];
+
+static fdnreverb  *MV_Room      = NULL;
+static int         MV_RoomLevel = 0;
+static float       MV_RoomInput[ MixBufferSize ];
+static float       MV_RoomLeft[ MixBufferSize ];
+static float       MV_RoomRight[ MixBufferSize ];
+
+static limiter    *MV_Limiter   = NULL;
+static int         MV_Headroom  = 0;
+static float       MV_LimiterData[ MixBufferSize * 2 ];
+
+static int MV_Interpolation       = MV_InterpNearest;
+static int MV_InterpolationBudget = MV_DefaultInterpolationBudget;
+
+// Nearest, linear and cubic variants of each 16-bit output mixer
+static const MV_MixFunc MV_KernelSets[][ MV_NumInterpolators ] =
+   {
+      { MV_Mix16BitMono, MV_Mix16BitMonoLinear, MV_Mix16BitMonoCubic },
+      { MV_Mix16BitStereo, MV_Mix16BitStereoLinear, MV_Mix16BitStereoCubic },
+      { MV_Mix16BitMono16, MV_Mix16BitMono16Linear, MV_Mix16BitMono16Cubic },
+      { MV_Mix16BitStereo16, MV_Mix16BitStereo16Linear, MV_Mix16BitStereo16Cubic },
+      { MV_Mix16BitMono8Stereo, MV_Mix16BitMono8StereoLinear, MV_Mix16BitMono8StereoCubic },
+      { MV_Mix16BitStereo8Stereo, MV_Mix16BitStereo8StereoLinear, MV_Mix16BitStereo8StereoCubic },
+      { MV_Mix16BitMono16Stereo, MV_Mix16BitMono16StereoLinear, MV_Mix16BitMono16StereoCubic },
+      { MV_Mix16BitStereo16Stereo, MV_Mix16BitStereo16StereoLinear, MV_Mix16BitStereo16StereoCubic },
+      { MV_Mix16BitMonoLaw, MV_Mix16BitMonoLawLinear, MV_Mix16BitMonoLawCubic },
+      { MV_Mix16BitStereoLaw, MV_Mix16BitStereoLawLinear, MV_Mix16BitStereoLawCubic },
+      { MV_Mix16BitMonoLawStereo, MV_Mix16BitMonoLawStereoLinear, MV_Mix16BitMonoLawStereoCubic },
+      { MV_Mix16BitStereoLawStereo, MV_Mix16BitStereoLawStereoLinear, MV_Mix16BitStereoLawStereoCubic }
+   };
 static int MV_VoiceHandle  = MV_MinVoiceHandle;
 
 static void ( *MV_CallBackFunc )( unsigned int ) = NULL;
@@ -106,10 +222,12 @@ char  *MV_HarshClipTable;
 char  *MV_MixDestination;
 short *MV_LeftVolume;
 short *MV_RightVolume;
+const short *MV_MixExpand;
 int    MV_SampleSize = 1;
 int    MV_RightChannelOffset;
 
 unsigned int MV_MixPosition;
+unsigned int MV_MixLastSample;
 
 int MV_ErrorCode = MV_Ok;
 
@@ -196,6 +314,10 @@ const char *MV_ErrorString
          ErrorString = "Invalid OggVorbis file passed in to Multivoc.";
          break;
 
+      case MV_InvalidFLACFile :
+         ErrorString = "Invalid FLAC file passed in to Multivoc.";
+         break;
+
       case MV_InvalidMixMode :
          ErrorString = "Invalid mix mode request in Multivoc.";
          break;
@@ -204,6 +326,46 @@ const char *MV_ErrorString
          ErrorString = "Null record function passed to MV_StartRecording.";
          break;
 
+      case MV_QueueFull :
+         ErrorString = "Buffer queue of voice is full.";
+         break;
+
+      case MV_SoundLimited :
+         ErrorString = "Sound instance limit or retrigger interval reached.";
+         break;
+
+      case MV_InvalidBus :
+         ErrorString = "Invalid effect bus number.";
+         break;
+
+      case MV_InvalidGroup :
+         ErrorString = "Invalid voice group number.";
+         break;
+
+      case MV_InvalidCurve :
+         ErrorString = "Invalid attenuation curve number.";
+         break;
+
+      case MV_InvalidDecoder :
+         ErrorString = "Decoder is incomplete or too many are registered.";
+         break;
+
+      case MV_UnknownFormat :
+         ErrorString = "Sound data is in no format a decoder recognises.";
+         break;
+
+      case MV_InvalidSound :
+         ErrorString = "Invalid loaded sound ID.";
+         break;
+
+      case MV_InvalidBank :
+         ErrorString = "Invalid sound bank passed in to Multivoc.";
+         break;
+
+      case MV_FileError :
+         ErrorString = "Unable to open sound file.";
+         break;
+
       default :
          ErrorString = "Unknown Multivoc error code.";
          break;
@@ -214,15 +376,15 @@ const char *MV_ErrorString
 
 
 /*---------------------------------------------------------------------
-   Function: MV_Mix
+   Function: MV_MixVoiceTo
 
-   Mixes the sound into the buffer.
+   Mixes the sound into the given page.
 ---------------------------------------------------------------------*/
 
-static void MV_Mix
+static void MV_MixVoiceTo
    (
    VoiceNode *voice,
-   int        buffer
+   char      *dest
    )
 
    {
@@ -241,9 +403,10 @@ static void MV_Mix
    length               = MixBufferSize;
    FixedPointBufferSize = voice->FixedPointBufferSize;
 
-   MV_MixDestination    = MV_MixBuffer[ buffer ];
+   MV_MixDestination    = dest;
    MV_LeftVolume        = voice->LeftVolume;
    MV_RightVolume       = voice->RightVolume;
+   MV_MixExpand         = voice->Expand;
 
    if ( ( MV_Channels == 2 ) && ( IS_QUIET( MV_LeftVolume ) ) )
       {
@@ -277,6 +440,8 @@ static void MV_Mix
          voclength = length;
          }
 
+      MV_MixLastSample = ( voice->length - 1 ) >> 16;
+
       if (voice->mix) {
          voice->mix( position, rate, start, voclength );
       }
@@ -293,10 +458,10 @@ static void MV_Mix
             return;
             }
 
-         if ( length > (voice->channels - 1) )
+         if ( length > 0 )
             {
             // Get the position of the last sample in the buffer
-            FixedPointBufferSize = voice->RateScale * ( length - voice->channels );
+            FixedPointBufferSize = voice->RateScale * ( length - 1 );
             }
          }
       }
@@ -304,1067 +469,5216 @@ static void MV_Mix
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayVoice
+   Function: MV_GroupDucked
+
+   Checks if a group's gain is below full anywhere in this buffer.
+---------------------------------------------------------------------*/
+
+static int MV_GroupDucked
+   (
+   int group
+   )
+
+   {
+   return( ( MV_GroupStartGain[ group ] < 1.f ) || ( MV_GroupGain[ group ] < 1.f ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_MixScratchVoice
 
-   Adds a voice to the play list.
+   Mixes a voice on its own into the scratch buffer, ramping it from
+   its group's gain at the start of the buffer to the gain at the end
+   so that ducking changes smoothly.
 ---------------------------------------------------------------------*/
 
-void MV_PlayVoice
+static void MV_MixScratchVoice
    (
    VoiceNode *voice
    )
 
    {
-   int flags;
+   float gain;
+   float step;
+   int   index;
+   int   channel;
 
-   flags = DisableInterrupts();
-   LL_SortedInsertion( &VoiceList, voice, prev, next, VoiceNode, priority );
+   ClearBuffer_DW( MV_FilterScratch, MV_Silence, MV_BufferSize >> 2 );
+   MV_MixVoiceTo( voice, ( char * )MV_FilterScratch );
 
-   RestoreInterrupts( flags );
+   if ( !MV_GroupDucked( voice->Group ) )
+      {
+      return;
+      }
+
+   gain = MV_GroupStartGain[ voice->Group ];
+   step = ( MV_GroupGain[ voice->Group ] - gain ) / MixBufferSize;
+
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      gain += step;
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         if ( MV_Bits == 16 )
+            {
+            short *sample;
+
+            sample  = ( short * )MV_FilterScratch + index * MV_Channels + channel;
+            *sample = ( short )lrintf( *sample * gain );
+            }
+         else
+            {
+            unsigned char *sample;
+
+            sample  = ( unsigned char * )MV_FilterScratch + index * MV_Channels + channel;
+            *sample = ( unsigned char )( 128 + lrintf( ( *sample - 128 ) * gain ) );
+            }
+         }
+      }
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_StopVoice
+   Function: MV_Mix
 
-   Removes the voice from the play list and adds it to the free list.
+   Mixes the sound into the buffer.
 ---------------------------------------------------------------------*/
 
-static void MV_StopVoice
+static void MV_Mix
    (
-   VoiceNode *voice
+   VoiceNode *voice,
+   int        buffer
    )
 
    {
-   int flags;
+   MV_MixVoiceTo( voice, MV_MixBuffer[ buffer ] );
+   }
 
-   flags = DisableInterrupts();
 
-   // move the voice from the play list to the free list
-   LL_Remove( voice, next, prev );
-   LL_Add( (VoiceNode*) &VoicePool, voice, next, prev );
+/*---------------------------------------------------------------------
+   Function: MV_SendToBus
 
-   RestoreInterrupts( flags );
+   Adds one channel of a voice, scaled by its send level, to a bus.
+   source is read every stride samples.
+---------------------------------------------------------------------*/
+
+static void MV_SendToBus
+   (
+   int          bus,
+   const float *source,
+   int          stride,
+   int          channel,
+   int          send
+   )
 
-   #ifdef HAVE_VORBIS
-   if (voice->wavetype == Vorbis)
+   {
+   float *dest;
+   float  level;
+   int    index;
+
+   dest  = ( channel == 0 ) ? MV_Buses[ bus ].left : MV_Buses[ bus ].right;
+   level = send / 255.f;
+
+   for( index = 0; index < MixBufferSize; index++ )
       {
-      MV_ReleaseVorbisVoice(voice);
+      dest[ index ] += *source * level;
+      source += stride;
       }
-   #endif
+
+   MV_Buses[ bus ].active = TRUE;
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_ServiceVoc
+   Function: MV_MeasureGroup
 
-   Starts playback of the waiting buffer and mixes the next one.
+   Raises the peak level of a group by one channel of a voice's mix.
+---------------------------------------------------------------------*/
 
-   JBF: no synchronisation happens inside MV_ServiceVoc nor the
-        supporting functions it calls. This would cause a deadlock
-        between the mixer thread in the driver vs the nested
-        locking in the user-space functions of MultiVoc. The call
-        to MV_ServiceVoc is synchronised in the driver.
+static void MV_MeasureGroup
+   (
+   int          group,
+   const float *source,
+   int          stride
+   )
 
-        Known functions called by MV_ServiceVoc and its helpers:
-           MV_Mix (and its MV_Mix*bit* workers)
-           MV_GetNextVOCBlock
-           MV_GetNextWAVBlock
-           MV_SetVoiceMixMode
+   {
+   float peak;
+   int   index;
+
+   peak = MV_GroupPeak[ group ];
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      peak = max( peak, fabsf( *source ) );
+      source += stride;
+      }
+
+   MV_GroupPeak[ group ] = peak;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_MixSendVoice
+
+   Mixes a voice that feeds send buses on its own.  A single pass then
+   adds it to the buffer and to each bus it sends to, and meters it
+   for ducking.
 ---------------------------------------------------------------------*/
-static void MV_ServiceVoc
+
+static void MV_MixSendVoice
    (
-   void
+   VoiceNode *voice,
+   int        buffer
    )
 
    {
-   VoiceNode *voice;
-   VoiceNode *next;
-   //int        flags;
-
-   // Toggle which buffer we'll mix next
-   MV_MixPage++;
-   if ( MV_MixPage >= MV_NumberOfBuffers )
+   float *busdata[ MV_NumBuses ][ 2 ];
+   float  level[ MV_NumBuses ];
+   float  value;
+   float  peak;
+   int    measure;
+   int    sends;
+   int    index;
+   int    channel;
+   int    sample;
+   int    bus;
+   int    send;
+
+   MV_MixScratchVoice( voice );
+
+   sends = 0;
+   for( bus = 0; bus < MV_NumBuses; bus++ )
       {
-      MV_MixPage -= MV_NumberOfBuffers;
+      if ( voice->Send[ bus ] != 0 )
+         {
+         busdata[ sends ][ 0 ] = MV_Buses[ bus ].left;
+         busdata[ sends ][ 1 ] = MV_Buses[ bus ].right;
+         level[ sends ]        = voice->Send[ bus ] / 255.f;
+         MV_Buses[ bus ].active = TRUE;
+         sends++;
+         }
       }
 
-   if ( MV_ReverbLevel == 0 )
+   measure = MV_KeyGroups[ voice->Group ];
+   peak    = MV_GroupPeak[ voice->Group ];
+
+   for( index = 0; index < MixBufferSize; index++ )
       {
-      // Initialize buffer
-      //Commented out so that the buffer is always cleared.
-      //This is so the guys at Echo Speech can mix into the
-      //buffer even when no sounds are playing.
-      //if ( !MV_BufferEmpty[ MV_MixPage ] )
+      for( channel = 0; channel < MV_Channels; channel++ )
          {
-         ClearBuffer_DW( MV_MixBuffer[ MV_MixPage ], MV_Silence, MV_BufferSize >> 2 );
-         MV_BufferEmpty[ MV_MixPage ] = TRUE;
+         if ( MV_Bits == 16 )
+            {
+            short *dest;
+
+            sample = ( ( short * )MV_FilterScratch )[ index * MV_Channels + channel ];
+            dest   = ( short * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            *dest  = ( short )min( 32767, max( -32768, *dest + sample ) );
+            }
+         else
+            {
+            unsigned char *dest;
+
+            sample = ( ( unsigned char * )MV_FilterScratch )[ index * MV_Channels + channel ] - 128;
+            dest   = ( unsigned char * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            *dest  = ( unsigned char )min( 255, max( 0, *dest + sample ) );
+            }
+
+         value = ( float )sample;
+         if ( measure )
+            {
+            peak = max( peak, fabsf( value ) );
+            }
+
+         for( send = 0; send < sends; send++ )
+            {
+            busdata[ send ][ channel ][ index ] += value * level[ send ];
+            }
          }
       }
-   else
+
+   MV_GroupPeak[ voice->Group ] = peak;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ProcessBuses
+
+   Runs each bus's effects once and adds its return to the buffer.
+---------------------------------------------------------------------*/
+
+static void MV_ProcessBuses
+   (
+   int buffer
+   )
+
+   {
+   sendbus *bus;
+   float   *left;
+   float   *right;
+   float    level;
+   int      index;
+   int      sample;
+
+   for( bus = MV_Buses; bus < &MV_Buses[ MV_NumBuses ]; bus++ )
       {
-      char *end;
-      char *source;
-      char *dest;
-      unsigned int   count;
-      unsigned int   length;
+      // Reverb tails keep running after the sends stop
+      if ( !bus->active && ( bus->reverb == NULL ) && ( bus->convolver == NULL ) )
+         {
+         continue;
+         }
 
-      end = MV_MixBuffer[ 0 ] + MV_BufferLength;;
-      dest = MV_MixBuffer[ MV_MixPage ];
-      source = MV_MixBuffer[ MV_MixPage ] - MV_ReverbDelay;
-      if ( source < MV_MixBuffer[ 0 ] )
+      if ( MV_Channels == 1 )
          {
-         source += MV_BufferLength;
+         memcpy( bus->right, bus->left, sizeof( bus->right ) );
          }
 
-      length = MV_BufferSize;
-      while( length > 0 )
+      if ( bus->filter.type != MV_FilterNone )
          {
-         count = length;
-         if ( source + count > end )
+         MV_FilterBlock( &bus->filter, bus->left, MixBufferSize, 0 );
+         MV_FilterBlock( &bus->filter, bus->right, MixBufferSize, 1 );
+         }
+
+      left  = bus->left;
+      right = bus->right;
+      if ( ( bus->reverb != NULL ) || ( bus->convolver != NULL ) )
+         {
+         for( index = 0; index < MixBufferSize; index++ )
             {
-            count = (unsigned int)(end - source);
+            MV_RoomInput[ index ] = ( left[ index ] + right[ index ] ) * 0.5f;
+            }
+
+         memset( MV_RoomLeft, 0, sizeof( MV_RoomLeft ) );
+         memset( MV_RoomRight, 0, sizeof( MV_RoomRight ) );
+
+         // Both effects run in parallel on the same input
+         if ( bus->reverb != NULL )
+            {
+            MV_ProcessFDN( bus->reverb, MV_RoomInput, MV_RoomLeft, MV_RoomRight, MixBufferSize );
+            }
+         if ( bus->convolver != NULL )
+            {
+            MV_ProcessConvolver( bus->convolver, MV_RoomInput, MV_RoomLeft, MV_RoomRight );
             }
 
+         left  = MV_RoomLeft;
+         right = MV_RoomRight;
+         }
+
+      level = bus->level / 255.f;
+      for( index = 0; index < MixBufferSize; index++ )
+         {
          if ( MV_Bits == 16 )
             {
-            if ( MV_ReverbTable != NULL )
+            short *dest;
+
+            dest = ( short * )MV_MixBuffer[ buffer ] + index * MV_Channels;
+            if ( MV_Channels == 2 )
                {
-               MV_16BitReverb( source, dest, MV_ReverbTable, count / 2 );
+               sample  = dest[ 0 ] + ( int )( left[ index ] * level );
+               dest[ 0 ] = ( short )min( 32767, max( -32768, sample ) );
+               sample  = dest[ 1 ] + ( int )( right[ index ] * level );
+               dest[ 1 ] = ( short )min( 32767, max( -32768, sample ) );
                }
             else
                {
-               MV_16BitReverbFast( source, dest, count / 2, MV_ReverbLevel );
+               sample  = dest[ 0 ] + ( int )( ( left[ index ] + right[ index ] ) * 0.5f * level );
+               dest[ 0 ] = ( short )min( 32767, max( -32768, sample ) );
                }
             }
          else
             {
-            if ( MV_ReverbTable != NULL )
+            unsigned char *dest;
+
+            dest = ( unsigned char * )MV_MixBuffer[ buffer ] + index * MV_Channels;
+            if ( MV_Channels == 2 )
                {
-               MV_8BitReverb( (signed char *) source, (signed char *) dest, MV_ReverbTable, count );
+               sample  = dest[ 0 ] + ( int )( left[ index ] * level );
+               dest[ 0 ] = ( unsigned char )min( 255, max( 0, sample ) );
+               sample  = dest[ 1 ] + ( int )( right[ index ] * level );
+               dest[ 1 ] = ( unsigned char )min( 255, max( 0, sample ) );
                }
             else
                {
-               MV_8BitReverbFast( (signed char *) source, (signed char *) dest, count, MV_ReverbLevel );
+               sample  = dest[ 0 ] + ( int )( ( left[ index ] + right[ index ] ) * 0.5f * level );
+               dest[ 0 ] = ( unsigned char )min( 255, max( 0, sample ) );
                }
             }
-
-         // if we go through the loop again, it means that we've wrapped around the buffer
-         source  = MV_MixBuffer[ 0 ];
-         dest   += count;
-         length -= count;
          }
+
+      memset( bus->left, 0, sizeof( bus->left ) );
+      memset( bus->right, 0, sizeof( bus->right ) );
+      bus->active = FALSE;
       }
+   }
 
-   // Play any waiting voices
-   //flags = DisableInterrupts();
 
-   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
+/*---------------------------------------------------------------------
+   Function: MV_FlushFilters
+
+   Runs the pending batch of filtered voices and adds the result to
+   the buffer.
+---------------------------------------------------------------------*/
+
+static void MV_FlushFilters
+   (
+   int buffer
+   )
+
+   {
+   float *data;
+   int    index;
+   int    lane;
+   int    channel;
+   int    sample;
+   int    voice;
+
+   MV_FilterLanes( &MV_FilterData[ 0 ][ 0 ], MixBufferSize, &MV_FilterBatch );
+
+   // Save the filter state of voices that are still the same sound
+   for( voice = 0; voice < MV_FilterBatchVoices; voice++ )
       {
-      if ( voice->Paused )
+      VoiceNode *node;
+
+      node = MV_FilterVoices[ voice ];
+      if ( node->handle != MV_FilterHandles[ voice ] )
          {
-         next = voice->next;
          continue;
          }
 
-      MV_BufferEmpty[ MV_MixPage ] = FALSE;
-
-      MV_MixFunction( voice, MV_MixPage );
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         lane = voice * MV_Channels + channel;
+         node->Filter.z1[ channel ] = MV_FilterBatch.z1[ lane ];
+         node->Filter.z2[ channel ] = MV_FilterBatch.z2[ lane ];
+         }
+      }
 
-      next = voice->next;
+   // Feed the filtered voices' sends and sidechains
+   for( voice = 0; voice < MV_FilterBatchVoices; voice++ )
+      {
+      int bus;
 
-      // Is this voice done?
-      if ( !voice->Playing )
+      if ( MV_KeyGroups[ MV_FilterGroups[ voice ] ] )
          {
-         //JBF: prevent a deadlock caused by MV_StopVoice grabbing the mutex again
-         //MV_StopVoice( voice );
-         LL_Remove( voice, next, prev );
-         LL_Add( (VoiceNode*) &VoicePool, voice, next, prev );
+         for( channel = 0; channel < MV_Channels; channel++ )
+            {
+            MV_MeasureGroup( MV_FilterGroups[ voice ],
+               &MV_FilterData[ 0 ][ voice * MV_Channels + channel ], MV_NumFilterLanes );
+            }
+         }
 
-         if ( MV_CallBackFunc )
+      for( bus = 0; bus < MV_NumBuses; bus++ )
+         {
+         if ( MV_FilterSends[ voice ][ bus ] != 0 )
             {
-            MV_CallBackFunc( voice->callbackval );
+            for( channel = 0; channel < MV_Channels; channel++ )
+               {
+               MV_SendToBus( bus, &MV_FilterData[ 0 ][ voice * MV_Channels + channel ],
+                  MV_NumFilterLanes, channel, MV_FilterSends[ voice ][ bus ] );
+               }
             }
          }
       }
 
-   //RestoreInterrupts(flags);
-   }
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      data = MV_FilterData[ index ];
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         float sum;
 
+         sum = 0.f;
+         for( lane = channel; lane < MV_FilterBatchLanes; lane += MV_Channels )
+            {
+            sum += data[ lane ];
+            }
 
-/*---------------------------------------------------------------------
-   Function: MV_GetNextVOCBlock
+         if ( MV_Bits == 16 )
+            {
+            short *dest;
 
-   Interperate the information of a VOC format sound file.
----------------------------------------------------------------------*/
+            dest   = ( short * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            sample = *dest + ( int )sum;
+            *dest  = ( short )min( 32767, max( -32768, sample ) );
+            }
+         else
+            {
+            unsigned char *dest;
+
+            dest   = ( unsigned char * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            sample = *dest + ( int )sum;
+            *dest  = ( unsigned char )min( 255, max( 0, sample ) );
+            }
+         }
+      }
+
+   memset( &MV_FilterBatch, 0, sizeof( MV_FilterBatch ) );
+   MV_FilterBatchLanes  = 0;
+   MV_FilterBatchVoices = 0;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_MixFilteredVoice
+
+   Mixes a filtered voice on its own and adds its channels to the
+   pending filter batch, which is run once all lanes are in use.
+---------------------------------------------------------------------*/
+
+static void MV_MixFilteredVoice
+   (
+   VoiceNode *voice,
+   int        buffer
+   )
+
+   {
+   int index;
+   int lane;
+   int channel;
+
+   if ( MV_FilterBatchLanes + MV_Channels > MV_NumFilterLanes )
+      {
+      MV_FlushFilters( buffer );
+      }
+
+   MV_MixScratchVoice( voice );
+
+   for( channel = 0; channel < MV_Channels; channel++ )
+      {
+      lane = MV_FilterBatchLanes + channel;
+
+      MV_FilterBatch.b0[ lane ] = voice->Filter.b0;
+      MV_FilterBatch.b1[ lane ] = voice->Filter.b1;
+      MV_FilterBatch.b2[ lane ] = voice->Filter.b2;
+      MV_FilterBatch.a1[ lane ] = voice->Filter.a1;
+      MV_FilterBatch.a2[ lane ] = voice->Filter.a2;
+      MV_FilterBatch.z1[ lane ] = voice->Filter.z1[ channel ];
+      MV_FilterBatch.z2[ lane ] = voice->Filter.z2[ channel ];
+
+      if ( MV_Bits == 16 )
+         {
+         short *source;
+
+         source = ( short * )MV_FilterScratch + channel;
+         for( index = 0; index < MixBufferSize; index++ )
+            {
+            MV_FilterData[ index ][ lane ] = *source;
+            source += MV_Channels;
+            }
+         }
+      else
+         {
+         unsigned char *source;
+
+         source = ( unsigned char * )MV_FilterScratch + channel;
+         for( index = 0; index < MixBufferSize; index++ )
+            {
+            MV_FilterData[ index ][ lane ] = ( float )( *source - 128 );
+            source += MV_Channels;
+            }
+         }
+      }
+
+   MV_FilterVoices[ MV_FilterBatchVoices ]  = voice;
+   MV_FilterHandles[ MV_FilterBatchVoices ] = voice->handle;
+   memcpy( MV_FilterSends[ MV_FilterBatchVoices ], voice->Send, sizeof( voice->Send ) );
+   MV_FilterGroups[ MV_FilterBatchVoices ] = voice->Group;
+   MV_FilterBatchVoices++;
+   MV_FilterBatchLanes += MV_Channels;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SpreadAngles
+
+   Checks if voices placed at an angle by the 3D functions are mixed
+   through the spatial path rather than panned by level.
+---------------------------------------------------------------------*/
+
+static int MV_SpreadAngles
+   (
+   void
+   )
+
+   {
+   return( ( MV_OutputChannels > MV_Channels ) || ( MV_HRTF != NULL ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_MixSpatialVoice
+
+   Mixes a positioned voice down to mono and either queues it for
+   binaural rendering, while the HRTF voice budget lasts, or spreads it
+   over the output channels by its speaker gains.
+---------------------------------------------------------------------*/
+
+static void MV_MixSpatialVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   const float *gains;
+   float       *dest;
+   float        sample;
+   float        scale;
+   float        azimuth;
+   float        level;
+   int          angle;
+   int          index;
+   int          channel;
+   int          bus;
+
+   MV_MixScratchVoice( voice );
+
+   // Both sides carry the same level, so the average is the voice
+   scale = 1.f / MV_Channels;
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      sample = 0.f;
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         if ( MV_Bits == 16 )
+            {
+            sample += ( ( short * )MV_FilterScratch )[ index * MV_Channels + channel ];
+            }
+         else
+            {
+            sample += ( ( unsigned char * )MV_FilterScratch )[ index * MV_Channels + channel ] - 128;
+            }
+         }
+      MV_SpatialInput[ index ] = sample * scale;
+      }
+
+   if ( voice->Filter.type != MV_FilterNone )
+      {
+      MV_FilterBlock( &voice->Filter, MV_SpatialInput, MixBufferSize, 0 );
+      }
+
+   if ( MV_KeyGroups[ voice->Group ] )
+      {
+      MV_MeasureGroup( voice->Group, MV_SpatialInput, 1 );
+      }
+
+   for( bus = 0; bus < MV_NumBuses; bus++ )
+      {
+      if ( voice->Send[ bus ] != 0 )
+         {
+         MV_SendToBus( bus, MV_SpatialInput, 1, 0, voice->Send[ bus ] );
+         MV_SendToBus( bus, MV_SpatialInput, 1, 1, voice->Send[ bus ] );
+         }
+      }
+
+   if ( voice->Emitter.active )
+      {
+      gains   = voice->Emitter.gains;
+      azimuth = voice->Emitter.azimuth;
+      level   = voice->Emitter.level;
+      }
+   else
+      {
+      // SBPro uses reversed panning
+      angle   = MV_SwapLeftRight ? ( -voice->Angle & MV_MaxPanPosition ) : voice->Angle;
+      gains   = MV_SpeakerGains[ angle ];
+      azimuth = ( float )( 2.0 * PI * angle / MV_NumPanPositions );
+      level   = 1.f;
+      }
+
+   if ( ( MV_HRTF != NULL ) && ( MV_HRTFUsed < MV_HRTFVoices ) &&
+      MV_QueueHRTF( MV_HRTF, voice->handle, MV_SpatialInput, azimuth, level ) )
+      {
+      MV_HRTFUsed++;
+      return;
+      }
+
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      dest   = MV_SpatialData[ index ];
+      sample = MV_SpatialInput[ index ];
+      for( channel = 0; channel < MV_OutputChannels; channel++ )
+         {
+         dest[ channel ] += gains[ channel ] * sample;
+         }
+      }
+
+   MV_SpatialActive = TRUE;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FlushHRTF
+
+   Renders the voices queued for binaural output into the spatial mix.
+---------------------------------------------------------------------*/
+
+static void MV_FlushHRTF
+   (
+   void
+   )
+
+   {
+   int index;
+
+   memset( MV_HRTFLeft, 0, sizeof( MV_HRTFLeft ) );
+   memset( MV_HRTFRight, 0, sizeof( MV_HRTFRight ) );
+   MV_RenderHRTF( MV_HRTF, MV_HRTFLeft, MV_HRTFRight );
+
+   if ( MV_HRTFUsed > 0 )
+      {
+      for( index = 0; index < MixBufferSize; index++ )
+         {
+         MV_SpatialData[ index ][ 0 ] += MV_HRTFLeft[ index ];
+         MV_SpatialData[ index ][ 1 ] += MV_HRTFRight[ index ];
+         }
+      MV_SpatialActive = TRUE;
+      }
+
+   MV_HRTFUsed = 0;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FlushSpatial
+
+   Adds the positioned voices to the buffer when the device has no
+   more channels than the mix.
+---------------------------------------------------------------------*/
+
+static void MV_FlushSpatial
+   (
+   int buffer
+   )
+
+   {
+   int index;
+   int channel;
+   int sample;
+
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         if ( MV_Bits == 16 )
+            {
+            short *dest;
+
+            dest   = ( short * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            sample = *dest + ( int )MV_SpatialData[ index ][ channel ];
+            *dest  = ( short )min( 32767, max( -32768, sample ) );
+            }
+         else
+            {
+            unsigned char *dest;
+
+            dest   = ( unsigned char * )MV_MixBuffer[ buffer ] + index * MV_Channels + channel;
+            sample = *dest + ( int )MV_SpatialData[ index ][ channel ];
+            *dest  = ( unsigned char )min( 255, max( 0, sample ) );
+            }
+         }
+      }
+
+   memset( MV_SpatialData, 0, sizeof( MV_SpatialData ) );
+   MV_SpatialActive = FALSE;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UpdateEmitters
+
+   Works out the speaker gains and Doppler shifted rate of every voice
+   with a 3D position for the coming buffer.
+---------------------------------------------------------------------*/
+
+static void MV_UpdateEmitters
+   (
+   void
+   )
+
+   {
+   VoiceNode *voice;
+   double     rate;
+   float      shift;
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+      {
+      if ( !voice->Emitter.active )
+         {
+         continue;
+         }
+
+      shift = MV_UpdateEmitter( &voice->Emitter, &MV_Listener,
+         &MV_Curves[ voice->Emitter.curve ], MV_DopplerFactor, MV_SpeedOfSound,
+         MV_OutputChannels, MV_SwapLeftRight );
+      shift = max( 0.25f, min( 4.f, shift ) );
+
+      rate = ( double )voice->SamplingRate * voice->PitchScale / MV_MixRate;
+      voice->RateScale = ( unsigned int )( rate * shift );
+      voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+         voice->RateScale;
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_RecycleVoice
+
+   Returns a voice node to the free pool, or retires it to the reserve
+   if the pool is being shrunk while the node was busy.
+---------------------------------------------------------------------*/
+
+static void MV_RecycleVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   if ( MV_VoiceDeficit > 0 )
+      {
+      MV_VoiceDeficit--;
+      LL_Add( (VoiceNode*) &VoiceReserve, voice, next, prev );
+      }
+   else
+      {
+      LL_Add( (VoiceNode*) &VoicePool, voice, next, prev );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_IsBlockVoice
+
+   Checks whether a voice node belongs to the block allocated by MV_Init
+   rather than being allocated on its own by MV_SetMaxVoices.
+---------------------------------------------------------------------*/
+
+static int MV_IsBlockVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   return( ( voice >= MV_Voices ) && ( voice < MV_Voices + MV_BlockVoices ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FreeReserveVoices
+
+   Releases the separately allocated nodes held in a voice list.  Nodes
+   from the MV_Init block stay where they are.
+---------------------------------------------------------------------*/
+
+static void MV_FreeReserveVoices
+   (
+   VoiceNode *list
+   )
+
+   {
+   VoiceNode *voice;
+   VoiceNode *next;
+
+   for( voice = list->next; voice != list; voice = next )
+      {
+      next = voice->next;
+      if ( !MV_IsBlockVoice( voice ) )
+         {
+         LL_Remove( voice, next, prev );
+         free( voice );
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FindSoundLimit
+
+   Locates the limit entry for a sound, or the free slot it would
+   occupy when create is set.
+---------------------------------------------------------------------*/
+
+static soundlimit *MV_FindSoundLimit
+   (
+   char *ptr,
+   int   create
+   )
+
+   {
+   unsigned int index;
+   unsigned int probe;
+
+   if ( ( ptr == NULL ) || ( ( MV_NumSoundLimits == 0 ) && !create ) )
+      {
+      return( NULL );
+      }
+
+   index = ( unsigned int )( ( ( uintptr_t )ptr >> 3 ) * 2654435761u );
+   for( probe = 0; probe < MV_SoundLimitTableSize; probe++ )
+      {
+      soundlimit *limit;
+
+      limit = &MV_SoundLimits[ ( index + probe ) & ( MV_SoundLimitTableSize - 1 ) ];
+      if ( limit->key == ptr )
+         {
+         return( limit );
+         }
+      if ( limit->key == NULL )
+         {
+         return( create ? limit : NULL );
+         }
+      }
+
+   return( NULL );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_AdmitSound
+
+   Checks a new trigger of a sound against its retrigger interval and
+   instance limit, stealing the oldest instance if so configured.
+---------------------------------------------------------------------*/
+
+static int MV_AdmitSound
+   (
+   char *ptr
+   )
+
+   {
+   soundlimit *limit;
+   VoiceNode  *voice;
+   VoiceNode  *oldest;
+   int         flags;
+
+   flags = DisableInterrupts();
+
+   limit = MV_FindSoundLimit( ptr, FALSE );
+   if ( limit == NULL )
+      {
+      RestoreInterrupts( flags );
+      return( TRUE );
+      }
+
+   if ( limit->triggered &&
+      ( MV_MixClock - limit->lasttrigger < limit->interval ) )
+      {
+      RestoreInterrupts( flags );
+      return( FALSE );
+      }
+
+   if ( ( limit->maxvoices > 0 ) && ( limit->active >= limit->maxvoices ) )
+      {
+      oldest = NULL;
+      if ( limit->steal )
+         {
+         for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+            {
+            if ( ( voice->Limit == limit ) && ( ( oldest == NULL ) ||
+               ( MV_MixClock - voice->StartTime > MV_MixClock - oldest->StartTime ) ) )
+               {
+               oldest = voice;
+               }
+            }
+         }
+
+      if ( oldest == NULL )
+         {
+         RestoreInterrupts( flags );
+         return( FALSE );
+         }
+
+      MV_Kill( oldest->handle );
+      }
+
+   RestoreInterrupts( flags );
+
+   return( TRUE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FindCoalescableVoice
+
+   Locates a playing voice started from the same sound data at the
+   same pitch and angle within the coalescing window.
+---------------------------------------------------------------------*/
+
+static VoiceNode *MV_FindCoalescableVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   VoiceNode *node;
+
+   if ( ( MV_CoalesceWindow < 0 ) || ( voice->Origin == NULL ) ||
+      ( voice->LoopStart != NULL ) )
+      {
+      return( NULL );
+      }
+
+   for( node = VoiceList.next; node != &VoiceList; node = node->next )
+      {
+      if ( ( node->Origin == voice->Origin ) &&
+         ( node->wavetype == voice->wavetype ) &&
+         ( node->PitchScale == voice->PitchScale ) &&
+         ( node->Angle == voice->Angle ) &&
+         ( node->LoopStart == NULL ) && !node->Paused && !node->Emitter.active &&
+         ( node->NumMerged < MV_MaxMergedCallbacks ) &&
+         ( MV_MixClock - node->StartTime <= (unsigned int)MV_CoalesceWindow ) )
+         {
+         return( node );
+         }
+      }
+
+   return( NULL );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_DoVoiceCallbacks
+
+   Calls the callback function for a finished voice and for each
+   trigger that was coalesced into it.
+---------------------------------------------------------------------*/
+
+static void MV_DoVoiceCallbacks
+   (
+   unsigned int callbackval,
+   const unsigned int *merged,
+   int nummerged
+   )
+
+   {
+   int i;
+
+   if ( MV_CallBackFunc == NULL )
+      {
+      return;
+      }
+
+   MV_CallBackFunc( callbackval );
+
+   for( i = 0; i < nummerged; i++ )
+      {
+      MV_CallBackFunc( merged[ i ] );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_CleanupVoice
+
+   Releases any decoder, queue or file state attached to a stopped
+   voice.
+---------------------------------------------------------------------*/
+
+static void MV_CleanupVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   if ( voice->Limit != NULL )
+      {
+      voice->Limit->active--;
+      voice->Limit = NULL;
+      }
+
+   if ( ( voice->wavetype == BufferQueue ) && ( voice->extra != NULL ) )
+      {
+      queuedata *qd = ( queuedata * )voice->extra;
+
+      // Every buffer still queued counts as processed once stopped
+      qd->playing  = FALSE;
+      qd->finished = qd->tail;
+      qd->released = TRUE;
+      voice->extra = NULL;
+
+      // With nothing left to hand back the state is free at once
+      if ( qd->unqueued == qd->tail )
+         {
+         qd->inuse = FALSE;
+         }
+      }
+
+   MV_ReleaseADPCMVoice( voice );
+   MV_ReleaseDecoderVoice( voice );
+   MV_ReleaseFileVoice( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayVoice
+
+   Adds a voice to the play list and returns its handle.  When
+   coalescing is enabled, a duplicate trigger is folded into the
+   matching voice instead, and that voice's handle is returned.  The
+   trigger's callback is called when the shared voice finishes.
+---------------------------------------------------------------------*/
+
+int MV_PlayVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   VoiceNode  *node;
+   soundlimit *limit;
+   int flags;
+   int handle;
+
+   flags = DisableInterrupts();
+
+   voice->StartTime = MV_MixClock;
+
+   limit = MV_FindSoundLimit( voice->Origin, FALSE );
+   if ( limit != NULL )
+      {
+      limit->lasttrigger = MV_MixClock;
+      limit->triggered   = TRUE;
+      }
+
+   node = MV_FindCoalescableVoice( voice );
+   if ( node != NULL )
+      {
+      MV_SetVoiceAngle( node,
+         min( node->Volume + voice->Volume, MV_MaxTotalVolume ),
+         min( node->LeftLevel + voice->LeftLevel, MV_MaxTotalVolume ),
+         min( node->RightLevel + voice->RightLevel, MV_MaxTotalVolume ),
+         node->Angle );
+
+      node->MergedCallbacks[ node->NumMerged++ ] = voice->callbackval;
+
+      MV_CleanupVoice( voice );
+      MV_RecycleVoice( voice );
+      handle = node->handle;
+      }
+   else
+      {
+      LL_SortedInsertion( &VoiceList, voice, prev, next, VoiceNode, priority );
+      handle = voice->handle;
+
+      voice->Limit = limit;
+      if ( limit != NULL )
+         {
+         limit->active++;
+         }
+      }
+
+   RestoreInterrupts( flags );
+
+   return( handle );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StopVoice
+
+   Removes the voice from the play list and adds it to the free list.
+---------------------------------------------------------------------*/
+
+static void MV_StopVoice
+   (
+   VoiceNode *voice
+   )
+
+   {
+   int flags;
+
+   flags = DisableInterrupts();
+
+   // move the voice from the play list to the free list
+   LL_Remove( voice, next, prev );
+   MV_RecycleVoice( voice );
+
+   RestoreInterrupts( flags );
+
+   MV_CleanupVoice( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ApplyRoomReverb
+
+   Runs the mixed buffer through the room reverb and adds the result
+   back in at the room reverb level.
+---------------------------------------------------------------------*/
+
+static void MV_ApplyRoomReverb
+   (
+   int buffer
+   )
+
+   {
+   float  level;
+   int    index;
+   int    sample;
+
+   if ( MV_Bits == 16 )
+      {
+      short *source;
+
+      source = ( short * )MV_MixBuffer[ buffer ];
+      for( index = 0; index < MixBufferSize; index++ )
+         {
+         if ( MV_Channels == 2 )
+            {
+            MV_RoomInput[ index ] = ( source[ 0 ] + source[ 1 ] ) * 0.5f;
+            }
+         else
+            {
+            MV_RoomInput[ index ] = source[ 0 ];
+            }
+         source += MV_Channels;
+         }
+      }
+   else
+      {
+      unsigned char *source;
+
+      source = ( unsigned char * )MV_MixBuffer[ buffer ];
+      for( index = 0; index < MixBufferSize; index++ )
+         {
+         if ( MV_Channels == 2 )
+            {
+            MV_RoomInput[ index ] = ( source[ 0 ] + source[ 1 ] - 256 ) * 0.5f;
+            }
+         else
+            {
+            MV_RoomInput[ index ] = ( float )( source[ 0 ] - 128 );
+            }
+         source += MV_Channels;
+         }
+      }
+
+   memset( MV_RoomLeft, 0, sizeof( MV_RoomLeft ) );
+   memset( MV_RoomRight, 0, sizeof( MV_RoomRight ) );
+   MV_ProcessFDN( MV_Room, MV_RoomInput, MV_RoomLeft, MV_RoomRight, MixBufferSize );
+
+   level = MV_RoomLevel / 255.f;
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      if ( MV_Channels == 1 )
+         {
+         MV_RoomLeft[ index ] = ( MV_RoomLeft[ index ] + MV_RoomRight[ index ] ) * 0.5f;
+         }
+
+      if ( MV_Bits == 16 )
+         {
+         short *dest;
+
+         dest   = ( short * )MV_MixBuffer[ buffer ] + index * MV_Channels;
+         sample = dest[ 0 ] + ( int )( MV_RoomLeft[ index ] * level );
+         dest[ 0 ] = ( short )min( 32767, max( -32768, sample ) );
+         if ( MV_Channels == 2 )
+            {
+            sample = dest[ 1 ] + ( int )( MV_RoomRight[ index ] * level );
+            dest[ 1 ] = ( short )min( 32767, max( -32768, sample ) );
+            }
+         }
+      else
+         {
+         unsigned char *dest;
+
+         dest   = ( unsigned char * )MV_MixBuffer[ buffer ] + index * MV_Channels;
+         sample = dest[ 0 ] + ( int )( MV_RoomLeft[ index ] * level );
+         dest[ 0 ] = ( unsigned char )min( 255, max( 0, sample ) );
+         if ( MV_Channels == 2 )
+            {
+            sample = dest[ 1 ] + ( int )( MV_RoomRight[ index ] * level );
+            dest[ 1 ] = ( unsigned char )min( 255, max( 0, sample ) );
+            }
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UpdateDucking
+
+   Follows the level of each key group over the buffer just mixed and
+   sets the gain its ducked group will ramp to over the next one.
+---------------------------------------------------------------------*/
+
+static void MV_UpdateDucking
+   (
+   void
+   )
+
+   {
+   ducker *duck;
+   float   scale;
+   float   level;
+   float   gain;
+   int     group;
+
+   // peaks are in buffer units, make them relative to full scale
+   if ( MV_Bits == 16 )
+      {
+      scale = ( float )( 1 << MV_Headroom ) / 32768.f;
+      }
+   else
+      {
+      scale = 1.f / 128.f;
+      }
+
+   for( group = 0; group < MV_NumGroups; group++ )
+      {
+      // The gain reached at the end of the last buffer is where the
+      // next one starts
+      MV_GroupStartGain[ group ] = MV_GroupGain[ group ];
+
+      duck = &MV_Duckers[ group ];
+      if ( duck->key < 0 )
+         {
+         continue;
+         }
+
+      level = MV_GroupPeak[ duck->key ] * scale;
+      if ( level > duck->envelope )
+         {
+         duck->envelope = level + ( duck->envelope - level ) * duck->attack;
+         }
+      else
+         {
+         duck->envelope = level + ( duck->envelope - level ) * duck->release;
+         }
+
+      gain = 1.f - ( 1.f - duck->level ) * min( 1.f, duck->envelope / duck->threshold );
+
+      // The release never quite reaches full gain, so snap to it once
+      // within half a step of 1/256, letting the voices mix directly
+      if ( gain > 511.f / 512.f )
+         {
+         gain = 1.f;
+         }
+
+      MV_GroupGain[ group ] = gain;
+      }
+
+   for( group = 0; group < MV_NumGroups; group++ )
+      {
+      MV_GroupPeak[ group ] = 0.f;
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ApplyLimiter
+
+   Restores the level held back as headroom and runs the finished
+   16-bit buffer through the master limiter.
+---------------------------------------------------------------------*/
+
+static void MV_ApplyLimiter
+   (
+   int buffer
+   )
+
+   {
+   short *dest;
+   float  makeup;
+   int    count;
+   int    index;
+   int    sample;
+
+   dest   = ( short * )MV_MixBuffer[ buffer ];
+   count  = MixBufferSize * MV_Channels;
+   makeup = ( float )( 1 << MV_Headroom );
+   for( index = 0; index < count; index++ )
+      {
+      MV_LimiterData[ index ] = dest[ index ] * makeup;
+      }
+
+   MV_ProcessLimiter( MV_Limiter, MV_LimiterData );
+
+   for( index = 0; index < count; index++ )
+      {
+      sample = ( int )MV_LimiterData[ index ];
+      dest[ index ] = ( short )min( 32767, max( -32768, sample ) );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SelectInterpolation
+
+   Picks the resampling kernel each voice will use for the coming
+   buffer.  In automatic mode the level of detail follows the voice's
+   effective level, and the interpolation tap budget is spent on the
+   highest priority voices first.  Changes only take effect on buffer
+   boundaries.
+---------------------------------------------------------------------*/
+
+static void MV_SelectInterpolation
+   (
+   void
+   )
+
+   {
+   VoiceNode *voice;
+   int        budget;
+   int        level;
+   int        quality;
+
+   budget = MV_InterpolationBudget;
+   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+      {
+      if ( voice->Kernels == NULL )
+         {
+         continue;
+         }
+
+      if ( voice->Paused || ( voice->RateScale == 0x10000 ) )
+         {
+         // Nothing to gain from interpolating at unity rate
+         quality = MV_InterpNearest;
+         }
+      else if ( MV_Interpolation != MV_InterpAuto )
+         {
+         quality = MV_Interpolation;
+         }
+      else
+         {
+         if ( MV_Channels == 1 )
+            {
+            level = voice->Volume;
+            }
+         else
+            {
+            level = max( voice->LeftLevel, voice->RightLevel );
+            }
+         level = ( level * MV_TotalVolume ) / MV_MaxTotalVolume;
+
+         // Use lower thresholds to keep a quality than to reach it so
+         // voices near a threshold don't flip every buffer
+         if ( level >= ( voice->Interpolation == MV_InterpCubic ? 64 : 96 ) )
+            {
+            quality = MV_InterpCubic;
+            }
+         else if ( level >= ( voice->Interpolation != MV_InterpNearest ? 16 : 24 ) )
+            {
+            quality = MV_InterpLinear;
+            }
+         else
+            {
+            quality = MV_InterpNearest;
+            }
+
+         if ( ( quality == MV_InterpCubic ) && ( budget < 4 ) )
+            {
+            quality = MV_InterpLinear;
+            }
+         if ( ( quality == MV_InterpLinear ) && ( budget < 2 ) )
+            {
+            quality = MV_InterpNearest;
+            }
+
+         if ( quality == MV_InterpCubic )
+            {
+            budget -= 4;
+            }
+         else if ( quality == MV_InterpLinear )
+            {
+            budget -= 2;
+            }
+         }
+
+      voice->Interpolation = quality;
+      voice->mix = voice->Kernels[ quality ];
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ServiceVoc
+
+   Starts playback of the waiting buffer and mixes the next one.
+
+   JBF: no synchronisation happens inside MV_ServiceVoc nor the
+        supporting functions it calls. This would cause a deadlock
+        between the mixer thread in the driver vs the nested
+        locking in the user-space functions of MultiVoc. The call
+        to MV_ServiceVoc is synchronised in the driver.
+
+        Known functions called by MV_ServiceVoc and its helpers:
+           MV_Mix (and its MV_Mix*bit* workers)
+           MV_GetNextVOCBlock
+           MV_GetNextWAVBlock
+           MV_GetNextQueuedBlock
+           MV_SetVoiceMixMode
+---------------------------------------------------------------------*/
+static void MV_ServiceVoc
+   (
+   void
+   )
+
+   {
+   VoiceNode *voice;
+   VoiceNode *next;
+   //int        flags;
+
+   // Toggle which buffer we'll mix next
+   MV_MixPage++;
+   if ( MV_MixPage >= MV_NumberOfBuffers )
+      {
+      MV_MixPage -= MV_NumberOfBuffers;
+      }
+
+   MV_MixClock += MixBufferSize;
+
+   if ( MV_ReverbLevel == 0 )
+      {
+      // Initialize buffer
+      //Commented out so that the buffer is always cleared.
+      //This is so the guys at Echo Speech can mix into the
+      //buffer even when no sounds are playing.
+      //if ( !MV_BufferEmpty[ MV_MixPage ] )
+         {
+         ClearBuffer_DW( MV_MixBuffer[ MV_MixPage ], MV_Silence, MV_BufferSize >> 2 );
+         MV_BufferEmpty[ MV_MixPage ] = TRUE;
+         }
+      }
+   else
+      {
+      char *end;
+      char *source;
+      char *dest;
+      unsigned int   count;
+      unsigned int   length;
+
+      end = MV_MixBuffer[ 0 ] + MV_BufferLength;;
+      dest = MV_MixBuffer[ MV_MixPage ];
+      source = MV_MixBuffer[ MV_MixPage ] - MV_ReverbDelay;
+      if ( source < MV_MixBuffer[ 0 ] )
+         {
+         source += MV_BufferLength;
+         }
+
+      length = MV_BufferSize;
+      while( length > 0 )
+         {
+         count = length;
+         if ( source + count > end )
+            {
+            count = (unsigned int)(end - source);
+            }
+
+         if ( MV_Bits == 16 )
+            {
+            if ( MV_ReverbTable != NULL )
+               {
+               MV_16BitReverb( source, dest, MV_ReverbTable, count / 2 );
+               }
+            else
+               {
+               MV_16BitReverbFast( source, dest, count / 2, MV_ReverbLevel );
+               }
+            }
+         else
+            {
+            if ( MV_ReverbTable != NULL )
+               {
+               MV_8BitReverb( (signed char *) source, (signed char *) dest, MV_ReverbTable, count );
+               }
+            else
+               {
+               MV_8BitReverbFast( (signed char *) source, (signed char *) dest, count, MV_ReverbLevel );
+               }
+            }
+
+         // if we go through the loop again, it means that we've wrapped around the buffer
+         source  = MV_MixBuffer[ 0 ];
+         dest   += count;
+         length -= count;
+         }
+      }
+
+   MV_UpdateEmitters();
+
+   if ( MV_Interpolation != MV_InterpNearest )
+      {
+      MV_SelectInterpolation();
+      }
+
+   // Play any waiting voices
+   //flags = DisableInterrupts();
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
+      {
+      if ( voice->Paused )
+         {
+         next = voice->next;
+         continue;
+         }
+
+      MV_BufferEmpty[ MV_MixPage ] = FALSE;
+
+      if ( voice->Emitter.active || ( ( voice->Angle >= 0 ) && MV_SpreadAngles() ) )
+         {
+         MV_MixSpatialVoice( voice );
+         }
+      else if ( voice->Filter.type != MV_FilterNone )
+         {
+         MV_MixFilteredVoice( voice, MV_MixPage );
+         }
+      else if ( voice->Sends || MV_KeyGroups[ voice->Group ] ||
+         MV_GroupDucked( voice->Group ) )
+         {
+         MV_MixSendVoice( voice, MV_MixPage );
+         }
+      else
+         {
+         MV_MixFunction( voice, MV_MixPage );
+         }
+
+      next = voice->next;
+
+      // Is this voice done?
+      if ( !voice->Playing )
+         {
+         //JBF: prevent a deadlock caused by MV_StopVoice grabbing the mutex again
+         //MV_StopVoice( voice );
+         LL_Remove( voice, next, prev );
+         MV_RecycleVoice( voice );
+
+         MV_CleanupVoice( voice );
+
+         MV_DoVoiceCallbacks( voice->callbackval, voice->MergedCallbacks,
+            voice->NumMerged );
+         }
+      }
+
+   if ( MV_FilterBatchLanes > 0 )
+      {
+      MV_FlushFilters( MV_MixPage );
+      }
+
+   if ( MV_HRTF != NULL )
+      {
+      MV_FlushHRTF();
+      }
+
+   if ( MV_SpatialActive && ( MV_OutputChannels == MV_Channels ) )
+      {
+      MV_FlushSpatial( MV_MixPage );
+      }
+
+   MV_UpdateDucking();
+
+   MV_ProcessBuses( MV_MixPage );
+
+   if ( MV_Room != NULL )
+      {
+      MV_ApplyRoomReverb( MV_MixPage );
+      }
+
+   // Surround output is limited once the speakers are mixed
+   if ( ( MV_Limiter != NULL ) && ( MV_OutputChannels == MV_Channels ) )
+      {
+      MV_ApplyLimiter( MV_MixPage );
+      }
+
+   //RestoreInterrupts(flags);
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ReadMixPage
+
+   Mixes the next buffer and returns it as float frames with one sample
+   per output channel.  On surround devices the stereo mix fills the
+   front pair and the spread 3D voices are added to every speaker.
+---------------------------------------------------------------------*/
+
+static void MV_ReadMixPage
+   (
+   float *data
+   )
+
+   {
+   float *dest;
+   float  makeup;
+   int    index;
+   int    channel;
+   int    count;
+
+   MV_ServiceVoc();
+
+   for( index = 0; index < MixBufferSize; index++ )
+      {
+      dest = data + index * MV_OutputChannels;
+      for( channel = 0; channel < MV_Channels; channel++ )
+         {
+         if ( MV_Bits == 16 )
+            {
+            dest[ channel ] = ( ( short * )MV_MixBuffer[ MV_MixPage ] )[ index * MV_Channels + channel ];
+            }
+         else
+            {
+            dest[ channel ] = ( float )( ( ( unsigned char * )MV_MixBuffer[ MV_MixPage ] )
+               [ index * MV_Channels + channel ] - 128 );
+            }
+         }
+      for( ; channel < MV_OutputChannels; channel++ )
+         {
+         dest[ channel ] = 0.f;
+         }
+      }
+
+   if ( MV_OutputChannels == MV_Channels )
+      {
+      return;
+      }
+
+   if ( MV_SpatialActive )
+      {
+      for( index = 0; index < MixBufferSize; index++ )
+         {
+         dest = data + index * MV_OutputChannels;
+         for( channel = 0; channel < MV_OutputChannels; channel++ )
+            {
+            dest[ channel ] += MV_SpatialData[ index ][ channel ];
+            }
+         }
+      memset( MV_SpatialData, 0, sizeof( MV_SpatialData ) );
+      MV_SpatialActive = FALSE;
+      }
+
+   if ( MV_Limiter != NULL )
+      {
+      count  = MixBufferSize * MV_OutputChannels;
+      makeup = ( float )( 1 << MV_Headroom );
+      for( index = 0; index < count; index++ )
+         {
+         data[ index ] *= makeup;
+         }
+
+      MV_ProcessLimiter( MV_Limiter, data );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ServiceOutput
+
+   Driver callback when the output pages differ from the mix pages,
+   either because the mix runs at an internal rate or because the
+   device has surround channels.  Mixes as many buffers as needed and
+   writes them, at the device rate, to the next output page.
+---------------------------------------------------------------------*/
+
+static void MV_ServiceOutput
+   (
+   void
+   )
+
+   {
+   int index;
+   int count;
+   int sample;
+
+   MV_OutputPage++;
+   if ( MV_OutputPage >= MV_NumberOfBuffers )
+      {
+      MV_OutputPage -= MV_NumberOfBuffers;
+      }
+
+   if ( MV_Resampler != NULL )
+      {
+      while( MV_ResamplerAvailable( MV_Resampler ) < MixBufferSize )
+         {
+         MV_ReadMixPage( MV_ResampleData );
+         MV_ResamplerPush( MV_Resampler, MV_ResampleData, MixBufferSize );
+         }
+
+      MV_ResamplerPull( MV_Resampler, MV_ResampleData, MixBufferSize );
+      }
+   else
+      {
+      MV_ReadMixPage( MV_ResampleData );
+      }
+
+   count = MixBufferSize * MV_OutputChannels;
+   if ( MV_Bits == 16 )
+      {
+      short *dest;
+
+      dest = ( short * )MV_OutputBuffer[ MV_OutputPage ];
+      for( index = 0; index < count; index++ )
+         {
+         sample = ( int )floorf( MV_ResampleData[ index ] + 0.5f );
+         dest[ index ] = ( short )min( 32767, max( -32768, sample ) );
+         }
+      }
+   else
+      {
+      unsigned char *dest;
+
+      dest = ( unsigned char * )MV_OutputBuffer[ MV_OutputPage ];
+      for( index = 0; index < count; index++ )
+         {
+         sample = ( int )floorf( MV_ResampleData[ index ] + 0.5f ) + 128;
+         dest[ index ] = ( unsigned char )min( 255, max( 0, sample ) );
+         }
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextVOCWindow
+
+   Decodes the next window of a packed VOC block, or plays the next
+   stretch of a silence block from the shared silent buffer.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextVOCWindow
+   (
+   VoiceNode  *voice,
+   vocdecoder *dec
+   )
+
+   {
+   unsigned int count;
+   unsigned int bytes;
+
+   if ( dec->silence > 0 )
+      {
+      count         = min( dec->silence, ( unsigned int )MV_VOCWindow );
+      dec->silence -= count;
+      voice->sound  = ( char * )MV_VOCSilence;
+      }
+   else
+      {
+      count = 0;
+      if ( dec->haveref )
+         {
+         // A packed block opens with a plain sample to start from
+         dec->reference = *dec->data++;
+         dec->scale     = 0;
+         dec->window[ count++ ] = ( unsigned char )dec->reference;
+         dec->bytes--;
+         dec->haveref = FALSE;
+         }
+
+      bytes = min( dec->bytes, ( unsigned int )( ( MV_VOCWindow - 1 ) /
+         MV_CreativeADPCMRatio( dec->packtype ) ) );
+      count += MV_DecodeCreativeADPCM( dec->packtype, dec->data, bytes,
+         dec->window + count, &dec->reference, &dec->scale );
+      dec->data  += bytes;
+      dec->bytes -= bytes;
+      voice->sound = ( char * )dec->window;
+      }
+
+   voice->position   -= voice->length;
+   voice->length      = count << 16;
+   voice->BlockLength = 0;
+
+   return( KeepPlaying );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextVOCBlock
+
+   Interperate the information of a VOC format sound file.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextVOCBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   unsigned char *ptr;
+   int            blocktype;
+   int            lastblocktype;
+   unsigned int   blocklength = 0;
+   unsigned int   samplespeed = 0;
+   unsigned int   tc = 0;
+   int            packtype;
+   int            voicemode;
+   int            done;
+   unsigned       BitsPerSample;
+   unsigned       Channels;
+   unsigned       Format;
+   vocdecoder    *dec;
+
+   // Only files with packed or silence blocks have a decoder
+   dec = ( vocdecoder * )voice->extra;
+   if ( ( dec != NULL ) && ( ( dec->bytes > 0 ) || ( dec->silence > 0 ) ) )
+      {
+      return( MV_GetNextVOCWindow( voice, dec ) );
+      }
+
+   if ( voice->BlockLength > 0 )
+      {
+      voice->position    -= voice->length;
+      voice->sound       += (voice->length >> 16) * (voice->channels * voice->bits / 8);
+      voice->length       = min( voice->BlockLength, 0x8000 );
+      voice->BlockLength -= voice->length;
+      voice->length     <<= 16;
+      return( KeepPlaying );
+      }
+
+   if ( ( voice->length > 0 ) && ( voice->LoopEnd != NULL ) &&
+      ( voice->LoopStart != NULL ) )
+      {
+      voice->BlockLength  = voice->LoopSize;
+      voice->sound        = voice->LoopStart;
+      voice->position     = 0;
+      voice->length       = min( voice->BlockLength, 0x8000 );
+      voice->BlockLength -= voice->length;
+      voice->length     <<= 16;
+      return( KeepPlaying );
+      }
+
+   ptr = ( unsigned char * )voice->NextBlock;
+
+   voice->Playing = TRUE;
+
+   voicemode = 0;
+   lastblocktype = 0;
+   packtype = VOC_8BIT;
+
+   done = FALSE;
+   while( !done )
+      {
+      // Stop playing if we get a NULL pointer
+      if ( ptr == NULL )
+         {
+         voice->Playing = FALSE;
+         done = TRUE;
+         break;
+         }
+
+      blocktype = ( int )*ptr;
+      blocklength = LITTLE32( *( unsigned int * )( ptr + 1 ) ) & 0x00ffffff;
+      ptr += 4;
+
+      switch( blocktype )
+         {
+         case 0 :
+            // End of data
+            if ( ( voice->LoopStart == NULL ) ||
+               ( voice->LoopStart >= (char *)( ptr - 4 ) ) )
+               {
+               voice->Playing = FALSE;
+               done = TRUE;
+               }
+            else
+               {
+               voice->BlockLength  = (unsigned int)((char *)( ptr - 4 ) - voice->LoopStart);
+               voice->sound        = voice->LoopStart;
+               voice->position     = 0;
+               voice->length       = min( voice->BlockLength, 0x8000 );
+               voice->BlockLength -= voice->length;
+               voice->length     <<= 16;
+               return( KeepPlaying );
+               }
+            break;
+
+         case 1 :
+            // Sound data block
+            voice->bits  = 8;
+            voice->Expand = NULL;
+            voice->channels = voicemode + 1;
+            if ( lastblocktype != 8 )
+               {
+               tc = ( unsigned int )*ptr << 8;
+               packtype = *( ptr + 1 );
+               }
+
+            ptr += 2;
+            blocklength -= 2;
+
+            samplespeed = 256000000L / ( voice->channels * ( 65536 - tc ) );
+
+            if ( dec != NULL )
+               {
+               dec->packtype = packtype;
+               }
+
+            if ( packtype == VOC_8BIT )
+               {
+               done = TRUE;
+               }
+            else if ( ( dec != NULL ) && ( blocklength > 0 ) &&
+               ( MV_CreativeADPCMRatio( packtype ) > 0 ) )
+               {
+               // Decoded a window at a time as it plays
+               voice->channels = 1;
+               dec->data    = ptr;
+               dec->bytes   = blocklength;
+               dec->haveref = TRUE;
+               ptr         += blocklength;
+               blocklength  = 0;
+               done         = TRUE;
+               }
+            else
+               {
+               // Skip packed data we cannot decode
+               ptr += blocklength;
+               }
+            voicemode = 0;
+            break;
+
+         case 2 :
+            // Sound continuation block
+            samplespeed = voice->SamplingRate;
+            if ( ( dec != NULL ) && ( dec->packtype != VOC_8BIT ) )
+               {
+               // Packed data carries on from the previous block's state
+               if ( ( blocklength > 0 ) &&
+                  ( MV_CreativeADPCMRatio( dec->packtype ) > 0 ) )
+                  {
+                  dec->data    = ptr;
+                  dec->bytes   = blocklength;
+                  dec->haveref = FALSE;
+                  ptr         += blocklength;
+                  blocklength  = 0;
+                  done         = TRUE;
+                  }
+               else
+                  {
+                  ptr += blocklength;
+                  }
+               break;
+               }
+            done = TRUE;
+            break;
+
+         case 3 :
+            // Silence
+            if ( dec != NULL )
+               {
+               dec->silence = LITTLE16( *( unsigned short * )ptr ) + 1;
+               tc = ( unsigned int )*( ptr + 2 ) << 8;
+               samplespeed = 256000000L / ( 65536 - tc );
+               voice->bits     = 8;
+               voice->channels = 1;
+               voice->Expand   = NULL;
+               ptr        += blocklength;
+               blocklength = 0;
+               done        = TRUE;
+               }
+            else
+               {
+               ptr += blocklength;
+               }
+            break;
+
+         case 4 :
+            // Marker
+            // Not implimented.
+            ptr += blocklength;
+            break;
+
+         case 5 :
+            // ASCII string
+            // Not implimented.
+            ptr += blocklength;
+            break;
+
+         case 6 :
+            // Repeat begin
+            if ( voice->LoopEnd == NULL )
+               {
+               voice->LoopCount = LITTLE16(*( unsigned short * )ptr);
+               voice->LoopStart = (char *)ptr + blocklength;
+               }
+            ptr += blocklength;
+            break;
+
+         case 7 :
+            // Repeat end
+            ptr += blocklength;
+            if ( lastblocktype == 6 )
+               {
+               voice->LoopCount = 0;
+               }
+            else
+               {
+               if ( ( voice->LoopCount > 0 ) && ( voice->LoopStart != NULL ) )
+                  {
+                  ptr = (unsigned char *)voice->LoopStart;
+                  if ( voice->LoopCount < 0xffff )
+                     {
+                     voice->LoopCount--;
+                     if ( voice->LoopCount == 0 )
+                        {
+                        voice->LoopStart = NULL;
+                        }
+                     }
+                  }
+               }
+            break;
+
+         case 8 :
+            // Extended block
+            voice->bits  = 8;
+            voice->channels = 1;
+            tc = LITTLE16( *( unsigned short * )ptr );
+            packtype = *( ptr + 2 );
+            voicemode = *( ptr + 3 );
+            ptr += blocklength;
+            break;
+
+         case 9 :
+            // New sound data block
+            samplespeed = LITTLE32( *( unsigned int * )ptr );
+            BitsPerSample = ( unsigned )*( ptr + 4 );
+            Channels = ( unsigned )*( ptr + 5 );
+            Format = ( unsigned )LITTLE16( *( unsigned short * )( ptr + 6 ) );
+
+            // Only packed data is continued through the decoder
+            if ( dec != NULL )
+               {
+               dec->packtype = ( MV_CreativeADPCMRatio( Format ) > 0 ) ? Format : VOC_8BIT;
+               }
+
+            if ( ( BitsPerSample == 8 ) && ( Channels == 1 || Channels == 2 ) &&
+               ( Format == VOC_8BIT || Format == VOC_ALAW || Format == VOC_MULAW ) )
+               {
+               ptr         += 12;
+               blocklength -= 12;
+               voice->bits  = 8;
+               voice->channels = Channels;
+               voice->Expand = ( Format == VOC_ALAW ) ? MV_ALawTable :
+                  ( Format == VOC_MULAW ) ? MV_MuLawTable : NULL;
+               done         = TRUE;
+               }
+            else if ( ( BitsPerSample == 16 ) && ( Channels == 1 || Channels == 2 ) &&
+               ( Format == VOC_16BIT ) )
+               {
+               ptr         += 12;
+               blocklength -= 12;
+               voice->bits  = 16;
+               voice->channels = Channels;
+               voice->Expand = NULL;
+               done         = TRUE;
+               }
+            else if ( ( dec != NULL ) && ( Channels == 1 ) && ( blocklength > 12 ) &&
+               ( MV_CreativeADPCMRatio( Format ) > 0 ) )
+               {
+               // Decoded a window at a time as it plays, like a type 1 block
+               ptr         += 12;
+               blocklength -= 12;
+               voice->bits  = 8;
+               voice->channels = 1;
+               voice->Expand = NULL;
+               dec->data    = ptr;
+               dec->bytes   = blocklength;
+               dec->haveref = TRUE;
+               ptr         += blocklength;
+               blocklength  = 0;
+               done         = TRUE;
+               }
+            else
+               {
+               // Nothing carries on from packed data we cannot decode
+               if ( dec != NULL )
+                  {
+                  dec->packtype = VOC_8BIT;
+                  }
+               ptr += blocklength;
+               }
+            break;
+
+         default :
+            // Unknown data.  Probably not a VOC file.
+            voice->Playing = FALSE;
+            done = TRUE;
+            break;
+         }
+
+      lastblocktype = blocktype;
+      }
+
+   if ( voice->Playing )
+      {
+      voice->NextBlock    = (char *)ptr + blocklength;
+      voice->sound        = (char *)ptr;
+
+      voice->SamplingRate = samplespeed;
+      voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
+
+      // Multiply by MixBufferSize - 1
+      voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+         voice->RateScale;
+
+      if ( ( dec != NULL ) && ( ( dec->bytes > 0 ) || ( dec->silence > 0 ) ) )
+         {
+         // Loop points are offsets into sample data, which packed and
+         // silent blocks don't have
+         if ( voice->LoopEnd != NULL )
+            {
+            voice->LoopStart = NULL;
+            voice->LoopEnd   = NULL;
+            }
+
+         voice->bits = 8;
+         MV_SetVoiceMixMode( voice );
+
+         return( MV_GetNextVOCWindow( voice, dec ) );
+         }
+
+      if ( voice->LoopEnd != NULL )
+         {
+         if ( blocklength > (unsigned int)(intptr_t)voice->LoopEnd )
+            {
+            blocklength = (unsigned int)(intptr_t)voice->LoopEnd;
+            }
+         else
+            {
+            voice->LoopEnd = (char *)(intptr_t)blocklength;
+            }
+
+         voice->LoopStart = voice->sound + (intptr_t)voice->LoopStart;
+         voice->LoopEnd   = voice->sound + (intptr_t)voice->LoopEnd;
+         voice->LoopSize  = (unsigned int)(voice->LoopEnd - voice->LoopStart);
+         }
+
+      if ( voice->bits == 16 )
+         {
+         blocklength /= 2;
+         }
+      if ( voice->channels == 2 )
+         {
+         blocklength /= 2;
+         }
+
+      voice->position     = 0;
+      voice->length       = min( blocklength, 0x8000 );
+      voice->BlockLength  = blocklength - voice->length;
+      voice->length     <<= 16;
+
+      MV_SetVoiceMixMode( voice );
+
+      return( KeepPlaying );
+      }
+
+   return( NoMoreData );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextDemandFeedBlock
+
+   Controls playback of demand fed data.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextDemandFeedBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   if ( voice->BlockLength > 0 )
+      {
+      voice->position    -= voice->length;
+      voice->sound       += voice->length >> 16;
+      voice->length       = min( voice->BlockLength, 0x8000 );
+      voice->BlockLength -= voice->length;
+      voice->length     <<= 16;
+
+      return( KeepPlaying );
+      }
+
+   if ( voice->DemandFeed == NULL )
+      {
+      return( NoMoreData );
+      }
+
+   voice->position     = 0;
+   ( voice->DemandFeed )( &voice->sound, &voice->BlockLength );
+   voice->length       = min( voice->BlockLength, 0x8000 );
+   voice->BlockLength -= voice->length;
+   voice->length     <<= 16;
+
+   if ( ( voice->length > 0 ) && ( voice->sound != NULL ) )
+      {
+      return( KeepPlaying );
+      }
+   return( NoMoreData );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextQueuedBlock
+
+   Controls playback of buffers submitted with MV_QueueBuffer.  When
+   the queue runs dry the voice idles until more data arrives.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextQueuedBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   queuedata *qd = ( queuedata * )voice->extra;
+   unsigned int slot;
+
+   if ( voice->BlockLength <= 0 )
+      {
+      if ( qd->playing )
+         {
+         qd->playing = FALSE;
+         qd->finished++;
+         }
+
+      if ( qd->head == qd->tail )
+         {
+         if ( qd->ended )
+            {
+            voice->Playing = FALSE;
+            }
+
+         voice->position = 0;
+         voice->length   = 0;
+         return( NoMoreData );
+         }
+
+      slot = qd->head % MV_MaxQueuedBuffers;
+      qd->head++;
+      qd->playing = TRUE;
+
+      voice->NextBlock   = qd->buffer[ slot ];
+      voice->BlockLength = qd->length[ slot ];
+      }
+
+   voice->sound        = voice->NextBlock;
+   voice->position    -= voice->length;
+   voice->length       = min( voice->BlockLength, 0x8000 );
+   voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
+   voice->BlockLength -= voice->length;
+   voice->length     <<= 16;
+
+   return( KeepPlaying );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextRawBlock
+
+   Controls playback of demand fed data.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextRawBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   if ( voice->BlockLength <= 0 )
+      {
+      if ( voice->LoopStart == NULL )
+         {
+         voice->Playing = FALSE;
+         return( NoMoreData );
+         }
+
+      voice->BlockLength = voice->LoopSize;
+      voice->NextBlock   = voice->LoopStart;
+      voice->length = 0;
+      voice->position = 0;
+      }
+
+   voice->sound        = voice->NextBlock;
+   voice->position    -= voice->length;
+   voice->length       = min( voice->BlockLength, 0x8000 );
+   voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
+   voice->BlockLength -= voice->length;
+   voice->length     <<= 16;
+
+   return( KeepPlaying );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ParseWAV
+
+   Reads the format of a RIFF WAVE file and locates its sample data.
+   Only 8 and 16 bit PCM, 8 bit A-law and mu-law, and 4 bit IMA ADPCM
+   with one or two channels are accepted.  Chunks between the format and the data, such as the
+   fact chunk compressed files carry, are skipped.
+---------------------------------------------------------------------*/
+
+int MV_ParseWAV
+   (
+   char          *ptr,
+   unsigned int   ptrlength,
+   format_header *format,
+   char         **sampledata,
+   unsigned int  *samplelength
+   )
+
+   {
+   riff_header   riff;
+   data_header   data;
+   char *dataptr = ptr;
+
+   memcpy(&riff, dataptr, sizeof(riff_header));
+   riff.file_size   = LITTLE32(riff.file_size);
+   riff.format_size = LITTLE32(riff.format_size);
+   dataptr += sizeof(riff_header);
+
+   if ( ( memcmp( riff.RIFF, "RIFF", 4 ) != 0 ) ||
+      ( memcmp( riff.WAVE, "WAVE", 4 ) != 0 ) ||
+      ( memcmp( riff.fmt, "fmt ", 4) != 0 ) )
+      {
+      MV_SetErrorCode( MV_InvalidWAVFile );
+      return( MV_Error );
+      }
+
+   memcpy(format, dataptr, sizeof(format_header));
+   format->wFormatTag      = LITTLE16(format->wFormatTag);
+   format->nChannels       = LITTLE16(format->nChannels);
+   format->nSamplesPerSec  = LITTLE32(format->nSamplesPerSec);
+   format->nAvgBytesPerSec = LITTLE32(format->nAvgBytesPerSec);
+   format->nBlockAlign     = LITTLE16(format->nBlockAlign);
+   format->nBitsPerSample  = LITTLE16(format->nBitsPerSample);
+   dataptr += riff.format_size;
+
+   memcpy(&data, dataptr, sizeof(data_header));
+   data.size = LITTLE32(data.size);
+
+   while ( ( memcmp( data.DATA, "data", 4 ) != 0 ) && ( ptrlength > 0 ) &&
+      ( ( unsigned int )( dataptr - ptr ) + sizeof(data_header) + data.size +
+        sizeof(data_header) <= ptrlength ) )
+      {
+      dataptr += sizeof(data_header) + ( ( data.size + 1 ) & ~1 );
+      memcpy(&data, dataptr, sizeof(data_header));
+      data.size = LITTLE32(data.size);
+      }
+
+   if ( format->nChannels != 1 && format->nChannels != 2 )
+      {
+      MV_SetErrorCode( MV_InvalidWAVFile );
+      return( MV_Error );
+      }
+
+   // Check if it's PCM, companded or ADPCM data.
+   if ( format->wFormatTag == WAVE_FORMAT_PCM )
+      {
+      if ( ( format->nBitsPerSample != 8 ) &&
+         ( format->nBitsPerSample != 16 ) )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+      }
+   else if ( ( format->wFormatTag == WAVE_FORMAT_ALAW ) ||
+      ( format->wFormatTag == WAVE_FORMAT_MULAW ) )
+      {
+      if ( format->nBitsPerSample != 8 )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+      }
+   else if ( format->wFormatTag == WAVE_FORMAT_IMA_ADPCM )
+      {
+      if ( ( format->nBitsPerSample != 4 ) ||
+         ( format->nBlockAlign <= 4 * format->nChannels ) )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+      }
+   else
+      {
+      MV_SetErrorCode( MV_InvalidWAVFile );
+      return( MV_Error );
+      }
+
+   if ( memcmp( data.DATA, "data", 4 ) != 0 )
+      {
+      MV_SetErrorCode( MV_InvalidWAVFile );
+      return( MV_Error );
+      }
+
+   dataptr += sizeof(data_header);
+
+   // Don't trust a data size that runs past the end of the file
+   if ( ( ptrlength > 0 ) && ( ( unsigned int )( dataptr - ptr ) <= ptrlength ) )
+      {
+      data.size = min( data.size, ptrlength - ( unsigned int )( dataptr - ptr ) );
+      }
+
+   *sampledata   = dataptr;
+   *samplelength = data.size;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetNextWAVBlock
+
+   Controls playback of demand fed data.
+---------------------------------------------------------------------*/
+
+static playbackstatus MV_GetNextWAVBlock
+   (
+   VoiceNode *voice
+   )
+
+   {
+   if ( voice->BlockLength <= 0 )
+      {
+      if ( voice->LoopStart == NULL )
+         {
+         voice->Playing = FALSE;
+         return( NoMoreData );
+         }
+
+      voice->BlockLength = voice->LoopSize;
+      voice->NextBlock   = voice->LoopStart;
+      voice->length      = 0;
+      voice->position    = 0;
+      }
+
+   voice->sound        = voice->NextBlock;
+   voice->position    -= voice->length;
+   voice->length       = min( voice->BlockLength, 0x8000 );
+   voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
+   voice->BlockLength -= voice->length;
+   voice->length     <<= 16;
+
+   return( KeepPlaying );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ServiceRecord
+
+   Starts recording of the waiting buffer.
+---------------------------------------------------------------------*/
+
+/*static void MV_ServiceRecord
+   (
+   void
+   )
+
+   {
+   if ( MV_RecordFunc )
+      {
+      MV_RecordFunc( MV_MixBuffer[ 0 ] + MV_MixPage * MixBufferSize,
+         MixBufferSize );
+      }
+
+   // Toggle which buffer we'll mix next
+   MV_MixPage++;
+   if ( MV_MixPage >= NumberOfBuffers )
+      {
+      MV_MixPage = 0;
+      }
+   }*/
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetVoice
+
+   Locates the voice with the specified handle.
+---------------------------------------------------------------------*/
+
+static VoiceNode *MV_GetVoice
+   (
+   int handle
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+
+   flags = DisableInterrupts();
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+      {
+      if ( handle == voice->handle )
+         {
+         break;
+         }
+      }
+
+   RestoreInterrupts( flags );
+
+   if ( voice == &VoiceList )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      voice = 0;
+      }
+
+   return( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_VoicePlaying
+
+   Checks if the voice associated with the specified handle is
+   playing.
+---------------------------------------------------------------------*/
+
+int MV_VoicePlaying
+   (
+   int handle
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( FALSE );
+      }
+
+   voice = MV_GetVoice( handle );
+
+   if ( voice == NULL )
+      {
+      return( FALSE );
+      }
+
+   return( TRUE );
+   }
+
+
+/*---------------------------------------------------------------------
+Function: MV_VoicePaused
+
+Checks if the voice associated with the specified handle is
+paused.
+---------------------------------------------------------------------*/
+
+int MV_VoicePaused
+   (
+   int handle
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( FALSE );
+      }
+
+   voice = MV_GetVoice( handle );
+
+   if ( voice == NULL )
+      {
+      return( FALSE );
+      }
+
+   return voice->Paused;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_KillAllVoices
+
+   Stops output of all currently active voices.
+---------------------------------------------------------------------*/
+
+int MV_KillAllVoices
+   (
+   void
+   )
+
+   {
+   VoiceNode * voice, * next;
+   int        flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   // Remove all the voices from the list
+   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
+      {
+      next = voice->next;
+      if (voice->priority < MV_MUSIC_PRIORITY)
+         {
+         MV_Kill( voice->handle );
+         }
+      }
+
+   RestoreInterrupts(flags);
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_KillSoundVoices
+
+   Stops every voice playing a loaded sound.
+---------------------------------------------------------------------*/
+
+void MV_KillSoundVoices
+   (
+   int sound
+   )
+
+   {
+   VoiceNode * voice, * next;
+   int        flags;
+
+   flags = DisableInterrupts();
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
+      {
+      next = voice->next;
+      if ( voice->Sound == sound )
+         {
+         MV_Kill( voice->handle );
+         }
+      }
+
+   RestoreInterrupts( flags );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_Kill
+
+   Stops output of the voice associated with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_Kill
+   (
+   int handle
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+   unsigned int callbackval;
+   unsigned int merged[ MV_MaxMergedCallbacks ];
+   int        nummerged;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
+      }
+
+   callbackval = voice->callbackval;
+   nummerged   = voice->NumMerged;
+   memcpy( merged, voice->MergedCallbacks, nummerged * sizeof( merged[ 0 ] ) );
+
+   MV_StopVoice( voice );
+
+   RestoreInterrupts( flags );
+
+   MV_DoVoiceCallbacks( callbackval, merged, nummerged );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PauseVoice
+
+   Pauses or resumes output of the voice associated with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_PauseVoice
+(
+ int handle,
+ int pauseon
+ )
+
+{
+   VoiceNode *voice;
+   int        flags;
+
+   if ( !MV_Installed )
+   {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+   }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+   {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
+   }
+
+   voice->Paused = pauseon;
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+}
+
+
+/*---------------------------------------------------------------------
+   Function: MV_VoicesPlaying
+
+   Determines the number of currently active voices.
+---------------------------------------------------------------------*/
+
+int MV_VoicesPlaying
+   (
+   void
+   )
+
+   {
+   VoiceNode   *voice;
+   int         NumVoices = 0;
+   int         flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( 0 );
+      }
+
+   flags = DisableInterrupts();
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+      {
+      NumVoices++;
+      }
+
+   RestoreInterrupts( flags );
+
+   return( NumVoices );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_AllocVoice
+
+   Retrieve an inactive or lower priority voice for output.
+---------------------------------------------------------------------*/
+
+VoiceNode *MV_AllocVoice
+   (
+   int priority
+   )
+
+   {
+   VoiceNode   *voice;
+   VoiceNode   *node;
+   int          flags;
+
+//return( NULL );
+   if ( MV_Recording )
+      {
+      return( NULL );
+      }
+
+   flags = DisableInterrupts();
+
+   // Check if we have any free voices
+   if ( LL_Empty( &VoicePool, next, prev ) )
+      {
+      // check if we have a higher priority than a voice that is playing.
+      voice = VoiceList.next;
+      for( node = voice->next; node != &VoiceList; node = node->next )
+         {
+         if ( node->priority < voice->priority )
+            {
+            voice = node;
+            }
+         }
+
+      if ( priority >= voice->priority )
+         {
+         MV_Kill( voice->handle );
+         }
+      }
+
+   // Check if any voices are in the voice pool
+   if ( LL_Empty( &VoicePool, next, prev ) )
+      {
+      // No free voices
+      RestoreInterrupts( flags );
+      return( NULL );
+      }
+
+   voice = VoicePool.next;
+   LL_Remove( voice, next, prev );
+   RestoreInterrupts( flags );
+
+   // Find a free voice handle
+   do
+      {
+      MV_VoiceHandle++;
+      if ( MV_VoiceHandle < MV_MinVoiceHandle )
+         {
+         MV_VoiceHandle = MV_MinVoiceHandle;
+         }
+      }
+   while( MV_VoicePlaying( MV_VoiceHandle ) );
+
+   voice->handle = MV_VoiceHandle;
+   voice->Interpolation = MV_InterpNearest;
+   voice->Expand        = NULL;
+   voice->Filter.type   = MV_FilterNone;
+   voice->Sends         = 0;
+   voice->Group         = 0;
+   voice->Angle         = -1;
+   voice->NumMerged     = 0;
+   voice->Sound         = 0;
+   voice->File          = NULL;
+   memset( voice->Send, 0, sizeof( voice->Send ) );
+   memset( &voice->Emitter, 0, sizeof( voice->Emitter ) );
+
+   return( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_VoiceAvailable
+
+   Checks if a voice can be play at the specified priority.
+---------------------------------------------------------------------*/
+
+int MV_VoiceAvailable
+   (
+   int priority
+   )
+
+   {
+   VoiceNode   *voice;
+   VoiceNode   *node;
+   int          flags;
+
+   // Check if we have any free voices
+   if ( !LL_Empty( &VoicePool, next, prev ) )
+      {
+      return( TRUE );
+      }
+
+   flags = DisableInterrupts();
+
+   // check if we have a higher priority than a voice that is playing.
+   voice = VoiceList.next;
+   for( node = VoiceList.next; node != &VoiceList; node = node->next )
+      {
+      if ( node->priority < voice->priority )
+         {
+         voice = node;
+         }
+      }
+
+   RestoreInterrupts( flags );
+
+   if ( ( voice != &VoiceList ) && ( priority >= voice->priority ) )
+      {
+      return( TRUE );
+      }
+
+   return( FALSE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoicePitch
+
+   Sets the pitch for the specified voice.
+---------------------------------------------------------------------*/
+
+static void MV_SetVoicePitch
+   (
+   VoiceNode *voice,
+   unsigned int rate,
+   int pitchoffset
+   )
+
+   {
+   voice->SamplingRate = rate;
+   voice->PitchScale   = PITCH_GetScale( pitchoffset );
+   voice->RateScale    = ( rate * voice->PitchScale ) / MV_MixRate;
+
+   // Multiply by MixBufferSize - 1
+   voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+      voice->RateScale;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetPitch
+
+   Sets the pitch for the voice associated with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_SetPitch
+   (
+   int handle,
+   int pitchoffset
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
+      }
+
+   MV_SetVoicePitch( voice, voice->SamplingRate, pitchoffset );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetFrequency
+
+   Sets the frequency for the voice associated with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_SetFrequency
+   (
+   int handle,
+   int frequency
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
+      }
+
+   MV_SetVoicePitch( voice, frequency, 0 );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetFrequency
+
+   Gets the frequency for the voice associated with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_GetFrequency
+   (
+   int handle,
+   int *frequency
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
+      }
+
+    if ( voice->SamplingRate == 0 )
+      {
+      voice->GetSound( voice );
+      }
+
+   *frequency = voice->SamplingRate;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetVolumeTable
+
+   Returns a pointer to the volume table associated with the specified
+   volume.
+---------------------------------------------------------------------*/
+
+static short *MV_GetVolumeTable
+   (
+   int vol
+   )
+
+   {
+   int volume;
+   short *table;
+
+   volume = MIX_VOLUME( vol );
+
+   table = (short *) &MV_VolumeTable[ volume ];
+
+   return( table );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceMixMode
+
+   Selects which method should be used to mix the voice.
+
+ 8Bit  16Bit  8Bit  16Bit |  8Bit  16Bit  8Bit  16Bit |
+ Mono  Mono   Ster  Ster  |  Mono  Mono   Ster  Ster  |  Mixer
+ Out   Out    Out   Out   |  In    In     In    In    |
+--------------------------+---------------------------+-------------
+  X                       |         X                 | Mix8BitMono16
+  X                       |   X                       | Mix8BitMono
+               X          |         X                 | Mix8BitStereo16
+               X          |   X                       | Mix8BitStereo
+        X                 |         X                 | Mix16BitMono16
+        X                 |   X                       | Mix16BitMono
+                     X    |         X                 | Mix16BitStereo16
+                     X    |   X                       | Mix16BitStereo
+--------------------------+---------------------------+-------------
+                     X    |                      X    | Mix16BitStereo16Stereo
+                     X    |                X          | Mix16BitStereo8Stereo
+               X          |                      X    | Mix8BitStereo16Stereo
+               X          |                X          | Mix8BitStereo8Stereo
+        X                 |                      X    | Mix16BitMono16Stereo
+        X                 |                X          | Mix16BitMono8Stereo
+  X                       |                      X    | Mix8BitMono16Stereo
+  X                       |                X          | Mix8BitMono8Stereo
+
+---------------------------------------------------------------------*/
+
+void MV_SetVoiceMixMode
+   (
+   VoiceNode *voice
+   )
+
+   {
+   //int flags;
+   int test;
+
+   //flags = DisableInterrupts();
+
+   test = T_DEFAULT;
+   if ( MV_Bits == 8 )
+      {
+      test |= T_8BITS;
+      }
+
+   if ( MV_Channels == 1 )
+      {
+      test |= T_MONO;
+      }
+   else
+      {
+      if ( IS_QUIET( voice->RightVolume ) )
+         {
+         test |= T_RIGHTQUIET;
+         }
+      else if ( IS_QUIET( voice->LeftVolume ) )
+         {
+         test |= T_LEFTQUIET;
+         }
+      }
+
+   if ( voice->bits == 16 )
+      {
+      test |= T_16BITSOURCE;
+      }
+
+   if ( voice->channels == 2 )
+      {
+      test |= T_STEREOSOURCE;
+      test &= ~(T_RIGHTQUIET | T_LEFTQUIET);
+      }
+
+   if ( voice->Expand != NULL )
+      {
+      test |= T_LAWSOURCE;
+      }
+
+   switch( test )
+      {
+      case T_8BITS | T_MONO | T_16BITSOURCE :
+         voice->mix = MV_Mix8BitMono16;
+         break;
+
+      case T_8BITS | T_MONO :
+         voice->mix = MV_Mix8BitMono;
+         break;
+
+      case T_8BITS | T_16BITSOURCE | T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix8BitMono16;
+         break;
+
+      case T_8BITS | T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix8BitMono;
+         break;
+
+      case T_8BITS | T_16BITSOURCE | T_RIGHTQUIET :
+         voice->mix = MV_Mix8BitMono16;
+         break;
+
+      case T_8BITS | T_RIGHTQUIET :
+         voice->mix = MV_Mix8BitMono;
+         break;
+
+      case T_8BITS | T_16BITSOURCE :
+         voice->mix = MV_Mix8BitStereo16;
+         break;
+
+      case T_8BITS :
+         voice->mix = MV_Mix8BitStereo;
+         break;
+
+      case T_MONO | T_16BITSOURCE :
+         voice->mix = MV_Mix16BitMono16;
+         break;
+
+      case T_MONO :
+         voice->mix = MV_Mix16BitMono;
+         break;
+
+      case T_16BITSOURCE | T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix16BitMono16;
+         break;
+
+      case T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix16BitMono;
+         break;
+
+      case T_16BITSOURCE | T_RIGHTQUIET :
+         voice->mix = MV_Mix16BitMono16;
+         break;
+
+      case T_RIGHTQUIET :
+         voice->mix = MV_Mix16BitMono;
+         break;
+
+      case T_16BITSOURCE :
+         voice->mix = MV_Mix16BitStereo16;
+         break;
+
+      case T_SIXTEENBIT_STEREO :
+         voice->mix = MV_Mix16BitStereo;
+         break;
+
+      case T_16BITSOURCE | T_STEREOSOURCE:
+         voice->mix = MV_Mix16BitStereo16Stereo;
+         break;
+
+      case T_16BITSOURCE | T_STEREOSOURCE | T_8BITS:
+         voice->mix = MV_Mix8BitStereo16Stereo;
+         break;
+
+      case T_16BITSOURCE | T_STEREOSOURCE | T_MONO:
+         voice->mix = MV_Mix16BitMono16Stereo;
+         break;
+
+      case T_16BITSOURCE | T_STEREOSOURCE | T_8BITS | T_MONO:
+         voice->mix = MV_Mix8BitMono16Stereo;
+         break;
+
+      case T_STEREOSOURCE:
+         voice->mix = MV_Mix16BitStereo8Stereo;
+         break;
+
+      case T_STEREOSOURCE | T_8BITS:
+         voice->mix = MV_Mix8BitStereo8Stereo;
+         break;
+
+      case T_STEREOSOURCE | T_MONO:
+         voice->mix = MV_Mix16BitMono8Stereo;
+         break;
+
+      case T_STEREOSOURCE | T_8BITS | T_MONO:
+         voice->mix = MV_Mix8BitMono8Stereo;
+         break;
+
+      case T_LAWSOURCE | T_8BITS | T_MONO :
+         voice->mix = MV_Mix8BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE | T_8BITS | T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix8BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE | T_8BITS | T_RIGHTQUIET :
+         voice->mix = MV_Mix8BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE | T_8BITS :
+         voice->mix = MV_Mix8BitStereoLaw;
+         break;
+
+      case T_LAWSOURCE | T_MONO :
+         voice->mix = MV_Mix16BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE | T_LEFTQUIET :
+         MV_LeftVolume = MV_RightVolume;
+         voice->mix = MV_Mix16BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE | T_RIGHTQUIET :
+         voice->mix = MV_Mix16BitMonoLaw;
+         break;
+
+      case T_LAWSOURCE :
+         voice->mix = MV_Mix16BitStereoLaw;
+         break;
+
+      case T_LAWSOURCE | T_STEREOSOURCE :
+         voice->mix = MV_Mix16BitStereoLawStereo;
+         break;
+
+      case T_LAWSOURCE | T_STEREOSOURCE | T_8BITS :
+         voice->mix = MV_Mix8BitStereoLawStereo;
+         break;
+
+      case T_LAWSOURCE | T_STEREOSOURCE | T_MONO :
+         voice->mix = MV_Mix16BitMonoLawStereo;
+         break;
+
+      case T_LAWSOURCE | T_STEREOSOURCE | T_8BITS | T_MONO :
+         voice->mix = MV_Mix8BitMonoLawStereo;
+         break;
+
+      default :
+         voice->mix = 0;
+      }
+
+   voice->Kernels = NULL;
+   for( test = 0; test < ( int )( sizeof( MV_KernelSets ) / sizeof( MV_KernelSets[ 0 ] ) ); test++ )
+      {
+      if ( voice->mix == MV_KernelSets[ test ][ MV_InterpNearest ] )
+         {
+         voice->Kernels = MV_KernelSets[ test ];
+         voice->mix     = voice->Kernels[ voice->Interpolation ];
+         break;
+         }
+      }
+
+   //RestoreInterrupts( flags );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceAngle
+
+   Sets the stereo and mono volume level of a voice and the angle the
+   3D functions placed it at, or -1 if it is panned by level alone.
+---------------------------------------------------------------------*/
+
+void MV_SetVoiceAngle
+   (
+   VoiceNode *voice,
+   int vol,
+   int left,
+   int right,
+   int angle
+   )
+
+   {
+   voice->Volume     = vol;
+   voice->LeftLevel  = left;
+   voice->RightLevel = right;
+   voice->Angle      = angle;
+
+   // Panning by level takes the voice out of the 3D scene and drops
+   // its Doppler shift
+   if ( voice->Emitter.active )
+      {
+      voice->Emitter.active = FALSE;
+      voice->RateScale = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
+      voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
+         voice->RateScale;
+      }
+
+   if ( MV_Channels == 1 )
+      {
+      left  = vol;
+      right = vol;
+      }
+   else if ( ( voice->Angle >= 0 ) && MV_SpreadAngles() )
+      {
+      // Spread over the speakers or rendered binaurally rather than panned
+      left  = max( left, right );
+      right = left;
+      }
+
+   if ( MV_SwapLeftRight )
+      {
+      // SBPro uses reversed panning
+      voice->LeftVolume  = MV_GetVolumeTable( right );
+      voice->RightVolume = MV_GetVolumeTable( left );
+      }
+   else
+      {
+      voice->LeftVolume  = MV_GetVolumeTable( left );
+      voice->RightVolume = MV_GetVolumeTable( right );
+      }
+
+   MV_SetVoiceMixMode( voice );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceVolume
+
+   Sets the stereo and mono volume level of the voice associated
+   with the specified handle.
+---------------------------------------------------------------------*/
+
+void MV_SetVoiceVolume
+   (
+   VoiceNode *voice,
+   int vol,
+   int left,
+   int right
+   )
+
+   {
+   MV_SetVoiceAngle( voice, vol, left, right, -1 );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_TagVoice
+
+   Records which loaded sound or mapped file a newly allocated voice
+   plays.
+---------------------------------------------------------------------*/
+
+void MV_TagVoice
+   (
+   VoiceNode *voice,
+   const voicestart *start
+   )
+
+   {
+   if ( start != NULL )
+      {
+      voice->Sound = start->sound;
+      voice->File  = start->file;
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_TagHandle
+
+   Records which loaded sound or mapped file a voice started by a
+   format's own play function plays.
+---------------------------------------------------------------------*/
+
+void MV_TagHandle
+   (
+   int handle,
+   const voicestart *start
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice != NULL )
+      {
+      MV_TagVoice( voice, start );
+      }
+
+   RestoreInterrupts( flags );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartAngle
+
+   Returns the angle a voice starts at, or -1 if it is panned by level.
+---------------------------------------------------------------------*/
+
+int MV_StartAngle
+   (
+   const voicestart *start
+   )
+
+   {
+   return( ( start != NULL ) ? start->angle : -1 );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_EndLooping
+
+   Stops the voice associated with the specified handle from looping
+   without stoping the sound.
+---------------------------------------------------------------------*/
+
+int MV_EndLooping
+   (
+   int handle
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   voice->LoopCount = 0;
+   voice->LoopStart = NULL;
+   voice->LoopEnd   = NULL;
+   MV_EndDecoderLooping( voice );
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetPan
+
+   Sets the stereo and mono volume level of the voice associated
+   with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_SetPan
+   (
+   int handle,
+   int vol,
+   int left,
+   int right
+   )
+
+   {
+   VoiceNode *voice;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   MV_SetVoiceVolume( voice, vol, left, right );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceFilter
+
+   Applies a low- or high-pass filter to the voice associated with the
+   specified handle.  cutoff is in Hz and q is the filter Q in
+   hundredths.  MV_FilterNone removes the filter.
+---------------------------------------------------------------------*/
+
+int MV_SetVoiceFilter
+   (
+   int handle,
+   int type,
+   int cutoff,
+   int q
+   )
+
+   {
+   VoiceNode   *voice;
+   voicefilter  filter;
+   int          flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( type < MV_FilterNone ) || ( type > MV_FilterHighPass ) )
+      {
+      MV_SetErrorCode( MV_InvalidMixMode );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   if ( type == MV_FilterNone )
+      {
+      voice->Filter.type = MV_FilterNone;
+      }
+   else
+      {
+      memset( &filter, 0, sizeof( filter ) );
+      MV_CalcFilter( &filter, type, cutoff, q, MV_MixRate );
+
+      // Keep the running state so sweeping the cutoff doesn't click
+      if ( voice->Filter.type != MV_FilterNone )
+         {
+         memcpy( filter.z1, voice->Filter.z1, sizeof( filter.z1 ) );
+         memcpy( filter.z2, voice->Filter.z2, sizeof( filter.z2 ) );
+         }
+
+      voice->Filter = filter;
+      }
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceSend
+
+   Sets how much of the voice associated with the specified handle is
+   sent to an effect bus, from 0 to 255.
+---------------------------------------------------------------------*/
+
+int MV_SetVoiceSend
+   (
+   int handle,
+   int bus,
+   int level
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+   int        index;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( bus < 0 ) || ( bus >= MV_NumBuses ) )
+      {
+      MV_SetErrorCode( MV_InvalidBus );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
 
-static playbackstatus MV_GetNextVOCBlock
+   voice->Send[ bus ] = ( unsigned char )min( 255, max( 0, level ) );
+
+   voice->Sends = 0;
+   for( index = 0; index < MV_NumBuses; index++ )
+      {
+      if ( voice->Send[ index ] != 0 )
+         {
+         voice->Sends++;
+         }
+      }
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetVoiceGroup
+
+   Places the voice associated with the specified handle in a group
+   for ducking.  Voices start in group 0.
+---------------------------------------------------------------------*/
+
+int MV_SetVoiceGroup
+   (
+   int handle,
+   int group
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( group < 0 ) || ( group >= MV_NumGroups ) )
+      {
+      MV_SetErrorCode( MV_InvalidGroup );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   voice->Group = group;
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetDucking
+
+   Ducks a group under the level of a key group.  As the key group's
+   peak level rises to threshold (0 to 255 of full scale) the group is
+   brought down to level (0 to 255).  attack and release are the times
+   in milliseconds the level follower takes to respond.  The gain is
+   worked out once per buffer and applied to the next.  A negative key
+   group stops the ducking.
+---------------------------------------------------------------------*/
+
+int MV_SetDucking
+   (
+   int group,
+   int keygroup,
+   int level,
+   int threshold,
+   int attack,
+   int release
+   )
+
+   {
+   ducker duck;
+   float  buffertime;
+   int    flags;
+   int    index;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( group < 0 ) || ( group >= MV_NumGroups ) || ( keygroup >= MV_NumGroups ) )
+      {
+      MV_SetErrorCode( MV_InvalidGroup );
+      return( MV_Error );
+      }
+
+   // one-pole coefficients per buffer for the follower
+   buffertime = MixBufferSize * 1000.f / MV_MixRate;
+
+   memset( &duck, 0, sizeof( duck ) );
+   duck.key       = max( -1, keygroup );
+   duck.level     = min( 255, max( 0, level ) ) / 255.f;
+   duck.threshold = max( 1, min( 255, threshold ) ) / 255.f;
+   duck.attack    = attack > 0 ? ( float )exp( -buffertime / attack ) : 0.f;
+   duck.release   = release > 0 ? ( float )exp( -buffertime / release ) : 0.f;
+
+   flags = DisableInterrupts();
+
+   if ( MV_Duckers[ group ].key == duck.key )
+      {
+      duck.envelope = MV_Duckers[ group ].envelope;
+      }
+   MV_Duckers[ group ] = duck;
+   if ( duck.key < 0 )
+      {
+      MV_GroupGain[ group ] = 1.f;
+      }
+
+   memset( MV_KeyGroups, 0, sizeof( MV_KeyGroups ) );
+   for( index = 0; index < MV_NumGroups; index++ )
+      {
+      if ( MV_Duckers[ index ].key >= 0 )
+         {
+         MV_KeyGroups[ MV_Duckers[ index ].key ] = TRUE;
+         }
+      }
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_Pan3D
+
+   Set the angle and distance from the listener of the voice associated
+   with the specified handle.
+---------------------------------------------------------------------*/
+
+int MV_Pan3D
+   (
+   int handle,
+   int angle,
+   int distance
+   )
+
+   {
+   VoiceNode *voice;
+   int left;
+   int right;
+   int mid;
+   int volume;
+   int flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
+
+   volume = MIX_VOLUME( distance );
+
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
+
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   MV_SetVoiceAngle( voice, mid, left, right, angle );
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetListener
+
+   Sets the position, velocity and orientation of the listener in the
+   3D scene.  Any of the vectors may be NULL to leave it unchanged;
+   forward and up are only used together.
+---------------------------------------------------------------------*/
+
+void MV_SetListener
+   (
+   const float *position,
+   const float *velocity,
+   const float *forward,
+   const float *up
+   )
+
+   {
+   float right[ 3 ];
+   float length;
+   float flength;
+   int   flags;
+   int   index;
+
+   flags = DisableInterrupts();
+
+   if ( position != NULL )
+      {
+      memcpy( MV_Listener.position, position, sizeof( MV_Listener.position ) );
+      }
+
+   if ( velocity != NULL )
+      {
+      memcpy( MV_Listener.velocity, velocity, sizeof( MV_Listener.velocity ) );
+      }
+
+   if ( ( forward != NULL ) && ( up != NULL ) )
+      {
+      right[ 0 ] = forward[ 1 ] * up[ 2 ] - forward[ 2 ] * up[ 1 ];
+      right[ 1 ] = forward[ 2 ] * up[ 0 ] - forward[ 0 ] * up[ 2 ];
+      right[ 2 ] = forward[ 0 ] * up[ 1 ] - forward[ 1 ] * up[ 0 ];
+      length  = sqrtf( right[ 0 ] * right[ 0 ] + right[ 1 ] * right[ 1 ] + right[ 2 ] * right[ 2 ] );
+      flength = sqrtf( forward[ 0 ] * forward[ 0 ] + forward[ 1 ] * forward[ 1 ] +
+         forward[ 2 ] * forward[ 2 ] );
+
+      // Ignore an orientation whose forward and up are parallel
+      if ( ( length > 1e-6f ) && ( flength > 1e-6f ) )
+         {
+         for( index = 0; index < 3; index++ )
+            {
+            MV_Listener.right[ index ]   = right[ index ] / length;
+            MV_Listener.forward[ index ] = forward[ index ] / flength;
+            }
+         }
+      }
+
+   RestoreInterrupts( flags );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetAttenuation
+
+   Sets how one of the attenuation curves lowers the level of an
+   emitter with its distance from the listener.  The inverse and
+   linear models hold full level up to refdistance and stop changing
+   past maxdistance.
+---------------------------------------------------------------------*/
+
+int MV_SetAttenuation
+   (
+   int   curve,
+   int   model,
+   float refdistance,
+   float maxdistance,
+   float rolloff
+   )
+
+   {
+   int flags;
+
+   if ( ( curve < 0 ) || ( curve >= MV_NumCurves ) )
+      {
+      MV_SetErrorCode( MV_InvalidCurve );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   MV_Curves[ curve ].model       = model;
+   MV_Curves[ curve ].refdistance = max( refdistance, 1e-3f );
+   MV_Curves[ curve ].maxdistance = max( maxdistance, MV_Curves[ curve ].refdistance );
+   MV_Curves[ curve ].rolloff     = max( rolloff, 0.f );
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetDoppler
+
+   Sets how strongly the emitters' and listener's velocities shift the
+   pitch, and the speed of sound in the same units.  A factor of 0
+   turns the Doppler shift off.
+---------------------------------------------------------------------*/
+
+void MV_SetDoppler
+   (
+   float factor,
+   float speedofsound
+   )
+
+   {
+   MV_DopplerFactor = max( factor, 0.f );
+   MV_SpeedOfSound  = max( speedofsound, 1.f );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetEmitterCurve
+
+   Chooses the attenuation curve the voice associated with the
+   specified handle uses when it is positioned in the 3D scene.
+---------------------------------------------------------------------*/
+
+int MV_SetEmitterCurve
+   (
+   int handle,
+   int curve
+   )
+
+   {
+   VoiceNode *voice;
+   int        flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( curve < 0 ) || ( curve >= MV_NumCurves ) )
+      {
+      MV_SetErrorCode( MV_InvalidCurve );
+      return( MV_Error );
+      }
+
+   flags = DisableInterrupts();
+
+   voice = MV_GetVoice( handle );
+   if ( voice == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
+
+   voice->Emitter.curve = curve;
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetEmitters
+
+   Places the voices associated with count handles in the 3D scene.
+   positions holds three floats per voice, as does velocities, which
+   may be NULL for stationary voices.  Their level, panning and
+   Doppler shift are worked out by the mixer on every buffer until
+   they are panned by level again.  The voice list is walked once for
+   each MV_EmitterBatch handles, so large batches stay cheap.
+---------------------------------------------------------------------*/
+
+int MV_SetEmitters
    (
-   VoiceNode *voice
+   int          count,
+   const int   *handles,
+   const float *positions,
+   const float *velocities
    )
 
    {
-   unsigned char *ptr;
-   int            blocktype;
-   int            lastblocktype;
-   unsigned int   blocklength = 0;
-   unsigned int   samplespeed = 0;
-   unsigned int   tc = 0;
-   int            packtype;
-   int            voicemode;
-   int            done;
-   unsigned       BitsPerSample;
-   unsigned       Channels;
-   unsigned       Format;
-
-   if ( voice->BlockLength > 0 )
-      {
-      voice->position    -= voice->length;
-      voice->sound       += (voice->length >> 16) * (voice->channels * voice->bits / 8);
-      voice->length       = min( voice->BlockLength, 0x8000 );
-      voice->BlockLength -= voice->length;
-      voice->length     <<= 16;
-      return( KeepPlaying );
-      }
+   static short slots[ 1 << MV_EmitterHashBits ];
+   VoiceNode   *voice;
+   unsigned int hash;
+   unsigned int mask;
+   int          found;
+   int          first;
+   int          batch;
+   int          index;
+   int          slot;
+   int          flags;
 
-   if ( ( voice->length > 0 ) && ( voice->LoopEnd != NULL ) &&
-      ( voice->LoopStart != NULL ) )
+   if ( !MV_Installed )
       {
-      voice->BlockLength  = voice->LoopSize;
-      voice->sound        = voice->LoopStart;
-      voice->position     = 0;
-      voice->length       = min( voice->BlockLength, 0x8000 );
-      voice->BlockLength -= voice->length;
-      voice->length     <<= 16;
-      return( KeepPlaying );
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
       }
 
-   ptr = ( unsigned char * )voice->NextBlock;
-
-   voice->Playing = TRUE;
-
-   voicemode = 0;
-   lastblocktype = 0;
-   packtype = VOC_8BIT;
+   found = 0;
+   mask  = ( 1 << MV_EmitterHashBits ) - 1;
+   flags = DisableInterrupts();
 
-   done = FALSE;
-   while( !done )
+   for( first = 0; first < count; first += batch )
       {
-      // Stop playing if we get a NULL pointer
-      if ( ptr == NULL )
+      batch = min( count - first, MV_EmitterBatch );
+
+      // Hash the handles of this batch by open addressing
+      memset( slots, -1, sizeof( slots ) );
+      for( index = 0; index < batch; index++ )
          {
-         voice->Playing = FALSE;
-         done = TRUE;
-         break;
+         hash = MV_HashHandle( handles[ first + index ] );
+         while( slots[ hash ] >= 0 )
+            {
+            hash = ( hash + 1 ) & mask;
+            }
+         slots[ hash ] = ( short )index;
          }
 
-      blocktype = ( int )*ptr;
-      blocklength = LITTLE32( *( unsigned int * )( ptr + 1 ) ) & 0x00ffffff;
-      ptr += 4;
-
-      switch( blocktype )
+      for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
          {
-         case 0 :
-            // End of data
-            if ( ( voice->LoopStart == NULL ) ||
-               ( voice->LoopStart >= (char *)( ptr - 4 ) ) )
+         for( hash = MV_HashHandle( voice->handle ); ( slot = slots[ hash ] ) >= 0;
+            hash = ( hash + 1 ) & mask )
+            {
+            if ( handles[ first + slot ] != voice->handle )
                {
-               voice->Playing = FALSE;
-               done = TRUE;
+               continue;
+               }
+
+            index = first + slot;
+            memcpy( voice->Emitter.position, &positions[ index * 3 ],
+               sizeof( voice->Emitter.position ) );
+            if ( velocities != NULL )
+               {
+               memcpy( voice->Emitter.velocity, &velocities[ index * 3 ],
+                  sizeof( voice->Emitter.velocity ) );
                }
             else
                {
-               voice->BlockLength  = (unsigned int)((char *)( ptr - 4 ) - voice->LoopStart);
-               voice->sound        = voice->LoopStart;
-               voice->position     = 0;
-               voice->length       = min( voice->BlockLength, 0x8000 );
-               voice->BlockLength -= voice->length;
-               voice->length     <<= 16;
-               return( KeepPlaying );
+               memset( voice->Emitter.velocity, 0, sizeof( voice->Emitter.velocity ) );
                }
-            break;
 
-         case 1 :
-            // Sound data block
-            voice->bits  = 8;
-            voice->channels = voicemode + 1;
-            if ( lastblocktype != 8 )
+            if ( !voice->Emitter.active )
                {
-               tc = ( unsigned int )*ptr << 8;
-               packtype = *( ptr + 1 );
+               // The level is applied by the mixer, so both sides
+               // play at the voice's own volume
+               voice->Emitter.active = TRUE;
+               voice->LeftVolume     = MV_GetVolumeTable( voice->Volume );
+               voice->RightVolume    = voice->LeftVolume;
+               MV_SetVoiceMixMode( voice );
                }
 
-            ptr += 2;
-            blocklength -= 2;
+            found++;
+            break;
+            }
+         }
+      }
 
-            samplespeed = 256000000L / ( voice->channels * ( 65536 - tc ) );
+   RestoreInterrupts( flags );
 
-            // Skip packed data
-            if ( packtype != VOC_8BIT )
-               {
-               ptr += blocklength;
-               }
-            else
-               {
-               done = TRUE;
-               }
-            voicemode = 0;
-            break;
+   if ( found < count )
+      {
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Warning );
+      }
 
-         case 2 :
-            // Sound continuation block
-            samplespeed = voice->SamplingRate;
-            done = TRUE;
-            break;
+   return( MV_Ok );
+   }
 
-         case 3 :
-            // Silence
-            // Not implimented.
-            ptr += blocklength;
-            break;
 
-         case 4 :
-            // Marker
-            // Not implimented.
-            ptr += blocklength;
-            break;
+/*---------------------------------------------------------------------
+   Function: MV_SetHRTF
+
+   Renders 3D voices binaurally for headphones through the head-related
+   impulse responses in a stereo WAV file.  The file holds directions
+   responses of equal length one after another, evenly spaced clockwise
+   around the listener starting straight ahead.  Responses are
+   resampled to the mix rate, cut to MixBufferSize taps and normalised
+   to the energy of the frontal response.  A NULL ptr returns to
+   speaker panning.
+---------------------------------------------------------------------*/
 
-         case 5 :
-            // ASCII string
-            // Not implimented.
-            ptr += blocklength;
-            break;
+int MV_SetHRTF
+   (
+   char *ptr,
+   unsigned int ptrlength,
+   int directions
+   )
 
-         case 6 :
-            // Repeat begin
-            if ( voice->LoopEnd == NULL )
-               {
-               voice->LoopCount = LITTLE16(*( unsigned short * )ptr);
-               voice->LoopStart = (char *)ptr + blocklength;
-               }
-            ptr += blocklength;
-            break;
+   {
+   format_header format;
+   hrtfset      *hrtf;
+   hrtfset      *old;
+   float        *ir;
+   char         *data;
+   unsigned int  datalength;
+   double        energy[ 2 ];
+   double        step;
+   double        pos;
+   float         scale[ 2 ];
+   int           frames;
+   int           length;
+   int           direction;
+   int           index;
+   int           channel;
+   int           flags;
 
-         case 7 :
-            // Repeat end
-            ptr += blocklength;
-            if ( lastblocktype == 6 )
-               {
-               voice->LoopCount = 0;
-               }
-            else
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   hrtf = NULL;
+   if ( ptr != NULL )
+      {
+      if ( ( MV_OutputChannels != 2 ) || ( MV_Channels != 2 ) )
+         {
+         MV_SetErrorCode( MV_InvalidMixMode );
+         return( MV_Error );
+         }
+
+      if ( MV_ParseWAV( ptr, ptrlength, &format, &data, &datalength ) != MV_Ok )
+         {
+         return( MV_Error );
+         }
+
+      if ( format.wFormatTag != WAVE_FORMAT_PCM )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+
+      frames = 0;
+      if ( ( format.nChannels == 2 ) && ( directions > 0 ) )
+         {
+         frames = datalength / ( 2 * ( format.nBitsPerSample / 8 ) ) / directions;
+         }
+      if ( ( frames == 0 ) || ( format.nSamplesPerSec == 0 ) )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+
+      step   = ( double )format.nSamplesPerSec / MV_MixRate;
+      length = min( ( int )( frames / step ), MixBufferSize );
+      length = max( length, 1 );
+
+      ir = ( float * )malloc( directions * length * 2 * sizeof( float ) );
+      if ( ir == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+
+      // Linearly resample each direction's response to the mix rate
+      for( direction = 0; direction < directions; direction++ )
+         {
+         for( index = 0, pos = 0; index < length; index++, pos += step )
+            {
+            int   frame;
+            float frac;
+
+            frame = ( int )pos;
+            frac  = ( float )( pos - frame );
+            for( channel = 0; channel < 2; channel++ )
                {
-               if ( ( voice->LoopCount > 0 ) && ( voice->LoopStart != NULL ) )
+               float a;
+               float b;
+               int   first;
+               int   next;
+
+               first = ( direction * frames + frame ) * 2 + channel;
+               next  = ( direction * frames + min( frame + 1, frames - 1 ) ) * 2 + channel;
+               if ( format.nBitsPerSample == 16 )
                   {
-                  ptr = (unsigned char *)voice->LoopStart;
-                  if ( voice->LoopCount < 0xffff )
-                     {
-                     voice->LoopCount--;
-                     if ( voice->LoopCount == 0 )
-                        {
-                        voice->LoopStart = NULL;
-                        }
-                     }
+                  a = ( short )LITTLE16( ( ( short * )data )[ first ] );
+                  b = ( short )LITTLE16( ( ( short * )data )[ next ] );
+                  }
+               else
+                  {
+                  a = ( ( unsigned char * )data )[ first ] - 128.f;
+                  b = ( ( unsigned char * )data )[ next ] - 128.f;
                   }
+
+               ir[ ( direction * length + index ) * 2 + channel ] = a + ( b - a ) * frac;
                }
-            break;
+            }
+         }
+
+      // A frontal source keeps the level it has through the panner
+      energy[ 0 ] = energy[ 1 ] = 0;
+      for( index = 0; index < length * 2; index++ )
+         {
+         energy[ index & 1 ] += ir[ index ] * ir[ index ];
+         }
+      for( channel = 0; channel < 2; channel++ )
+         {
+         scale[ channel ] = 1.f;
+         if ( energy[ channel ] > 0 )
+            {
+            scale[ channel ] = ( float )( sqrt( 0.5 / energy[ channel ] ) );
+            }
+         }
+      for( index = 0; index < directions * length * 2; index++ )
+         {
+         ir[ index ] *= scale[ index & 1 ];
+         }
+
+      hrtf = MV_CreateHRTF( ir, length, directions );
+      free( ir );
+
+      if ( hrtf == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+      }
+
+   flags = DisableInterrupts();
+   old = MV_HRTF;
+   MV_HRTF = hrtf;
+   MV_HRTFUsed = 0;
+   RestoreInterrupts( flags );
+
+   MV_DestroyHRTF( old );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetHRTFVoices
+
+   Sets how many of the highest priority 3D voices are rendered through
+   the HRTF each buffer.  The rest use the cheaper level panner.
+---------------------------------------------------------------------*/
+
+void MV_SetHRTFVoices
+   (
+   int voices
+   )
+
+   {
+   MV_HRTFVoices = max( 0, min( voices, MV_MaxHRTFVoices ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetReverb
+
+   Sets the level of reverb to add to mix.
+---------------------------------------------------------------------*/
+
+void MV_SetReverb
+   (
+   int reverb
+   )
+
+   {
+   MV_ReverbLevel = MIX_VOLUME( reverb );
+   MV_ReverbTable = &MV_VolumeTable[ MV_ReverbLevel ];
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetFastReverb
+
+   Sets the level of reverb to add to mix.
+---------------------------------------------------------------------*/
+
+void MV_SetFastReverb
+   (
+   int reverb
+   )
 
-         case 8 :
-            // Extended block
-            voice->bits  = 8;
-            voice->channels = 1;
-            tc = LITTLE16( *( unsigned short * )ptr );
-            packtype = *( ptr + 2 );
-            voicemode = *( ptr + 3 );
-            ptr += blocklength;
-            break;
+   {
+   MV_ReverbLevel = max( 0, min( 16, reverb ) );
+   MV_ReverbTable = NULL;
+   }
 
-         case 9 :
-            // New sound data block
-            samplespeed = LITTLE32( *( unsigned int * )ptr );
-            BitsPerSample = ( unsigned )*( ptr + 4 );
-            Channels = ( unsigned )*( ptr + 5 );
-            Format = ( unsigned )LITTLE16( *( unsigned short * )( ptr + 6 ) );
 
-            if ( ( BitsPerSample == 8 ) && ( Channels == 1 || Channels == 2 ) &&
-               ( Format == VOC_8BIT ) )
-               {
-               ptr         += 12;
-               blocklength -= 12;
-               voice->bits  = 8;
-               voice->channels = Channels;
-               done         = TRUE;
-               }
-            else if ( ( BitsPerSample == 16 ) && ( Channels == 1 || Channels == 2 ) &&
-               ( Format == VOC_16BIT ) )
-               {
-               ptr         += 12;
-               blocklength -= 12;
-               voice->bits  = 16;
-               voice->channels = Channels;
-               done         = TRUE;
-               }
-            else
-               {
-               ptr += blocklength;
-               }
-            break;
+/*---------------------------------------------------------------------
+   Function: MV_SetRoomReverb
 
-         default :
-            // Unknown data.  Probably not a VOC file.
-            voice->Playing = FALSE;
-            done = TRUE;
-            break;
-         }
+   Enables the feedback delay network reverb.  level, roomsize and
+   damping range from 0 to 255; a level of zero turns it off and
+   releases its delay lines.
+---------------------------------------------------------------------*/
 
-      lastblocktype = blocktype;
-      }
+int MV_SetRoomReverb
+   (
+   int level,
+   int roomsize,
+   int damping
+   )
 
-   if ( voice->Playing )
+   {
+   fdnreverb *room;
+   int        flags;
+
+   if ( !MV_Installed )
       {
-      voice->NextBlock    = (char *)ptr + blocklength;
-      voice->sound        = (char *)ptr;
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
 
-      voice->SamplingRate = samplespeed;
-      voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
+   if ( level <= 0 )
+      {
+      flags = DisableInterrupts();
+      room         = MV_Room;
+      MV_Room      = NULL;
+      MV_RoomLevel = 0;
+      RestoreInterrupts( flags );
 
-      // Multiply by MixBufferSize - 1
-      voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
-         voice->RateScale;
+      MV_DestroyFDN( room );
+      return( MV_Ok );
+      }
 
-      if ( voice->LoopEnd != NULL )
+   room = NULL;
+   if ( MV_Room == NULL )
+      {
+      room = MV_CreateFDN( MV_MixRate );
+      if ( room == NULL )
          {
-         if ( blocklength > (unsigned int)(intptr_t)voice->LoopEnd )
-            {
-            blocklength = (unsigned int)(intptr_t)voice->LoopEnd;
-            }
-         else
-            {
-            voice->LoopEnd = (char *)(intptr_t)blocklength;
-            }
-
-         voice->LoopStart = voice->sound + (intptr_t)voice->LoopStart;
-         voice->LoopEnd   = voice->sound + (intptr_t)voice->LoopEnd;
-         voice->LoopSize  = (unsigned int)(voice->LoopEnd - voice->LoopStart);
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
          }
+      }
 
-      if ( voice->bits == 16 )
-         {
-         blocklength /= 2;
-         }
-      if ( voice->channels == 2 )
-         {
-         blocklength /= 2;
-         }
+   flags = DisableInterrupts();
+   if ( room != NULL )
+      {
+      MV_Room = room;
+      }
+   MV_SetFDNParams( MV_Room, roomsize, damping );
+   MV_RoomLevel = min( level, 255 );
+   RestoreInterrupts( flags );
 
-      voice->position     = 0;
-      voice->length       = min( blocklength, 0x8000 );
-      voice->BlockLength  = blocklength - voice->length;
-      voice->length     <<= 16;
+   return( MV_Ok );
+   }
 
-      MV_SetVoiceMixMode( voice );
 
-      return( KeepPlaying );
+/*---------------------------------------------------------------------
+   Function: MV_SetBusReturn
+
+   Sets the level at which an effect bus is mixed back into the output.
+---------------------------------------------------------------------*/
+
+int MV_SetBusReturn
+   (
+   int bus,
+   int level
+   )
+
+   {
+   if ( ( bus < 0 ) || ( bus >= MV_NumBuses ) )
+      {
+      MV_SetErrorCode( MV_InvalidBus );
+      return( MV_Error );
       }
 
-   return( NoMoreData );
+   MV_Buses[ bus ].level = min( 255, max( 0, level ) );
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetNextDemandFeedBlock
+   Function: MV_SetBusReverb
 
-   Controls playback of demand fed data.
+   Places a room reverb on an effect bus.  roomsize and damping range
+   from 0 to 255; a negative roomsize removes the reverb.
 ---------------------------------------------------------------------*/
 
-static playbackstatus MV_GetNextDemandFeedBlock
+int MV_SetBusReverb
    (
-   VoiceNode *voice
+   int bus,
+   int roomsize,
+   int damping
    )
 
    {
-   if ( voice->BlockLength > 0 )
+   fdnreverb *reverb;
+   int        flags;
+
+   if ( !MV_Installed )
       {
-      voice->position    -= voice->length;
-      voice->sound       += voice->length >> 16;
-      voice->length       = min( voice->BlockLength, 0x8000 );
-      voice->BlockLength -= voice->length;
-      voice->length     <<= 16;
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
 
-      return( KeepPlaying );
+   if ( ( bus < 0 ) || ( bus >= MV_NumBuses ) )
+      {
+      MV_SetErrorCode( MV_InvalidBus );
+      return( MV_Error );
       }
 
-   if ( voice->DemandFeed == NULL )
+   if ( roomsize < 0 )
       {
-      return( NoMoreData );
+      flags = DisableInterrupts();
+      reverb = MV_Buses[ bus ].reverb;
+      MV_Buses[ bus ].reverb = NULL;
+      RestoreInterrupts( flags );
+
+      MV_DestroyFDN( reverb );
+      return( MV_Ok );
       }
 
-   voice->position     = 0;
-   ( voice->DemandFeed )( &voice->sound, &voice->BlockLength );
-   voice->length       = min( voice->BlockLength, 0x8000 );
-   voice->BlockLength -= voice->length;
-   voice->length     <<= 16;
+   reverb = NULL;
+   if ( MV_Buses[ bus ].reverb == NULL )
+      {
+      reverb = MV_CreateFDN( MV_MixRate );
+      if ( reverb == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+      }
 
-   if ( ( voice->length > 0 ) && ( voice->sound != NULL ) )
+   flags = DisableInterrupts();
+   if ( reverb != NULL )
       {
-      return( KeepPlaying );
+      MV_Buses[ bus ].reverb = reverb;
       }
-   return( NoMoreData );
+   MV_SetFDNParams( MV_Buses[ bus ].reverb, roomsize, damping );
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetNextRawBlock
+   Function: MV_SetBusImpulse
 
-   Controls playback of demand fed data.
+   Convolves an effect bus with the impulse response in a WAV file,
+   resampled to the mix rate and normalised to unit energy.  Responses
+   are cut to MV_MaxImpulseSeconds.  A NULL ptr removes the convolver.
 ---------------------------------------------------------------------*/
 
-static playbackstatus MV_GetNextRawBlock
+int MV_SetBusImpulse
    (
-   VoiceNode *voice
+   int bus,
+   char *ptr,
+   unsigned int ptrlength
    )
 
    {
-   if ( voice->BlockLength <= 0 )
+   format_header format;
+   convolver    *conv;
+   convolver    *old;
+   float        *ir;
+   char         *data;
+   unsigned int  datalength;
+   double        energy;
+   double        step;
+   double        pos;
+   float         scale;
+   int           frames;
+   int           length;
+   int           index;
+   int           channel;
+   int           flags;
+
+   if ( !MV_Installed )
       {
-      if ( voice->LoopStart == NULL )
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( bus < 0 ) || ( bus >= MV_NumBuses ) )
+      {
+      MV_SetErrorCode( MV_InvalidBus );
+      return( MV_Error );
+      }
+
+   conv = NULL;
+   if ( ptr != NULL )
+      {
+      if ( MV_ParseWAV( ptr, ptrlength, &format, &data, &datalength ) != MV_Ok )
          {
-         voice->Playing = FALSE;
-         return( NoMoreData );
+         return( MV_Error );
          }
 
-      voice->BlockLength = voice->LoopSize;
-      voice->NextBlock   = voice->LoopStart;
-      voice->length = 0;
-      voice->position = 0;
+      if ( format.wFormatTag != WAVE_FORMAT_PCM )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+
+      frames = datalength / ( format.nChannels * ( format.nBitsPerSample / 8 ) );
+      if ( ( frames == 0 ) || ( format.nSamplesPerSec == 0 ) )
+         {
+         MV_SetErrorCode( MV_InvalidWAVFile );
+         return( MV_Error );
+         }
+
+      step   = ( double )format.nSamplesPerSec / MV_MixRate;
+      length = min( ( int )( frames / step ), MV_MaxImpulseSeconds * MV_MixRate );
+      length = max( length, 1 );
+
+      ir = ( float * )malloc( length * format.nChannels * sizeof( float ) );
+      if ( ir == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+
+      // Linearly resample to the mix rate
+      energy = 0;
+      for( index = 0, pos = 0; index < length; index++, pos += step )
+         {
+         int   frame;
+         float frac;
+
+         frame = ( int )pos;
+         frac  = ( float )( pos - frame );
+         for( channel = 0; channel < format.nChannels; channel++ )
+            {
+            float a;
+            float b;
+            int   next;
+
+            next = min( frame + 1, frames - 1 ) * format.nChannels + channel;
+            if ( format.nBitsPerSample == 16 )
+               {
+               a = ( short )LITTLE16( ( ( short * )data )[ frame * format.nChannels + channel ] );
+               b = ( short )LITTLE16( ( ( short * )data )[ next ] );
+               }
+            else
+               {
+               a = ( ( unsigned char * )data )[ frame * format.nChannels + channel ] - 128.f;
+               b = ( ( unsigned char * )data )[ next ] - 128.f;
+               }
+
+            a += ( b - a ) * frac;
+            ir[ index * format.nChannels + channel ] = a;
+            energy += a * a;
+            }
+         }
+
+      if ( energy > 0 )
+         {
+         scale = ( float )( 1.0 / sqrt( energy / format.nChannels ) );
+         for( index = 0; index < length * format.nChannels; index++ )
+            {
+            ir[ index ] *= scale;
+            }
+         }
+
+      conv = MV_CreateConvolver( ir, length, format.nChannels );
+      free( ir );
+
+      if ( conv == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
       }
 
-   voice->sound        = voice->NextBlock;
-   voice->position    -= voice->length;
-   voice->length       = min( voice->BlockLength, 0x8000 );
-   voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
-   voice->BlockLength -= voice->length;
-   voice->length     <<= 16;
+   flags = DisableInterrupts();
+   old = MV_Buses[ bus ].convolver;
+   MV_Buses[ bus ].convolver = conv;
+   RestoreInterrupts( flags );
+
+   MV_DestroyConvolver( old );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetBusFilter
+
+   Places a low- or high-pass filter on an effect bus.
+---------------------------------------------------------------------*/
+
+int MV_SetBusFilter
+   (
+   int bus,
+   int type,
+   int cutoff,
+   int q
+   )
+
+   {
+   voicefilter filter;
+   int         flags;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   if ( ( bus < 0 ) || ( bus >= MV_NumBuses ) )
+      {
+      MV_SetErrorCode( MV_InvalidBus );
+      return( MV_Error );
+      }
+
+   if ( ( type < MV_FilterNone ) || ( type > MV_FilterHighPass ) )
+      {
+      MV_SetErrorCode( MV_InvalidMixMode );
+      return( MV_Error );
+      }
+
+   memset( &filter, 0, sizeof( filter ) );
+   if ( type != MV_FilterNone )
+      {
+      MV_CalcFilter( &filter, type, cutoff, q, MV_MixRate );
+      }
 
-   return( KeepPlaying );
+   flags = DisableInterrupts();
+   if ( MV_Buses[ bus ].filter.type != MV_FilterNone )
+      {
+      memcpy( filter.z1, MV_Buses[ bus ].filter.z1, sizeof( filter.z1 ) );
+      memcpy( filter.z2, MV_Buses[ bus ].filter.z2, sizeof( filter.z2 ) );
+      }
+   MV_Buses[ bus ].filter = filter;
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetNextWAVBlock
+   Function: MV_GetMaxReverbDelay
 
-   Controls playback of demand fed data.
+   Returns the maximum delay time for reverb.
 ---------------------------------------------------------------------*/
 
-static playbackstatus MV_GetNextWAVBlock
+int MV_GetMaxReverbDelay
    (
-   VoiceNode *voice
+   void
    )
 
    {
-   if ( voice->BlockLength <= 0 )
-      {
-      if ( voice->LoopStart == NULL )
-         {
-         voice->Playing = FALSE;
-         return( NoMoreData );
-         }
-
-      voice->BlockLength = voice->LoopSize;
-      voice->NextBlock   = voice->LoopStart;
-      voice->length      = 0;
-      voice->position    = 0;
-      }
+   int maxdelay;
 
-   voice->sound        = voice->NextBlock;
-   voice->position    -= voice->length;
-   voice->length       = min( voice->BlockLength, 0x8000 );
-   voice->NextBlock   += voice->length * (voice->channels * voice->bits / 8);
-   voice->BlockLength -= voice->length;
-   voice->length     <<= 16;
+   maxdelay = MixBufferSize * MV_NumberOfBuffers;
 
-   return( KeepPlaying );
+   return maxdelay;
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_ServiceRecord
+   Function: MV_GetReverbDelay
 
-   Starts recording of the waiting buffer.
+   Returns the current delay time for reverb.
 ---------------------------------------------------------------------*/
 
-/*static void MV_ServiceRecord
+int MV_GetReverbDelay
    (
    void
    )
 
    {
-   if ( MV_RecordFunc )
-      {
-      MV_RecordFunc( MV_MixBuffer[ 0 ] + MV_MixPage * MixBufferSize,
-         MixBufferSize );
-      }
-
-   // Toggle which buffer we'll mix next
-   MV_MixPage++;
-   if ( MV_MixPage >= NumberOfBuffers )
-      {
-      MV_MixPage = 0;
-      }
-   }*/
+   return MV_ReverbDelay / MV_SampleSize;
+   }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetVoice
+   Function: MV_SetReverbDelay
 
-   Locates the voice with the specified handle.
+   Sets the delay level of reverb to add to mix.
 ---------------------------------------------------------------------*/
 
-static VoiceNode *MV_GetVoice
+void MV_SetReverbDelay
    (
-   int handle
+   int delay
    )
 
    {
-   VoiceNode *voice;
-   int        flags;
-
-   flags = DisableInterrupts();
-
-   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
-      {
-      if ( handle == voice->handle )
-         {
-         break;
-         }
-      }
-
-   RestoreInterrupts( flags );
-
-   if ( voice == &VoiceList )
-      {
-      MV_SetErrorCode( MV_VoiceNotFound );
-      voice = 0;
-      }
+   int maxdelay;
 
-   return( voice );
+   maxdelay = MV_GetMaxReverbDelay();
+   MV_ReverbDelay = max( MixBufferSize, min( delay, maxdelay ) );
+   MV_ReverbDelay *= MV_SampleSize;
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_VoicePlaying
+   Function: MV_SetMixMode
 
-   Checks if the voice associated with the specified handle is
-   playing.
+   Prepares Multivoc to play stereo of mono digitized sounds.
 ---------------------------------------------------------------------*/
 
-int MV_VoicePlaying
+int MV_SetMixMode
    (
-   int handle
+   int numchannels,
+   int samplebits
    )
 
    {
-   VoiceNode *voice;
+   int mode;
 
    if ( !MV_Installed )
       {
       MV_SetErrorCode( MV_NotInstalled );
-      return( FALSE );
+      return( MV_Error );
       }
 
-   voice = MV_GetVoice( handle );
+   mode = 0;
+   if ( numchannels >= 2 )
+      {
+      mode |= STEREO;
+      }
+   if ( samplebits == 16 )
+      {
+      mode |= SIXTEEN_BIT;
+      }
 
-   if ( voice == NULL )
+   MV_MixMode = mode;
+
+   MV_Channels = 1;
+   if ( MV_MixMode & STEREO )
       {
-      return( FALSE );
+      MV_Channels = 2;
       }
 
-   return( TRUE );
+   MV_Bits = 8;
+   if ( MV_MixMode & SIXTEEN_BIT )
+      {
+      MV_Bits = 16;
+      }
+
+   MV_BuffShift  = 7 + MV_Channels;
+   MV_SampleSize = sizeof( MONO8 ) * MV_Channels;
+
+   if ( MV_Bits == 8 )
+      {
+      MV_Silence = SILENCE_8BIT;
+      }
+   else
+      {
+      MV_Silence     = SILENCE_16BIT;
+      MV_BuffShift  += 1;
+      MV_SampleSize *= 2;
+      }
+
+   MV_BufferSize = MixBufferSize * MV_SampleSize;
+   MV_NumberOfBuffers = TotalBufferSize / MV_BufferSize;
+   MV_BufferLength = TotalBufferSize;
+
+   MV_RightChannelOffset = MV_SampleSize / 2;
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-Function: MV_VoicePaused
+   Function: MV_GetInternalMixRate
 
-Checks if the voice associated with the specified handle is
-paused.
+   Returns the rate to mix at when it differs from the device rate,
+   never more than twice as fast as the device plays.
 ---------------------------------------------------------------------*/
 
-int MV_VoicePaused
+static int MV_GetInternalMixRate
    (
-   int handle
+   void
    )
 
    {
-   VoiceNode *voice;
-
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( FALSE );
-      }
-
-   voice = MV_GetVoice( handle );
-
-   if ( voice == NULL )
-      {
-      return( FALSE );
-      }
-
-   return voice->Paused;
+   return( min( MV_InternalMixRate, MV_RequestedMixRate * 2 ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_KillAllVoices
+   Function: MV_StartPlayback
 
-   Stops output of all currently active voices.
+   Starts the sound playback engine.
 ---------------------------------------------------------------------*/
 
-int MV_KillAllVoices
+int MV_StartPlayback
    (
    void
    )
 
    {
-   VoiceNode * voice, * next;
-   int        flags;
+   int status;
+   int buffer;
 
-   if ( !MV_Installed )
+   // Initialize the buffers
+   ClearBuffer_DW( MV_MixBuffer[ 0 ], MV_Silence, TotalBufferSize >> 2 );
+   for( buffer = 0; buffer < MV_NumberOfBuffers; buffer++ )
       {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
+      MV_BufferEmpty[ buffer ] = TRUE;
       }
 
-   flags = DisableInterrupts();
+   // Set the mix buffer variables
+   MV_MixPage = 1;
 
-   // Remove all the voices from the list
-   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
+   MV_MixFunction = MV_Mix;
+
+//JIM
+//   MV_MixRate = MV_RequestedMixRate;
+//   return( MV_Ok );
+
+   // Start playback
+   if ( MV_OutputBuffer[ 0 ] != NULL )
       {
-      next = voice->next;
-      if (voice->priority < MV_MUSIC_PRIORITY)
-         {
-         MV_Kill( voice->handle );
-         }
+      ClearBuffer_DW( MV_OutputBuffer[ 0 ], MV_Silence,
+         ( MV_OutputPageSize * MV_NumberOfBuffers ) >> 2 );
+      MV_OutputPage = 1;
+
+      status = SoundDriver_PCM_BeginPlayback(MV_OutputBuffer[0], MV_OutputPageSize,
+                                         MV_NumberOfBuffers, MV_ServiceOutput);
+      }
+   else
+      {
+      status = SoundDriver_PCM_BeginPlayback(MV_MixBuffer[0], MV_BufferSize,
+                                         MV_NumberOfBuffers, MV_ServiceVoc);
       }
+   if (status != MV_Ok) {
+      MV_SetErrorCode(MV_DriverError);
+      return MV_Error;
+   }
 
-   RestoreInterrupts(flags);
+   if ( MV_Resampler != NULL )
+      {
+      MV_MixRate = MV_GetInternalMixRate();
+      }
+   else
+      {
+      MV_MixRate = MV_RequestedMixRate;
+      }
 
    return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_Kill
+   Function: MV_StopPlayback
 
-   Stops output of the voice associated with the specified handle.
+   Stops the sound playback engine.
 ---------------------------------------------------------------------*/
 
-int MV_Kill
+void MV_StopPlayback
    (
-   int handle
+   void
    )
 
    {
-   VoiceNode *voice;
-   int        flags;
-   unsigned int callbackval;
-
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
-
-   flags = DisableInterrupts();
-
-   voice = MV_GetVoice( handle );
-   if ( voice == NULL )
-      {
-      RestoreInterrupts( flags );
-      MV_SetErrorCode( MV_VoiceNotFound );
-      return( MV_Error );
-      }
-
-   callbackval = voice->callbackval;
+   VoiceNode   *voice;
+   VoiceNode   *next;
+   int          flags;
 
-   MV_StopVoice( voice );
+   // Stop sound playback
+   SoundDriver_PCM_StopPlayback();
 
-   RestoreInterrupts( flags );
+   // Make sure all callbacks are done.
+   flags = DisableInterrupts();
 
-   if ( MV_CallBackFunc )
+   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
       {
-      MV_CallBackFunc( callbackval );
+      next = voice->next;
+
+      MV_StopVoice( voice );
+
+      MV_DoVoiceCallbacks( voice->callbackval, voice->MergedCallbacks,
+         voice->NumMerged );
       }
 
-   return( MV_Ok );
+   RestoreInterrupts( flags );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PauseVoice
+   Function: MV_StartRecording
 
-   Pauses or resumes output of the voice associated with the specified handle.
+   Starts the sound recording engine.
 ---------------------------------------------------------------------*/
 
-int MV_PauseVoice
-(
- int handle,
- int pauseon
- )
-
-{
-   VoiceNode *voice;
-   int        flags;
+int MV_StartRecording
+   (
+   int MixRate,
+   void ( *function )( char *ptr, int length )
+   )
 
-   if ( !MV_Installed )
    {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
+   (void)MixRate; (void)function;
+
+   MV_SetErrorCode( MV_UnsupportedCard );
+   return( MV_Error );
    }
 
-   flags = DisableInterrupts();
 
-   voice = MV_GetVoice( handle );
-   if ( voice == NULL )
-   {
-      RestoreInterrupts( flags );
-      MV_SetErrorCode( MV_VoiceNotFound );
-      return( MV_Error );
-   }
+/*---------------------------------------------------------------------
+   Function: MV_StopRecord
 
-   voice->Paused = pauseon;
+   Stops the sound record engine.
+---------------------------------------------------------------------*/
 
-   RestoreInterrupts( flags );
+void MV_StopRecord
+   (
+   void
+   )
 
-   return( MV_Ok );
-}
+   {
+   }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_VoicesPlaying
+   Function: MV_StartDemandFeedPlayback
 
-   Determines the number of currently active voices.
+   Plays a digitized sound from a user controlled buffering system.
 ---------------------------------------------------------------------*/
 
-int MV_VoicesPlaying
+int MV_StartDemandFeedPlayback
    (
-   void
+   void ( *function )( char **ptr, unsigned int *length ),
+   int rate,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
    )
 
    {
-   VoiceNode   *voice;
-   int         NumVoices = 0;
-   int         flags;
+   VoiceNode *voice;
 
    if ( !MV_Installed )
       {
       MV_SetErrorCode( MV_NotInstalled );
-      return( 0 );
+      return( MV_Error );
       }
 
-   flags = DisableInterrupts();
-
-   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+   // Request a voice from the voice pool
+   voice = MV_AllocVoice( priority );
+   if ( voice == NULL )
       {
-      NumVoices++;
+      MV_SetErrorCode( MV_NoVoices );
+      return( MV_Error );
       }
 
-   RestoreInterrupts( flags );
+   voice->wavetype    = DemandFeed;
+   voice->bits        = 8;
+   voice->channels    = 1;
+   voice->GetSound    = MV_GetNextDemandFeedBlock;
+   voice->NextBlock   = NULL;
+   voice->DemandFeed  = function;
+   voice->LoopStart   = NULL;
+   voice->LoopCount   = 0;
+   voice->BlockLength = 0;
+   voice->position    = 0;
+   voice->sound       = NULL;
+   voice->length      = 0;
+   voice->BlockLength = 0;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = NULL;
 
-   return( NumVoices );
+   MV_SetVoicePitch( voice, rate, pitchoffset );
+   MV_SetVoiceVolume( voice, vol, left, right );
+   return( MV_PlayVoice( voice ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_AllocVoice
+   Function: MV_ClaimQueue
 
-   Retrieve an inactive or lower priority voice for output.
+   Takes a free queue state from the pool, growing the pool if every
+   state is in use or still holds buffers for the caller.
 ---------------------------------------------------------------------*/
 
-VoiceNode *MV_AllocVoice
+static queuedata *MV_ClaimQueue
    (
-   int priority
+   void
    )
 
    {
-   VoiceNode   *voice;
-   VoiceNode   *node;
-   int          flags;
-
-//return( NULL );
-   if ( MV_Recording )
-      {
-      return( NULL );
-      }
+   queuedata *qd;
+   int        flags;
 
    flags = DisableInterrupts();
 
-   // Check if we have any free voices
-   if ( LL_Empty( &VoicePool, next, prev ) )
+   for( qd = MV_QueuePool; qd != NULL; qd = qd->next )
       {
-      // check if we have a higher priority than a voice that is playing.
-      voice = VoiceList.next;
-      for( node = voice->next; node != &VoiceList; node = node->next )
-         {
-         if ( node->priority < voice->priority )
-            {
-            voice = node;
-            }
-         }
-
-      if ( priority >= voice->priority )
+      if ( !qd->inuse )
          {
-         MV_Kill( voice->handle );
+         qd->inuse = TRUE;
+         break;
          }
       }
 
-   // Check if any voices are in the voice pool
-   if ( LL_Empty( &VoicePool, next, prev ) )
-      {
-      // No free voices
-      RestoreInterrupts( flags );
-      return( NULL );
-      }
-
-   voice = VoicePool.next;
-   LL_Remove( voice, next, prev );
    RestoreInterrupts( flags );
 
-   // Find a free voice handle
-   do
+   if ( qd == NULL )
       {
-      MV_VoiceHandle++;
-      if ( MV_VoiceHandle < MV_MinVoiceHandle )
+      qd = ( queuedata * )malloc( sizeof( queuedata ) );
+      if ( qd == NULL )
          {
-         MV_VoiceHandle = MV_MinVoiceHandle;
+         return( NULL );
          }
-      }
-   while( MV_VoicePlaying( MV_VoiceHandle ) );
 
-   voice->handle = MV_VoiceHandle;
+      flags = DisableInterrupts();
+      qd->next     = MV_QueuePool;
+      MV_QueuePool = qd;
+      RestoreInterrupts( flags );
+      }
 
-   return( voice );
+   memset( qd->buffer, 0, sizeof( qd->buffer ) );
+   memset( qd->length, 0, sizeof( qd->length ) );
+   qd->tail     = 0;
+   qd->head     = 0;
+   qd->finished = 0;
+   qd->unqueued = 0;
+   qd->playing  = FALSE;
+   qd->ended    = FALSE;
+   qd->released = FALSE;
+   qd->handle   = 0;
+   qd->inuse    = TRUE;
+
+   return( qd );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_VoiceAvailable
+   Function: MV_FindQueue
 
-   Checks if a voice can be play at the specified priority.
+   Locates the queue state of a queued voice, or of one that has
+   stopped with buffers not yet handed back.  Interrupts must be
+   disabled.
 ---------------------------------------------------------------------*/
 
-int MV_VoiceAvailable
+static queuedata *MV_FindQueue
    (
-   int priority
+   int handle
    )
 
    {
-   VoiceNode   *voice;
-   VoiceNode   *node;
-   int          flags;
+   VoiceNode *voice;
+   queuedata *qd;
 
-   // Check if we have any free voices
-   if ( !LL_Empty( &VoicePool, next, prev ) )
+   voice = MV_GetVoice( handle );
+   if ( ( voice != NULL ) && ( voice->wavetype == BufferQueue ) )
       {
-      return( TRUE );
+      return( ( queuedata * )voice->extra );
       }
 
-   flags = DisableInterrupts();
-
-   // check if we have a higher priority than a voice that is playing.
-   voice = VoiceList.next;
-   for( node = VoiceList.next; node != &VoiceList; node = node->next )
+   for( qd = MV_QueuePool; qd != NULL; qd = qd->next )
       {
-      if ( node->priority < voice->priority )
+      if ( qd->inuse && qd->released && ( qd->handle == handle ) )
          {
-         voice = node;
+         return( qd );
          }
       }
 
-   RestoreInterrupts( flags );
-
-   if ( ( voice != &VoiceList ) && ( priority >= voice->priority ) )
-      {
-      return( TRUE );
-      }
-
-   return( FALSE );
+   return( NULL );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetVoicePitch
+   Function: MV_FreeQueues
 
-   Sets the pitch for the specified voice.
+   Frees the queue state pool.  No voices may be playing.
 ---------------------------------------------------------------------*/
 
-static void MV_SetVoicePitch
+static void MV_FreeQueues
    (
-   VoiceNode *voice,
-   unsigned int rate,
-   int pitchoffset
+   void
    )
 
    {
-   voice->SamplingRate = rate;
-   voice->PitchScale   = PITCH_GetScale( pitchoffset );
-   voice->RateScale    = ( rate * voice->PitchScale ) / MV_MixRate;
+   queuedata *qd;
 
-   // Multiply by MixBufferSize - 1
-   voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
-      voice->RateScale;
+   while( MV_QueuePool != NULL )
+      {
+      qd = MV_QueuePool;
+      MV_QueuePool = qd->next;
+      free( qd );
+      }
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetPitch
+   Function: MV_CountQueueStates
 
-   Sets the pitch for the voice associated with the specified handle.
+   Returns how many queue states the pool holds, free or not.
 ---------------------------------------------------------------------*/
 
-int MV_SetPitch
+int MV_CountQueueStates
    (
-   int handle,
-   int pitchoffset
+   void
    )
 
    {
-   VoiceNode *voice;
+   queuedata *qd;
+   int        count = 0;
+   int        flags;
 
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
+   flags = DisableInterrupts();
 
-   voice = MV_GetVoice( handle );
-   if ( voice == NULL )
+   for( qd = MV_QueuePool; qd != NULL; qd = qd->next )
       {
-      MV_SetErrorCode( MV_VoiceNotFound );
-      return( MV_Error );
+      count++;
       }
 
-   MV_SetVoicePitch( voice, voice->SamplingRate, pitchoffset );
+   RestoreInterrupts( flags );
 
-   return( MV_Ok );
+   return( count );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetFrequency
+   Function: MV_StartQueuedPlayback
 
-   Sets the frequency for the voice associated with the specified handle.
+   Starts a voice that plays back-to-back the PCM buffers submitted
+   with MV_QueueBuffer.
 ---------------------------------------------------------------------*/
 
-int MV_SetFrequency
+int MV_StartQueuedPlayback
    (
-   int handle,
-   int frequency
+   int rate,
+   int bits,
+   int channels,
+   int pitchoffset,
+   int vol,
+   int left,
+   int right,
+   int priority,
+   unsigned int callbackval
    )
 
    {
    VoiceNode *voice;
+   queuedata *qd;
 
    if ( !MV_Installed )
       {
@@ -1372,33 +5686,78 @@ int MV_SetFrequency
       return( MV_Error );
       }
 
-   voice = MV_GetVoice( handle );
+   if ( ( bits != 8 && bits != 16 ) || ( channels != 1 && channels != 2 ) )
+      {
+      MV_SetErrorCode( MV_InvalidMixMode );
+      return( MV_Error );
+      }
+
+   qd = MV_ClaimQueue();
+   if ( qd == NULL )
+      {
+      MV_SetErrorCode( MV_NoMem );
+      return( MV_Error );
+      }
+
+   // Request a voice from the voice pool
+   voice = MV_AllocVoice( priority );
    if ( voice == NULL )
       {
-      MV_SetErrorCode( MV_VoiceNotFound );
+      qd->inuse = FALSE;
+      MV_SetErrorCode( MV_NoVoices );
       return( MV_Error );
       }
 
-   MV_SetVoicePitch( voice, frequency, 0 );
+   voice->wavetype    = BufferQueue;
+   voice->bits        = bits;
+   voice->channels    = channels;
+   voice->extra       = ( void * )qd;
+   qd->handle         = voice->handle;
+   voice->GetSound    = MV_GetNextQueuedBlock;
+   voice->NextBlock   = NULL;
+   voice->DemandFeed  = NULL;
+   voice->LoopStart   = NULL;
+   voice->LoopEnd     = NULL;
+   voice->LoopCount   = 0;
+   voice->BlockLength = 0;
+   voice->position    = 0;
+   voice->sound       = NULL;
+   voice->length      = 0;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = NULL;
 
-   return( MV_Ok );
+   MV_SetVoicePitch( voice, rate, pitchoffset );
+   MV_SetVoiceVolume( voice, vol, left, right );
+   return( MV_PlayVoice( voice ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetFrequency
+   Function: MV_QueueBuffer
 
-   Gets the frequency for the voice associated with the specified handle.
+   Appends a buffer of PCM data to a queued voice.  The buffer must
+   remain valid until it is returned by MV_UnqueueProcessed.  Passing
+   a NULL pointer marks the end of the stream, letting the voice stop
+   once the queue drains.
 ---------------------------------------------------------------------*/
 
-int MV_GetFrequency
+int MV_QueueBuffer
    (
    int handle,
-   int *frequency
+   char *ptr,
+   unsigned int length
    )
 
    {
    VoiceNode *voice;
+   queuedata *qd;
+   unsigned int samplesize;
+   int        flags;
 
    if ( !MV_Installed )
       {
@@ -1406,284 +5765,155 @@ int MV_GetFrequency
       return( MV_Error );
       }
 
+   flags = DisableInterrupts();
+
    voice = MV_GetVoice( handle );
-   if ( voice == NULL )
+   if ( ( voice == NULL ) || ( voice->wavetype != BufferQueue ) )
       {
+      RestoreInterrupts( flags );
       MV_SetErrorCode( MV_VoiceNotFound );
       return( MV_Error );
       }
 
-    if ( voice->SamplingRate == 0 )
+   qd = ( queuedata * )voice->extra;
+
+   if ( ptr == NULL )
       {
-      voice->GetSound( voice );
+      qd->ended = TRUE;
+      RestoreInterrupts( flags );
+      return( MV_Ok );
       }
 
-   *frequency = voice->SamplingRate;
-
-   return( MV_Ok );
-   }
-
-
-/*---------------------------------------------------------------------
-   Function: MV_GetVolumeTable
-
-   Returns a pointer to the volume table associated with the specified
-   volume.
----------------------------------------------------------------------*/
-
-static short *MV_GetVolumeTable
-   (
-   int vol
-   )
-
-   {
-   int volume;
-   short *table;
+   samplesize = voice->channels * voice->bits / 8;
+   if ( ( qd->ended ) || ( length < samplesize ) ||
+      ( qd->tail - qd->unqueued >= MV_MaxQueuedBuffers ) )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_QueueFull );
+      return( MV_Error );
+      }
 
-   volume = MIX_VOLUME( vol );
+   qd->buffer[ qd->tail % MV_MaxQueuedBuffers ] = ptr;
+   qd->length[ qd->tail % MV_MaxQueuedBuffers ] = length / samplesize;
+   qd->tail++;
 
-   table = (short *) &MV_VolumeTable[ volume ];
+   RestoreInterrupts( flags );
 
-   return( table );
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetVoiceMixMode
-
-   Selects which method should be used to mix the voice.
-
- 8Bit  16Bit  8Bit  16Bit |  8Bit  16Bit  8Bit  16Bit |
- Mono  Mono   Ster  Ster  |  Mono  Mono   Ster  Ster  |  Mixer
- Out   Out    Out   Out   |  In    In     In    In    |
---------------------------+---------------------------+-------------
-  X                       |         X                 | Mix8BitMono16
-  X                       |   X                       | Mix8BitMono
-               X          |         X                 | Mix8BitStereo16
-               X          |   X                       | Mix8BitStereo
-        X                 |         X                 | Mix16BitMono16
-        X                 |   X                       | Mix16BitMono
-                     X    |         X                 | Mix16BitStereo16
-                     X    |   X                       | Mix16BitStereo
---------------------------+---------------------------+-------------
-                     X    |                      X    | Mix16BitStereo16Stereo
-                     X    |                X          | Mix16BitStereo8Stereo
-               X          |                      X    | Mix8BitStereo16Stereo
-               X          |                X          | Mix8BitStereo8Stereo
-        X                 |                      X    | Mix16BitMono16Stereo
-        X                 |                X          | Mix16BitMono8Stereo
-  X                       |                      X    | Mix8BitMono16Stereo
-  X                       |                X          | Mix8BitMono8Stereo
+   Function: MV_UnqueueProcessed
 
+   Hands back up to maxbuffers buffers the mixer has finished with,
+   oldest first.  Returns the number of buffers stored in buffers.
+   Buffers of a voice that has stopped can still be retrieved, and
+   count as finished whether or not they were played.
 ---------------------------------------------------------------------*/
 
-void MV_SetVoiceMixMode
+int MV_UnqueueProcessed
    (
-   VoiceNode *voice
+   int handle,
+   char **buffers,
+   int maxbuffers
    )
 
    {
-   //int flags;
-   int test;
-
-   //flags = DisableInterrupts();
+   queuedata *qd;
+   int        count;
+   int        flags;
 
-   test = T_DEFAULT;
-   if ( MV_Bits == 8 )
+   if ( !MV_Installed )
       {
-      test |= T_8BITS;
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
       }
 
-   if ( MV_Channels == 1 )
-      {
-      test |= T_MONO;
-      }
-   else
-      {
-      if ( IS_QUIET( voice->RightVolume ) )
-         {
-         test |= T_RIGHTQUIET;
-         }
-      else if ( IS_QUIET( voice->LeftVolume ) )
-         {
-         test |= T_LEFTQUIET;
-         }
-      }
+   flags = DisableInterrupts();
 
-   if ( voice->bits == 16 )
+   qd = MV_FindQueue( handle );
+   if ( qd == NULL )
       {
-      test |= T_16BITSOURCE;
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_VoiceNotFound );
+      return( MV_Error );
       }
 
-   if ( voice->channels == 2 )
+   count = 0;
+   while( ( count < maxbuffers ) && ( qd->unqueued != qd->finished ) )
       {
-      test |= T_STEREOSOURCE;
-      test &= ~(T_RIGHTQUIET | T_LEFTQUIET);
+      buffers[ count++ ] = qd->buffer[ qd->unqueued % MV_MaxQueuedBuffers ];
+      qd->unqueued++;
       }
 
-   switch( test )
+   // Once a stopped voice's buffers are all back, its state is free
+   if ( qd->released && ( qd->unqueued == qd->finished ) )
       {
-      case T_8BITS | T_MONO | T_16BITSOURCE :
-         voice->mix = MV_Mix8BitMono16;
-         break;
-
-      case T_8BITS | T_MONO :
-         voice->mix = MV_Mix8BitMono;
-         break;
-
-      case T_8BITS | T_16BITSOURCE | T_LEFTQUIET :
-         MV_LeftVolume = MV_RightVolume;
-         voice->mix = MV_Mix8BitMono16;
-         break;
-
-      case T_8BITS | T_LEFTQUIET :
-         MV_LeftVolume = MV_RightVolume;
-         voice->mix = MV_Mix8BitMono;
-         break;
-
-      case T_8BITS | T_16BITSOURCE | T_RIGHTQUIET :
-         voice->mix = MV_Mix8BitMono16;
-         break;
-
-      case T_8BITS | T_RIGHTQUIET :
-         voice->mix = MV_Mix8BitMono;
-         break;
-
-      case T_8BITS | T_16BITSOURCE :
-         voice->mix = MV_Mix8BitStereo16;
-         break;
-
-      case T_8BITS :
-         voice->mix = MV_Mix8BitStereo;
-         break;
-
-      case T_MONO | T_16BITSOURCE :
-         voice->mix = MV_Mix16BitMono16;
-         break;
-
-      case T_MONO :
-         voice->mix = MV_Mix16BitMono;
-         break;
-
-      case T_16BITSOURCE | T_LEFTQUIET :
-         MV_LeftVolume = MV_RightVolume;
-         voice->mix = MV_Mix16BitMono16;
-         break;
-
-      case T_LEFTQUIET :
-         MV_LeftVolume = MV_RightVolume;
-         voice->mix = MV_Mix16BitMono;
-         break;
-
-      case T_16BITSOURCE | T_RIGHTQUIET :
-         voice->mix = MV_Mix16BitMono16;
-         break;
-
-      case T_RIGHTQUIET :
-         voice->mix = MV_Mix16BitMono;
-         break;
-
-      case T_16BITSOURCE :
-         voice->mix = MV_Mix16BitStereo16;
-         break;
-
-      case T_SIXTEENBIT_STEREO :
-         voice->mix = MV_Mix16BitStereo;
-         break;
-
-      case T_16BITSOURCE | T_STEREOSOURCE:
-         voice->mix = MV_Mix16BitStereo16Stereo;
-         break;
-
-      case T_16BITSOURCE | T_STEREOSOURCE | T_8BITS:
-         voice->mix = MV_Mix8BitStereo16Stereo;
-         break;
-
-      case T_16BITSOURCE | T_STEREOSOURCE | T_MONO:
-         voice->mix = MV_Mix16BitMono16Stereo;
-         break;
-
-      case T_16BITSOURCE | T_STEREOSOURCE | T_8BITS | T_MONO:
-         voice->mix = MV_Mix8BitMono16Stereo;
-         break;
-
-      case T_STEREOSOURCE:
-         voice->mix = MV_Mix16BitStereo8Stereo;
-         break;
-
-      case T_STEREOSOURCE | T_8BITS:
-         voice->mix = MV_Mix8BitStereo8Stereo;
-         break;
-
-      case T_STEREOSOURCE | T_MONO:
-         voice->mix = MV_Mix16BitMono8Stereo;
-         break;
-
-      case T_STEREOSOURCE | T_8BITS | T_MONO:
-         voice->mix = MV_Mix8BitMono8Stereo;
-         break;
-
-      default :
-         voice->mix = 0;
+      qd->inuse = FALSE;
       }
 
-   //RestoreInterrupts( flags );
+   RestoreInterrupts( flags );
+
+   return( count );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetVoiceVolume
+   Function: MV_PlayRaw
 
-   Sets the stereo and mono volume level of the voice associated
-   with the specified handle.
+   Begin playback of sound data with the given sound levels and
+   priority.
 ---------------------------------------------------------------------*/
 
-void MV_SetVoiceVolume
+int MV_PlayRaw
    (
-   VoiceNode *voice,
-   int vol,
-   int left,
-   int right
+   char *ptr,
+   unsigned int length,
+   unsigned rate,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
    )
 
-   {
-   if ( MV_Channels == 1 )
-      {
-      left  = vol;
-      right = vol;
-      }
-
-   if ( MV_SwapLeftRight )
-      {
-      // SBPro uses reversed panning
-      voice->LeftVolume  = MV_GetVolumeTable( right );
-      voice->RightVolume = MV_GetVolumeTable( left );
-      }
-   else
-      {
-      voice->LeftVolume  = MV_GetVolumeTable( left );
-      voice->RightVolume = MV_GetVolumeTable( right );
-      }
+   {
+   int status;
 
-   MV_SetVoiceMixMode( voice );
+   status = MV_PlayLoopedRaw( ptr, length, NULL, NULL, rate, pitchoffset,
+      vol, left, right, priority, callbackval );
+
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_EndLooping
+   Function: MV_StartRaw
 
-   Stops the voice associated with the specified handle from looping
-   without stoping the sound.
+   Begin playback of sound data with the given sound levels, priority
+   and placement.
 ---------------------------------------------------------------------*/
 
-int MV_EndLooping
+int MV_StartRaw
    (
-   int handle
+   char *ptr,
+   unsigned int length,
+   char *loopstart,
+   char *loopend,
+   unsigned rate,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   const voicestart *start
    )
 
    {
    VoiceNode *voice;
-   int        flags;
 
    if ( !MV_Installed )
       {
@@ -1691,75 +5921,120 @@ int MV_EndLooping
       return( MV_Error );
       }
 
-   flags = DisableInterrupts();
+   // Enforce any per-sound instance limit or retrigger cooldown
+   if ( !MV_AdmitSound( ptr ) )
+      {
+      MV_SetErrorCode( MV_SoundLimited );
+      return( MV_Error );
+      }
 
-   voice = MV_GetVoice( handle );
+   // Request a voice from the voice pool
+   voice = MV_AllocVoice( priority );
    if ( voice == NULL )
       {
-      RestoreInterrupts( flags );
-      MV_SetErrorCode( MV_VoiceNotFound );
-      return( MV_Warning );
+      MV_SetErrorCode( MV_NoVoices );
+      return( MV_Error );
       }
+   MV_TagVoice( voice, start );
 
-   voice->LoopCount = 0;
-   voice->LoopStart = NULL;
-   voice->LoopEnd   = NULL;
-
-   RestoreInterrupts( flags );
+   voice->wavetype    = Raw;
+   voice->bits        = 8;
+   voice->channels    = 1;
+   voice->GetSound    = MV_GetNextRawBlock;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+   voice->NextBlock   = ptr;
+   voice->position    = 0;
+   voice->BlockLength = length;
+   voice->length      = 0;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = ptr;
+   voice->LoopStart   = loopstart;
+   voice->LoopEnd     = loopend;
+   voice->LoopSize    = (unsigned int)( voice->LoopEnd - voice->LoopStart ) + 1;
 
-   return( MV_Ok );
+   MV_SetVoicePitch( voice, rate, pitchoffset );
+   MV_SetVoiceAngle( voice, vol, left, right, MV_StartAngle( start ) );
+   return( MV_PlayVoice( voice ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetPan
+   Function: MV_PlayLoopedRaw
 
-   Sets the stereo and mono volume level of the voice associated
-   with the specified handle.
+   Begin playback of sound data with the given sound levels and
+   priority.
 ---------------------------------------------------------------------*/
 
-int MV_SetPan
+int MV_PlayLoopedRaw
    (
-   int handle,
-   int vol,
-   int left,
-   int right
+   char *ptr,
+   unsigned int length,
+   char *loopstart,
+   char *loopend,
+   unsigned rate,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
    )
 
    {
-   VoiceNode *voice;
+   return( MV_StartRaw( ptr, length, loopstart, loopend, rate, pitchoffset,
+      vol, left, right, priority, callbackval, NULL ) );
+   }
 
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
 
-   voice = MV_GetVoice( handle );
-   if ( voice == NULL )
-      {
-      MV_SetErrorCode( MV_VoiceNotFound );
-      return( MV_Warning );
-      }
+/*---------------------------------------------------------------------
+   Function: MV_PlayWAV
 
-   MV_SetVoiceVolume( voice, vol, left, right );
+   Begin playback of sound data with the given sound levels and
+   priority.
+---------------------------------------------------------------------*/
 
-   return( MV_Ok );
+int MV_PlayWAV
+   (
+   char *ptr,
+   unsigned int length,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   int status;
+
+   status = MV_PlayLoopedWAV( ptr, length, -1, -1, pitchoffset, vol, left, right,
+      priority, callbackval );
+
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_Pan3D
+   Function: MV_PlayWAV3D
 
-   Set the angle and distance from the listener of the voice associated
-   with the specified handle.
+   Begin playback of sound data at specified angle and distance
+   from listener.
 ---------------------------------------------------------------------*/
 
-int MV_Pan3D
+int MV_PlayWAV3D
    (
-   int handle,
-   int angle,
-   int distance
+   char *ptr,
+   unsigned int length,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
    )
 
    {
@@ -1768,6 +6043,13 @@ int MV_Pan3D
    int mid;
    int volume;
    int status;
+   voicestart start;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
 
    if ( distance < 0 )
       {
@@ -1784,309 +6066,457 @@ int MV_Pan3D
    right = MV_PanTable[ angle ][ volume ].right;
    mid   = max( 0, 255 - distance );
 
-   status = MV_SetPan( handle, mid, left, right );
+   start.angle = angle;
+   start.sound = 0;
+   start.file  = NULL;
+   status = MV_StartWAV( ptr, length, -1, -1, pitchoffset, mid, left, right,
+      priority, callbackval, &start );
 
    return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetReverb
+   Function: MV_PlayRaw3D
 
-   Sets the level of reverb to add to mix.
+   Begin playback of sound data at specified angle and distance
+   from listener.
 ---------------------------------------------------------------------*/
 
-void MV_SetReverb
+int MV_PlayRaw3D
    (
-   int reverb
+   char *ptr,
+   unsigned int length,
+   unsigned rate,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
    )
 
    {
-   MV_ReverbLevel = MIX_VOLUME( reverb );
-   MV_ReverbTable = &MV_VolumeTable[ MV_ReverbLevel ];
-   }
+   int left;
+   int right;
+   int mid;
+   int volume;
+   int status;
+   voicestart start;
 
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
 
-/*---------------------------------------------------------------------
-   Function: MV_SetFastReverb
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
 
-   Sets the level of reverb to add to mix.
----------------------------------------------------------------------*/
+   volume = MIX_VOLUME( distance );
 
-void MV_SetFastReverb
-   (
-   int reverb
-   )
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
 
-   {
-   MV_ReverbLevel = max( 0, min( 16, reverb ) );
-   MV_ReverbTable = NULL;
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
+
+   start.angle = angle;
+   start.sound = 0;
+   start.file  = NULL;
+   status = MV_StartRaw( ptr, length, NULL, NULL, rate, pitchoffset, mid, left,
+      right, priority, callbackval, &start );
+
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetMaxReverbDelay
+   Function: MV_StartWAV
 
-   Returns the maximum delay time for reverb.
+   Begin playback of sound data with the given sound levels, priority
+   and placement.
 ---------------------------------------------------------------------*/
 
-int MV_GetMaxReverbDelay
+int MV_StartWAV
    (
-   void
+   char *ptr,
+   unsigned int ptrlength,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   const voicestart *start
    )
 
    {
-   int maxdelay;
-
-   maxdelay = MixBufferSize * MV_NumberOfBuffers;
-
-   return maxdelay;
-   }
-
-
-/*---------------------------------------------------------------------
-   Function: MV_GetReverbDelay
+   format_header format;
+   char *dataptr;
+   unsigned int datalength;
 
-   Returns the current delay time for reverb.
----------------------------------------------------------------------*/
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
 
-int MV_GetReverbDelay
-   (
-   void
-   )
+   if ( MV_ParseWAV( ptr, ptrlength, &format, &dataptr, &datalength ) != MV_Ok )
+      {
+      return( MV_Error );
+      }
 
-   {
-   return MV_ReverbDelay / MV_SampleSize;
+   return( MV_PlayParsedWAV( ptr, &format, dataptr, datalength, loopstart,
+      loopend, pitchoffset, vol, left, right, priority, callbackval, start ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetReverbDelay
+   Function: MV_PlayLoopedWAV
 
-   Sets the delay level of reverb to add to mix.
+   Begin playback of sound data with the given sound levels and
+   priority.
 ---------------------------------------------------------------------*/
 
-void MV_SetReverbDelay
+int MV_PlayLoopedWAV
    (
-   int delay
+   char *ptr,
+   unsigned int ptrlength,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
    )
 
    {
-   int maxdelay;
-
-   maxdelay = MV_GetMaxReverbDelay();
-   MV_ReverbDelay = max( MixBufferSize, min( delay, maxdelay ) );
-   MV_ReverbDelay *= MV_SampleSize;
+   return( MV_StartWAV( ptr, ptrlength, loopstart, loopend, pitchoffset,
+      vol, left, right, priority, callbackval, NULL ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetMixMode
+   Function: MV_PlayParsedWAV
 
-   Prepares Multivoc to play stereo of mono digitized sounds.
+   Begin playback of sample data whose format has already been read.
+   ptr identifies the sound for instance limits, and start holds the
+   angle for 3D playback or is NULL.
 ---------------------------------------------------------------------*/
 
-int MV_SetMixMode
+int MV_PlayParsedWAV
    (
-   int numchannels,
-   int samplebits
+   char *ptr,
+   const format_header *format,
+   char *dataptr,
+   unsigned int datalength,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   const voicestart *start
    )
 
    {
-   int mode;
+   data_header   data;
+   VoiceNode     *voice;
+   int length;
+   int absloopend;
+   int absloopstart;
+   int sizemask;
 
-   if ( !MV_Installed )
+   // Enforce any per-sound instance limit or retrigger cooldown
+   if ( !MV_AdmitSound( ptr ) )
       {
-      MV_SetErrorCode( MV_NotInstalled );
+      MV_SetErrorCode( MV_SoundLimited );
       return( MV_Error );
       }
 
-   mode = 0;
-   if ( numchannels == 2 )
+   // Compressed data is decoded a block at a time as it plays
+   if ( format->wFormatTag == WAVE_FORMAT_IMA_ADPCM )
       {
-      mode |= STEREO;
+      return( MV_PlayLoopedADPCM( ptr, format, dataptr, datalength, loopstart,
+         loopend, pitchoffset, vol, left, right, priority, callbackval, start ) );
       }
-   if ( samplebits == 16 )
+
+   // Request a voice from the voice pool
+   voice = MV_AllocVoice( priority );
+   if ( voice == NULL )
       {
-      mode |= SIXTEEN_BIT;
+      MV_SetErrorCode( MV_NoVoices );
+      return( MV_Error );
       }
+   MV_TagVoice( voice, start );
 
-   MV_MixMode = mode;
+   voice->wavetype    = WAV;
+   voice->bits        = format->nBitsPerSample;
+   voice->channels    = format->nChannels;
+   voice->GetSound    = MV_GetNextWAVBlock;
 
-   MV_Channels = 1;
-   if ( MV_MixMode & STEREO )
+   // Companded samples are expanded by the mixer as they are read
+   if ( format->wFormatTag == WAVE_FORMAT_ALAW )
       {
-      MV_Channels = 2;
+      voice->Expand = MV_ALawTable;
       }
-
-   MV_Bits = 8;
-   if ( MV_MixMode & SIXTEEN_BIT )
+   else if ( format->wFormatTag == WAVE_FORMAT_MULAW )
       {
-      MV_Bits = 16;
+      voice->Expand = MV_MuLawTable;
       }
 
-   MV_BuffShift  = 7 + MV_Channels;
-   MV_SampleSize = sizeof( MONO8 ) * MV_Channels;
-
-   if ( MV_Bits == 8 )
+   data.size = datalength;
+   length = data.size;
+   absloopstart = loopstart;
+   absloopend   = loopend;
+   sizemask = 0;
+   if ( voice->bits == 16 )
       {
-      MV_Silence = SILENCE_8BIT;
+      loopstart  *= 2;
+      loopend    *= 2;
+      length     /= 2;
+      sizemask    = 1;
       }
-   else
+   if ( voice->channels == 2 )
       {
-      MV_Silence     = SILENCE_16BIT;
-      MV_BuffShift  += 1;
-      MV_SampleSize *= 2;
+      loopstart  *= 2;
+      loopend    *= 2;
+      length     /= 2;
+      sizemask    = (sizemask<<1) | 1;
       }
+   data.size  &= ~sizemask;
 
-   MV_BufferSize = MixBufferSize * MV_SampleSize;
-   MV_NumberOfBuffers = TotalBufferSize / MV_BufferSize;
-   MV_BufferLength = TotalBufferSize;
+   loopend    = (int)min( (unsigned int)loopend, data.size );
+   absloopend = (int)min( (unsigned int)absloopend, (unsigned int)length );
 
-   MV_RightChannelOffset = MV_SampleSize / 2;
+   voice->Playing     = TRUE;
+   voice->Paused      = FALSE;
+   voice->DemandFeed  = NULL;
+   voice->LoopStart   = NULL;
+   voice->LoopCount   = 0;
+   voice->position    = 0;
+   voice->length      = 0;
+   voice->BlockLength = absloopend;
+   voice->NextBlock   = dataptr;
+   voice->next        = NULL;
+   voice->prev        = NULL;
+   voice->priority    = priority;
+   voice->callbackval = callbackval;
+   voice->Origin      = ptr;
+   voice->LoopStart   = voice->NextBlock + loopstart;
+   voice->LoopEnd     = voice->NextBlock + loopend;
+   voice->LoopSize    = absloopend - absloopstart;
 
-   return( MV_Ok );
+   if ( ( loopstart >= (int)data.size ) || ( loopstart < 0 ) )
+      {
+      voice->LoopStart = NULL;
+      voice->LoopEnd   = NULL;
+      voice->BlockLength = length;
+      }
+
+   MV_SetVoicePitch( voice, format->nSamplesPerSec, pitchoffset );
+   MV_SetVoiceAngle( voice, vol, left, right, MV_StartAngle( start ) );
+   return( MV_PlayVoice( voice ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_StartPlayback
+   Function: MV_PlayVOC3D
 
-   Starts the sound playback engine.
+   Begin playback of sound data at specified angle and distance
+   from listener.
 ---------------------------------------------------------------------*/
 
-int MV_StartPlayback
+int MV_PlayVOC3D
    (
-   void
+   char *ptr,
+   unsigned int ptrlength,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
    )
 
    {
+   int left;
+   int right;
+   int mid;
+   int volume;
    int status;
-   int buffer;
+   voicestart start;
 
-   // Initialize the buffers
-   ClearBuffer_DW( MV_MixBuffer[ 0 ], MV_Silence, TotalBufferSize >> 2 );
-   for( buffer = 0; buffer < MV_NumberOfBuffers; buffer++ )
+   if ( !MV_Installed )
       {
-      MV_BufferEmpty[ buffer ] = TRUE;
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
       }
 
-   // Set the mix buffer variables
-   MV_MixPage = 1;
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
 
-   MV_MixFunction = MV_Mix;
+   volume = MIX_VOLUME( distance );
 
-//JIM
-//   MV_MixRate = MV_RequestedMixRate;
-//   return( MV_Ok );
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
 
-   // Start playback
-   status = SoundDriver_PCM_BeginPlayback(MV_MixBuffer[0], MV_BufferSize,
-                                      MV_NumberOfBuffers, MV_ServiceVoc);
-   if (status != MV_Ok) {
-      MV_SetErrorCode(MV_DriverError);
-      return MV_Error;
-   }
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
 
-   MV_MixRate = MV_RequestedMixRate;
+   start.angle = angle;
+   start.sound = 0;
+   start.file  = NULL;
+   status = MV_StartVOC( ptr, ptrlength, -1, -1, pitchoffset, mid, left, right,
+      priority, callbackval, &start );
 
-   return( MV_Ok );
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_StopPlayback
+   Function: MV_PlayVOC
 
-   Stops the sound playback engine.
+   Begin playback of sound data with the given sound levels and
+   priority.
 ---------------------------------------------------------------------*/
 
-void MV_StopPlayback
+int MV_PlayVOC
    (
-   void
+   char *ptr,
+   unsigned int ptrlength,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
    )
 
    {
-   VoiceNode   *voice;
-   VoiceNode   *next;
-   int          flags;
-
-   // Stop sound playback
-   SoundDriver_PCM_StopPlayback();
-
-   // Make sure all callbacks are done.
-   flags = DisableInterrupts();
-
-   for( voice = VoiceList.next; voice != &VoiceList; voice = next )
-      {
-      next = voice->next;
-
-      MV_StopVoice( voice );
+   int status;
 
-      if ( MV_CallBackFunc )
-         {
-         MV_CallBackFunc( voice->callbackval );
-         }
-      }
+   status = MV_PlayLoopedVOC( ptr, ptrlength, -1, -1, pitchoffset, vol, left, right,
+      priority, callbackval );
 
-   RestoreInterrupts( flags );
+   return( status );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_StartRecording
+   Function: MV_VOCNeedsDecoder
 
-   Starts the sound recording engine.
+   Scans the blocks of a VOC file for Creative ADPCM data or silence,
+   which are expanded as they play and need a decoder attached to the
+   voice.
 ---------------------------------------------------------------------*/
 
-int MV_StartRecording
+static int MV_VOCNeedsDecoder
    (
-   int MixRate,
-   void ( *function )( char *ptr, int length )
+   char *ptr,
+   unsigned int ptrlength
    )
 
    {
-   (void)MixRate; (void)function;
+   unsigned char *block;
+   unsigned char *end;
+   unsigned int   blocklength;
 
-   MV_SetErrorCode( MV_UnsupportedCard );
-   return( MV_Error );
-   }
+   block = ( unsigned char * )ptr + LITTLE16( *( unsigned short * )( ptr + 0x14 ) );
+   end   = ( unsigned char * )ptr + ptrlength;
 
+   while( ( ptrlength == 0 ) || ( block + 4 <= end ) )
+      {
+      blocklength = LITTLE32( *( unsigned int * )( block + 1 ) ) & 0x00ffffff;
+      switch( *block )
+         {
+         case 1 :
+            if ( *( block + 5 ) != VOC_8BIT )
+               {
+               return( TRUE );
+               }
+            break;
 
-/*---------------------------------------------------------------------
-   Function: MV_StopRecord
+         case 3 :
+            return( TRUE );
 
-   Stops the sound record engine.
----------------------------------------------------------------------*/
+         case 8 :
+            if ( *( block + 6 ) != VOC_8BIT )
+               {
+               return( TRUE );
+               }
+            break;
 
-void MV_StopRecord
-   (
-   void
-   )
+         case 9 :
+            if ( MV_CreativeADPCMRatio( LITTLE16( *( unsigned short * )( block + 10 ) ) ) > 0 )
+               {
+               return( TRUE );
+               }
+            break;
 
-   {
+         case 0 :
+         case 2 :
+         case 4 :
+         case 5 :
+         case 6 :
+         case 7 :
+            break;
+
+         default :
+            return( FALSE );
+         }
+
+      if ( *block == 0 )
+         {
+         break;
+         }
+
+      block += 4 + blocklength;
+      }
+
+   return( FALSE );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_StartDemandFeedPlayback
+   Function: MV_StartVOC
 
-   Plays a digitized sound from a user controlled buffering system.
+   Begin playback of sound data with the given sound levels, priority
+   and placement.
 ---------------------------------------------------------------------*/
 
-int MV_StartDemandFeedPlayback
+int MV_StartVOC
    (
-   void ( *function )( char **ptr, unsigned int *length ),
-   int rate,
-   int pitchoffset,
-   int vol,
-   int left,
-   int right,
-   int priority,
-   unsigned int callbackval
+   char *ptr,
+   unsigned int ptrlength,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   const voicestart *start
    )
 
    {
-   VoiceNode *voice;
+   VoiceNode   *voice;
+   vocdecoder  *dec;
+   int          status;
 
    if ( !MV_Installed )
       {
@@ -2094,54 +6524,88 @@ int MV_StartDemandFeedPlayback
       return( MV_Error );
       }
 
+   // Make sure it's a valid VOC file.
+   status = memcmp( ptr, "Creative Voice File", 19 );
+   if ( status != 0 )
+      {
+      MV_SetErrorCode( MV_InvalidVOCFile );
+      return( MV_Error );
+      }
+
+   // Enforce any per-sound instance limit or retrigger cooldown
+   if ( !MV_AdmitSound( ptr ) )
+      {
+      MV_SetErrorCode( MV_SoundLimited );
+      return( MV_Error );
+      }
+
+   dec = NULL;
+   if ( MV_VOCNeedsDecoder( ptr, ptrlength ) )
+      {
+      dec = ( vocdecoder * )malloc( sizeof( vocdecoder ) );
+      if ( dec == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+      memset( dec, 0, sizeof( vocdecoder ) );
+      }
+
    // Request a voice from the voice pool
    voice = MV_AllocVoice( priority );
    if ( voice == NULL )
       {
+      free( dec );
       MV_SetErrorCode( MV_NoVoices );
       return( MV_Error );
       }
+   MV_TagVoice( voice, start );
 
-   voice->wavetype    = DemandFeed;
+   voice->wavetype    = VOC;
+   voice->extra       = dec;
    voice->bits        = 8;
    voice->channels    = 1;
-   voice->GetSound    = MV_GetNextDemandFeedBlock;
-   voice->NextBlock   = NULL;
-   voice->DemandFeed  = function;
+   voice->GetSound    = MV_GetNextVOCBlock;
+   voice->NextBlock   = ptr + LITTLE16(*( unsigned short * )( ptr + 0x14 ));
+   voice->DemandFeed  = NULL;
    voice->LoopStart   = NULL;
    voice->LoopCount   = 0;
    voice->BlockLength = 0;
-   voice->position    = 0;
-   voice->sound       = NULL;
+   voice->PitchScale  = PITCH_GetScale( pitchoffset );
    voice->length      = 0;
-   voice->BlockLength = 0;
-   voice->Playing     = TRUE;
-   voice->Paused      = FALSE;
    voice->next        = NULL;
    voice->prev        = NULL;
    voice->priority    = priority;
    voice->callbackval = callbackval;
+   voice->Origin      = ptr;
+   voice->LoopStart   = ( char * )(intptr_t)loopstart;
+   voice->LoopEnd     = ( char * )(intptr_t)loopend;
+   voice->LoopSize    = loopend - loopstart + 1;
 
-   MV_SetVoicePitch( voice, rate, pitchoffset );
-   MV_SetVoiceVolume( voice, vol, left, right );
-   MV_PlayVoice( voice );
+   if ( loopstart < 0 )
+      {
+      voice->LoopStart = NULL;
+      voice->LoopEnd   = NULL;
+      }
 
-   return( voice->handle );
+   MV_SetVoiceAngle( voice, vol, left, right, MV_StartAngle( start ) );
+   return( MV_PlayVoice( voice ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayRaw
+   Function: MV_PlayLoopedVOC
 
    Begin playback of sound data with the given sound levels and
    priority.
 ---------------------------------------------------------------------*/
 
-int MV_PlayRaw
+int MV_PlayLoopedVOC
    (
    char *ptr,
-   unsigned int length,
-   unsigned rate,
+   unsigned int ptrlength,
+   int   loopstart,
+   int   loopend,
    int   pitchoffset,
    int   vol,
    int   left,
@@ -2151,483 +6615,364 @@ int MV_PlayRaw
    )
 
    {
-   int status;
-
-   status = MV_PlayLoopedRaw( ptr, length, NULL, NULL, rate, pitchoffset,
-      vol, left, right, priority, callbackval );
-
-   return( status );
+   return( MV_StartVOC( ptr, ptrlength, loopstart, loopend, pitchoffset,
+      vol, left, right, priority, callbackval, NULL ) );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayLoopedRaw
+   Function: MV_CreateVolumeTable
 
-   Begin playback of sound data with the given sound levels and
-   priority.
+   Create the table used to convert sound data to a specific volume
+   level.
 ---------------------------------------------------------------------*/
 
-int MV_PlayLoopedRaw
+void MV_CreateVolumeTable
    (
-   char *ptr,
-   unsigned int length,
-   char *loopstart,
-   char *loopend,
-   unsigned rate,
-   int   pitchoffset,
-   int   vol,
-   int   left,
-   int   right,
-   int   priority,
-   unsigned int callbackval
+   int index,
+   int volume,
+   int MaxVolume
    )
 
    {
-   VoiceNode *voice;
+   int val;
+   int level;
+   int i;
 
-   if ( !MV_Installed )
+   level = ( volume * MaxVolume ) / MV_MaxTotalVolume;
+   if ( MV_Bits == 16 )
       {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
+      for( i = 0; i < 65536; i += 256 )
+         {
+         val   = i - 0x8000;
+         val  *= level;
+         val  /= MV_MaxVolume << MV_Headroom;
+         MV_VolumeTable[ index ][ i / 256 ] = val;
+         }
       }
-
-   // Request a voice from the voice pool
-   voice = MV_AllocVoice( priority );
-   if ( voice == NULL )
+   else
       {
-      MV_SetErrorCode( MV_NoVoices );
-      return( MV_Error );
+      for( i = 0; i < 256; i++ )
+         {
+         val   = i - 0x80;
+         val  *= level;
+         val  /= MV_MaxVolume;
+         MV_VolumeTable[ volume ][ i ] = val;
+         }
       }
-
-   voice->wavetype    = Raw;
-   voice->bits        = 8;
-   voice->channels    = 1;
-   voice->GetSound    = MV_GetNextRawBlock;
-   voice->Playing     = TRUE;
-   voice->Paused      = FALSE;
-   voice->NextBlock   = ptr;
-   voice->position    = 0;
-   voice->BlockLength = length;
-   voice->length      = 0;
-   voice->next        = NULL;
-   voice->prev        = NULL;
-   voice->priority    = priority;
-   voice->callbackval = callbackval;
-   voice->LoopStart   = loopstart;
-   voice->LoopEnd     = loopend;
-   voice->LoopSize    = (unsigned int)( voice->LoopEnd - voice->LoopStart ) + 1;
-
-   MV_SetVoicePitch( voice, rate, pitchoffset );
-   MV_SetVoiceVolume( voice, vol, left, right );
-   MV_PlayVoice( voice );
-
-   return( voice->handle );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayWAV
+   Function: MV_CalcVolume
 
-   Begin playback of sound data with the given sound levels and
-   priority.
+   Create the table used to convert sound data to a specific volume
+   level.
 ---------------------------------------------------------------------*/
 
-int MV_PlayWAV
+static void MV_CalcVolume
    (
-   char *ptr,
-   unsigned int length,
-   int   pitchoffset,
-   int   vol,
-   int   left,
-   int   right,
-   int   priority,
-   unsigned int callbackval
+   int MaxVolume
    )
 
    {
-   int status;
+   int volume;
 
-   status = MV_PlayLoopedWAV( ptr, length, -1, -1, pitchoffset, vol, left, right,
-      priority, callbackval );
+   for( volume = 0; volume < 128; volume++ )
+      {
+      MV_HarshClipTable[ volume ] = 0;
+      MV_HarshClipTable[ volume + 384 ] = 255;
+      }
+   for( volume = 0; volume < 256; volume++ )
+      {
+      MV_HarshClipTable[ volume + 128 ] = volume;
+      }
 
-   return( status );
+   // For each volume level, create a translation table with the
+   // appropriate volume calculated.
+   for( volume = 0; volume <= MV_MaxVolume; volume++ )
+      {
+      MV_CreateVolumeTable( volume, volume, MaxVolume );
+      }
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayWAV3D
+   Function: MV_CalcPanTable
 
-   Begin playback of sound data at specified angle and distance
-   from listener.
+   Create the table used to determine the stereo volume level of
+   a sound located at a specific angle and distance from the listener.
 ---------------------------------------------------------------------*/
 
-int MV_PlayWAV3D
+static void MV_CalcPanTable
    (
-   char *ptr,
-   unsigned int length,
-   int  pitchoffset,
-   int  angle,
-   int  distance,
-   int  priority,
-   unsigned int callbackval
+   void
    )
 
    {
-   int left;
-   int right;
-   int mid;
-   int volume;
-   int status;
+   int   level;
+   int   angle;
+   int   distance;
+   int   HalfAngle;
+   int   ramp;
 
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
+   HalfAngle = ( MV_NumPanPositions / 2 );
 
-   if ( distance < 0 )
+   for( distance = 0; distance <= MV_MaxVolume; distance++ )
       {
-      distance  = -distance;
-      angle    += MV_NumPanPositions / 2;
+      level = ( 255 * ( MV_MaxVolume - distance ) ) / MV_MaxVolume;
+      for( angle = 0; angle <= HalfAngle / 2; angle++ )
+         {
+         ramp = level - ( ( level * angle ) /
+            ( MV_NumPanPositions / 4 ) );
+
+         MV_PanTable[ angle ][ distance ].left = ramp;
+         MV_PanTable[ HalfAngle - angle ][ distance ].left = ramp;
+         MV_PanTable[ HalfAngle + angle ][ distance ].left = level;
+         MV_PanTable[ MV_MaxPanPosition - angle ][ distance ].left = level;
+
+         MV_PanTable[ angle ][ distance ].right = level;
+         MV_PanTable[ HalfAngle - angle ][ distance ].right = level;
+         MV_PanTable[ HalfAngle + angle ][ distance ].right = ramp;
+         MV_PanTable[ MV_MaxPanPosition - angle ][ distance ].right = ramp;
+         }
       }
+   }
 
-   volume = MIX_VOLUME( distance );
 
-   // Ensure angle is within 0 - 31
-   angle &= MV_MaxPanPosition;
+/*---------------------------------------------------------------------
+   Function: MV_CalcSpeakerGains
 
-   left  = MV_PanTable[ angle ][ volume ].left;
-   right = MV_PanTable[ angle ][ volume ].right;
-   mid   = max( 0, 255 - distance );
+   Create the table of speaker gains for each pan position on a
+   surround device.
+---------------------------------------------------------------------*/
 
-   status = MV_PlayWAV( ptr, length, pitchoffset, mid, left, right, priority,
-      callbackval );
+static void MV_CalcSpeakerGains
+   (
+   void
+   )
 
-   return( status );
+   {
+   int angle;
+
+   for( angle = 0; angle < MV_NumPanPositions; angle++ )
+      {
+      MV_PanGains( 2.0 * PI * angle / MV_NumPanPositions, MV_OutputChannels,
+         MV_SpeakerGains[ angle ] );
+      }
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayRaw3D
+   Function: MV_SetVolume
 
-   Begin playback of sound data at specified angle and distance
-   from listener.
+   Sets the volume of digitized sound playback.
 ---------------------------------------------------------------------*/
 
-int MV_PlayRaw3D
+void MV_SetVolume
    (
-   char *ptr,
-   unsigned int length,
-   unsigned rate,
-   int  pitchoffset,
-   int  angle,
-   int  distance,
-   int  priority,
-   unsigned int callbackval
+   int volume
    )
 
    {
-   int left;
-   int right;
-   int mid;
-   int volume;
-   int status;
+   volume = max( 0, volume );
+   volume = min( volume, MV_MaxTotalVolume );
 
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
+   MV_TotalVolume = volume;
 
-   if ( distance < 0 )
-      {
-      distance  = -distance;
-      angle    += MV_NumPanPositions / 2;
-      }
+   // Calculate volume table
+   MV_CalcVolume( volume );
+   }
 
-   volume = MIX_VOLUME( distance );
 
-   // Ensure angle is within 0 - 31
-   angle &= MV_MaxPanPosition;
+/*---------------------------------------------------------------------
+   Function: MV_GetVolume
 
-   left  = MV_PanTable[ angle ][ volume ].left;
-   right = MV_PanTable[ angle ][ volume ].right;
-   mid   = max( 0, 255 - distance );
+   Returns the volume of digitized sound playback.
+---------------------------------------------------------------------*/
 
-   status = MV_PlayRaw( ptr, length, rate, pitchoffset, mid, left, right,
-      priority, callbackval );
+int MV_GetVolume
+   (
+   void
+   )
 
-   return( status );
+   {
+   return( MV_TotalVolume );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayLoopedWAV
+   Function: MV_SetInternalMixRate
 
-   Begin playback of sound data with the given sound levels and
-   priority.
+   Sets the rate sounds are mixed at, taking effect at the next call to
+   MV_Init.  The mix is converted to the device rate just before it is
+   handed to the driver, which adds about one buffer of latency.  A
+   rate of 0 mixes at the device rate.
 ---------------------------------------------------------------------*/
 
-int MV_PlayLoopedWAV
+void MV_SetInternalMixRate
    (
-   char *ptr,
-   unsigned int ptrlength,
-   int   loopstart,
-   int   loopend,
-   int   pitchoffset,
-   int   vol,
-   int   left,
-   int   right,
-   int   priority,
-   unsigned int callbackval
+   int rate
    )
 
    {
-   riff_header   riff;
-   format_header format;
-   data_header   data;
-   VoiceNode     *voice;
-   char *dataptr = ptr;
-   int length;
-   int absloopend;
-   int absloopstart;
-   int sizemask;
-
-   (void)ptrlength;
-
-   if ( !MV_Installed )
+   if ( rate > 0 )
       {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
+      rate = max( 8000, min( rate, 96000 ) );
       }
 
-   memcpy(&riff, dataptr, sizeof(riff_header));
-   riff.file_size   = LITTLE32(riff.file_size);
-   riff.format_size = LITTLE32(riff.format_size);
-   dataptr += sizeof(riff_header);
+   MV_InternalMixRate = max( 0, rate );
+   }
 
-   if ( ( memcmp( riff.RIFF, "RIFF", 4 ) != 0 ) ||
-      ( memcmp( riff.WAVE, "WAVE", 4 ) != 0 ) ||
-      ( memcmp( riff.fmt, "fmt ", 4) != 0 ) )
-      {
-      MV_SetErrorCode( MV_InvalidWAVFile );
-      return( MV_Error );
-      }
 
-   memcpy(&format, dataptr, sizeof(format_header));
-   format.wFormatTag      = LITTLE16(format.wFormatTag);
-   format.nChannels       = LITTLE16(format.nChannels);
-   format.nSamplesPerSec  = LITTLE32(format.nSamplesPerSec);
-   format.nAvgBytesPerSec = LITTLE32(format.nAvgBytesPerSec);
-   format.nBlockAlign     = LITTLE16(format.nBlockAlign);
-   format.nBitsPerSample  = LITTLE16(format.nBitsPerSample);
-   dataptr += riff.format_size;
+/*---------------------------------------------------------------------
+   Function: MV_SetLimiter
+
+   Enables the master limiter with the given look-ahead and release
+   times in milliseconds.  Signals more than threshold dB below full
+   scale pass untouched, those above are compressed by ratio:1 before
+   the peaks are limited.  A threshold of 0 or a ratio of 1 limits
+   without compressing.  The look-ahead adds to the output latency and
+   a look-ahead of 0 turns the limiter off.  Only 16-bit output is
+   supported.
+---------------------------------------------------------------------*/
 
-   memcpy(&data, dataptr, sizeof(data_header));
-   data.size = LITTLE32(data.size);
+int MV_SetLimiter
+   (
+   int lookahead,
+   int release,
+   int threshold,
+   int ratio
+   )
 
-   // Check if it's PCM data.
-   if ( format.wFormatTag != 1 )
-      {
-      MV_SetErrorCode( MV_InvalidWAVFile );
-      return( MV_Error );
-      }
+   {
+   limiter *lim;
+   float    level;
+   int      flags;
 
-   if ( format.nChannels != 1 && format.nChannels != 2 )
+   if ( !MV_Installed )
       {
-      MV_SetErrorCode( MV_InvalidWAVFile );
+      MV_SetErrorCode( MV_NotInstalled );
       return( MV_Error );
       }
 
-   if ( ( format.nBitsPerSample != 8 ) &&
-      ( format.nBitsPerSample != 16 ) )
+   if ( lookahead <= 0 )
       {
-      MV_SetErrorCode( MV_InvalidWAVFile );
-      return( MV_Error );
-      }
+      flags = DisableInterrupts();
+      lim         = MV_Limiter;
+      MV_Limiter  = NULL;
+      MV_Headroom = 0;
+      MV_CalcVolume( MV_TotalVolume );
+      RestoreInterrupts( flags );
 
-   if ( memcmp( data.DATA, "data", 4 ) != 0 )
-      {
-      MV_SetErrorCode( MV_InvalidWAVFile );
-      return( MV_Error );
+      MV_DestroyLimiter( lim );
+      return( MV_Ok );
       }
 
-   // Request a voice from the voice pool
-   voice = MV_AllocVoice( priority );
-   if ( voice == NULL )
+   if ( MV_Bits != 16 )
       {
-      MV_SetErrorCode( MV_NoVoices );
+      MV_SetErrorCode( MV_InvalidMixMode );
       return( MV_Error );
       }
 
-   voice->wavetype    = WAV;
-   voice->bits        = format.nBitsPerSample;
-   voice->channels    = format.nChannels;
-   voice->GetSound    = MV_GetNextWAVBlock;
-
-   length = data.size;
-   absloopstart = loopstart;
-   absloopend   = loopend;
-   sizemask = 0;
-   if ( voice->bits == 16 )
-      {
-      loopstart  *= 2;
-      loopend    *= 2;
-      length     /= 2;
-      sizemask    = 1;
-      }
-   if ( voice->channels == 2 )
+   lim = NULL;
+   if ( MV_Limiter == NULL )
       {
-      loopstart  *= 2;
-      loopend    *= 2;
-      length     /= 2;
-      sizemask    = (sizemask<<1) | 1;
+      lim = MV_CreateLimiter( MV_OutputChannels );
+      if ( lim == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
       }
-   data.size  &= ~sizemask;
-
-   loopend    = (int)min( (unsigned int)loopend, data.size );
-   absloopend = (int)min( (unsigned int)absloopend, (unsigned int)length );
 
-   voice->Playing     = TRUE;
-   voice->Paused      = FALSE;
-   voice->DemandFeed  = NULL;
-   voice->LoopStart   = NULL;
-   voice->LoopCount   = 0;
-   voice->position    = 0;
-   voice->length      = 0;
-   voice->BlockLength = absloopend;
-   voice->NextBlock   = dataptr + sizeof(data_header);
-   voice->next        = NULL;
-   voice->prev        = NULL;
-   voice->priority    = priority;
-   voice->callbackval = callbackval;
-   voice->LoopStart   = voice->NextBlock + loopstart;
-   voice->LoopEnd     = voice->NextBlock + loopend;
-   voice->LoopSize    = absloopend - absloopstart;
+   level = ( float )( 32768.0 * pow( 10.0, -max( 0, threshold ) / 20.0 ) );
 
-   if ( ( loopstart >= (int)data.size ) || ( loopstart < 0 ) )
+   flags = DisableInterrupts();
+   if ( lim != NULL )
       {
-      voice->LoopStart = NULL;
-      voice->LoopEnd   = NULL;
-      voice->BlockLength = length;
+      // mix quieter by the headroom so the limiter sees the true peaks
+      MV_Limiter  = lim;
+      MV_Headroom = MV_LimiterHeadroom;
+      MV_CalcVolume( MV_TotalVolume );
       }
+   MV_SetLimiterParams( MV_Limiter, lookahead * MV_MixRate / 1000,
+      max( 0, release ) * MV_MixRate / 1000, level,
+      ( float )( threshold > 0 ? ratio : 1 ) );
+   RestoreInterrupts( flags );
 
-   MV_SetVoicePitch( voice, format.nSamplesPerSec, pitchoffset );
-   MV_SetVoiceVolume( voice, vol, left, right );
-   MV_PlayVoice( voice );
-
-   return( voice->handle );
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayVOC3D
+   Function: MV_SetCallBack
 
-   Begin playback of sound data at specified angle and distance
-   from listener.
+   Set the function to call when a voice stops.
 ---------------------------------------------------------------------*/
 
-int MV_PlayVOC3D
+void MV_SetCallBack
    (
-   char *ptr,
-   unsigned int ptrlength,
-   int  pitchoffset,
-   int  angle,
-   int  distance,
-   int  priority,
-   unsigned int callbackval
+   void ( *function )( unsigned int )
    )
 
    {
-   int left;
-   int right;
-   int mid;
-   int volume;
-   int status;
-
-   if ( !MV_Installed )
-      {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-      }
-
-   if ( distance < 0 )
-      {
-      distance  = -distance;
-      angle    += MV_NumPanPositions / 2;
-      }
-
-   volume = MIX_VOLUME( distance );
-
-   // Ensure angle is within 0 - 31
-   angle &= MV_MaxPanPosition;
-
-   left  = MV_PanTable[ angle ][ volume ].left;
-   right = MV_PanTable[ angle ][ volume ].right;
-   mid   = max( 0, 255 - distance );
-
-   status = MV_PlayVOC( ptr, ptrlength, pitchoffset, mid, left, right, priority,
-      callbackval );
-
-   return( status );
+   MV_CallBackFunc = function;
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayVOC
+   Function: MV_SetCoalesceWindow
 
-   Begin playback of sound data with the given sound levels and
-   priority.
+   Sets how many samples apart two triggers of the same sound at the
+   same pitch may start and still be merged into one voice.  Zero
+   merges only triggers that land in the same mix buffer; a negative
+   value disables coalescing.
 ---------------------------------------------------------------------*/
 
-int MV_PlayVOC
+void MV_SetCoalesceWindow
    (
-   char *ptr,
-   unsigned int ptrlength,
-   int   pitchoffset,
-   int   vol,
-   int   left,
-   int   right,
-   int   priority,
-   unsigned int callbackval
+   int window
    )
 
    {
-   int status;
-
-   status = MV_PlayLoopedVOC( ptr, ptrlength, -1, -1, pitchoffset, vol, left, right,
-      priority, callbackval );
-
-   return( status );
+   MV_CoalesceWindow = max( -1, window );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_PlayLoopedVOC
+   Function: MV_GetCoalesceWindow
 
-   Begin playback of sound data with the given sound levels and
-   priority.
+   Returns the trigger coalescing window.
 ---------------------------------------------------------------------*/
 
-int MV_PlayLoopedVOC
+int MV_GetCoalesceWindow
    (
-   char *ptr,
-   unsigned int ptrlength,
-   int   loopstart,
-   int   loopend,
-   int   pitchoffset,
-   int   vol,
-   int   left,
-   int   right,
-   int   priority,
-   unsigned int callbackval
+   void
+   )
+
+   {
+   return( MV_CoalesceWindow );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetMaxVoices
+
+   Grows or shrinks the voice pool without interrupting playback.
+   Retired nodes are reused first when growing.  When shrinking, free
+   nodes are released at once and busy ones as their sounds end.
+---------------------------------------------------------------------*/
+
+int MV_SetMaxVoices
+   (
+   int voices
    )
 
    {
-   VoiceNode   *voice;
-   int          status;
-
-   (void)ptrlength;
+   VoiceNode *voice;
+   int        flags;
+   int        delta;
 
    if ( !MV_Installed )
       {
@@ -2635,225 +6980,261 @@ int MV_PlayLoopedVOC
       return( MV_Error );
       }
 
-   // Make sure it's a valid VOC file.
-   status = memcmp( ptr, "Creative Voice File", 19 );
-   if ( status != 0 )
+   if ( voices < 1 )
       {
-      MV_SetErrorCode( MV_InvalidVOCFile );
-      return( MV_Error );
+      voices = 1;
       }
 
-   // Request a voice from the voice pool
-   voice = MV_AllocVoice( priority );
-   if ( voice == NULL )
+   flags = DisableInterrupts();
+
+   delta = voices - MV_MaxVoices;
+   MV_MaxVoices = voices;
+
+   if ( delta > 0 )
       {
-      MV_SetErrorCode( MV_NoVoices );
-      return( MV_Error );
-      }
+      // Cancel any retirements still pending
+      if ( MV_VoiceDeficit > 0 )
+         {
+         int cancel;
 
-   voice->wavetype    = VOC;
-   voice->bits        = 8;
-   voice->channels    = 1;
-   voice->GetSound    = MV_GetNextVOCBlock;
-   voice->NextBlock   = ptr + LITTLE16(*( unsigned short * )( ptr + 0x14 ));
-   voice->DemandFeed  = NULL;
-   voice->LoopStart   = NULL;
-   voice->LoopCount   = 0;
-   voice->BlockLength = 0;
-   voice->PitchScale  = PITCH_GetScale( pitchoffset );
-   voice->length      = 0;
-   voice->next        = NULL;
-   voice->prev        = NULL;
-   voice->priority    = priority;
-   voice->callbackval = callbackval;
-   voice->LoopStart   = ( char * )(intptr_t)loopstart;
-   voice->LoopEnd     = ( char * )(intptr_t)loopend;
-   voice->LoopSize    = loopend - loopstart + 1;
+         cancel = min( delta, MV_VoiceDeficit );
+         MV_VoiceDeficit -= cancel;
+         delta           -= cancel;
+         }
 
-   if ( loopstart < 0 )
+      while( ( delta > 0 ) && !LL_Empty( &VoiceReserve, next, prev ) )
+         {
+         voice = VoiceReserve.next;
+         LL_Remove( voice, next, prev );
+         LL_Add( (VoiceNode*) &VoicePool, voice, next, prev );
+         delta--;
+         }
+      }
+   else
       {
-      voice->LoopStart = NULL;
-      voice->LoopEnd   = NULL;
+      while( ( delta < 0 ) && !LL_Empty( &VoicePool, next, prev ) )
+         {
+         voice = VoicePool.next;
+         LL_Remove( voice, next, prev );
+         LL_Add( (VoiceNode*) &VoiceReserve, voice, next, prev );
+         delta++;
+         }
+
+      MV_VoiceDeficit += -delta;
+      delta = 0;
+
+      MV_FreeReserveVoices( (VoiceNode*) &VoiceReserve );
       }
 
-   MV_SetVoiceVolume( voice, vol, left, right );
-   MV_PlayVoice( voice );
+   RestoreInterrupts( flags );
+
+   // Allocate whatever the reserve couldn't supply
+   while( delta > 0 )
+      {
+      voice = ( VoiceNode * )malloc( sizeof( VoiceNode ) );
+      if ( voice == NULL )
+         {
+         flags = DisableInterrupts();
+         MV_MaxVoices -= delta;
+         RestoreInterrupts( flags );
+
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+
+      memset( voice, 0, sizeof( VoiceNode ) );
+
+      flags = DisableInterrupts();
+      LL_Add( (VoiceNode*) &VoicePool, voice, next, prev );
+      RestoreInterrupts( flags );
 
-   return( voice->handle );
+      delta--;
+      }
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_CreateVolumeTable
+   Function: MV_GetMaxVoices
 
-   Create the table used to convert sound data to a specific volume
-   level.
+   Returns the number of voices in the pool.
 ---------------------------------------------------------------------*/
 
-void MV_CreateVolumeTable
+int MV_GetMaxVoices
    (
-   int index,
-   int volume,
-   int MaxVolume
+   void
    )
 
    {
-   int val;
-   int level;
-   int i;
-
-   level = ( volume * MaxVolume ) / MV_MaxTotalVolume;
-   if ( MV_Bits == 16 )
-      {
-      for( i = 0; i < 65536; i += 256 )
-         {
-         val   = i - 0x8000;
-         val  *= level;
-         val  /= MV_MaxVolume;
-         MV_VolumeTable[ index ][ i / 256 ] = val;
-         }
-      }
-   else
-      {
-      for( i = 0; i < 256; i++ )
-         {
-         val   = i - 0x80;
-         val  *= level;
-         val  /= MV_MaxVolume;
-         MV_VolumeTable[ volume ][ i ] = val;
-         }
-      }
+   return( MV_MaxVoices );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_CalcVolume
+   Function: MV_SetInterpolation
 
-   Create the table used to convert sound data to a specific volume
-   level.
+   Selects nearest, linear or cubic resampling for all voices, or
+   automatic selection per voice.  Only 16-bit output interpolates.
 ---------------------------------------------------------------------*/
 
-static void MV_CalcVolume
+int MV_SetInterpolation
    (
-   int MaxVolume
+   int mode
    )
 
    {
-   int volume;
+   VoiceNode *voice;
+   int        flags;
 
-   for( volume = 0; volume < 128; volume++ )
-      {
-      MV_HarshClipTable[ volume ] = 0;
-      MV_HarshClipTable[ volume + 384 ] = 255;
-      }
-   for( volume = 0; volume < 256; volume++ )
+   if ( ( mode < MV_InterpNearest ) || ( mode > MV_InterpAuto ) )
       {
-      MV_HarshClipTable[ volume + 128 ] = volume;
+      MV_SetErrorCode( MV_InvalidMixMode );
+      return( MV_Error );
       }
 
-   // For each volume level, create a translation table with the
-   // appropriate volume calculated.
-   for( volume = 0; volume <= MV_MaxVolume; volume++ )
+   flags = DisableInterrupts();
+
+   MV_Interpolation = mode;
+   if ( mode == MV_InterpNearest )
       {
-      MV_CreateVolumeTable( volume, volume, MaxVolume );
+      for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+         {
+         voice->Interpolation = MV_InterpNearest;
+         if ( voice->Kernels != NULL )
+            {
+            voice->mix = voice->Kernels[ MV_InterpNearest ];
+            }
+         }
       }
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_CalcPanTable
+   Function: MV_GetInterpolation
 
-   Create the table used to determine the stereo volume level of
-   a sound located at a specific angle and distance from the listener.
+   Returns the resampling mode.
 ---------------------------------------------------------------------*/
 
-static void MV_CalcPanTable
+int MV_GetInterpolation
    (
    void
    )
 
    {
-   int   level;
-   int   angle;
-   int   distance;
-   int   HalfAngle;
-   int   ramp;
-
-   HalfAngle = ( MV_NumPanPositions / 2 );
-
-   for( distance = 0; distance <= MV_MaxVolume; distance++ )
-      {
-      level = ( 255 * ( MV_MaxVolume - distance ) ) / MV_MaxVolume;
-      for( angle = 0; angle <= HalfAngle / 2; angle++ )
-         {
-         ramp = level - ( ( level * angle ) /
-            ( MV_NumPanPositions / 4 ) );
-
-         MV_PanTable[ angle ][ distance ].left = ramp;
-         MV_PanTable[ HalfAngle - angle ][ distance ].left = ramp;
-         MV_PanTable[ HalfAngle + angle ][ distance ].left = level;
-         MV_PanTable[ MV_MaxPanPosition - angle ][ distance ].left = level;
-
-         MV_PanTable[ angle ][ distance ].right = level;
-         MV_PanTable[ HalfAngle - angle ][ distance ].right = level;
-         MV_PanTable[ HalfAngle + angle ][ distance ].right = ramp;
-         MV_PanTable[ MV_MaxPanPosition - angle ][ distance ].right = ramp;
-         }
-      }
+   return( MV_Interpolation );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetVolume
+   Function: MV_SetInterpolationBudget
 
-   Sets the volume of digitized sound playback.
+   Sets how many source taps per output sample automatic mode may
+   spend on interpolating voices.  Linear voices cost two taps and
+   cubic voices four.
 ---------------------------------------------------------------------*/
 
-void MV_SetVolume
+void MV_SetInterpolationBudget
    (
-   int volume
+   int taps
    )
 
    {
-   volume = max( 0, volume );
-   volume = min( volume, MV_MaxTotalVolume );
-
-   MV_TotalVolume = volume;
-
-   // Calculate volume table
-   MV_CalcVolume( volume );
+   MV_InterpolationBudget = max( 0, taps );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_GetVolume
+   Function: MV_SetSoundLimit
 
-   Returns the volume of digitized sound playback.
+   Caps how many voices may play the sound at ptr at once and how many
+   samples must pass between triggers of it.  When the cap is reached
+   a new trigger either steals the oldest instance or is rejected.
+   A maxvoices or interval of zero leaves that check disabled.
 ---------------------------------------------------------------------*/
 
-int MV_GetVolume
+int MV_SetSoundLimit
    (
-   void
+   char *ptr,
+   int   maxvoices,
+   int   interval,
+   int   steal
    )
 
    {
-   return( MV_TotalVolume );
+   soundlimit *limit;
+   int         flags;
+
+   flags = DisableInterrupts();
+
+   limit = MV_FindSoundLimit( ptr, TRUE );
+   if ( limit == NULL )
+      {
+      RestoreInterrupts( flags );
+      MV_SetErrorCode( MV_NoMem );
+      return( MV_Error );
+      }
+
+   if ( limit->key == NULL )
+      {
+      VoiceNode *voice;
+
+      limit->key       = ptr;
+      limit->active    = 0;
+      limit->triggered = FALSE;
+      MV_NumSoundLimits++;
+
+      // Account for instances that are already playing
+      for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+         {
+         if ( voice->Origin == ptr )
+            {
+            voice->Limit = limit;
+            limit->active++;
+            }
+         }
+      }
+
+   limit->maxvoices = max( 0, maxvoices );
+   limit->interval  = ( unsigned int )max( 0, interval );
+   limit->steal     = steal;
+
+   RestoreInterrupts( flags );
+
+   return( MV_Ok );
    }
 
 
 /*---------------------------------------------------------------------
-   Function: MV_SetCallBack
+   Function: MV_ClearSoundLimits
 
-   Set the function to call when a voice stops.
+   Removes every per-sound limit.
 ---------------------------------------------------------------------*/
 
-void MV_SetCallBack
+void MV_ClearSoundLimits
    (
-   void ( *function )( unsigned int )
+   void
    )
 
    {
-   MV_CallBackFunc = function;
+   VoiceNode *voice;
+   int        flags;
+
+   flags = DisableInterrupts();
+
+   for( voice = VoiceList.next; voice != &VoiceList; voice = voice->next )
+      {
+      voice->Limit = NULL;
+      }
+
+   memset( MV_SoundLimits, 0, sizeof( MV_SoundLimits ) );
+   MV_NumSoundLimits = 0;
+
+   RestoreInterrupts( flags );
    }
 
 
@@ -2930,6 +7311,7 @@ int MV_Init
    memset(ptr, 0, MV_TotalMemory);
 
    MV_Voices = ( VoiceNode * )ptr;
+   MV_BlockVoices = Voices;
    ptr += Voices * sizeof( VoiceNode );
 
    MV_HarshClipTable = ptr;
@@ -2937,9 +7319,11 @@ int MV_Init
 
    // Set number of voices before calculating volume table
    MV_MaxVoices = Voices;
+   MV_VoiceDeficit = 0;
 
    LL_Reset( (VoiceNode*) &VoiceList, next, prev );
    LL_Reset( (VoiceNode*) &VoicePool, next, prev );
+   LL_Reset( (VoiceNode*) &VoiceReserve, next, prev );
 
    for( index = 0; index < Voices; index++ )
       {
@@ -2979,8 +7363,15 @@ int MV_Init
    // Set the sampling rate
    MV_RequestedMixRate = *MixRate;
 
+   // Surround devices mix in stereo and spread the 3D voices at output
+   MV_OutputChannels = *numchannels;
+   if ( ( MV_OutputChannels != 4 ) && ( MV_OutputChannels != 6 ) && ( MV_OutputChannels != 8 ) )
+      {
+      MV_OutputChannels = min( max( MV_OutputChannels, 1 ), 2 );
+      }
+
    // Set Mixer to play stereo digitized sound
-   MV_SetMixMode( *numchannels, *samplebits );
+   MV_SetMixMode( MV_OutputChannels, *samplebits );
    MV_ReverbDelay = MV_BufferSize * 3;
 
    // Make sure we don't cross a physical page
@@ -2993,9 +7384,74 @@ int MV_Init
 
    // Calculate pan table
    MV_CalcPanTable();
+   MV_CalcSpeakerGains();
+   memset( MV_SpatialData, 0, sizeof( MV_SpatialData ) );
+   MV_SpatialActive = FALSE;
+
+   // The listener stands at the origin facing -z with +y up
+   memset( &MV_Listener, 0, sizeof( MV_Listener ) );
+   MV_Listener.forward[ 2 ] = -1.f;
+   MV_Listener.right[ 0 ]   = 1.f;
+   for( buffer = 0; buffer < MV_NumCurves; buffer++ )
+      {
+      MV_Curves[ buffer ].model       = MV_AttenuateInverse;
+      MV_Curves[ buffer ].refdistance = 1.f;
+      MV_Curves[ buffer ].maxdistance = 1000.f;
+      MV_Curves[ buffer ].rolloff     = 1.f;
+      }
+
+   MV_InitInterpolation();
+   MV_InitCompanding();
+
+   memset( MV_VOCSilence, 0x80, sizeof( MV_VOCSilence ) );
+
+   memset( MV_Buses, 0, sizeof( MV_Buses ) );
+   for( buffer = 0; buffer < MV_NumBuses; buffer++ )
+      {
+      MV_Buses[ buffer ].level = MV_MaxTotalVolume;
+      }
+
+   memset( MV_Duckers, 0, sizeof( MV_Duckers ) );
+   memset( MV_GroupPeak, 0, sizeof( MV_GroupPeak ) );
+   memset( MV_KeyGroups, 0, sizeof( MV_KeyGroups ) );
+   for( buffer = 0; buffer < MV_NumGroups; buffer++ )
+      {
+      MV_Duckers[ buffer ].key      = -1;
+      MV_GroupStartGain[ buffer ]   = 1.f;
+      MV_GroupGain[ buffer ]        = 1.f;
+      }
 
    MV_SetVolume( MV_MaxTotalVolume );
 
+   MV_OutputPageSize = MixBufferSize * MV_OutputChannels * ( MV_Bits / 8 );
+   if ( ( MV_InternalMixRate > 0 ) && ( MV_InternalMixRate != MV_RequestedMixRate ) )
+      {
+      MV_Resampler = MV_CreateResampler( MV_GetInternalMixRate(), MV_RequestedMixRate,
+         MV_OutputChannels );
+      if ( MV_Resampler == NULL )
+         {
+         MV_Shutdown();
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+      }
+
+   if ( ( MV_Resampler != NULL ) || ( MV_OutputChannels > MV_Channels ) )
+      {
+      MV_OutputBuffer[ 0 ] = ( char * )malloc( MV_OutputPageSize * MV_NumberOfBuffers );
+      if ( MV_OutputBuffer[ 0 ] == NULL )
+         {
+         MV_Shutdown();
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+
+      for( buffer = 1; buffer < MV_NumberOfBuffers; buffer++ )
+         {
+         MV_OutputBuffer[ buffer ] = MV_OutputBuffer[ buffer - 1 ] + MV_OutputPageSize;
+         }
+      }
+
    // Start the playback engine
    status = MV_StartPlayback();
    if ( status != MV_Ok )
@@ -3046,15 +7502,49 @@ int MV_Shutdown
    // Shutdown the sound card
    SoundDriver_PCM_Shutdown();
 
+   MV_DestroyFDN( MV_Room );
+   MV_Room      = NULL;
+   MV_RoomLevel = 0;
+
+   MV_DestroyLimiter( MV_Limiter );
+   MV_Limiter  = NULL;
+   MV_Headroom = 0;
+
+   MV_DestroyHRTF( MV_HRTF );
+   MV_HRTF     = NULL;
+   MV_HRTFUsed = 0;
+
+   MV_DestroyResampler( MV_Resampler );
+   MV_Resampler = NULL;
+   free( MV_OutputBuffer[ 0 ] );
+   memset( MV_OutputBuffer, 0, sizeof( MV_OutputBuffer ) );
+
+   for( buffer = 0; buffer < MV_NumBuses; buffer++ )
+      {
+      MV_DestroyFDN( MV_Buses[ buffer ].reverb );
+      MV_DestroyConvolver( MV_Buses[ buffer ].convolver );
+      }
+   memset( MV_Buses, 0, sizeof( MV_Buses ) );
+
    // Free any voices we allocated
+   MV_FreeReserveVoices( (VoiceNode*) &VoicePool );
+   MV_FreeReserveVoices( (VoiceNode*) &VoiceReserve );
    free( MV_Voices );
    MV_Voices      = NULL;
+   MV_BlockVoices = 0;
    MV_TotalMemory = 0;
 
+   MV_StopStreamThreads();
+   MV_FreeDecoderStates();
+   MV_CloseFiles();
+   MV_FreeQueues();
+
    LL_Reset( (VoiceNode*) &VoiceList, next, prev );
    LL_Reset( (VoiceNode*) &VoicePool, next, prev );
+   LL_Reset( (VoiceNode*) &VoiceReserve, next, prev );
 
    MV_MaxVoices = 1;
+   MV_VoiceDeficit = 0;
 
    // Release the descriptor from our mix buffer
    for( buffer = 0; buffer < NumberOfBuffers; buffer++ )
@@ -50,7 +50,78 @@ enum MV_Errors
    MV_InvalidWAVFile,
 	MV_InvalidVorbisFile,
    MV_InvalidMixMode,
-   MV_NullRecordFunction
+   MV_NullRecordFunction,
+   MV_QueueFull,
+   MV_SoundLimited,
+   MV_InvalidBus,
+   MV_InvalidGroup,
+   MV_InvalidCurve,
+   MV_InvalidFLACFile,
+   MV_InvalidDecoder,
+   MV_UnknownFormat,
+   MV_InvalidSound,
+   MV_InvalidBank,
+   MV_FileError
+   };
+
+/*
+ A sound format. Formats mixed in place supply play; streamed ones
+ supply open, decode, seek and close and get statesize bytes of zeroed
+ per-voice state. Callbacks that can fail return MV_Ok or an MV_Errors
+ code. decode points block at the next run of samples in the format
+ it reports, which it may change between blocks, and returns how many
+ sample frames it holds, or zero at the end of the stream. After seek,
+ decoding resumes exactly at the given sample frame.
+ */
+typedef struct
+   {
+   unsigned int rate;
+   int          channels;
+   int          bits;
+   } MV_DecoderFormat;
+
+typedef struct
+   {
+   const char   *name;
+   int         ( *probe )( const char *ptr, unsigned int length );
+   int         ( *play )( char *ptr, unsigned int length, int loopstart, int loopend,
+                  int pitchoffset, int vol, int left, int right, int priority,
+                  unsigned int callbackval );
+   unsigned int  statesize;
+   int         ( *open )( void *state, char *ptr, unsigned int length,
+                  MV_DecoderFormat *format );
+   int         ( *decode )( void *state, char **block, MV_DecoderFormat *format );
+   int         ( *seek )( void *state, unsigned int frame );
+   void        ( *close )( void *state );
+   } MV_Decoder;
+
+enum MV_Interpolations
+   {
+   MV_InterpNearest,
+   MV_InterpLinear,
+   MV_InterpCubic,
+   MV_InterpAuto
+   };
+
+enum MV_FilterTypes
+   {
+   MV_FilterNone,
+   MV_FilterLowPass,
+   MV_FilterHighPass
+   };
+
+enum MV_Attenuations
+   {
+   MV_AttenuateNone,
+   MV_AttenuateInverse,
+   MV_AttenuateLinear,
+   MV_AttenuateExponential
+   };
+
+enum MV_LoadFlags
+   {
+   MV_LoadConvert  = 1,
+   MV_LoadResample = 2
    };
 
 const char *MV_ErrorString( int ErrorNumber );
@@ -67,8 +138,28 @@ int   MV_GetFrequency( int handle, int *frequency );
 int   MV_EndLooping( int handle );
 int   MV_SetPan( int handle, int vol, int left, int right );
 int   MV_Pan3D( int handle, int angle, int distance );
+void  MV_SetListener( const float *position, const float *velocity,
+         const float *forward, const float *up );
+int   MV_SetAttenuation( int curve, int model, float refdistance, float maxdistance,
+         float rolloff );
+void  MV_SetDoppler( float factor, float speedofsound );
+int   MV_SetEmitterCurve( int handle, int curve );
+int   MV_SetEmitters( int count, const int *handles, const float *positions,
+         const float *velocities );
+int   MV_SetHRTF( char *ptr, unsigned int ptrlength, int directions );
+void  MV_SetHRTFVoices( int voices );
+int   MV_SetVoiceFilter( int handle, int type, int cutoff, int q );
+int   MV_SetVoiceSend( int handle, int bus, int level );
+int   MV_SetVoiceGroup( int handle, int group );
+int   MV_SetDucking( int group, int keygroup, int level, int threshold, int attack, int release );
+int   MV_SetBusReturn( int bus, int level );
+int   MV_SetBusReverb( int bus, int roomsize, int damping );
+int   MV_SetBusFilter( int bus, int type, int cutoff, int q );
+int   MV_SetBusImpulse( int bus, char *ptr, unsigned int ptrlength );
 void  MV_SetReverb( int reverb );
 void  MV_SetFastReverb( int reverb );
+int   MV_SetRoomReverb( int level, int roomsize, int damping );
+int   MV_SetLimiter( int lookahead, int release, int threshold, int ratio );
 int   MV_GetMaxReverbDelay( void );
 int   MV_GetReverbDelay( void );
 void  MV_SetReverbDelay( int delay );
@@ -80,6 +171,10 @@ void  MV_StopRecord( void );
 int   MV_StartDemandFeedPlayback( void ( *function )( char **ptr, unsigned int *length ),
          int rate, int pitchoffset, int vol, int left, int right,
          int priority, unsigned int callbackval );
+int   MV_StartQueuedPlayback( int rate, int bits, int channels, int pitchoffset,
+         int vol, int left, int right, int priority, unsigned int callbackval );
+int   MV_QueueBuffer( int handle, char *ptr, unsigned int length );
+int   MV_UnqueueProcessed( int handle, char **buffers, int maxbuffers );
 int   MV_PlayRaw( char *ptr, unsigned int length,
          unsigned rate, int pitchoffset, int vol, int left,
          int right, int priority, unsigned int callbackval );
@@ -110,10 +205,55 @@ int   MV_PlayVorbis( char *ptr, unsigned int length, int pitchoffset, int vol, i
 int   MV_PlayLoopedVorbis( char *ptr, unsigned int length, int loopstart, int loopend,
                         int pitchoffset, int vol, int left, int right, int priority,
                         unsigned int callbackval );
+int   MV_RegisterDecoder( const MV_Decoder *decoder );
+const MV_Decoder *MV_FindDecoder( const char *ptr, unsigned int length );
+int   MV_PlayDecoder3D( const MV_Decoder *decoder, char *ptr, unsigned int length,
+         int pitchoffset, int angle, int distance, int priority, unsigned int callbackval );
+int   MV_PlayLoopedDecoder( const MV_Decoder *decoder, char *ptr, unsigned int length,
+         int loopstart, int loopend, int pitchoffset, int vol, int left, int right,
+         int priority, unsigned int callbackval );
+int   MV_PlayAuto3D( char *ptr, unsigned int length, int pitchoffset, int angle, int distance,
+         int priority, unsigned int callbackval );
+int   MV_PlayAuto( char *ptr, unsigned int length, int pitchoffset, int vol, int left, int right,
+         int priority, unsigned int callbackval );
+int   MV_PlayLoopedAuto( char *ptr, unsigned int length, int loopstart, int loopend,
+         int pitchoffset, int vol, int left, int right, int priority,
+         unsigned int callbackval );
+int   MV_PlayFile3D( const char *filename, int pitchoffset, int angle, int distance,
+         int priority, unsigned int callbackval );
+int   MV_PlayFile( const char *filename, int pitchoffset, int vol, int left, int right,
+         int priority, unsigned int callbackval );
+int   MV_PlayLoopedFile( const char *filename, int loopstart, int loopend,
+         int pitchoffset, int vol, int left, int right, int priority,
+         unsigned int callbackval );
+int   MV_LoadSound( char *ptr, unsigned int length, int flags );
+int   MV_LoadBank( char *ptr, unsigned int length, int *ids, int maxids );
+int   MV_UnloadSound( int sound );
+void  MV_UnloadAllSounds( void );
+int   MV_GetSoundInfo( int sound, unsigned int *rate, int *channels, unsigned int *frames );
+int   MV_PlaySound3D( int sound, int pitchoffset, int angle, int distance, int priority,
+         unsigned int callbackval );
+int   MV_PlaySound( int sound, int pitchoffset, int vol, int left, int right, int priority,
+         unsigned int callbackval );
+int   MV_PlayLoopedSound( int sound, int loopstart, int loopend, int pitchoffset, int vol,
+         int left, int right, int priority, unsigned int callbackval );
 void  MV_CreateVolumeTable( int index, int volume, int MaxVolume );
 void  MV_SetVolume( int volume );
+void  MV_SetInternalMixRate( int rate );
 int   MV_GetVolume( void );
 void  MV_SetCallBack( void ( *function )( unsigned int ) );
+void  MV_SetCoalesceWindow( int window );
+int   MV_GetCoalesceWindow( void );
+void  MV_SetStreamThreads( int threads );
+int   MV_GetStreamThreads( void );
+int   MV_GetStreamStarvation( void );
+int   MV_SetSoundLimit( char *ptr, int maxvoices, int interval, int steal );
+void  MV_ClearSoundLimits( void );
+int   MV_SetMaxVoices( int voices );
+int   MV_GetMaxVoices( void );
+int   MV_SetInterpolation( int mode );
+int   MV_GetInterpolation( void );
+void  MV_SetInterpolationBudget( int taps );
 void  MV_SetReverseStereo( int setting );
 int   MV_GetReverseStereo( void );
 int   MV_Init( int soundcard, int * MixRate, int Voices, int * numchannels,
@@ -0,0 +1,218 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Polyphase windowed-sinc sample rate converter
+ *
+ * A Kaiser-windowed sinc is tabulated at MV_ResamplePhases fractional
+ * offsets and each output sample interpolates between the two nearest
+ * phases. Upsampling uses MV_ResampleTaps taps; downsampling widens
+ * the filter by the rate ratio so its cutoff stays below the output
+ * Nyquist frequency. The passband reaches about 80% of the lower
+ * Nyquist frequency with roughly 70dB of image rejection. The tap
+ * count is kept a multiple of four for the inner loops.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+
+// zeroth order modified Bessel function, for the Kaiser window
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+resampler *MV_CreateResampler(int inrate, int outrate, int channels)
+{
+    resampler *rs;
+    double cutoff, beta, d, x, w, sum;
+    int p, k, c, taps, half;
+
+    rs = (resampler *) malloc(sizeof(resampler));
+    if (!rs) {
+        return NULL;
+    }
+    memset(rs, 0, sizeof(resampler));
+
+    taps = MV_ResampleTaps;
+    cutoff = 0.88;
+    if (inrate > outrate) {
+        taps = (int) ((double) taps * inrate / outrate + 3) & ~3;
+        cutoff *= (double) outrate / inrate;
+    }
+    if (taps > MV_MaxResampleTaps) {
+        taps = MV_MaxResampleTaps;
+    }
+    half = taps / 2;
+    beta = 7.0;
+
+    rs->channels = channels;
+    rs->taps = taps;
+    rs->step = (double) inrate / outrate;
+    rs->capacity = taps + MixBufferSize * ((inrate + outrate - 1) / outrate + 2);
+    rs->coefs = (float *) malloc((MV_ResamplePhases + 1) * taps * sizeof(float));
+    rs->input[0] = (float *) calloc(rs->capacity * channels, sizeof(float));
+    if (!rs->coefs || !rs->input[0]) {
+        MV_DestroyResampler(rs);
+        return NULL;
+    }
+    for (c = 1; c < channels; c++) {
+        rs->input[c] = rs->input[c - 1] + rs->capacity;
+    }
+
+    // row p holds the taps for a fractional offset of p/phases
+    for (p = 0; p <= MV_ResamplePhases; p++) {
+        float *row = rs->coefs + p * taps;
+
+        sum = 0.0;
+        for (k = 0; k < taps; k++) {
+            d = k - (half - 1) - (double) p / MV_ResamplePhases;
+            x = d / half;
+            w = (x > -1.0 && x < 1.0) ? bessel_i0(beta * sqrt(1.0 - x * x)) / bessel_i0(beta) : 0.0;
+            x = PI * cutoff * d;
+            row[k] = (float) (w * (fabs(x) < 1e-9 ? 1.0 : sin(x) / x));
+            sum += row[k];
+        }
+
+        // unity gain at DC for every phase
+        for (k = 0; k < taps; k++) {
+            row[k] = (float) (row[k] / sum);
+        }
+    }
+
+    // the first output lines up with the first input sample
+    rs->fill = half - 1;
+
+    return rs;
+}
+
+void MV_DestroyResampler(resampler *rs)
+{
+    if (!rs) {
+        return;
+    }
+
+    free(rs->coefs);
+    free(rs->input[0]);
+    free(rs);
+}
+
+/*
+ Returns how many output frames the buffered input can produce.
+ */
+int MV_ResamplerAvailable(resampler *rs)
+{
+    double span = rs->fill - rs->taps - rs->position;
+
+    if (span < 0.0) {
+        return 0;
+    }
+
+    return (int) (span / rs->step) + 1;
+}
+
+/*
+ Appends frames of interleaved input.
+ */
+void MV_ResamplerPush(resampler *rs, const float *data, int frames)
+{
+    int c, i;
+
+    if (rs->fill + frames > rs->capacity) {
+        frames = rs->capacity - rs->fill;
+    }
+
+    for (c = 0; c < rs->channels; c++) {
+        float *dest = rs->input[c] + rs->fill;
+
+        for (i = 0; i < frames; i++) {
+            dest[i] = data[i * rs->channels + c];
+        }
+    }
+    rs->fill += frames;
+}
+
+/*
+ Produces frames of interleaved output. The caller makes sure enough
+ input is buffered.
+ */
+void MV_ResamplerPull(resampler *rs, float *data, int frames)
+{
+    float coef[MV_MaxResampleTaps], acc[4];
+    const float *row0, *row1, *x;
+    float frac;
+    double position = rs->position, offset;
+    int taps = rs->taps, channels = rs->channels;
+    int i, k, j, c, index, phase, drop;
+
+    for (i = 0; i < frames; i++) {
+        index = (int) position;
+        offset = (position - index) * MV_ResamplePhases;
+        phase = (int) offset;
+        frac = (float) (offset - phase);
+
+        // blend the two nearest phases once for all channels
+        row0 = rs->coefs + phase * taps;
+        row1 = row0 + taps;
+        for (k = 0; k < taps; k++) {
+            coef[k] = row0[k] + (row1[k] - row0[k]) * frac;
+        }
+
+        for (c = 0; c < channels; c++) {
+            x = rs->input[c] + index;
+
+            // four running sums keep the adds independent and map onto
+            // one vector register
+            for (j = 0; j < 4; j++) {
+                acc[j] = 0.f;
+            }
+            for (k = 0; k < taps; k += 4) {
+                for (j = 0; j < 4; j++) {
+                    acc[j] += coef[k + j] * x[k + j];
+                }
+            }
+
+            data[i * channels + c] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        }
+
+        position += rs->step;
+    }
+
+    // drop the input no later output will reach
+    drop = (int) position;
+    if (drop > rs->fill) {
+        drop = rs->fill;
+    }
+    for (c = 0; c < rs->channels; c++) {
+        memmove(rs->input[c], rs->input[c] + drop, (rs->fill - drop) * sizeof(float));
+    }
+    rs->fill -= drop;
+    rs->position = position - drop;
+}
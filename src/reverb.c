@@ -0,0 +1,299 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Feedback delay network reverb
+ *
+ * Eight delay lines feed back through a normalised Hadamard matrix,
+ * with a one-pole low-pass in each line for high frequency damping.
+ * The eight lines are held as two four-wide vectors (SSE or NEON where
+ * the compiler targets them, plain C otherwise), so each frame's
+ * filters, fast Hadamard transform and gains take about 20 vector
+ * operations. Frames are processed in blocks no longer than the
+ * shortest line, so a block's delay reads and writes are contiguous
+ * runs per line. The cost does not depend on the number of voices or
+ * the room size: a 256 frame buffer is about 5000 vector operations
+ * plus 4096 delay line loads and stores.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "_multivc.h"
+#include "assmisc.h"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+
+typedef __m128 fdnvec;
+#define vec_load(p)       _mm_loadu_ps(p)
+#define vec_store(p, a)   _mm_storeu_ps((p), (a))
+#define vec_splat(x)      _mm_set1_ps(x)
+#define vec_add(a, b)     _mm_add_ps((a), (b))
+#define vec_sub(a, b)     _mm_sub_ps((a), (b))
+#define vec_mul(a, b)     _mm_mul_ps((a), (b))
+#define vec_swaphalves(a) _mm_shuffle_ps((a), (a), _MM_SHUFFLE(1, 0, 3, 2))
+#define vec_swappairs(a)  _mm_shuffle_ps((a), (a), _MM_SHUFFLE(2, 3, 0, 1))
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+typedef float32x4_t fdnvec;
+#define vec_load(p)       vld1q_f32(p)
+#define vec_store(p, a)   vst1q_f32((p), (a))
+#define vec_splat(x)      vdupq_n_f32(x)
+#define vec_add(a, b)     vaddq_f32((a), (b))
+#define vec_sub(a, b)     vsubq_f32((a), (b))
+#define vec_mul(a, b)     vmulq_f32((a), (b))
+#define vec_swaphalves(a) vextq_f32((a), (a), 2)
+#define vec_swappairs(a)  vrev64q_f32(a)
+
+#else
+
+typedef struct {
+    float f[4];
+} fdnvec;
+
+static inline fdnvec vec_load(const float *p)
+{
+    fdnvec r = {{ p[0], p[1], p[2], p[3] }};
+    return r;
+}
+
+static inline void vec_store(float *p, fdnvec a)
+{
+    p[0] = a.f[0]; p[1] = a.f[1]; p[2] = a.f[2]; p[3] = a.f[3];
+}
+
+static inline fdnvec vec_splat(float x)
+{
+    fdnvec r = {{ x, x, x, x }};
+    return r;
+}
+
+static inline fdnvec vec_add(fdnvec a, fdnvec b)
+{
+    fdnvec r = {{ a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3] }};
+    return r;
+}
+
+static inline fdnvec vec_sub(fdnvec a, fdnvec b)
+{
+    fdnvec r = {{ a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3] }};
+    return r;
+}
+
+static inline fdnvec vec_mul(fdnvec a, fdnvec b)
+{
+    fdnvec r = {{ a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3] }};
+    return r;
+}
+
+static inline fdnvec vec_swaphalves(fdnvec a)
+{
+    fdnvec r = {{ a.f[2], a.f[3], a.f[0], a.f[1] }};
+    return r;
+}
+
+static inline fdnvec vec_swappairs(fdnvec a)
+{
+    fdnvec r = {{ a.f[1], a.f[0], a.f[3], a.f[2] }};
+    return r;
+}
+
+#endif
+
+// frames per block, bounded further by the shortest line
+#define FDN_BLOCK 64
+
+// mutually prime line lengths in samples at 44.1kHz, for the largest room
+static const int fdn_lengths[MV_FDNLines] = {
+    1559, 1907, 2281, 2621, 2969, 3313, 3659, 4001
+};
+
+fdnreverb *MV_CreateFDN(int rate)
+{
+    fdnreverb *fdn;
+    int i, length;
+
+    fdn = (fdnreverb *) malloc(sizeof(fdnreverb));
+    if (!fdn) {
+        return NULL;
+    }
+    memset(fdn, 0, sizeof(fdnreverb));
+
+    fdn->rate = rate;
+    for (i = 0; i < MV_FDNLines; i++) {
+        length = (int) ((double) fdn_lengths[i] * rate / 44100.0) + 1;
+        fdn->line[i] = (float *) calloc(length, sizeof(float));
+        if (!fdn->line[i]) {
+            MV_DestroyFDN(fdn);
+            return NULL;
+        }
+        fdn->maxlength[i] = length;
+        fdn->length[i] = length;
+    }
+
+    MV_SetFDNParams(fdn, 128, 128);
+
+    return fdn;
+}
+
+void MV_DestroyFDN(fdnreverb *fdn)
+{
+    int i;
+
+    if (!fdn) {
+        return;
+    }
+
+    for (i = 0; i < MV_FDNLines; i++) {
+        free(fdn->line[i]);
+    }
+    free(fdn);
+}
+
+/*
+ roomsize and damping range from 0 to 255. The room size scales the
+ delay lengths and the decay time, from about 0.3 to 3 seconds.
+ */
+void MV_SetFDNParams(fdnreverb *fdn, int roomsize, int damping)
+{
+    double scale, rt60;
+    int i;
+
+    roomsize = min(255, max(0, roomsize));
+    damping = min(255, max(0, damping));
+
+    scale = 0.3 + 0.7 * roomsize / 255.0;
+    rt60 = 0.3 + 2.7 * roomsize / 255.0;
+
+    for (i = 0; i < MV_FDNLines; i++) {
+        fdn->length[i] = max(1, (int) (fdn->maxlength[i] * scale));
+        fdn->pos[i] %= fdn->length[i];
+
+        // per-line gain for a 60dB decay over rt60, with the Hadamard
+        // normalisation folded in
+        fdn->gain[i] = (float) (pow(10.0, -3.0 * fdn->length[i] / (fdn->rate * rt60)) /
+                                sqrt((double) MV_FDNLines));
+    }
+
+    fdn->damping = (float) (0.7 * damping / 255.0);
+}
+
+/*
+ Adds the reverberated input to count frames of left and right output.
+ */
+void MV_ProcessFDN(fdnreverb *fdn, const float *input, float *left, float *right, int count)
+{
+    static const float signhalves[4] = { 1.f, 1.f, -1.f, -1.f };
+    static const float signpairs[4] = { 1.f, -1.f, 1.f, -1.f };
+    float frames[FDN_BLOCK][MV_FDNLines];
+    float out[4];
+    fdnvec lp0, lp1, g0, g1, damp, half, pair;
+    fdnvec v0, v1, t0, t1, in;
+    int block, minlength;
+    int i, f, p;
+
+    minlength = fdn->length[0];
+    for (i = 1; i < MV_FDNLines; i++) {
+        minlength = min(minlength, fdn->length[i]);
+    }
+
+    lp0 = vec_load(fdn->lowpass);
+    lp1 = vec_load(fdn->lowpass + 4);
+    g0 = vec_load(fdn->gain);
+    g1 = vec_load(fdn->gain + 4);
+    damp = vec_splat(fdn->damping);
+    half = vec_load(signhalves);
+    pair = vec_load(signpairs);
+
+    while (count > 0) {
+        block = min(count, min(FDN_BLOCK, minlength));
+
+        // Nothing read in this block was written in it, as no line is
+        // shorter than the block
+        for (i = 0; i < MV_FDNLines; i++) {
+            const float *line = fdn->line[i];
+            p = fdn->pos[i];
+            for (f = 0; f < block; f++) {
+                frames[f][i] = line[p];
+                if (++p >= fdn->length[i]) {
+                    p = 0;
+                }
+            }
+        }
+
+        for (f = 0; f < block; f++) {
+            v0 = vec_load(frames[f]);
+            v1 = vec_load(frames[f] + 4);
+
+            lp0 = vec_add(v0, vec_mul(vec_sub(lp0, v0), damp));
+            lp1 = vec_add(v1, vec_mul(vec_sub(lp1, v1), damp));
+
+            // fast Walsh-Hadamard transform: across the two halves,
+            // then across lanes two apart, then adjacent lanes
+            v0 = vec_add(lp0, lp1);
+            v1 = vec_sub(lp0, lp1);
+
+            // (v0 - v2 + v4 - v6) and (v1 - v3 + v5 - v7) for the output
+            t0 = vec_sub(v0, vec_swaphalves(v0));
+            vec_store(out, t0);
+            left[f] += out[0] * 0.25f;
+            right[f] += out[1] * 0.25f;
+
+            v0 = vec_add(vec_mul(v0, half), vec_swaphalves(v0));
+            v1 = vec_add(vec_mul(v1, half), vec_swaphalves(v1));
+            v0 = vec_add(vec_mul(v0, pair), vec_swappairs(v0));
+            v1 = vec_add(vec_mul(v1, pair), vec_swappairs(v1));
+
+            in = vec_splat(input[f]);
+            t0 = vec_add(in, vec_mul(v0, g0));
+            t1 = vec_add(in, vec_mul(v1, g1));
+            vec_store(frames[f], t0);
+            vec_store(frames[f] + 4, t1);
+        }
+
+        for (i = 0; i < MV_FDNLines; i++) {
+            float *line = fdn->line[i];
+            p = fdn->pos[i];
+            for (f = 0; f < block; f++) {
+                line[p] = frames[f][i];
+                if (++p >= fdn->length[i]) {
+                    p = 0;
+                }
+            }
+            fdn->pos[i] = p;
+        }
+
+        input += block;
+        left += block;
+        right += block;
+        count -= block;
+    }
+
+    vec_store(fdn->lowpass, lp0);
+    vec_store(fdn->lowpass + 4, lp1);
+
+    for (i = 0; i < MV_FDNLines; i++) {
+        if (fabsf(fdn->lowpass[i]) < 1e-15f) fdn->lowpass[i] = 0.f;
+    }
+}
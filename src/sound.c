@@ -0,0 +1,1239 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Sounds loaded ahead of play
+ *
+ * Loading a sound reads its headers once and keeps the format, where
+ * the samples are, and any loop the file carries, so playing it again
+ * only sets up a voice. WAV files and VOC files holding one block of
+ * samples are fully parsed this way. Other formats are matched to
+ * their decoder once and opened by it at each play, unless the caller
+ * asks for them to be converted, in which case they are decoded to
+ * 16-bit PCM at load. Companded samples are expanded on conversion too.
+ * Sounds loaded for resampling are also converted to the mix rate with
+ * the windowed-sinc resampler, so that at their own pitch they play at
+ * unity rate. This happens at load, or at the first play if no mix rate
+ * is set yet, and again only if the mix rate changes. Loading the same
+ * data with the same conversions again shares the loaded sound.
+ *
+ * Packed banks are loaded from their index alone, and their sounds play
+ * from the bank's memory.
+ *
+ * The caller's data must stay in memory while the sound is loaded.
+ * Only the calling thread touches the sound table.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "multivoc.h"
+#include "_multivc.h"
+#include "assmisc.h"
+#include "bank.h"
+
+#define SoundUnused   0
+#define SoundParsed   1
+#define SoundDecoded  2
+
+typedef struct
+   {
+   int               kind;
+   char             *ptr;
+   unsigned int      length;
+   int               flags;
+   int               refs;
+
+   // a sound only its decoder can read
+   const MV_Decoder *decoder;
+
+   // a parsed or converted sound; rate, frames and the loop are the
+   // file's own even once resampled
+   format_header     format;
+   char             *data;
+   unsigned int      datalength;
+   unsigned int      rate;
+   unsigned int      frames;
+   int               loopstart;
+   int               loopend;
+
+   // converted samples, freed on unload
+   char             *buffer;
+   } sounddata;
+
+static sounddata *MV_Sounds = NULL;
+static int        MV_NumSounds = 0;
+
+#define MV_SoundGrowth 64
+
+
+/*---------------------------------------------------------------------
+   Function: MV_FindWAVLoop
+
+   Reads the first loop of a WAV file's sampler chunk, if it has one.
+---------------------------------------------------------------------*/
+
+static void MV_FindWAVLoop
+   (
+   sounddata *sound
+   )
+
+   {
+   unsigned char *chunk;
+   unsigned char *end;
+   unsigned int   size;
+   unsigned int   start;
+   unsigned int   finish;
+
+   if ( sound->length < 12 )
+      {
+      return;
+      }
+
+   chunk = ( unsigned char * )sound->ptr + 12;
+   end   = ( unsigned char * )sound->ptr + sound->length;
+
+   while( chunk + 8 <= end )
+      {
+      size = LITTLE32( *( unsigned int * )( chunk + 4 ) );
+      if ( size > ( unsigned int )( end - chunk ) - 8 )
+         {
+         break;
+         }
+
+      if ( ( memcmp( chunk, "smpl", 4 ) == 0 ) && ( size >= 36 + 24 ) &&
+         ( LITTLE32( *( unsigned int * )( chunk + 8 + 28 ) ) > 0 ) )
+         {
+         start  = LITTLE32( *( unsigned int * )( chunk + 8 + 36 + 8 ) );
+         finish = LITTLE32( *( unsigned int * )( chunk + 8 + 36 + 12 ) );
+
+         // The loop end is the last frame played
+         if ( ( start <= finish ) && ( finish < sound->frames ) )
+            {
+            sound->loopstart = ( int )start;
+            sound->loopend   = ( int )finish + 1;
+            }
+         return;
+         }
+
+      chunk += 8 + ( ( size + 1 ) & ~1 );
+      }
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ParseVOCBlock
+
+   Parses a VOC file that holds a single block of 8 or 16 bit samples.
+   Files with more blocks, repeats or packed data are left to the VOC
+   player.
+---------------------------------------------------------------------*/
+
+static int MV_ParseVOCBlock
+   (
+   sounddata *sound
+   )
+
+   {
+   unsigned char *block;
+   unsigned char *end;
+   unsigned int   blocklength;
+   unsigned int   rate;
+   int            bits;
+   int            channels;
+   int            format;
+
+   if ( sound->length < 0x1a )
+      {
+      return( FALSE );
+      }
+
+   block = ( unsigned char * )sound->ptr + LITTLE16( *( unsigned short * )( sound->ptr + 0x14 ) );
+   end   = ( unsigned char * )sound->ptr + sound->length;
+
+   // Skip text and markers ahead of the samples
+   while( ( block + 4 <= end ) && ( ( *block == 4 ) || ( *block == 5 ) ) )
+      {
+      block += 4 + ( LITTLE32( *( unsigned int * )( block + 1 ) ) & 0x00ffffff );
+      }
+
+   if ( block + 4 > end )
+      {
+      return( FALSE );
+      }
+
+   blocklength = LITTLE32( *( unsigned int * )( block + 1 ) ) & 0x00ffffff;
+   if ( blocklength > ( unsigned int )( end - block ) - 4 )
+      {
+      return( FALSE );
+      }
+
+   switch( *block )
+      {
+      case 1 :
+         if ( ( blocklength <= 2 ) || ( *( block + 5 ) != VOC_8BIT ) )
+            {
+            return( FALSE );
+            }
+         rate     = 256000000L / ( 65536 - ( ( unsigned int )*( block + 4 ) << 8 ) );
+         bits     = 8;
+         channels = 1;
+         format   = WAVE_FORMAT_PCM;
+         sound->data       = ( char * )block + 6;
+         sound->datalength = blocklength - 2;
+         break;
+
+      case 9 :
+         if ( blocklength <= 12 )
+            {
+            return( FALSE );
+            }
+         rate     = LITTLE32( *( unsigned int * )( block + 4 ) );
+         bits     = *( block + 8 );
+         channels = *( block + 9 );
+         switch( LITTLE16( *( unsigned short * )( block + 10 ) ) )
+            {
+            case VOC_8BIT :
+               format = ( bits == 8 ) ? WAVE_FORMAT_PCM : 0;
+               break;
+            case VOC_16BIT :
+               format = ( bits == 16 ) ? WAVE_FORMAT_PCM : 0;
+               break;
+            case VOC_ALAW :
+               format = ( bits == 8 ) ? WAVE_FORMAT_ALAW : 0;
+               break;
+            case VOC_MULAW :
+               format = ( bits == 8 ) ? WAVE_FORMAT_MULAW : 0;
+               break;
+            default :
+               format = 0;
+               break;
+            }
+         if ( ( format == 0 ) || ( channels < 1 ) || ( channels > 2 ) || ( rate == 0 ) )
+            {
+            return( FALSE );
+            }
+         sound->data       = ( char * )block + 16;
+         sound->datalength = blocklength - 12;
+         break;
+
+      default :
+         return( FALSE );
+      }
+
+   // Nothing but the terminator may follow
+   block += 4 + blocklength;
+   if ( ( block < end ) && ( *block != 0 ) )
+      {
+      return( FALSE );
+      }
+
+   memset( &sound->format, 0, sizeof( format_header ) );
+   sound->format.wFormatTag     = format;
+   sound->format.nChannels      = channels;
+   sound->format.nSamplesPerSec = rate;
+   sound->format.nBitsPerSample = bits;
+   sound->format.nBlockAlign    = channels * bits / 8;
+
+   return( TRUE );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ExpandSound
+
+   Converts companded samples to 16-bit.
+---------------------------------------------------------------------*/
+
+static int MV_ExpandSound
+   (
+   sounddata *sound
+   )
+
+   {
+   const unsigned char *in;
+   const short *table;
+   short       *out;
+   unsigned int i;
+
+   table = ( sound->format.wFormatTag == WAVE_FORMAT_ALAW ) ? MV_ALawTable : MV_MuLawTable;
+
+   out = ( short * )malloc( sound->datalength * sizeof( short ) + 1 );
+   if ( out == NULL )
+      {
+      return( MV_NoMem );
+      }
+
+   MV_InitCompanding();
+
+   in = ( const unsigned char * )sound->data;
+   for( i = 0; i < sound->datalength; i++ )
+      {
+      out[ i ] = table[ in[ i ] ];
+      }
+
+   sound->buffer      = ( char * )out;
+   sound->data        = sound->buffer;
+   sound->datalength *= sizeof( short );
+   sound->format.wFormatTag     = WAVE_FORMAT_PCM;
+   sound->format.nBitsPerSample = 16;
+   sound->format.nBlockAlign    = sound->format.nChannels * 2;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_DecodeSound
+
+   Runs a streamed sound through its decoder into one buffer.  Streams
+   that change format part way are left to play through the decoder.
+---------------------------------------------------------------------*/
+
+static int MV_DecodeSound
+   (
+   sounddata *sound
+   )
+
+   {
+   const MV_Decoder *decoder = sound->decoder;
+   MV_DecoderFormat  format;
+   MV_DecoderFormat  first;
+   void         *state;
+   char         *block;
+   char         *buffer = NULL;
+   char         *grown;
+   unsigned int  used = 0;
+   unsigned int  size = 0;
+   unsigned int  bytes;
+   int           frames;
+   int           status;
+
+   state = malloc( max( decoder->statesize, 1 ) );
+   if ( state == NULL )
+      {
+      return( MV_NoMem );
+      }
+   memset( state, 0, decoder->statesize );
+
+   status = decoder->open( state, sound->ptr, sound->length, &format );
+   if ( status != MV_Ok )
+      {
+      free( state );
+      return( status );
+      }
+   first = format;
+
+   if ( ( format.channels < 1 ) || ( format.channels > 2 ) ||
+      ( ( format.bits != 8 ) && ( format.bits != 16 ) ) || ( format.rate == 0 ) )
+      {
+      status = MV_InvalidDecoder;
+      }
+
+   while( status == MV_Ok )
+      {
+      frames = decoder->decode( state, &block, &format );
+      if ( frames <= 0 )
+         {
+         break;
+         }
+
+      if ( ( format.rate != first.rate ) || ( format.channels != first.channels ) ||
+         ( format.bits != first.bits ) )
+         {
+         status = MV_Error;
+         break;
+         }
+
+      bytes = ( unsigned int )frames * format.channels * format.bits / 8;
+      if ( used + bytes > size )
+         {
+         size  = max( size * 2, used + bytes );
+         grown = ( char * )realloc( buffer, size );
+         if ( grown == NULL )
+            {
+            status = MV_NoMem;
+            break;
+            }
+         buffer = grown;
+         }
+
+      memcpy( buffer + used, block, bytes );
+      used += bytes;
+      }
+
+   if ( decoder->close != NULL )
+      {
+      decoder->close( state );
+      }
+   free( state );
+
+   if ( ( status == MV_Ok ) && ( used == 0 ) )
+      {
+      status = MV_InvalidDecoder;
+      }
+
+   if ( status != MV_Ok )
+      {
+      free( buffer );
+      return( status );
+      }
+
+   memset( &sound->format, 0, sizeof( format_header ) );
+   sound->format.wFormatTag     = WAVE_FORMAT_PCM;
+   sound->format.nChannels      = first.channels;
+   sound->format.nSamplesPerSec = first.rate;
+   sound->format.nBitsPerSample = first.bits;
+   sound->format.nBlockAlign    = first.channels * first.bits / 8;
+
+   sound->buffer     = buffer;
+   sound->data       = buffer;
+   sound->datalength = used;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ResampleSound
+
+   Converts 8 or 16-bit PCM to 16-bit at the specified rate.  Other
+   sounds are left alone.
+---------------------------------------------------------------------*/
+
+static int MV_ResampleSound
+   (
+   sounddata *sound,
+   unsigned int rate
+   )
+
+   {
+   resampler    *rs;
+   float         input[ MixBufferSize * 2 ];
+   float         output[ MixBufferSize * 2 ];
+   short        *out;
+   unsigned int  frames;
+   unsigned int  length;
+   unsigned int  read;
+   unsigned int  made;
+   int           channels;
+   int           count;
+   int           sample;
+   int           i;
+   int           c;
+
+   if ( ( sound->kind != SoundParsed ) ||
+      ( sound->format.wFormatTag != WAVE_FORMAT_PCM ) ||
+      ( ( sound->format.nBitsPerSample != 8 ) &&
+         ( sound->format.nBitsPerSample != 16 ) ) ||
+      ( sound->format.nSamplesPerSec == 0 ) ||
+      ( sound->format.nSamplesPerSec == rate ) )
+      {
+      return( MV_Ok );
+      }
+
+   channels = sound->format.nChannels;
+   frames   = sound->datalength / ( channels * sound->format.nBitsPerSample / 8 );
+   if ( ( double )frames * rate / sound->format.nSamplesPerSec >=
+      0x7fffffff / ( channels * sizeof( short ) ) )
+      {
+      return( MV_NoMem );
+      }
+   length = ( unsigned int )( ( double )frames * rate /
+      sound->format.nSamplesPerSec + 0.5 );
+
+   out = ( short * )malloc( length * channels * sizeof( short ) + 1 );
+   rs  = MV_CreateResampler( sound->format.nSamplesPerSec, rate, channels );
+   if ( ( out == NULL ) || ( rs == NULL ) )
+      {
+      free( out );
+      MV_DestroyResampler( rs );
+      return( MV_NoMem );
+      }
+
+   read = 0;
+   made = 0;
+   while( made < length )
+      {
+      count = MV_ResamplerAvailable( rs );
+      if ( count == 0 )
+         {
+         // Feed more of the sound, then silence to flush the filter
+         count = min( rs->capacity - rs->fill, MixBufferSize );
+         for( i = 0; i < count; i++, read++ )
+            {
+            for( c = 0; c < channels; c++ )
+               {
+               if ( read >= frames )
+                  {
+                  input[ i * channels + c ] = 0.f;
+                  }
+               else if ( sound->format.nBitsPerSample == 16 )
+                  {
+                  input[ i * channels + c ] = ( short )LITTLE16(
+                     ( ( short * )sound->data )[ read * channels + c ] );
+                  }
+               else
+                  {
+                  input[ i * channels + c ] = ( ( ( unsigned char * )
+                     sound->data )[ read * channels + c ] - 128 ) * 256.f;
+                  }
+               }
+            }
+         MV_ResamplerPush( rs, input, count );
+         continue;
+         }
+
+      count = min( count, MixBufferSize );
+      count = min( ( unsigned int )count, length - made );
+      MV_ResamplerPull( rs, output, count );
+      for( i = 0; i < count * channels; i++ )
+         {
+         sample = ( int )floorf( output[ i ] + 0.5f );
+         out[ made * channels + i ] = ( short )min( 32767, max( -32768, sample ) );
+         }
+      made += count;
+      }
+
+   MV_DestroyResampler( rs );
+
+   free( sound->buffer );
+   sound->buffer     = ( char * )out;
+   sound->data       = sound->buffer;
+   sound->datalength = length * channels * sizeof( short );
+   sound->format.nSamplesPerSec = rate;
+   sound->format.nBitsPerSample = 16;
+   sound->format.nBlockAlign    = channels * sizeof( short );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetSound
+
+   Locates the loaded sound with the specified ID.
+---------------------------------------------------------------------*/
+
+static sounddata *MV_GetSound
+   (
+   int id
+   )
+
+   {
+   if ( ( id < 1 ) || ( id > MV_NumSounds ) ||
+      ( MV_Sounds[ id - 1 ].kind == SoundUnused ) )
+      {
+      return( NULL );
+      }
+
+   return( &MV_Sounds[ id - 1 ] );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_AddSound
+
+   Stores a sound in the first free slot of the table, growing it if
+   need be, and returns its ID.
+---------------------------------------------------------------------*/
+
+static int MV_AddSound
+   (
+   const sounddata *sound
+   )
+
+   {
+   sounddata *grown;
+   int        id;
+
+   for( id = 1; id <= MV_NumSounds; id++ )
+      {
+      if ( MV_Sounds[ id - 1 ].kind == SoundUnused )
+         {
+         break;
+         }
+      }
+
+   if ( id > MV_NumSounds )
+      {
+      grown = ( sounddata * )realloc( MV_Sounds,
+         ( MV_NumSounds + MV_SoundGrowth ) * sizeof( sounddata ) );
+      if ( grown == NULL )
+         {
+         MV_SetErrorCode( MV_NoMem );
+         return( MV_Error );
+         }
+      memset( grown + MV_NumSounds, 0, MV_SoundGrowth * sizeof( sounddata ) );
+      MV_Sounds     = grown;
+      MV_NumSounds += MV_SoundGrowth;
+      }
+
+   MV_Sounds[ id - 1 ] = *sound;
+   MV_Sounds[ id - 1 ].refs = 1;
+
+   return( id );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_ReadSound
+
+   Reads a sound's format and does the conversions asked for, short
+   of resampling.
+---------------------------------------------------------------------*/
+
+static int MV_ReadSound
+   (
+   sounddata *sound,
+   char *ptr,
+   unsigned int length,
+   int flags
+   )
+
+   {
+   int status;
+
+   memset( sound, 0, sizeof( sounddata ) );
+   sound->ptr       = ptr;
+   sound->length    = length;
+   sound->flags     = flags;
+   sound->loopstart = -1;
+   sound->loopend   = -1;
+
+   sound->decoder = MV_FindDecoder( ptr, length );
+   if ( sound->decoder == NULL )
+      {
+      MV_SetErrorCode( MV_UnknownFormat );
+      return( MV_Error );
+      }
+
+   sound->kind = SoundDecoded;
+
+   if ( !memcmp( "RIFF", ptr, 4 ) && ( length > 0 ) )
+      {
+      if ( MV_ParseWAV( ptr, length, &sound->format, &sound->data,
+         &sound->datalength ) != MV_Ok )
+         {
+         return( MV_Error );
+         }
+      sound->kind = SoundParsed;
+      }
+   else if ( !memcmp( "Creative Voice File\x1a", ptr, 20 ) && ( length > 0 ) )
+      {
+      if ( MV_ParseVOCBlock( sound ) )
+         {
+         sound->kind = SoundParsed;
+         }
+      }
+   else if ( ( flags & MV_LoadConvert ) && ( sound->decoder->open != NULL ) )
+      {
+      status = MV_DecodeSound( sound );
+      if ( status == MV_Ok )
+         {
+         sound->kind = SoundParsed;
+         }
+      else if ( status != MV_Error )
+         {
+         MV_SetErrorCode( status );
+         return( MV_Error );
+         }
+      }
+
+   if ( sound->kind == SoundParsed )
+      {
+      if ( ( flags & MV_LoadConvert ) &&
+         ( ( sound->format.wFormatTag == WAVE_FORMAT_ALAW ) ||
+         ( sound->format.wFormatTag == WAVE_FORMAT_MULAW ) ) )
+         {
+         status = MV_ExpandSound( sound );
+         if ( status != MV_Ok )
+            {
+            MV_SetErrorCode( status );
+            return( MV_Error );
+            }
+         }
+
+      // IMA ADPCM lengths are left unknown
+      if ( sound->format.wFormatTag != WAVE_FORMAT_IMA_ADPCM )
+         {
+         sound->frames = sound->datalength /
+            ( sound->format.nChannels * sound->format.nBitsPerSample / 8 );
+         }
+      sound->rate = sound->format.nSamplesPerSec;
+
+      if ( !memcmp( "RIFF", ptr, 4 ) )
+         {
+         MV_FindWAVLoop( sound );
+         }
+      }
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UpdateSoundRate
+
+   Resamples a sound loaded for resampling to the current mix rate.
+   A sound resampled to another rate before is read again, so that it
+   is only ever filtered once.
+---------------------------------------------------------------------*/
+
+static int MV_UpdateSoundRate
+   (
+   int id
+   )
+
+   {
+   sounddata *sound;
+   sounddata  fresh;
+   int        status;
+
+   sound = &MV_Sounds[ id - 1 ];
+   if ( !( sound->flags & MV_LoadResample ) || ( sound->kind != SoundParsed ) ||
+      ( sound->format.wFormatTag != WAVE_FORMAT_PCM ) ||
+      ( sound->format.nSamplesPerSec == ( unsigned int )MV_MixRate ) )
+      {
+      return( MV_Ok );
+      }
+
+   if ( sound->format.nSamplesPerSec == sound->rate )
+      {
+      fresh = *sound;
+      }
+   else if ( MV_ReadSound( &fresh, sound->ptr, sound->length, sound->flags ) != MV_Ok )
+      {
+      free( fresh.buffer );
+      return( MV_Error );
+      }
+   else
+      {
+      fresh.refs = sound->refs;
+      free( sound->buffer );
+      sound->buffer = NULL;
+      }
+
+   // No voice should be using the old samples, but make sure
+   if ( MV_Installed )
+      {
+      MV_KillSoundVoices( id );
+      }
+
+   status = MV_ResampleSound( &fresh, MV_MixRate );
+   if ( status != MV_Ok )
+      {
+      // Keep the samples as they are
+      *sound = fresh;
+      MV_SetErrorCode( status );
+      return( MV_Error );
+      }
+
+   *sound = fresh;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_LoadSound
+
+   Reads a sound's format once so that it can be played by ID.  flags
+   may ask for compressed sounds to be decoded now rather than as they
+   play, and for sounds to be resampled to the mix rate, which implies
+   decoding.  Returns the sound's ID, or MV_Error.
+---------------------------------------------------------------------*/
+
+int MV_LoadSound
+   (
+   char *ptr,
+   unsigned int length,
+   int flags
+   )
+
+   {
+   sounddata  sound;
+   int        status;
+   int        id;
+
+   if ( flags & MV_LoadResample )
+      {
+      flags |= MV_LoadConvert;
+      }
+
+   // Converted sounds are shared rather than converted again
+   if ( flags != 0 )
+      {
+      for( id = 1; id <= MV_NumSounds; id++ )
+         {
+         if ( ( MV_Sounds[ id - 1 ].kind != SoundUnused ) &&
+            ( MV_Sounds[ id - 1 ].ptr == ptr ) &&
+            ( MV_Sounds[ id - 1 ].length == length ) &&
+            ( MV_Sounds[ id - 1 ].flags == flags ) )
+            {
+            MV_Sounds[ id - 1 ].refs++;
+            return( id );
+            }
+         }
+      }
+
+   if ( MV_ReadSound( &sound, ptr, length, flags ) != MV_Ok )
+      {
+      free( sound.buffer );
+      return( MV_Error );
+      }
+
+   if ( ( flags & MV_LoadResample ) && MV_Installed )
+      {
+      status = MV_ResampleSound( &sound, MV_MixRate );
+      if ( status != MV_Ok )
+         {
+         free( sound.buffer );
+         MV_SetErrorCode( status );
+         return( MV_Error );
+         }
+      }
+
+   id = MV_AddSound( &sound );
+   if ( id == MV_Error )
+      {
+      free( sound.buffer );
+      }
+
+   return( id );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_LoadBank
+
+   Loads every sound in a packed bank, storing their IDs in index
+   order.  The sounds play straight from the bank, which must stay in
+   memory while they are loaded.  Returns the number of sounds, or
+   MV_Error.
+---------------------------------------------------------------------*/
+
+int MV_LoadBank
+   (
+   char *ptr,
+   unsigned int length,
+   int *ids,
+   int maxids
+   )
+
+   {
+   bank_header header;
+   bank_entry  entry;
+   sounddata   sound;
+   int         count;
+   int         i;
+
+   if ( length < sizeof( bank_header ) )
+      {
+      MV_SetErrorCode( MV_InvalidBank );
+      return( MV_Error );
+      }
+
+   memcpy( &header, ptr, sizeof( bank_header ) );
+   header.version     = LITTLE16( header.version );
+   header.count       = LITTLE16( header.count );
+   header.indexoffset = LITTLE32( header.indexoffset );
+   header.length      = LITTLE32( header.length );
+
+   if ( ( memcmp( header.magic, BANK_MAGIC, 4 ) != 0 ) ||
+      ( header.version != BANK_VERSION ) || ( header.length > length ) ||
+      ( header.indexoffset > header.length ) ||
+      ( header.count > ( header.length - header.indexoffset ) / sizeof( bank_entry ) ) )
+      {
+      MV_SetErrorCode( MV_InvalidBank );
+      return( MV_Error );
+      }
+
+   count = min( ( int )header.count, maxids );
+   for( i = 0; i < count; i++ )
+      {
+      memcpy( &entry, ptr + header.indexoffset + i * sizeof( bank_entry ),
+         sizeof( bank_entry ) );
+      entry.offset     = LITTLE32( entry.offset );
+      entry.length     = LITTLE32( entry.length );
+      entry.rate       = LITTLE32( entry.rate );
+      entry.frames     = LITTLE32( entry.frames );
+      entry.loopstart  = LITTLE32( entry.loopstart );
+      entry.loopend    = LITTLE32( entry.loopend );
+      entry.format     = LITTLE16( entry.format );
+      entry.blockalign = LITTLE16( entry.blockalign );
+
+      memset( &sound, 0, sizeof( sound ) );
+      sound.ptr        = ptr + entry.offset;
+      sound.length     = entry.length;
+      sound.data       = sound.ptr;
+      sound.datalength = entry.length;
+      sound.frames     = entry.frames;
+      sound.loopstart  = entry.loopstart;
+      sound.loopend    = entry.loopend;
+
+      sound.format.wFormatTag     = entry.format;
+      sound.format.nChannels      = entry.channels;
+      sound.format.nSamplesPerSec = entry.rate;
+      sound.rate                  = entry.rate;
+      sound.format.nBitsPerSample = entry.bits;
+      sound.format.nBlockAlign    = entry.blockalign;
+
+      if ( ( entry.offset > header.length ) ||
+         ( entry.length > header.length - entry.offset ) )
+         {
+         sound.kind = SoundUnused;
+         }
+      else if ( entry.format == BANK_FORMAT_STREAM )
+         {
+         sound.decoder = MV_FindDecoder( sound.ptr, sound.length );
+         sound.kind    = ( sound.decoder != NULL ) ? SoundDecoded : SoundUnused;
+         }
+      else if ( ( ( entry.format == WAVE_FORMAT_PCM ) &&
+            ( ( entry.bits == 8 ) || ( entry.bits == 16 ) ) ) ||
+         ( ( ( entry.format == WAVE_FORMAT_ALAW ) ||
+            ( entry.format == WAVE_FORMAT_MULAW ) ) && ( entry.bits == 8 ) ) ||
+         ( ( entry.format == WAVE_FORMAT_IMA_ADPCM ) && ( entry.bits == 4 ) &&
+            ( entry.blockalign > 4 * entry.channels ) ) )
+         {
+         sound.kind = SoundParsed;
+         }
+
+      if ( ( entry.channels < 1 ) || ( entry.channels > 2 ) ||
+         ( ( sound.kind == SoundParsed ) && ( entry.rate == 0 ) ) )
+         {
+         sound.kind = SoundUnused;
+         }
+
+      if ( sound.kind == SoundUnused )
+         {
+         MV_SetErrorCode( MV_InvalidBank );
+         ids[ i ] = MV_Error;
+         }
+      else
+         {
+         ids[ i ] = MV_AddSound( &sound );
+         }
+
+      if ( ids[ i ] == MV_Error )
+         {
+         while( i-- > 0 )
+            {
+            MV_UnloadSound( ids[ i ] );
+            }
+         return( MV_Error );
+         }
+      }
+
+   return( count );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UnloadSound
+
+   Stops any voices playing a loaded sound and forgets it, once it has
+   been unloaded as many times as it was loaded.
+---------------------------------------------------------------------*/
+
+int MV_UnloadSound
+   (
+   int id
+   )
+
+   {
+   sounddata *sound;
+
+   sound = MV_GetSound( id );
+   if ( sound == NULL )
+      {
+      MV_SetErrorCode( MV_InvalidSound );
+      return( MV_Error );
+      }
+
+   if ( --sound->refs > 0 )
+      {
+      return( MV_Ok );
+      }
+
+   if ( MV_Installed )
+      {
+      MV_KillSoundVoices( id );
+      }
+
+   free( sound->buffer );
+   memset( sound, 0, sizeof( sounddata ) );
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_UnloadAllSounds
+
+   Unloads every loaded sound.
+---------------------------------------------------------------------*/
+
+void MV_UnloadAllSounds
+   (
+   void
+   )
+
+   {
+   int id;
+
+   for( id = 1; id <= MV_NumSounds; id++ )
+      {
+      if ( MV_Sounds[ id - 1 ].kind != SoundUnused )
+         {
+         MV_Sounds[ id - 1 ].refs = 1;
+         MV_UnloadSound( id );
+         }
+      }
+
+   free( MV_Sounds );
+   MV_Sounds    = NULL;
+   MV_NumSounds = 0;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetSoundInfo
+
+   Reports a loaded sound's sample rate, channels and length in sample
+   frames.  Whatever is not known until the sound plays is zero.
+---------------------------------------------------------------------*/
+
+int MV_GetSoundInfo
+   (
+   int id,
+   unsigned int *rate,
+   int *channels,
+   unsigned int *frames
+   )
+
+   {
+   sounddata *sound;
+
+   sound = MV_GetSound( id );
+   if ( sound == NULL )
+      {
+      MV_SetErrorCode( MV_InvalidSound );
+      return( MV_Error );
+      }
+
+   // Streamed sounds only know this much when it came from a bank
+   *rate     = sound->rate;
+   *channels = sound->format.nChannels;
+   *frames   = sound->frames;
+
+   return( MV_Ok );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartSound
+
+   Begin playback of a loaded sound, tagging the voice with the sound
+   so unloading it stops the voice, and placing it at angle, or by its
+   levels if angle is -1.
+---------------------------------------------------------------------*/
+
+static int MV_StartSound
+   (
+   int   id,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval,
+   int   angle
+   )
+
+   {
+   sounddata *sound;
+   voicestart start;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   sound = MV_GetSound( id );
+   if ( sound == NULL )
+      {
+      MV_SetErrorCode( MV_InvalidSound );
+      return( MV_Error );
+      }
+
+   if ( MV_UpdateSoundRate( id ) != MV_Ok )
+      {
+      return( MV_Error );
+      }
+
+   start.angle = angle;
+   start.sound = id;
+   start.file  = NULL;
+   if ( sound->kind == SoundParsed )
+      {
+      // Loops are given at the file's rate
+      if ( ( sound->format.nSamplesPerSec != sound->rate ) && ( sound->rate > 0 ) )
+         {
+         if ( loopstart >= 0 )
+            {
+            loopstart = ( int )( ( double )loopstart *
+               sound->format.nSamplesPerSec / sound->rate + 0.5 );
+            }
+         if ( loopend >= 0 )
+            {
+            loopend = ( int )( ( double )loopend *
+               sound->format.nSamplesPerSec / sound->rate + 0.5 );
+            }
+         }
+
+      return( MV_PlayParsedWAV( sound->ptr, &sound->format, sound->data,
+         sound->datalength, loopstart, loopend, pitchoffset, vol, left, right,
+         priority, callbackval, &start ) );
+      }
+
+   return( MV_StartDecoder( sound->decoder, sound->ptr, sound->length,
+      loopstart, loopend, pitchoffset, vol, left, right, priority, callbackval,
+      &start ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlayLoopedSound
+
+   Begin playback of a loaded sound with the given sound levels and
+   priority.  loopstart and loopend are in sample frames.
+---------------------------------------------------------------------*/
+
+int MV_PlayLoopedSound
+   (
+   int   id,
+   int   loopstart,
+   int   loopend,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   return( MV_StartSound( id, loopstart, loopend, pitchoffset, vol, left,
+      right, priority, callbackval, -1 ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlaySound
+
+   Begin playback of a loaded sound with the given sound levels and
+   priority, looping it if the file gave a loop.
+---------------------------------------------------------------------*/
+
+int MV_PlaySound
+   (
+   int   id,
+   int   pitchoffset,
+   int   vol,
+   int   left,
+   int   right,
+   int   priority,
+   unsigned int callbackval
+   )
+
+   {
+   sounddata *sound;
+
+   sound = MV_GetSound( id );
+   if ( sound == NULL )
+      {
+      MV_SetErrorCode( MV_InvalidSound );
+      return( MV_Error );
+      }
+
+   return( MV_PlayLoopedSound( id, sound->loopstart, sound->loopend, pitchoffset,
+      vol, left, right, priority, callbackval ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_PlaySound3D
+
+   Begin playback of a loaded sound at specified angle and distance
+   from listener.
+---------------------------------------------------------------------*/
+
+int MV_PlaySound3D
+   (
+   int  id,
+   int  pitchoffset,
+   int  angle,
+   int  distance,
+   int  priority,
+   unsigned int callbackval
+   )
+
+   {
+   int left;
+   int right;
+   int mid;
+   int volume;
+   sounddata *sound;
+
+   if ( !MV_Installed )
+      {
+      MV_SetErrorCode( MV_NotInstalled );
+      return( MV_Error );
+      }
+
+   sound = MV_GetSound( id );
+   if ( sound == NULL )
+      {
+      MV_SetErrorCode( MV_InvalidSound );
+      return( MV_Error );
+      }
+
+   if ( distance < 0 )
+      {
+      distance  = -distance;
+      angle    += MV_NumPanPositions / 2;
+      }
+
+   volume = MIX_VOLUME( distance );
+
+   // Ensure angle is within 0 - 31
+   angle &= MV_MaxPanPosition;
+
+   left  = MV_PanTable[ angle ][ volume ].left;
+   right = MV_PanTable[ angle ][ volume ].right;
+   mid   = max( 0, 255 - distance );
+
+   return( MV_StartSound( id, sound->loopstart, sound->loopend, pitchoffset,
+      mid, left, right, priority, callbackval, angle ) );
+   }
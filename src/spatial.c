@@ -0,0 +1,194 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Float positional audio: speaker panning, distance attenuation and
+ * Doppler shift for emitters relative to the listener
+ *
+ * Azimuths are in radians clockwise from straight ahead, so the right
+ * side is positive. Elevation is dropped: an emitter is panned by its
+ * projection onto the listener's horizontal plane.
+ */
+
+#include <math.h>
+#include "multivoc.h"
+#include "_multivc.h"
+
+// speaker azimuths in degrees, in the channel order SDL uses;
+// 999 marks the LFE channel, which gets no panned signal
+static const int quad[] = { -45, 45, -135, 135 };
+static const int surround51[] = { -30, 30, 0, 999, -110, 110 };
+static const int surround71[] = { -30, 30, 0, 999, -150, 150, -90, 90 };
+
+/*
+ Pans between the pair of adjacent speakers around the azimuth (vector
+ base amplitude panning), keeping the power constant.
+ */
+static void pan_vbap(double theta, const int *layout, int channels, float *gains)
+{
+    double best = 2.0 * PI, gi = 1.0, gj = 0.0, ti, tj, span, a, b, power;
+    int i, j, pi = 0, pj = 0;
+
+    // the narrowest pair whose arc holds the source is an adjacent one
+    for (i = 0; i < channels; i++) {
+        for (j = i + 1; j < channels; j++) {
+            if (layout[i] == 999 || layout[j] == 999) {
+                continue;
+            }
+
+            ti = layout[i] * PI / 180.0;
+            tj = layout[j] * PI / 180.0;
+            span = fabs(atan2(sin(ti - tj), cos(ti - tj)));
+            if (span >= best || span > PI - 0.001) {
+                continue;
+            }
+
+            a = sin(theta - tj) / sin(ti - tj);
+            b = sin(ti - theta) / sin(ti - tj);
+            if (a < -1e-6 || b < -1e-6) {
+                continue;
+            }
+
+            best = span;
+            pi = i;
+            pj = j;
+            gi = a > 0.0 ? a : 0.0;
+            gj = b > 0.0 ? b : 0.0;
+        }
+    }
+
+    power = sqrt(gi * gi + gj * gj);
+    for (i = 0; i < channels; i++) {
+        gains[i] = 0.f;
+    }
+    gains[pi] = (float) (gi / power);
+    gains[pj] = (float) (gj / power);
+}
+
+/*
+ Fills gains[channels] for a source at the given azimuth. Stereo uses
+ a constant power pan law on the left-right component; mono gets
+ unity gain.
+ */
+void MV_PanGains(double azimuth, int channels, float *gains)
+{
+    double phi;
+    int c;
+
+    switch (channels) {
+        case 4:
+            pan_vbap(azimuth, quad, channels, gains);
+            break;
+        case 6:
+            pan_vbap(azimuth, surround51, channels, gains);
+            break;
+        case 8:
+            pan_vbap(azimuth, surround71, channels, gains);
+            break;
+        case 2:
+            phi = (sin(azimuth) + 1.0) * PI / 4.0;
+            gains[0] = (float) cos(phi);
+            gains[1] = (float) sin(phi);
+            break;
+        default:
+            for (c = 0; c < channels; c++) {
+                gains[c] = 1.f;
+            }
+            break;
+    }
+}
+
+/*
+ Returns the gain of the attenuation curve at a distance. The inverse
+ and linear models clamp the distance to the reference and maximum
+ distances.
+ */
+float MV_AttenuationGain(const attenuation *curve, float distance)
+{
+    float ref = curve->refdistance, max = curve->maxdistance;
+    float d = distance;
+
+    switch (curve->model) {
+        case MV_AttenuateInverse:
+            d = d < ref ? ref : d > max ? max : d;
+            return ref / (ref + curve->rolloff * (d - ref));
+
+        case MV_AttenuateLinear:
+            d = d < ref ? ref : d > max ? max : d;
+            if (max <= ref) {
+                return 1.f;
+            }
+            d = 1.f - curve->rolloff * (d - ref) / (max - ref);
+            return d > 0.f ? d : 0.f;
+
+        case MV_AttenuateExponential:
+            d = d < ref ? ref : d;
+            return powf(d / ref, -curve->rolloff);
+
+        default:
+            return 1.f;
+    }
+}
+
+/*
+ Works out the azimuth, level and speaker gains of an emitter and
+ returns the ratio its pitch is shifted by. mirror swaps left and
+ right.
+ */
+float MV_UpdateEmitter(emitter *em, const listener *lis, const attenuation *curve,
+    float doppler, float speed, int channels, int mirror)
+{
+    float rel[3], x, z, distance, gain, vl, vs, limit;
+    int c;
+
+    for (c = 0; c < 3; c++) {
+        rel[c] = em->position[c] - lis->position[c];
+    }
+    distance = sqrtf(rel[0] * rel[0] + rel[1] * rel[1] + rel[2] * rel[2]);
+
+    x = rel[0] * lis->right[0] + rel[1] * lis->right[1] + rel[2] * lis->right[2];
+    z = rel[0] * lis->forward[0] + rel[1] * lis->forward[1] + rel[2] * lis->forward[2];
+    if (mirror) {
+        x = -x;
+    }
+
+    em->azimuth = (x == 0.f && z == 0.f) ? 0.f : atan2f(x, z);
+    MV_PanGains(em->azimuth, channels, em->gains);
+
+    gain = MV_AttenuationGain(curve, distance);
+    em->level = gain;
+    for (c = 0; c < channels; c++) {
+        em->gains[c] *= gain;
+    }
+
+    if (doppler <= 0.f || distance <= 0.f) {
+        return 1.f;
+    }
+
+    // velocities along the line from the emitter to the listener,
+    // held below the speed of sound so the ratio stays finite
+    vl = -(lis->velocity[0] * rel[0] + lis->velocity[1] * rel[1] + lis->velocity[2] * rel[2]) / distance;
+    vs = -(em->velocity[0] * rel[0] + em->velocity[1] * rel[1] + em->velocity[2] * rel[2]) / distance;
+    limit = speed / doppler * 0.99f;
+    vl = vl > limit ? limit : vl < -limit ? -limit : vl;
+    vs = vs > limit ? limit : vs < -limit ? -limit : vs;
+
+    return (speed - doppler * vl) / (speed - doppler * vs);
+}
@@ -0,0 +1,204 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ */
+
+/**
+ * Worker threads that read and decode file voices ahead of the mixer
+ *
+ * The pool starts with the first file played and stops at shutdown.
+ * Each streamed voice is given to one worker, which keeps its next
+ * block decoded. Workers poll their voices every few milliseconds
+ * rather than wait to be woken, so the mixer never takes a lock or
+ * makes a system call to hand a block back.
+ */
+
+#ifndef _WIN32
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <pthread.h>
+#endif
+#include "multivoc.h"
+#include "_multivc.h"
+#include "asssys.h"
+#include "assmisc.h"
+
+#ifdef _WIN32
+static HANDLE    MV_StreamThread[ MV_MaxStreamThreads ];
+#else
+static pthread_t MV_StreamThread[ MV_MaxStreamThreads ];
+#endif
+
+static int          MV_StreamThreads = MV_DefaultStreamThreads;
+static int          MV_StreamQuit = FALSE;
+
+// workers running, which serve streamed voices
+int MV_StreamWorkers = 0;
+
+// times a streamed voice ran out of samples
+volatile int MV_StreamStarvation = 0;
+
+
+#ifdef _WIN32
+static DWORD WINAPI MV_StreamProc( LPVOID arg )
+#else
+static void *MV_StreamProc( void *arg )
+#endif
+{
+   int worker = ( int )( intptr_t )arg;
+
+   while ( !MV_LoadAcquire( MV_StreamQuit ) ) {
+      MV_ServiceDecoderStreams( worker );
+      ASS_Sleep( MV_StreamPollTime );
+   }
+
+   return 0;
+}
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StartStreamThreads
+
+   Starts the stream workers if they are not running yet, and returns
+   how many there are.
+---------------------------------------------------------------------*/
+
+int MV_StartStreamThreads
+   (
+   void
+   )
+
+   {
+   int worker;
+   int started;
+
+   if ( ( MV_StreamWorkers > 0 ) || ( MV_StreamThreads == 0 ) )
+      {
+      return( MV_StreamWorkers );
+      }
+
+   MV_StreamQuit = FALSE;
+   for( worker = 0; worker < MV_StreamThreads; worker++ )
+      {
+#ifdef _WIN32
+      MV_StreamThread[ worker ] = CreateThread( NULL, 0, MV_StreamProc,
+         ( LPVOID )( intptr_t )worker, 0, NULL );
+      started = ( MV_StreamThread[ worker ] != NULL );
+#else
+      started = ( pthread_create( &MV_StreamThread[ worker ], NULL,
+         MV_StreamProc, ( void * )( intptr_t )worker ) == 0 );
+#endif
+      if ( !started )
+         {
+         ASS_Message( "MV_StartStreamThreads: could not start worker %d\n", worker );
+         break;
+         }
+      }
+
+   MV_StreamStarvation = 0;
+   MV_StreamWorkers    = worker;
+
+   return( MV_StreamWorkers );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_StopStreamThreads
+
+   Waits for the stream workers to finish.  Streamed voices stopped
+   since they last ran are closed by MV_FreeDecoderStates.
+---------------------------------------------------------------------*/
+
+void MV_StopStreamThreads
+   (
+   void
+   )
+
+   {
+   int worker;
+
+   MV_StoreRelease( MV_StreamQuit, TRUE );
+   for( worker = 0; worker < MV_StreamWorkers; worker++ )
+      {
+#ifdef _WIN32
+      WaitForSingleObject( MV_StreamThread[ worker ], INFINITE );
+      CloseHandle( MV_StreamThread[ worker ] );
+#else
+      pthread_join( MV_StreamThread[ worker ], NULL );
+#endif
+      }
+
+   MV_StreamWorkers = 0;
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_SetStreamThreads
+
+   Sets how many worker threads stream files the next time they
+   start.  With none, files play straight from their mapping in the
+   mixer.
+---------------------------------------------------------------------*/
+
+void MV_SetStreamThreads
+   (
+   int threads
+   )
+
+   {
+   MV_StreamThreads = max( 0, min( threads, MV_MaxStreamThreads ) );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetStreamThreads
+
+   Returns how many worker threads stream files.
+---------------------------------------------------------------------*/
+
+int MV_GetStreamThreads
+   (
+   void
+   )
+
+   {
+   return( MV_StreamThreads );
+   }
+
+
+/*---------------------------------------------------------------------
+   Function: MV_GetStreamStarvation
+
+   Returns how many times a streamed voice has gone silent waiting for
+   its worker since the workers started.
+---------------------------------------------------------------------*/
+
+int MV_GetStreamStarvation
+   (
+   void
+   )
+
+   {
+   return( MV_StreamStarvation );
+   }
@@ -20,6 +20,10 @@
 
 /**
  * OggVorbis source support for MultiVoc
+ *
+ * Plays through the decoder registry. A new logical bitstream always
+ * starts a new block, so a change of format applies from its first
+ * sample; samples of it read along with the old one are held over.
  */
 
 #ifdef HAVE_VORBIS
@@ -51,6 +55,10 @@ typedef struct {
    
    char block[0x8000];
    int lastbitstream;
+   int carry;
+   int carryoffset;
+   int carrystream;
+   int open;
 } vorbis_data;
 
 static size_t read_vorbis(void * ptr, size_t size, size_t nmemb, void * datasource)
@@ -126,87 +134,178 @@ static ov_callbacks vorbis_callbacks = {
 
 
 /*---------------------------------------------------------------------
-Function: MV_GetNextVorbisBlock
+Function: Vorbis_Probe
 
-Controls playback of OggVorbis data
+Recognises an Ogg stream.
 ---------------------------------------------------------------------*/
 
-static playbackstatus MV_GetNextVorbisBlock
-(
- VoiceNode *voice
- )
+static int Vorbis_Probe(const char * ptr, unsigned int length)
+{
+   return length >= 4 && !memcmp(ptr, "OggS", 4);
+}
+
+
+/*---------------------------------------------------------------------
+Function: Vorbis_Format
+
+Reports the format of the current logical bitstream.
+---------------------------------------------------------------------*/
+
+static int Vorbis_Format(vorbis_data * vd, MV_DecoderFormat * format)
+{
+   vorbis_info * vi = ov_info(&vd->vf, -1);
+
+   if (!vi || (vi->channels != 1 && vi->channels != 2)) {
+      return 0;
+   }
+
+   format->rate = (unsigned)vi->rate;
+   format->channels = vi->channels;
+   format->bits = 16;
+
+   return 1;
+}
+
+
+/*---------------------------------------------------------------------
+Function: Vorbis_Open
+
+Opens the stream and reports its format.
+---------------------------------------------------------------------*/
+
+static int Vorbis_Open(void * state, char * ptr, unsigned int length, MV_DecoderFormat * format)
+{
+   vorbis_data * vd = (vorbis_data *) state;
+   int status;
+
+   vd->ptr = ptr;
+   vd->pos = 0;
+   vd->length = length;
+   vd->lastbitstream = 0;
+
+   status = ov_open_callbacks((void *) vd, &vd->vf, 0, 0, vorbis_callbacks);
+   if (status < 0) {
+      ASS_Message("Vorbis_Open: err %d\n", status);
+      return MV_InvalidVorbisFile;
+   }
+
+   if (!Vorbis_Format(vd, format)) {
+      ov_clear(&vd->vf);
+      return MV_InvalidVorbisFile;
+   }
+   vd->open = 1;
+
+   return MV_Ok;
+}
+
+
+/*---------------------------------------------------------------------
+Function: Vorbis_Decode
+
+Decodes the next block of samples.
+---------------------------------------------------------------------*/
 
+static int Vorbis_Decode(void * state, char ** block, MV_DecoderFormat * format)
 {
-   vorbis_data * vd = (vorbis_data *) voice->extra;
+   vorbis_data * vd = (vorbis_data *) state;
    int bytes = 0, bytesread = 0;
-   int bitstream = 0, err = 0;
+   int bitstream = 0;
+
+   if (vd->carry > 0) {
+      // the first samples of a new bitstream held over from last time
+      memmove(vd->block, vd->block + vd->carryoffset, vd->carry);
+      bytesread = vd->carry;
+      vd->carry = 0;
+      if (!Vorbis_Format(vd, format)) {
+         return 0;
+      }
+      vd->lastbitstream = vd->carrystream;
+   }
 
-   voice->Playing = TRUE;
-   
-   bytesread = 0;
-   do {
+   while (bytesread < (int)sizeof(vd->block)) {
       bytes = (int)ov_read(&vd->vf, vd->block + bytesread, sizeof(vd->block) - bytesread, 0, 2, 1, &bitstream);
       //ASS_Message("ov_read = %d\n", bytes);
       if (bytes == OV_HOLE) continue;
       if (bytes == 0) {
-         if (voice->LoopCount) {
-            err = ov_pcm_seek_page(&vd->vf, 0);
-            if (err != 0) {
-               ASS_Message("MV_GetNextVorbisBlock ov_pcm_seek_page: err %d\n", err);
-            } else {
-               continue;
-            }
-         } else {
-           break;
-         }
+         break;
       } else if (bytes < 0) {
-         ASS_Message("MV_GetNextVorbisBlock ov_read: err %d\n", bytes);
-         voice->Playing = FALSE;
-         return NoMoreData;
+         ASS_Message("Vorbis_Decode ov_read: err %d\n", bytes);
+         return 0;
+      }
+
+      if (bitstream != vd->lastbitstream) {
+         // a new bitstream may change format, so it starts a new block
+         if (bytesread > 0) {
+            vd->carry = bytes;
+            vd->carryoffset = bytesread;
+            vd->carrystream = bitstream;
+            break;
+         }
+         if (!Vorbis_Format(vd, format)) {
+            return 0;
+         }
+         vd->lastbitstream = bitstream;
       }
 
       bytesread += bytes;
-   } while (bytesread < (int)sizeof(vd->block));
+   }
+
+   *block = vd->block;
+   return bytesread / (2 * format->channels);
+}
+
+
+/*---------------------------------------------------------------------
+Function: Vorbis_Seek
+
+Moves decoding to the given sample frame.
+---------------------------------------------------------------------*/
+
+static int Vorbis_Seek(void * state, unsigned int frame)
+{
+   vorbis_data * vd = (vorbis_data *) state;
+   int err;
 
-   if (bytesread == 0) {
-      voice->Playing = FALSE;
-      return NoMoreData;
+   vd->carry = 0;
+   err = ov_pcm_seek(&vd->vf, frame);
+   if (err != 0) {
+      ASS_Message("Vorbis_Seek ov_pcm_seek: err %d\n", err);
+      return MV_Error;
    }
-      
-   if (bitstream != vd->lastbitstream) {
-      vorbis_info * vi = 0;
-      
-      vi = ov_info(&vd->vf, -1);
-      if (!vi) {
-         voice->Playing = FALSE;
-         return NoMoreData;
-      }
-      
-      if (vi->channels != 1 && vi->channels != 2) {
-         voice->Playing = FALSE;
-         return NoMoreData;
-      }
-      
-      voice->channels = vi->channels;
-      voice->SamplingRate = (unsigned)vi->rate;
-      voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
-      voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
-         voice->RateScale;
-      MV_SetVoiceMixMode( voice );
+
+   return MV_Ok;
+}
+
+
+/*---------------------------------------------------------------------
+Function: Vorbis_Close
+
+Closes the stream.
+---------------------------------------------------------------------*/
+
+static void Vorbis_Close(void * state)
+{
+   vorbis_data * vd = (vorbis_data *) state;
+
+   if (vd->open) {
+      ov_clear(&vd->vf);
+      vd->open = 0;
    }
-   vd->lastbitstream = bitstream;
-   
-   bytesread /= 2 * voice->channels;
-   
-   voice->position    = 0;
-   voice->sound       = vd->block;
-   voice->BlockLength = 0;
-   voice->length      = bytesread << 16;
-   
-   return( KeepPlaying );
 }
 
 
+const MV_Decoder MV_VorbisDecoder = {
+   "Vorbis",
+   Vorbis_Probe,
+   NULL,
+   sizeof(vorbis_data),
+   Vorbis_Open,
+   Vorbis_Decode,
+   Vorbis_Seek,
+   Vorbis_Close
+};
+
+
 /*---------------------------------------------------------------------
 Function: MV_PlayVorbis3D
 
@@ -226,37 +325,8 @@ int MV_PlayVorbis3D
  )
 
 {
-   int left;
-   int right;
-   int mid;
-   int volume;
-   int status;
-   
-   if ( !MV_Installed )
-   {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-   }
-   
-   if ( distance < 0 )
-   {
-      distance  = -distance;
-      angle    += MV_NumPanPositions / 2;
-   }
-   
-   volume = MIX_VOLUME( distance );
-   
-   // Ensure angle is within 0 - 31
-   angle &= MV_MaxPanPosition;
-   
-   left  = MV_PanTable[ angle ][ volume ].left;
-   right = MV_PanTable[ angle ][ volume ].right;
-   mid   = max( 0, 255 - distance );
-   
-   status = MV_PlayVorbis( ptr, ptrlength, pitchoffset, mid, left, right, priority,
-                           callbackval );
-   
-   return( status );
+   return( MV_PlayDecoder3D( &MV_VorbisDecoder, ptr, ptrlength, pitchoffset,
+                             angle, distance, priority, callbackval ) );
 }
 
 
@@ -280,12 +350,9 @@ int MV_PlayVorbis
  )
 
 {
-   int status;
-   
-   status = MV_PlayLoopedVorbis( ptr, ptrlength, -1, -1, pitchoffset, vol, left, right,
-                                 priority, callbackval );
-   
-   return( status );
+   return( MV_PlayLoopedDecoder( &MV_VorbisDecoder, ptr, ptrlength, -1, -1,
+                                 pitchoffset, vol, left, right, priority,
+                                 callbackval ) );
 }
 
 
@@ -293,7 +360,7 @@ int MV_PlayVorbis
 Function: MV_PlayLoopedVorbis
 
 Begin playback of sound data with the given sound levels and
-priority.
+priority. loopstart and loopend are in sample frames.
 ---------------------------------------------------------------------*/
 
 int MV_PlayLoopedVorbis
@@ -311,109 +378,9 @@ int MV_PlayLoopedVorbis
  )
 
 {
-   VoiceNode   *voice;
-   int          status;
-   vorbis_data * vd = 0;
-   vorbis_info * vi = 0;
-
-   (void)loopend;
-
-   if ( !MV_Installed )
-   {
-      MV_SetErrorCode( MV_NotInstalled );
-      return( MV_Error );
-   }
-   
-   vd = (vorbis_data *) malloc( sizeof(vorbis_data) );
-   if (!vd) {
-      MV_SetErrorCode( MV_InvalidVorbisFile );
-      return MV_Error;
-   }
-   
-   memset(vd, 0, sizeof(vorbis_data));
-   vd->ptr = ptr;
-   vd->pos = 0;
-   vd->length = ptrlength;
-   vd->lastbitstream = -1;
-   
-   status = ov_open_callbacks((void *) vd, &vd->vf, 0, 0, vorbis_callbacks);
-   if (status < 0) {
-      ASS_Message("MV_PlayLoopedVorbis: err %d\n", status);
-      MV_SetErrorCode( MV_InvalidVorbisFile );
-      return MV_Error;
-   }
-   
-   vi = ov_info(&vd->vf, 0);
-   if (!vi) {
-      ov_clear(&vd->vf);
-      free(vd);
-      MV_SetErrorCode( MV_InvalidVorbisFile );
-      return MV_Error;
-   }
-   
-   if (vi->channels != 1 && vi->channels != 2) {
-      ov_clear(&vd->vf);
-      free(vd);
-      MV_SetErrorCode( MV_InvalidVorbisFile );
-      return MV_Error;
-   }
-   
-   // Request a voice from the voice pool
-   voice = MV_AllocVoice( priority );
-   if ( voice == NULL )
-   {
-      ov_clear(&vd->vf);
-      free(vd);
-      MV_SetErrorCode( MV_NoVoices );
-      return( MV_Error );
-   }
-   
-   voice->wavetype    = Vorbis;
-   voice->bits        = 16;
-   voice->channels    = vi->channels;
-   voice->extra       = (void *) vd;
-   voice->GetSound    = MV_GetNextVorbisBlock;
-   voice->NextBlock   = vd->block;
-   voice->DemandFeed  = NULL;
-   voice->LoopCount   = (loopstart >= 0 ? TRUE : FALSE);
-   voice->BlockLength = 0;
-   voice->PitchScale  = PITCH_GetScale( pitchoffset );
-   voice->length      = 0;
-   voice->next        = NULL;
-   voice->prev        = NULL;
-   voice->priority    = priority;
-   voice->callbackval = callbackval;
-   voice->LoopStart   = 0;
-   voice->LoopEnd     = 0;
-   voice->LoopSize    = 0;
-   voice->Playing     = TRUE;
-   voice->Paused      = FALSE;
-   
-   voice->SamplingRate = (unsigned)vi->rate;
-   voice->RateScale    = ( voice->SamplingRate * voice->PitchScale ) / MV_MixRate;
-   voice->FixedPointBufferSize = ( voice->RateScale * MixBufferSize ) -
-      voice->RateScale;
-   MV_SetVoiceMixMode( voice );
-
-   MV_SetVoiceVolume( voice, vol, left, right );
-   MV_PlayVoice( voice );
-   
-   return( voice->handle );
-}
-
-
-void MV_ReleaseVorbisVoice( VoiceNode * voice )
-{
-   vorbis_data * vd = (vorbis_data *) voice->extra;
-   
-   if (voice->wavetype != Vorbis) {
-      return;
-   }
-   
-   ov_clear(&vd->vf);
-   free(vd);
-   
-   voice->extra = 0;
+   return( MV_PlayLoopedDecoder( &MV_VorbisDecoder, ptr, ptrlength, loopstart,
+                                 loopend, pitchoffset, vol, left, right,
+                                 priority, callbackval ) );
 }
 
 #endif //HAVE_VORBIS
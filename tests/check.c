@@ -0,0 +1,299 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+ 
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ 
+ See the GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ 
+ */
+
+/**
+ * Regression checks, run with "make check"
+ *
+ * Each check starts the library on the test driver, drives the mixer
+ * by hand and reports what it expected and what it got.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fx_man.h"
+#include "sndcards.h"
+#include "multivoc.h"
+#include "_multivc.h"
+#include "testdrv.h"
+
+static int failures = 0;
+
+#define expect(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static int startup(void)
+{
+    int channels = 2, bits = 16, rate = 44100;
+
+    if (FX_Init(ASS_NoSound, 8, &channels, &bits, &rate, 0) != FX_Ok) {
+        printf("  FAIL FX_Init: %s\n", FX_ErrorString(FX_Error));
+        failures++;
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Queue states are pooled. Stopping queues, with or without buffers
+ * left to take back, must not grow the pool once the caller has all
+ * its buffers.
+ */
+static void check_queue_pool(void)
+{
+    static short samples[4][256];
+    char *buffers[4];
+    int i, j, handle;
+
+    if (!startup()) {
+        return;
+    }
+
+    for (i = 0; i < 1000; i++) {
+        handle = FX_StartQueuedPlayback(44100, 16, 1, 0, 255, 255, 255, 1, 0);
+        expect(handle > 0, "queue %d did not start: %s", i, FX_ErrorString(FX_Error));
+        if (handle <= 0) {
+            break;
+        }
+
+        // Every other queue gets buffers, some of them played
+        if (i & 1) {
+            for (j = 0; j < 4; j++) {
+                FX_QueueBuffer(handle, (char *)samples[j], sizeof(samples[j]));
+            }
+            if (i & 2) {
+                TestDrv_Pump();
+            }
+        }
+
+        FX_StopSound(handle);
+
+        if (i & 1) {
+            expect(FX_UnqueueProcessed(handle, buffers, 4) == 4,
+                   "queue %d did not hand back its buffers", i);
+        }
+    }
+
+    expect(MV_CountQueueStates() <= 2, "%d queue states pooled", MV_CountQueueStates());
+
+    FX_Shutdown();
+}
+
+/*
+ * A registered decoder that switches to a format the mixer cannot play
+ * partway through a streamed file must end the stream, not overrun the
+ * worker's block.
+ */
+typedef struct {
+    int calls;
+} widestate;
+
+static short widesamples[16384 * 6];
+
+static int wide_probe(const char *ptr, unsigned int length)
+{
+    return length >= 4 && !memcmp(ptr, "WIDE", 4);
+}
+
+static int wide_open(void *state, char *ptr, unsigned int length, MV_DecoderFormat *format)
+{
+    (void)state; (void)ptr; (void)length;
+    format->rate = 44100;
+    format->channels = 1;
+    format->bits = 16;
+    return MV_Ok;
+}
+
+static int wide_decode(void *state, char **block, MV_DecoderFormat *format)
+{
+    widestate *ws = (widestate *)state;
+
+    *block = (char *)widesamples;
+    if (++ws->calls < 4) {
+        return 512;
+    }
+    format->channels = 6;
+    return 16384;
+}
+
+static const MV_Decoder widedecoder = {
+    "WIDE", wide_probe, NULL, sizeof(widestate), wide_open, wide_decode, NULL, NULL
+};
+
+static void check_stream_format(void)
+{
+    const char *filename = "check-wide.tmp";
+    FILE *fp;
+    int i, handle;
+
+    for (i = 0; i < 16384 * 6; i++) {
+        widesamples[i] = (short)(i * 7);
+    }
+
+    fp = fopen(filename, "wb");
+    if (!fp) {
+        expect(0, "could not write %s", filename);
+        return;
+    }
+    fputs("WIDE file", fp);
+    fclose(fp);
+
+    MV_RegisterDecoder(&widedecoder);
+    if (!startup()) {
+        remove(filename);
+        return;
+    }
+
+    handle = FX_PlayFile(filename, 0, 255, 255, 255, 1, 0);
+    expect(handle > 0, "file did not start: %s", FX_ErrorString(FX_Error));
+
+    for (i = 0; i < 2000 && FX_SoundActive(handle); i++) {
+        TestDrv_Pump();
+    }
+    expect(!FX_SoundActive(handle), "voice still playing after %d pages", i);
+
+    FX_Shutdown();
+    remove(filename);
+}
+
+/*
+ * Creative ADPCM in a type 9 block, carried on by a type 2 block, must
+ * play the same as the same data in a type 1 block.
+ */
+static unsigned char *voc_block(unsigned char *p, int type, unsigned int length)
+{
+    *p++ = (unsigned char)type;
+    *p++ = (unsigned char)length;
+    *p++ = (unsigned char)(length >> 8);
+    *p++ = (unsigned char)(length >> 16);
+    return p;
+}
+
+static unsigned int voc_adpcm(unsigned char *voc, int type9, const unsigned char *data,
+                              unsigned int first, unsigned int second)
+{
+    unsigned char *p = voc;
+
+    memcpy(p, "Creative Voice File\x1a\x1a\x00\x0a\x01\x29\x11", 26);
+    p += 26;
+
+    if (type9) {
+        p = voc_block(p, 9, 12 + first);
+        memset(p, 0, 12);
+        p[0] = (unsigned char)(10000 & 255);    // 10000 Hz
+        p[1] = (unsigned char)(10000 >> 8);
+        p[4] = 4;                               // bits per sample
+        p[5] = 1;                               // channels
+        p[6] = VOC_CT4_ADPCM;
+        p += 12;
+    } else {
+        p = voc_block(p, 1, 2 + first);
+        *p++ = 156;                             // 1000000 / (256 - 156) Hz
+        *p++ = VOC_CT4_ADPCM;
+    }
+    memcpy(p, data, first);
+    p += first;
+
+    p = voc_block(p, 2, second);
+    memcpy(p, data + first, second);
+    p += second;
+
+    *p++ = 0;
+    return (unsigned int)(p - voc);
+}
+
+static int voc_play(unsigned char *voc, unsigned int length, char *out, int pages)
+{
+    int i, handle, size = TestDrv_PageSize();
+
+    if (!startup()) {
+        return 0;
+    }
+
+    handle = FX_PlayVOC((char *)voc, length, 0, 255, 255, 255, 1, 0);
+    expect(handle > 0, "voc did not start: %s", FX_ErrorString(FX_Error));
+    for (i = 0; i < pages; i++) {
+        memcpy(out + i * size, TestDrv_Pump(), size);
+    }
+
+    FX_Shutdown();
+    return handle > 0;
+}
+
+static void check_voc_adpcm(void)
+{
+    static unsigned char data[3000], type1[4096], type9[4096];
+    const int pages = 128;
+    unsigned int len1, len9;
+    char *out1, *out9;
+    int i, size, loud;
+
+    for (i = 0; i < (int)sizeof(data); i++) {
+        data[i] = (unsigned char)((i * 37) ^ (i >> 3));
+    }
+    data[0] = 128;
+    len1 = voc_adpcm(type1, 0, data, 1200, 1800);
+    len9 = voc_adpcm(type9, 1, data, 1200, 1800);
+
+    size = TestDrv_PageSize();
+    out1 = calloc(pages, size);
+    out9 = calloc(pages, size);
+    if (out1 && out9 && voc_play(type1, len1, out1, pages) && voc_play(type9, len9, out9, pages)) {
+        // The type 2 block starts around page 40 and runs out around page 105
+        for (i = 64 * size / 2, loud = 0; i < 96 * size / 2; i++) {
+            loud |= ((short *)out9)[i] != 0;
+        }
+        expect(loud, "type 2 block after type 9 played silence");
+        expect(!memcmp(out1, out9, pages * size), "type 9 voc played differently from type 1");
+    }
+
+    free(out1);
+    free(out9);
+}
+
+int main(void)
+{
+    static const struct {
+        const char *name;
+        void (*run)(void);
+    } checks[] = {
+        { "queue pool", check_queue_pool },
+        { "stream format", check_stream_format },
+        { "voc type 9 adpcm", check_voc_adpcm },
+    };
+    unsigned int i;
+    int before;
+
+    for (i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        before = failures;
+        checks[i].run();
+        printf("%s %s\n", failures == before ? "ok  " : "FAIL", checks[i].name);
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/*
+ Copyright (C) 2009 Jonathon Fowler <jf@jonof.id.au>
+ 
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ 
+ See the GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ 
+ */
+
+/**
+ * Stand-in for the no-sound driver that lets the tests run the mixer
+ *
+ * Linked ahead of the library, it replaces driver_nosound.c. Nothing
+ * plays the mix buffer; TestDrv_Pump calls the mixer once and returns
+ * the page it just filled.
+ */
+
+#include "midifuncs.h"
+#include <string.h>
+
+#include "testdrv.h"
+
+static char *MixBuffer = 0;
+static int MixBufferSize = 0;
+static int MixBufferCount = 0;
+static int MixBufferCurrent = 0;
+static void (*MixCallBack)(void) = 0;
+
+char *TestDrv_Pump(void)
+{
+    if (!MixCallBack) {
+        return 0;
+    }
+
+    MixCallBack();
+    MixBufferCurrent = (MixBufferCurrent + 1) % MixBufferCount;
+
+    return MixBuffer + MixBufferCurrent * MixBufferSize;
+}
+
+int TestDrv_PageSize(void)
+{
+    return MixBufferSize;
+}
+
+int NoSoundDrv_GetError(void)
+{
+    return 0;
+}
+
+const char *NoSoundDrv_ErrorString( int ErrorNumber )
+{
+    (void)ErrorNumber;
+    return "Test driver, Ok.";
+}
+
+int NoSoundDrv_PCM_Init(int * mixrate, int * numchannels, int * samplebits, void * initdata)
+{
+    (void)mixrate; (void)numchannels; (void)samplebits; (void)initdata;
+    return 0;
+}
+
+void NoSoundDrv_PCM_Shutdown(void)
+{
+}
+
+int NoSoundDrv_PCM_BeginPlayback(char *BufferStart, int BufferSize,
+                        int NumDivisions, void ( *CallBackFunc )( void ) )
+{
+    MixBuffer = BufferStart;
+    MixBufferSize = BufferSize;
+    MixBufferCount = NumDivisions;
+    MixBufferCurrent = 0;
+    MixCallBack = CallBackFunc;
+    return 0;
+}
+
+void NoSoundDrv_PCM_StopPlayback(void)
+{
+    MixCallBack = 0;
+}
+
+void NoSoundDrv_PCM_Lock(void)
+{
+}
+
+void NoSoundDrv_PCM_Unlock(void)
+{
+}
+
+int NoSoundDrv_CD_Init(void)
+{
+    return 0;
+}
+
+void NoSoundDrv_CD_Shutdown(void)
+{
+}
+
+int NoSoundDrv_CD_Play(int track, int loop)
+{
+    (void)track; (void)loop;
+    return 0;
+}
+
+void NoSoundDrv_CD_Stop(void)
+{
+}
+
+void NoSoundDrv_CD_Pause(int pauseon)
+{
+    (void)pauseon;
+}
+
+int NoSoundDrv_CD_IsPlaying(void)
+{
+    return 0;
+}
+
+void NoSoundDrv_CD_SetVolume(int volume)
+{
+    (void)volume;
+}
+
+int NoSoundDrv_MIDI_Init(midifuncs *funcs, const char *params)
+{
+    (void)params;
+    memset(funcs, 0, sizeof(midifuncs));
+    return 0;
+}
+
+void NoSoundDrv_MIDI_Shutdown(void)
+{
+}
+
+int  NoSoundDrv_MIDI_StartPlayback(void (*service)(void))
+{
+    (void)service;
+    return 0;
+}
+
+void NoSoundDrv_MIDI_HaltPlayback(void)
+{
+}
+
+unsigned int NoSoundDrv_MIDI_GetTick(void)
+{
+    return 0;
+}
+
+void NoSoundDrv_MIDI_SetTempo(int tempo, int division)
+{
+    (void)tempo; (void)division;
+}
+
+void NoSoundDrv_MIDI_Lock(void)
+{
+}
+
+void NoSoundDrv_MIDI_Unlock(void)
+{
+}